@@ -238,7 +238,158 @@ void radv_DestroyPipelineLayout(
 	vk_free2(&device->alloc, pAllocator, pipeline_layout);
 }
 
-#define EMPTY 1
+static void
+radv_descriptor_pool_bin_add(struct radv_descriptor_pool *pool, int index)
+{
+	struct radv_descriptor_pool_entry *entry = &pool->entries[index];
+	unsigned bin = util_logbase2(entry->size / 32);
+
+	entry->free = true;
+	entry->free_prev = -1;
+	entry->free_next = pool->free_bins[bin];
+	if (entry->free_next >= 0)
+		pool->entries[entry->free_next].free_prev = index;
+	pool->free_bins[bin] = index;
+	pool->free_bins_mask |= 1u << bin;
+}
+
+static void
+radv_descriptor_pool_bin_remove(struct radv_descriptor_pool *pool, int index)
+{
+	struct radv_descriptor_pool_entry *entry = &pool->entries[index];
+	unsigned bin = util_logbase2(entry->size / 32);
+
+	if (entry->free_prev >= 0)
+		pool->entries[entry->free_prev].free_next = entry->free_next;
+	else
+		pool->free_bins[bin] = entry->free_next;
+	if (entry->free_next >= 0)
+		pool->entries[entry->free_next].free_prev = entry->free_prev;
+
+	if (pool->free_bins[bin] < 0)
+		pool->free_bins_mask &= ~(1u << bin);
+	entry->free = false;
+}
+
+static void
+radv_descriptor_pool_release_entry(struct radv_descriptor_pool *pool, int index)
+{
+	pool->entries[index].free_next = pool->unused_entries;
+	pool->unused_entries = index;
+}
+
+static void
+radv_descriptor_pool_reset_entries(struct radv_descriptor_pool *pool)
+{
+	pool->free_bins_mask = 0;
+	for (unsigned i = 0; i < RADV_DESCRIPTOR_POOL_BINS; ++i)
+		pool->free_bins[i] = -1;
+
+	pool->unused_entries = -1;
+	for (int i = pool->max_entries - 1; i >= 0; --i)
+		radv_descriptor_pool_release_entry(pool, i);
+
+	if (pool->size) {
+		int index = pool->unused_entries;
+		struct radv_descriptor_pool_entry *entry = &pool->entries[index];
+
+		pool->unused_entries = entry->free_next;
+		entry->offset = 0;
+		entry->size = pool->size;
+		entry->prev = entry->next = -1;
+		radv_descriptor_pool_bin_add(pool, index);
+	}
+}
+
+/* Allocates size bytes of pool memory and returns the entry tracking them,
+ * or -1.  Ranges larger than the size are taken from the first non-empty
+ * bin that only holds large enough ranges, so this is constant time unless
+ * the only candidates share the bin of the size.
+ */
+static int
+radv_descriptor_pool_alloc(struct radv_descriptor_pool *pool, uint32_t size)
+{
+	uint32_t units = DIV_ROUND_UP(size, 32);
+	unsigned bin = util_logbase2(units);
+	unsigned first_bin = bin + !util_is_power_of_two(units);
+	uint32_t mask = first_bin < RADV_DESCRIPTOR_POOL_BINS ?
+		pool->free_bins_mask & ~((1u << first_bin) - 1) : 0;
+	int index = -1;
+
+	size = units * 32;
+
+	if (mask) {
+		index = pool->free_bins[ffs(mask) - 1];
+	} else {
+		for (int i = pool->free_bins[bin]; i >= 0; i = pool->entries[i].free_next) {
+			if (pool->entries[i].size >= size) {
+				index = i;
+				break;
+			}
+		}
+	}
+
+	if (index < 0)
+		return -1;
+
+	struct radv_descriptor_pool_entry *entry = &pool->entries[index];
+	radv_descriptor_pool_bin_remove(pool, index);
+
+	/* Return the tail to the pool.  There are enough entries for every
+	 * set plus the free ranges between them, but keep the whole range
+	 * rather than crash if that ever fails to hold.
+	 */
+	if (entry->size > size && pool->unused_entries >= 0) {
+		int tail_index = pool->unused_entries;
+		struct radv_descriptor_pool_entry *tail = &pool->entries[tail_index];
+
+		pool->unused_entries = tail->free_next;
+		tail->offset = entry->offset + size;
+		tail->size = entry->size - size;
+		tail->prev = index;
+		tail->next = entry->next;
+		if (tail->next >= 0)
+			pool->entries[tail->next].prev = tail_index;
+		entry->next = tail_index;
+		entry->size = size;
+		radv_descriptor_pool_bin_add(pool, tail_index);
+	}
+
+	return index;
+}
+
+/* Returns the range of an entry to the pool, merging it with free
+ * neighbours so that no two adjacent ranges are ever free.
+ */
+static void
+radv_descriptor_pool_free(struct radv_descriptor_pool *pool, int index)
+{
+	struct radv_descriptor_pool_entry *entry = &pool->entries[index];
+	int next = entry->next, prev = entry->prev;
+
+	assert(!entry->free);
+
+	if (next >= 0 && pool->entries[next].free) {
+		radv_descriptor_pool_bin_remove(pool, next);
+		entry->size += pool->entries[next].size;
+		entry->next = pool->entries[next].next;
+		if (entry->next >= 0)
+			pool->entries[entry->next].prev = index;
+		radv_descriptor_pool_release_entry(pool, next);
+	}
+
+	if (prev >= 0 && pool->entries[prev].free) {
+		radv_descriptor_pool_bin_remove(pool, prev);
+		pool->entries[prev].size += entry->size;
+		pool->entries[prev].next = entry->next;
+		if (entry->next >= 0)
+			pool->entries[entry->next].prev = prev;
+		radv_descriptor_pool_release_entry(pool, index);
+		index = prev;
+	}
+
+	radv_descriptor_pool_bin_add(pool, index);
+}
 
 static VkResult
 radv_descriptor_set_create(struct radv_device *device,
@@ -248,72 +399,58 @@ radv_descriptor_set_create(struct radv_device *device,
 			   struct radv_descriptor_set **out_set)
 {
 	struct radv_descriptor_set *set;
-	unsigned mem_size = sizeof(struct radv_descriptor_set) +
+	unsigned range_offset = sizeof(struct radv_descriptor_set) +
 		sizeof(struct radeon_winsys_bo *) * layout->buffer_count;
-	set = vk_alloc2(&device->alloc, NULL, mem_size, 8,
-			  VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
-
-	if (!set)
-		return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
-
-	memset(set, 0, mem_size);
+	unsigned mem_size = range_offset +
+		sizeof(struct radv_descriptor_range) * layout->dynamic_offset_count;
+
+	/* The set, its buffer list and its dynamic descriptors share a single
+	 * allocation, carved from the pool when sets are never freed one by
+	 * one.
+	 */
+	if (pool && pool->host_memory_base) {
+		if (pool->host_memory_end - pool->host_memory_ptr < mem_size)
+			return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
 
-	if (layout->dynamic_offset_count) {
-		unsigned size = sizeof(struct radv_descriptor_range) *
-		                layout->dynamic_offset_count;
-		set->dynamic_descriptors = vk_alloc2(&device->alloc, NULL, size, 8,
-			                               VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+		set = (struct radv_descriptor_set *)pool->host_memory_ptr;
+		pool->host_memory_ptr += align_u32(mem_size, 8);
+	} else {
+		set = vk_alloc2(&device->alloc, NULL, mem_size, 8,
+				VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
 
-		if (!set->dynamic_descriptors) {
-			vk_free2(&device->alloc, NULL, set);
+		if (!set)
 			return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
-		}
 	}
 
+	memset(set, 0, mem_size);
+	set->pool_entry = -1;
+
+	if (layout->dynamic_offset_count)
+		set->dynamic_descriptors = (struct radv_descriptor_range *)
+			((uint8_t *)set + range_offset);
+
 	set->layout = layout;
 	if (layout->size) {
 		uint32_t layout_size = align_u32(layout->size, 32);
 		set->size = layout->size;
 		if (!cmd_buffer) {
-			if (pool->current_offset + layout_size <= pool->size) {
-				set->bo = pool->bo;
-				set->mapped_ptr = (uint32_t*)(pool->mapped_ptr + pool->current_offset);
-				set->va = device->ws->buffer_get_va(set->bo) + pool->current_offset;
-				pool->current_offset += layout_size;
-
-			} else {
-				int entry = pool->free_list, prev_entry = -1;
-				uint32_t offset;
-				while (entry >= 0) {
-					if (pool->free_nodes[entry].size >= layout_size) {
-						if (prev_entry >= 0)
-							pool->free_nodes[prev_entry].next = pool->free_nodes[entry].next;
-						else
-							pool->free_list = pool->free_nodes[entry].next;
-						break;
-					}
-					prev_entry = entry;
-					entry = pool->free_nodes[entry].next;
-				}
-
-				if (entry < 0) {
+			int entry = radv_descriptor_pool_alloc(pool, layout_size);
+			if (entry < 0) {
+				if (!pool->host_memory_base)
 					vk_free2(&device->alloc, NULL, set);
-					return vk_error(VK_ERROR_OUT_OF_DEVICE_MEMORY);
-				}
-				offset = pool->free_nodes[entry].offset;
-				pool->free_nodes[entry].next = pool->full_list;
-				pool->full_list = entry;
-
-				set->bo = pool->bo;
-				set->mapped_ptr = (uint32_t*)(pool->mapped_ptr + offset);
-				set->va = device->ws->buffer_get_va(set->bo) + offset;
+				return vk_error(VK_ERROR_OUT_OF_DEVICE_MEMORY);
 			}
+
+			uint32_t offset = pool->entries[entry].offset;
+			set->pool_entry = entry;
+			set->bo = pool->bo;
+			set->mapped_ptr = (uint32_t*)(pool->mapped_ptr + offset);
+			set->va = device->ws->buffer_get_va(set->bo) + offset;
 		} else {
 			unsigned bo_offset;
 			if (!radv_cmd_buffer_upload_alloc(cmd_buffer, set->size, 32,
 							  &bo_offset,
 							  (void**)&set->mapped_ptr)) {
-				vk_free2(&device->alloc, NULL, set->dynamic_descriptors);
 				vk_free2(&device->alloc, NULL, set);
 				return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
 			}
@@ -354,20 +491,12 @@ radv_descriptor_set_destroy(struct radv_device *device,
 			    struct radv_descriptor_set *set,
 			    bool free_bo)
 {
-	if (free_bo && set->size) {
-		assert(pool->full_list >= 0);
-		int next = pool->free_nodes[pool->full_list].next;
-		pool->free_nodes[pool->full_list].next = pool->free_list;
-		pool->free_nodes[pool->full_list].offset = (uint8_t*)set->mapped_ptr - pool->mapped_ptr;
-		pool->free_nodes[pool->full_list].size = align_u32(set->size, 32);
-		pool->free_list = pool->full_list;
-		pool->full_list = next;
-	}
-	if (set->dynamic_descriptors)
-		vk_free2(&device->alloc, NULL, set->dynamic_descriptors);
+	if (free_bo && set->pool_entry >= 0)
+		radv_descriptor_pool_free(pool, set->pool_entry);
 	if (!list_empty(&set->descriptor_pool))
 		list_del(&set->descriptor_pool);
-	vk_free2(&device->alloc, NULL, set);
+	if (!pool || !pool->host_memory_base)
+		vk_free2(&device->alloc, NULL, set);
 }
 
 VkResult
@@ -402,29 +531,23 @@ VkResult radv_CreateDescriptorPool(
 {
 	RADV_FROM_HANDLE(radv_device, device, _device);
 	struct radv_descriptor_pool *pool;
-	unsigned max_sets = pCreateInfo->maxSets * 2;
-	int size = sizeof(struct radv_descriptor_pool) +
-	           max_sets * sizeof(struct radv_descriptor_pool_free_node);
+	/* One entry per set, plus the free ranges between them. */
+	unsigned max_entries = pCreateInfo->maxSets * 2 + 1;
+	uint64_t size = align_u64(sizeof(struct radv_descriptor_pool) +
+	                          max_entries * sizeof(struct radv_descriptor_pool_entry),
+	                          8);
+	uint64_t host_size = 0;
 	uint64_t bo_size = 0;
-	pool = vk_alloc2(&device->alloc, pAllocator, size, 8,
-			   VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
-	if (!pool)
-		return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
-
-	memset(pool, 0, sizeof(*pool));
-
-	pool->free_list = -1;
-	pool->full_list = 0;
-	pool->free_nodes[max_sets - 1].next = -1;
-	pool->max_sets = max_sets;
-
-	for (int i = 0; i  + 1 < max_sets; ++i)
-		pool->free_nodes[i].next = i + 1;
+	unsigned buffer_count = 0, range_count = 0;
 
 	for (unsigned i = 0; i < pCreateInfo->poolSizeCount; ++i) {
+		if (pCreateInfo->pPoolSizes[i].type != VK_DESCRIPTOR_TYPE_SAMPLER)
+			buffer_count += pCreateInfo->pPoolSizes[i].descriptorCount;
+
 		switch(pCreateInfo->pPoolSizes[i].type) {
 		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
 		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+			range_count += pCreateInfo->pPoolSizes[i].descriptorCount;
 			break;
 		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
 		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
@@ -448,12 +571,38 @@ VkResult radv_CreateDescriptorPool(
 		}
 	}
 
+	/* Sets that can't be freed individually are allocated linearly from
+	 * host memory owned by the pool.
+	 */
+	if (!(pCreateInfo->flags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)) {
+		host_size = pCreateInfo->maxSets *
+		            align_u32(sizeof(struct radv_descriptor_set), 8) +
+		            buffer_count * sizeof(struct radeon_winsys_bo *) +
+		            range_count * sizeof(struct radv_descriptor_range);
+		size += host_size;
+	}
+
+	pool = vk_alloc2(&device->alloc, pAllocator, size, 8,
+			   VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+	if (!pool)
+		return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
+
+	memset(pool, 0, sizeof(*pool));
+
+	if (host_size) {
+		pool->host_memory_base = (uint8_t *)pool + size - host_size;
+		pool->host_memory_ptr = pool->host_memory_base;
+		pool->host_memory_end = pool->host_memory_base + host_size;
+	}
+
 	if (bo_size) {
 		pool->bo = device->ws->buffer_create(device->ws, bo_size,
 							32, RADEON_DOMAIN_VRAM, 0);
 		pool->mapped_ptr = (uint8_t*)device->ws->buffer_map(pool->bo);
 	}
 	pool->size = bo_size;
+	pool->max_entries = max_entries;
+	radv_descriptor_pool_reset_entries(pool);
 
 	list_inithead(&pool->descriptor_sets);
 	*pDescriptorPool = radv_descriptor_pool_to_handle(pool);
@@ -494,13 +643,8 @@ VkResult radv_ResetDescriptorPool(
 		radv_descriptor_set_destroy(device, pool, set, false);
 	}
 
-	pool->current_offset = 0;
-	pool->free_list = -1;
-	pool->full_list = 0;
-	pool->free_nodes[pool->max_sets - 1].next = -1;
-
-	for (int i = 0; i  + 1 < pool->max_sets; ++i)
-		pool->free_nodes[i].next = i + 1;
+	pool->host_memory_ptr = pool->host_memory_base;
+	radv_descriptor_pool_reset_entries(pool);
 
 	return VK_SUCCESS;
 }
@@ -715,3 +859,139 @@ void radv_UpdateDescriptorSets(
 	if (descriptorCopyCount)
 		radv_finishme("copy descriptors");
 }
+
+VkResult radv_CreateDescriptorUpdateTemplateKHR(
+	VkDevice                                    _device,
+	const VkDescriptorUpdateTemplateCreateInfoKHR* pCreateInfo,
+	const VkAllocationCallbacks*                pAllocator,
+	VkDescriptorUpdateTemplateKHR*              pDescriptorUpdateTemplate)
+{
+	RADV_FROM_HANDLE(radv_device, device, _device);
+	RADV_FROM_HANDLE(radv_descriptor_set_layout, set_layout,
+			 pCreateInfo->descriptorSetLayout);
+	const uint32_t entry_count = pCreateInfo->descriptorUpdateEntryCount;
+	const size_t size = sizeof(struct radv_descriptor_update_template) +
+		sizeof(struct radv_descriptor_update_template_entry) * entry_count;
+	struct radv_descriptor_update_template *templ;
+
+	assert(pCreateInfo->templateType ==
+	       VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR);
+
+	templ = vk_alloc2(&device->alloc, pAllocator, size, 8,
+			  VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+	if (!templ)
+		return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
+
+	/* Resolve the bindings up front, so that updates are plain copies
+	 * from the application's data into the set.
+	 */
+	templ->entry_count = entry_count;
+	for (uint32_t i = 0; i < entry_count; i++) {
+		const VkDescriptorUpdateTemplateEntryKHR *entry =
+			&pCreateInfo->pDescriptorUpdateEntries[i];
+		const struct radv_descriptor_set_binding_layout *binding_layout =
+			set_layout->binding + entry->dstBinding;
+
+		assert(entry->descriptorType == binding_layout->type);
+
+		templ->entry[i] = (struct radv_descriptor_update_template_entry) {
+			.descriptor_type = entry->descriptorType,
+			.descriptor_count = entry->descriptorCount,
+			.dst_offset = (binding_layout->offset +
+				       binding_layout->size * entry->dstArrayElement) / 4,
+			.dst_stride = binding_layout->size / 4,
+			.buffer_offset = binding_layout->buffer_offset +
+				binding_layout->buffer_count * entry->dstArrayElement,
+			.buffer_count = binding_layout->buffer_count,
+			.dynamic_offset = binding_layout->dynamic_offset_offset +
+				entry->dstArrayElement,
+			.has_sampler = !binding_layout->immutable_samplers,
+			.src_offset = entry->offset,
+			.src_stride = entry->stride,
+		};
+	}
+
+	*pDescriptorUpdateTemplate = radv_descriptor_update_template_to_handle(templ);
+	return VK_SUCCESS;
+}
+
+void radv_DestroyDescriptorUpdateTemplateKHR(
+	VkDevice                                    _device,
+	VkDescriptorUpdateTemplateKHR               descriptorUpdateTemplate,
+	const VkAllocationCallbacks*                pAllocator)
+{
+	RADV_FROM_HANDLE(radv_device, device, _device);
+	RADV_FROM_HANDLE(radv_descriptor_update_template, templ,
+			 descriptorUpdateTemplate);
+
+	if (!templ)
+		return;
+
+	vk_free2(&device->alloc, pAllocator, templ);
+}
+
+void radv_UpdateDescriptorSetWithTemplateKHR(
+	VkDevice                                    _device,
+	VkDescriptorSet                             descriptorSet,
+	VkDescriptorUpdateTemplateKHR               descriptorUpdateTemplate,
+	const void*                                 pData)
+{
+	RADV_FROM_HANDLE(radv_device, device, _device);
+	RADV_FROM_HANDLE(radv_descriptor_set, set, descriptorSet);
+	RADV_FROM_HANDLE(radv_descriptor_update_template, templ,
+			 descriptorUpdateTemplate);
+	uint32_t i, j;
+
+	for (i = 0; i < templ->entry_count; ++i) {
+		const struct radv_descriptor_update_template_entry *entry =
+			&templ->entry[i];
+		struct radeon_winsys_bo **buffer_list =
+			set->descriptors + entry->buffer_offset;
+		uint32_t *ptr = set->mapped_ptr + entry->dst_offset;
+		const uint8_t *src = (const uint8_t *)pData + entry->src_offset;
+
+		for (j = 0; j < entry->descriptor_count; ++j) {
+			switch (entry->descriptor_type) {
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+				write_dynamic_buffer_descriptor(device,
+								set->dynamic_descriptors + entry->dynamic_offset + j,
+								buffer_list,
+								(const VkDescriptorBufferInfo *)src);
+				break;
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+				write_buffer_descriptor(device, ptr, buffer_list,
+							(const VkDescriptorBufferInfo *)src);
+				break;
+			case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+			case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+				write_texel_buffer_descriptor(device, ptr, buffer_list,
+							      *(const VkBufferView *)src);
+				break;
+			case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+			case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+			case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+				write_image_descriptor(device, ptr, buffer_list,
+						       (const VkDescriptorImageInfo *)src);
+				break;
+			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+				write_combined_image_sampler_descriptor(device, ptr, buffer_list,
+									(const VkDescriptorImageInfo *)src,
+									entry->has_sampler);
+				break;
+			case VK_DESCRIPTOR_TYPE_SAMPLER:
+				assert(entry->has_sampler);
+				write_sampler_descriptor(device, ptr,
+							 (const VkDescriptorImageInfo *)src);
+				break;
+			default:
+				unreachable("unimplemented descriptor type");
+				break;
+			}
+			src += entry->src_stride;
+			ptr += entry->dst_stride;
+			buffer_list += entry->buffer_count;
+		}
+	}
+}
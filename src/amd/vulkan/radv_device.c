@@ -189,6 +189,10 @@ static const VkExtensionProperties device_extensions[] = {
 		.extensionName = VK_AMD_NEGATIVE_VIEWPORT_HEIGHT_EXTENSION_NAME,
 		.specVersion = 1,
 	},
+	{
+		.extensionName = VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+		.specVersion = 1,
+	},
 };
 
 static void *
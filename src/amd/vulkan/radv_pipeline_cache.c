@@ -44,37 +44,46 @@ void
 radv_pipeline_cache_init(struct radv_pipeline_cache *cache,
 			 struct radv_device *device)
 {
-	cache->device = device;
-	pthread_mutex_init(&cache->mutex, NULL);
+	bool enabled = env_var_as_boolean("RADV_ENABLE_PIPELINE_CACHE", true);
 
+	cache->device = device;
 	cache->modified = false;
-	cache->kernel_count = 0;
 	cache->total_size = 0;
-	cache->table_size = 1024;
-	const size_t byte_size = cache->table_size * sizeof(cache->hash_table[0]);
-	cache->hash_table = malloc(byte_size);
-
-	/* We don't consider allocation failure fatal, we just start with a 0-sized
-	 * cache. */
-	if (cache->hash_table == NULL ||
-	    !env_var_as_boolean("RADV_ENABLE_PIPELINE_CACHE", true))
-		cache->table_size = 0;
-	else
-		memset(cache->hash_table, 0, byte_size);
+
+	for (unsigned i = 0; i < RADV_PIPELINE_CACHE_SHARDS; ++i) {
+		struct radv_pipeline_cache_shard *shard = &cache->shards[i];
+
+		pthread_mutex_init(&shard->mutex, NULL);
+		shard->kernel_count = 0;
+		shard->table_size = 64;
+		const size_t byte_size = shard->table_size * sizeof(shard->hash_table[0]);
+		shard->hash_table = enabled ? malloc(byte_size) : NULL;
+
+		/* We don't consider allocation failure fatal, we just start with a
+		 * 0-sized shard. */
+		if (shard->hash_table == NULL)
+			shard->table_size = 0;
+		else
+			memset(shard->hash_table, 0, byte_size);
+	}
 }
 
 void
 radv_pipeline_cache_finish(struct radv_pipeline_cache *cache)
 {
-	for (unsigned i = 0; i < cache->table_size; ++i)
-		if (cache->hash_table[i]) {
-			if (cache->hash_table[i]->variant)
-				radv_shader_variant_destroy(cache->device,
-							    cache->hash_table[i]->variant);
-			vk_free(&cache->alloc, cache->hash_table[i]);
-		}
-	pthread_mutex_destroy(&cache->mutex);
-	free(cache->hash_table);
+	for (unsigned s = 0; s < RADV_PIPELINE_CACHE_SHARDS; ++s) {
+		struct radv_pipeline_cache_shard *shard = &cache->shards[s];
+
+		for (unsigned i = 0; i < shard->table_size; ++i)
+			if (shard->hash_table[i]) {
+				if (shard->hash_table[i]->variant)
+					radv_shader_variant_destroy(cache->device,
+								    shard->hash_table[i]->variant);
+				vk_free(&cache->alloc, shard->hash_table[i]);
+			}
+		pthread_mutex_destroy(&shard->mutex);
+		free(shard->hash_table);
+	}
 }
 
 static uint32_t
@@ -108,16 +117,27 @@ radv_hash_shader(unsigned char *hash, struct radv_shader_module *module,
 }
 
 
+static struct radv_pipeline_cache_shard *
+radv_pipeline_cache_get_shard(struct radv_pipeline_cache *cache,
+			      const unsigned char *sha1)
+{
+	/* The first dword picks the slot within the shard. */
+	return &cache->shards[sha1[4] % RADV_PIPELINE_CACHE_SHARDS];
+}
+
 static struct cache_entry *
-radv_pipeline_cache_search_unlocked(struct radv_pipeline_cache *cache,
+radv_pipeline_cache_search_unlocked(struct radv_pipeline_cache_shard *shard,
 				    const unsigned char *sha1)
 {
-	const uint32_t mask = cache->table_size - 1;
+	const uint32_t mask = shard->table_size - 1;
 	const uint32_t start = (*(uint32_t *) sha1);
 
-	for (uint32_t i = 0; i < cache->table_size; i++) {
+	if (shard->table_size == 0)
+		return NULL;
+
+	for (uint32_t i = 0; i < shard->table_size; i++) {
 		const uint32_t index = (start + i) & mask;
-		struct cache_entry *entry = cache->hash_table[index];
+		struct cache_entry *entry = shard->hash_table[index];
 
 		if (!entry)
 			return NULL;
@@ -130,37 +150,30 @@ radv_pipeline_cache_search_unlocked(struct radv_pipeline_cache *cache,
 	unreachable("hash table should never be full");
 }
 
-static struct cache_entry *
-radv_pipeline_cache_search(struct radv_pipeline_cache *cache,
-			   const unsigned char *sha1)
-{
-	struct cache_entry *entry;
-
-	pthread_mutex_lock(&cache->mutex);
-
-	entry = radv_pipeline_cache_search_unlocked(cache, sha1);
-
-	pthread_mutex_unlock(&cache->mutex);
-
-	return entry;
-}
-
 struct radv_shader_variant *
 radv_create_shader_variant_from_pipeline_cache(struct radv_device *device,
 					       struct radv_pipeline_cache *cache,
 					       const unsigned char *sha1)
 {
-	struct cache_entry *entry = radv_pipeline_cache_search(cache, sha1);
+	struct radv_pipeline_cache_shard *shard =
+		radv_pipeline_cache_get_shard(cache, sha1);
+	struct radv_shader_variant *variant = NULL;
+	struct cache_entry *entry;
 
+	pthread_mutex_lock(&shard->mutex);
+
+	entry = radv_pipeline_cache_search_unlocked(shard, sha1);
 	if (!entry)
-		return NULL;
+		goto out;
 
+	/* Entries loaded from pipeline cache data don't have a variant until
+	 * they're first used.  It's created under the lock, so two threads don't
+	 * race to create it.
+	 */
 	if (!entry->variant) {
-		struct radv_shader_variant *variant;
-
 		variant = calloc(1, sizeof(struct radv_shader_variant));
 		if (!variant)
-			return NULL;
+			goto out;
 
 		variant->config = entry->config;
 		variant->info = entry->variant_info;
@@ -178,59 +191,64 @@ radv_create_shader_variant_from_pipeline_cache(struct radv_device *device,
 		entry->variant = variant;
 	}
 
-	__sync_fetch_and_add(&entry->variant->ref_count, 1);
-	return entry->variant;
+	variant = entry->variant;
+	__sync_fetch_and_add(&variant->ref_count, 1);
+
+out:
+	pthread_mutex_unlock(&shard->mutex);
+	return variant;
 }
 
 
 static void
-radv_pipeline_cache_set_entry(struct radv_pipeline_cache *cache,
+radv_pipeline_cache_set_entry(struct radv_pipeline_cache_shard *shard,
 			      struct cache_entry *entry)
 {
-	const uint32_t mask = cache->table_size - 1;
+	const uint32_t mask = shard->table_size - 1;
 	const uint32_t start = entry->sha1_dw[0];
 
 	/* We'll always be able to insert when we get here. */
-	assert(cache->kernel_count < cache->table_size / 2);
+	assert(shard->kernel_count < shard->table_size / 2);
 
-	for (uint32_t i = 0; i < cache->table_size; i++) {
+	for (uint32_t i = 0; i < shard->table_size; i++) {
 		const uint32_t index = (start + i) & mask;
-		if (!cache->hash_table[index]) {
-			cache->hash_table[index] = entry;
+		if (!shard->hash_table[index]) {
+			shard->hash_table[index] = entry;
 			break;
 		}
 	}
 
-	cache->total_size += entry_size(entry);
-	cache->kernel_count++;
+	shard->kernel_count++;
 }
 
 
 static VkResult
-radv_pipeline_cache_grow(struct radv_pipeline_cache *cache)
+radv_pipeline_cache_grow(struct radv_pipeline_cache_shard *shard)
 {
-	const uint32_t table_size = cache->table_size * 2;
-	const uint32_t old_table_size = cache->table_size;
-	const size_t byte_size = table_size * sizeof(cache->hash_table[0]);
+	const uint32_t table_size = shard->table_size * 2;
+	const uint32_t old_table_size = shard->table_size;
+	const size_t byte_size = table_size * sizeof(shard->hash_table[0]);
 	struct cache_entry **table;
-	struct cache_entry **old_table = cache->hash_table;
+	struct cache_entry **old_table = shard->hash_table;
+
+	if (table_size == 0)
+		return VK_ERROR_OUT_OF_HOST_MEMORY;
 
 	table = malloc(byte_size);
 	if (table == NULL)
 		return VK_ERROR_OUT_OF_HOST_MEMORY;
 
-	cache->hash_table = table;
-	cache->table_size = table_size;
-	cache->kernel_count = 0;
-	cache->total_size = 0;
+	shard->hash_table = table;
+	shard->table_size = table_size;
+	shard->kernel_count = 0;
 
-	memset(cache->hash_table, 0, byte_size);
+	memset(shard->hash_table, 0, byte_size);
 	for (uint32_t i = 0; i < old_table_size; i++) {
 		struct cache_entry *entry = old_table[i];
 		if (!entry)
 			continue;
 
-		radv_pipeline_cache_set_entry(cache, entry);
+		radv_pipeline_cache_set_entry(shard, entry);
 	}
 
 	free(old_table);
@@ -238,18 +256,27 @@ radv_pipeline_cache_grow(struct radv_pipeline_cache *cache)
 	return VK_SUCCESS;
 }
 
-static void
+/**
+ * Add an entry to its shard, whose lock must be held.  Returns false if
+ * there's no room for it, in which case the caller still owns the entry.
+ */
+static bool
 radv_pipeline_cache_add_entry(struct radv_pipeline_cache *cache,
+			      struct radv_pipeline_cache_shard *shard,
 			      struct cache_entry *entry)
 {
-	if (cache->kernel_count == cache->table_size / 2)
-		radv_pipeline_cache_grow(cache);
+	if (shard->kernel_count == shard->table_size / 2)
+		radv_pipeline_cache_grow(shard);
 
 	/* Failing to grow that hash table isn't fatal, but may mean we don't
 	 * have enough space to add this new kernel. Only add it if there's room.
 	 */
-	if (cache->kernel_count < cache->table_size / 2)
-		radv_pipeline_cache_set_entry(cache, entry);
+	if (shard->kernel_count >= shard->table_size / 2)
+		return false;
+
+	radv_pipeline_cache_set_entry(shard, entry);
+	__sync_fetch_and_add(&cache->total_size, entry_size(entry));
+	return true;
 }
 
 struct radv_shader_variant *
@@ -258,8 +285,11 @@ radv_pipeline_cache_insert_shader(struct radv_pipeline_cache *cache,
 				  struct radv_shader_variant *variant,
 				  const void *code, unsigned code_size)
 {
-	pthread_mutex_lock(&cache->mutex);
-	struct cache_entry *entry = radv_pipeline_cache_search_unlocked(cache, sha1);
+	struct radv_pipeline_cache_shard *shard =
+		radv_pipeline_cache_get_shard(cache, sha1);
+
+	pthread_mutex_lock(&shard->mutex);
+	struct cache_entry *entry = radv_pipeline_cache_search_unlocked(shard, sha1);
 	if (entry) {
 		if (entry->variant) {
 			radv_shader_variant_destroy(cache->device, variant);
@@ -268,14 +298,14 @@ radv_pipeline_cache_insert_shader(struct radv_pipeline_cache *cache,
 			entry->variant = variant;
 		}
 		__sync_fetch_and_add(&variant->ref_count, 1);
-		pthread_mutex_unlock(&cache->mutex);
+		pthread_mutex_unlock(&shard->mutex);
 		return variant;
 	}
 
 	entry = vk_alloc(&cache->alloc, sizeof(*entry) + code_size, 8,
 			   VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
 	if (!entry) {
-		pthread_mutex_unlock(&cache->mutex);
+		pthread_mutex_unlock(&shard->mutex);
 		return variant;
 	}
 
@@ -287,12 +317,16 @@ radv_pipeline_cache_insert_shader(struct radv_pipeline_cache *cache,
 	entry->rsrc2 = variant->rsrc2;
 	entry->code_size = code_size;
 	entry->variant = variant;
-	__sync_fetch_and_add(&variant->ref_count, 1);
 
-	radv_pipeline_cache_add_entry(cache, entry);
+	if (!radv_pipeline_cache_add_entry(cache, shard, entry)) {
+		vk_free(&cache->alloc, entry);
+		pthread_mutex_unlock(&shard->mutex);
+		return variant;
+	}
 
-	cache->modified = true;
-	pthread_mutex_unlock(&cache->mutex);
+	__sync_fetch_and_add(&variant->ref_count, 1);
+	(void) __sync_lock_test_and_set(&cache->modified, true);
+	pthread_mutex_unlock(&shard->mutex);
 	return variant;
 }
 
@@ -337,9 +371,17 @@ radv_pipeline_cache_load(struct radv_pipeline_cache *cache,
 		dest_entry = vk_alloc(&cache->alloc, sizeof(*entry) + entry->code_size,
 					8, VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
 		if (dest_entry) {
+			struct radv_pipeline_cache_shard *shard =
+				radv_pipeline_cache_get_shard(cache, entry->sha1);
+
 			memcpy(dest_entry, entry, sizeof(*entry) + entry->code_size);
 			dest_entry->variant = NULL;
-			radv_pipeline_cache_add_entry(cache, dest_entry);
+
+			pthread_mutex_lock(&shard->mutex);
+			if (radv_pipeline_cache_search_unlocked(shard, dest_entry->sha1) ||
+			    !radv_pipeline_cache_add_entry(cache, shard, dest_entry))
+				vk_free(&cache->alloc, dest_entry);
+			pthread_mutex_unlock(&shard->mutex);
 		}
 		p += sizeof (*entry) + entry->code_size;
 	}
@@ -425,38 +467,91 @@ VkResult radv_GetPipelineCacheData(
 	memcpy(header->uuid, pdevice->uuid, VK_UUID_SIZE);
 	p += header->header_size;
 
-	struct cache_entry *entry;
-	for (uint32_t i = 0; i < cache->table_size; i++) {
-		if (!cache->hash_table[i])
-			continue;
-		entry = cache->hash_table[i];
-		const uint32_t size = entry_size(entry);
-		if (end < p + size) {
-			result = VK_INCOMPLETE;
-			break;
+	for (unsigned s = 0; s < RADV_PIPELINE_CACHE_SHARDS &&
+			     result == VK_SUCCESS; s++) {
+		struct radv_pipeline_cache_shard *shard = &cache->shards[s];
+
+		pthread_mutex_lock(&shard->mutex);
+		for (uint32_t i = 0; i < shard->table_size; i++) {
+			struct cache_entry *entry = shard->hash_table[i];
+			if (!entry)
+				continue;
+			const uint32_t size = entry_size(entry);
+			if (end < p + size) {
+				result = VK_INCOMPLETE;
+				break;
+			}
+
+			memcpy(p, entry, size);
+			((struct cache_entry*)p)->variant = NULL;
+			p += size;
 		}
-
-		memcpy(p, entry, size);
-		((struct cache_entry*)p)->variant = NULL;
-		p += size;
+		pthread_mutex_unlock(&shard->mutex);
 	}
 	*pDataSize = p - pData;
 
 	return result;
 }
 
+/**
+ * Lock two shards in address order, so that merges running in opposite
+ * directions at the same time can't deadlock.
+ */
+static void
+radv_pipeline_cache_lock_shard_pair(struct radv_pipeline_cache_shard *a,
+				    struct radv_pipeline_cache_shard *b)
+{
+	if ((uintptr_t)a > (uintptr_t)b) {
+		struct radv_pipeline_cache_shard *tmp = a;
+		a = b;
+		b = tmp;
+	}
+
+	pthread_mutex_lock(&a->mutex);
+	pthread_mutex_lock(&b->mutex);
+}
+
+/**
+ * Copy the entries of src missing from dst.  Entries can't be moved out of
+ * src, since removing them would break its probe sequences.  The shards of
+ * both caches use the same sha1 bits, so each src shard only feeds the
+ * matching dst shard.
+ */
 static void
 radv_pipeline_cache_merge(struct radv_pipeline_cache *dst,
 			  struct radv_pipeline_cache *src)
 {
-	for (uint32_t i = 0; i < src->table_size; i++) {
-		struct cache_entry *entry = src->hash_table[i];
-		if (!entry || radv_pipeline_cache_search(dst, entry->sha1))
-			continue;
-
-		radv_pipeline_cache_add_entry(dst, entry);
+	for (unsigned s = 0; s < RADV_PIPELINE_CACHE_SHARDS; s++) {
+		struct radv_pipeline_cache_shard *src_shard = &src->shards[s];
+		struct radv_pipeline_cache_shard *dst_shard = &dst->shards[s];
+
+		radv_pipeline_cache_lock_shard_pair(src_shard, dst_shard);
+
+		for (uint32_t i = 0; i < src_shard->table_size; i++) {
+			struct cache_entry *entry = src_shard->hash_table[i];
+			if (!entry ||
+			    radv_pipeline_cache_search_unlocked(dst_shard, entry->sha1))
+				continue;
+
+			struct cache_entry *dst_entry =
+				vk_alloc(&dst->alloc, entry_size(entry), 8,
+					 VK_SYSTEM_ALLOCATION_SCOPE_CACHE);
+			if (!dst_entry)
+				continue;
+
+			memcpy(dst_entry, entry, entry_size(entry));
+			if (!radv_pipeline_cache_add_entry(dst, dst_shard, dst_entry)) {
+				vk_free(&dst->alloc, dst_entry);
+				continue;
+			}
+
+			if (dst_entry->variant)
+				__sync_fetch_and_add(&dst_entry->variant->ref_count, 1);
+			(void) __sync_lock_test_and_set(&dst->modified, true);
+		}
 
-		src->hash_table[i] = NULL;
+		pthread_mutex_unlock(&dst_shard->mutex);
+		pthread_mutex_unlock(&src_shard->mutex);
 	}
 }
 
@@ -471,6 +566,7 @@ VkResult radv_MergePipelineCaches(
 	for (uint32_t i = 0; i < srcCacheCount; i++) {
 		RADV_FROM_HANDLE(radv_pipeline_cache, src, pSrcCaches[i]);
 
+		assert(src != dst);
 		radv_pipeline_cache_merge(dst, src);
 	}
 
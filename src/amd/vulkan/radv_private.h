@@ -291,14 +291,24 @@ void radv_finish_wsi(struct radv_physical_device *physical_device);
 
 struct cache_entry;
 
-struct radv_pipeline_cache {
-	struct radv_device *                          device;
+/* Pipelines are often created from many threads at once, so the cache is
+ * split into independently locked shards.
+ */
+#define RADV_PIPELINE_CACHE_SHARDS 16
+
+struct radv_pipeline_cache_shard {
 	pthread_mutex_t                              mutex;
 
-	uint32_t                                     total_size;
 	uint32_t                                     table_size;
 	uint32_t                                     kernel_count;
 	struct cache_entry **                        hash_table;
+};
+
+struct radv_pipeline_cache {
+	struct radv_device *                          device;
+
+	struct radv_pipeline_cache_shard             shards[RADV_PIPELINE_CACHE_SHARDS];
+	uint32_t                                     total_size;
 	bool                                         modified;
 
 	VkAllocationCallbacks                        alloc;
@@ -512,27 +522,75 @@ struct radv_descriptor_set {
 	uint64_t va;
 	uint32_t *mapped_ptr;
 	struct radv_descriptor_range *dynamic_descriptors;
+	int pool_entry;
 	struct radeon_winsys_bo *descriptors[0];
 };
 
-struct radv_descriptor_pool_free_node {
-	int next;
+/* A range of descriptor pool memory, either used by a set or free. */
+struct radv_descriptor_pool_entry {
 	uint32_t offset;
 	uint32_t size;
+	bool free;
+
+	/* Neighbouring ranges in address order */
+	int prev, next;
+
+	/* Free list of the size class, or list of unused entries */
+	int free_prev, free_next;
 };
 
+/* Free ranges are binned by the log2 of their size in 32 byte units. */
+#define RADV_DESCRIPTOR_POOL_BINS 32
+
 struct radv_descriptor_pool {
 	struct list_head descriptor_sets;
 
 	struct radeon_winsys_bo *bo;
 	uint8_t *mapped_ptr;
-	uint64_t current_offset;
 	uint64_t size;
 
-	int free_list;
-	int full_list;
-	uint32_t max_sets;
-	struct radv_descriptor_pool_free_node free_nodes[];
+	/* Host memory for the sets of pools that can only be reset */
+	uint8_t *host_memory_base;
+	uint8_t *host_memory_ptr;
+	uint8_t *host_memory_end;
+
+	uint32_t free_bins_mask;
+	int free_bins[RADV_DESCRIPTOR_POOL_BINS];
+	int unused_entries;
+	uint32_t max_entries;
+	struct radv_descriptor_pool_entry entries[];
+};
+
+struct radv_descriptor_update_template_entry {
+	VkDescriptorType descriptor_type;
+	uint32_t descriptor_count;
+
+	/* First descriptor written and distance between array elements, in
+	 * dwords of the set's mapping.
+	 */
+	uint32_t dst_offset;
+	uint32_t dst_stride;
+
+	/* Same, in the set's buffer list */
+	uint32_t buffer_offset;
+	uint32_t buffer_count;
+
+	/* First dynamic descriptor written, for dynamic buffers */
+	uint32_t dynamic_offset;
+
+	/* Whether the sampler state comes from the update data */
+	bool has_sampler;
+
+	/* Location of the first element in the update data and distance
+	 * between elements, in bytes.
+	 */
+	size_t src_offset;
+	size_t src_stride;
+};
+
+struct radv_descriptor_update_template {
+	uint32_t entry_count;
+	struct radv_descriptor_update_template_entry entry[0];
 };
 
 struct radv_buffer {
@@ -1303,6 +1361,7 @@ RADV_DEFINE_NONDISP_HANDLE_CASTS(radv_buffer_view, VkBufferView)
 RADV_DEFINE_NONDISP_HANDLE_CASTS(radv_descriptor_pool, VkDescriptorPool)
 RADV_DEFINE_NONDISP_HANDLE_CASTS(radv_descriptor_set, VkDescriptorSet)
 RADV_DEFINE_NONDISP_HANDLE_CASTS(radv_descriptor_set_layout, VkDescriptorSetLayout)
+RADV_DEFINE_NONDISP_HANDLE_CASTS(radv_descriptor_update_template, VkDescriptorUpdateTemplateKHR)
 RADV_DEFINE_NONDISP_HANDLE_CASTS(radv_device_memory, VkDeviceMemory)
 RADV_DEFINE_NONDISP_HANDLE_CASTS(radv_fence, VkFence)
 RADV_DEFINE_NONDISP_HANDLE_CASTS(radv_event, VkEvent)
@@ -0,0 +1,237 @@
+/*
+ * Copyright © 2016 Red Hat
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* CPU-only benchmark for descriptor pools.  Sets of a few different sizes
+ * are allocated and freed at random, the way applications that recycle
+ * sets every frame do, and checked for overlap.
+ */
+
+#include <time.h>
+
+#include "radv_private.h"
+#include "device_test_helper.h"
+
+#define POOL_SETS 1024
+#define LIVE_SETS 512
+#define NUM_ITERATIONS (1 << 20)
+#define NUM_LAYOUTS 3
+
+static VkDescriptorSetLayout layouts[NUM_LAYOUTS];
+
+static void
+create_layouts(void)
+{
+	const VkDescriptorSetLayoutBinding bindings[NUM_LAYOUTS][2] = {
+		{
+			{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+			  VK_SHADER_STAGE_ALL, NULL },
+			{ 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1,
+			  VK_SHADER_STAGE_ALL, NULL },
+		}, {
+			{ 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4,
+			  VK_SHADER_STAGE_FRAGMENT_BIT, NULL },
+			{ 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+			  VK_SHADER_STAGE_ALL, NULL },
+		}, {
+			{ 0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 16,
+			  VK_SHADER_STAGE_FRAGMENT_BIT, NULL },
+			{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 2,
+			  VK_SHADER_STAGE_ALL, NULL },
+		},
+	};
+
+	for (unsigned i = 0; i < NUM_LAYOUTS; i++) {
+		VkDescriptorSetLayoutCreateInfo info = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = 2,
+			.pBindings = bindings[i],
+		};
+		radv_CreateDescriptorSetLayout(radv_device_to_handle(&device),
+					       &info, NULL, &layouts[i]);
+	}
+}
+
+static VkDescriptorPool
+create_pool(VkDescriptorPoolCreateFlags flags)
+{
+	const VkDescriptorPoolSize sizes[] = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * POOL_SETS },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, POOL_SETS },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 2 * POOL_SETS },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 * POOL_SETS },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 16 * POOL_SETS },
+	};
+	VkDescriptorPoolCreateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags = flags,
+		.maxSets = POOL_SETS,
+		.poolSizeCount = ARRAY_SIZE(sizes),
+		.pPoolSizes = sizes,
+	};
+	VkDescriptorPool pool;
+	VkResult result;
+
+	result = radv_CreateDescriptorPool(radv_device_to_handle(&device),
+					   &info, NULL, &pool);
+	assert(result == VK_SUCCESS);
+	return pool;
+}
+
+static VkDescriptorSet
+alloc_set(VkDescriptorPool pool, unsigned layout, unsigned id)
+{
+	VkDescriptorSetAllocateInfo info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &layouts[layout],
+	};
+	VkDescriptorSet _set;
+	VkResult result;
+
+	result = radv_AllocateDescriptorSets(radv_device_to_handle(&device),
+					     &info, &_set);
+	assert(result == VK_SUCCESS);
+
+	RADV_FROM_HANDLE(radv_descriptor_set, set, _set);
+	memset(set->mapped_ptr, id, set->size);
+	if (set->layout->dynamic_offset_count)
+		set->dynamic_descriptors[0].size = id;
+	return _set;
+}
+
+static void
+check_set(VkDescriptorSet _set, unsigned id)
+{
+	RADV_FROM_HANDLE(radv_descriptor_set, set, _set);
+	const uint8_t *map = (const uint8_t *)set->mapped_ptr;
+
+	for (unsigned i = 0; i < set->size; i++)
+		assert(map[i] == (uint8_t)id);
+	if (set->layout->dynamic_offset_count)
+		assert(set->dynamic_descriptors[0].size == id);
+}
+
+static double
+elapsed(const struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) +
+	       (end.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static void
+test_churn(void)
+{
+	VkDescriptorPool _pool =
+		create_pool(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+	RADV_FROM_HANDLE(radv_descriptor_pool, pool, _pool);
+	VkDevice _device = radv_device_to_handle(&device);
+	VkDescriptorSet sets[LIVE_SETS];
+	unsigned ids[LIVE_SETS];
+	uint32_t seed = 1;
+	struct timespec start;
+
+	for (unsigned i = 0; i < LIVE_SETS; i++) {
+		ids[i] = i;
+		sets[i] = alloc_set(_pool, i % NUM_LAYOUTS, ids[i]);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (unsigned i = 0; i < NUM_ITERATIONS; i++) {
+		seed = seed * 1103515245 + 12345;
+		unsigned slot = (seed >> 8) % LIVE_SETS;
+
+		if ((i & 1023) == 0)
+			check_set(sets[slot], ids[slot]);
+
+		radv_FreeDescriptorSets(_device, _pool, 1, &sets[slot]);
+		ids[slot] = i;
+		sets[slot] = alloc_set(_pool, (seed >> 24) % NUM_LAYOUTS, ids[slot]);
+	}
+
+	printf("descriptor set churn: %.2f million sets/s\n",
+	       NUM_ITERATIONS / elapsed(&start) / 1e6);
+
+	for (unsigned i = 0; i < LIVE_SETS; i++)
+		check_set(sets[i], ids[i]);
+
+	radv_FreeDescriptorSets(_device, _pool, LIVE_SETS, sets);
+
+	/* Freed ranges were merged back into a single one. */
+	assert(util_bitcount(pool->free_bins_mask) == 1);
+	int entry = pool->free_bins[ffs(pool->free_bins_mask) - 1];
+	assert(pool->entries[entry].offset == 0);
+	assert(pool->entries[entry].size == pool->size);
+
+	radv_DestroyDescriptorPool(_device, _pool, NULL);
+}
+
+static void
+test_reset(void)
+{
+	VkDescriptorPool pool = create_pool(0);
+	VkDevice _device = radv_device_to_handle(&device);
+	VkDescriptorSet sets[POOL_SETS];
+	struct timespec start;
+	const unsigned num_resets = NUM_ITERATIONS / POOL_SETS;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	/* The pool holds its maximum number of sets, even of the largest
+	 * layout, without any other allocation.
+	 */
+	for (unsigned r = 0; r < num_resets; r++) {
+		for (unsigned i = 0; i < POOL_SETS; i++)
+			sets[i] = alloc_set(pool, r % NUM_LAYOUTS, i);
+
+		if (r % 64 == 0) {
+			for (unsigned i = 0; i < POOL_SETS; i++)
+				check_set(sets[i], i);
+		}
+
+		radv_ResetDescriptorPool(_device, pool, 0);
+	}
+
+	printf("descriptor set reset: %.2f million sets/s\n",
+	       num_resets * POOL_SETS / elapsed(&start) / 1e6);
+
+	radv_DestroyDescriptorPool(_device, pool, NULL);
+}
+
+int main(int argc, char **argv)
+{
+	test_device_init();
+	create_layouts();
+	test_churn();
+	test_reset();
+
+	for (unsigned i = 0; i < NUM_LAYOUTS; i++)
+		radv_DestroyDescriptorSetLayout(radv_device_to_handle(&device),
+						layouts[i], NULL);
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright © 2016 Red Hat
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* A device backed by malloc instead of a real winsys, for the CPU-only
+ * tests.  Buffers live in system memory and their VA is their address.
+ */
+
+static struct radeon_winsys ws;
+static struct radv_instance instance;
+static struct radv_device device;
+
+static void *
+test_alloc(void *user_data, size_t size, size_t align,
+	   VkSystemAllocationScope scope)
+{
+	return malloc(size);
+}
+
+static void *
+test_realloc(void *user_data, void *mem, size_t size, size_t align,
+	     VkSystemAllocationScope scope)
+{
+	return realloc(mem, size);
+}
+
+static void
+test_free(void *user_data, void *mem)
+{
+	free(mem);
+}
+
+static struct radeon_winsys_bo *
+test_buffer_create(struct radeon_winsys *ws, uint64_t size, unsigned alignment,
+		   enum radeon_bo_domain domain, enum radeon_bo_flag flags)
+{
+	return calloc(1, size);
+}
+
+static void
+test_buffer_destroy(struct radeon_winsys_bo *bo)
+{
+	free(bo);
+}
+
+static void *
+test_buffer_map(struct radeon_winsys_bo *bo)
+{
+	return bo;
+}
+
+static void
+test_buffer_unmap(struct radeon_winsys_bo *bo)
+{
+}
+
+static uint64_t
+test_buffer_get_va(struct radeon_winsys_bo *bo)
+{
+	return (uintptr_t)bo;
+}
+
+static void
+test_device_init(void)
+{
+	ws.buffer_create = test_buffer_create;
+	ws.buffer_destroy = test_buffer_destroy;
+	ws.buffer_map = test_buffer_map;
+	ws.buffer_unmap = test_buffer_unmap;
+	ws.buffer_get_va = test_buffer_get_va;
+
+	device.alloc = (VkAllocationCallbacks) {
+		.pfnAllocation = test_alloc,
+		.pfnReallocation = test_realloc,
+		.pfnFree = test_free,
+	};
+	device.instance = &instance;
+	device.ws = &ws;
+}
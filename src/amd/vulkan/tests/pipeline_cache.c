@@ -0,0 +1,247 @@
+/*
+ * Copyright © 2016 Red Hat
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* CPU-only stress test for the pipeline cache.  Shaders are "compiled" and
+ * looked up from many threads at once, then the cache is serialized,
+ * reloaded and merged.
+ */
+
+#include <pthread.h>
+
+#include "util/mesa-sha1.h"
+#include "radv_private.h"
+#include "device_test_helper.h"
+
+#define NUM_THREADS 16
+#define NUM_KEYS 4096
+#define KEYS_PER_THREAD 2048
+#define CODE_SIZE 64
+#define NUM_MERGES 64
+
+struct job {
+	pthread_t thread;
+	unsigned id;
+	struct radv_pipeline_cache *cache;
+	unsigned compiled;
+} jobs[NUM_THREADS];
+
+pthread_barrier_t barrier;
+
+static void
+key_sha1(unsigned key, unsigned char sha1[20])
+{
+	_mesa_sha1_compute(&key, sizeof(key), sha1);
+}
+
+static void
+key_code(unsigned key, uint8_t code[CODE_SIZE])
+{
+	for (unsigned i = 0; i < CODE_SIZE; i++)
+		code[i] = key * 7 + i;
+}
+
+static void
+check_variant(struct radv_shader_variant *variant, unsigned key)
+{
+	uint8_t code[CODE_SIZE];
+
+	key_code(key, code);
+	assert(variant->rsrc1 == key);
+	assert(memcmp(test_buffer_map(variant->bo), code, CODE_SIZE) == 0);
+}
+
+static struct radv_shader_variant *
+lookup(struct radv_pipeline_cache *cache, unsigned key)
+{
+	unsigned char sha1[20];
+
+	key_sha1(key, sha1);
+	return radv_create_shader_variant_from_pipeline_cache(&device, cache, sha1);
+}
+
+static void *
+compile_shaders(void *_job)
+{
+	struct job *job = _job;
+
+	pthread_barrier_wait(&barrier);
+
+	/* Neighbouring threads share half of their keys. */
+	for (unsigned i = 0; i < KEYS_PER_THREAD; i++) {
+		unsigned key = (job->id * KEYS_PER_THREAD / 2 + i) % NUM_KEYS;
+		struct radv_shader_variant *variant = lookup(job->cache, key);
+
+		if (!variant) {
+			unsigned char sha1[20];
+			uint8_t code[CODE_SIZE];
+
+			key_sha1(key, sha1);
+			key_code(key, code);
+
+			variant = calloc(1, sizeof(*variant));
+			variant->ref_count = 1;
+			variant->rsrc1 = key;
+			variant->code_size = CODE_SIZE;
+			variant->bo = test_buffer_create(&ws, CODE_SIZE, 256,
+							 RADEON_DOMAIN_GTT, 0);
+			memcpy(test_buffer_map(variant->bo), code, CODE_SIZE);
+
+			variant = radv_pipeline_cache_insert_shader(job->cache, sha1, variant,
+								    code, CODE_SIZE);
+			job->compiled++;
+		}
+
+		check_variant(variant, key);
+		radv_shader_variant_destroy(&device, variant);
+	}
+
+	return NULL;
+}
+
+struct merge_job {
+	pthread_t thread;
+	VkPipelineCache dst;
+	VkPipelineCache src;
+};
+
+static void *
+merge_caches(void *_job)
+{
+	struct merge_job *job = _job;
+
+	pthread_barrier_wait(&barrier);
+
+	for (unsigned i = 0; i < NUM_MERGES; i++)
+		radv_MergePipelineCaches(radv_device_to_handle(&device), job->dst,
+					 1, &job->src);
+
+	return NULL;
+}
+
+static void
+check_all_keys(struct radv_pipeline_cache *cache)
+{
+	for (unsigned key = 0; key < NUM_KEYS; key++) {
+		struct radv_shader_variant *variant = lookup(cache, key);
+		assert(variant);
+		check_variant(variant, key);
+		radv_shader_variant_destroy(&device, variant);
+	}
+}
+
+static void
+init_cache(struct radv_pipeline_cache *cache)
+{
+	cache->alloc = device.alloc;
+	radv_pipeline_cache_init(cache, &device);
+}
+
+static void run_test()
+{
+	struct radv_pipeline_cache cache, loaded, merged;
+	unsigned compiled = 0;
+
+	init_cache(&cache);
+
+	pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+
+	for (unsigned i = 0; i < NUM_THREADS; i++) {
+		jobs[i].cache = &cache;
+		jobs[i].id = i;
+		jobs[i].compiled = 0;
+		pthread_create(&jobs[i].thread, NULL, compile_shaders, &jobs[i]);
+	}
+
+	for (unsigned i = 0; i < NUM_THREADS; i++) {
+		pthread_join(jobs[i].thread, NULL);
+		compiled += jobs[i].compiled;
+	}
+
+	pthread_barrier_destroy(&barrier);
+
+	/* Racing threads may both compile a shader, but never miss one. */
+	assert(compiled >= NUM_KEYS);
+	check_all_keys(&cache);
+
+	/* Round trip through vkGetPipelineCacheData. */
+	VkDevice _device = radv_device_to_handle(&device);
+	VkPipelineCache _cache = radv_pipeline_cache_to_handle(&cache);
+	size_t size;
+	VkResult result = radv_GetPipelineCacheData(_device, _cache, &size, NULL);
+	assert(result == VK_SUCCESS);
+
+	void *data = malloc(size);
+	result = radv_GetPipelineCacheData(_device, _cache, &size, data);
+	assert(result == VK_SUCCESS);
+
+	init_cache(&loaded);
+	radv_pipeline_cache_load(&loaded, data, size);
+	check_all_keys(&loaded);
+
+	/* The reloaded cache serializes to the same size. */
+	size_t loaded_size;
+	radv_GetPipelineCacheData(_device, radv_pipeline_cache_to_handle(&loaded),
+				  &loaded_size, NULL);
+	assert(loaded_size == size);
+	free(data);
+
+	/* Merging leaves the source cache intact. */
+	init_cache(&merged);
+	VkPipelineCache src[2] = { _cache, radv_pipeline_cache_to_handle(&loaded) };
+	radv_MergePipelineCaches(_device, radv_pipeline_cache_to_handle(&merged),
+				 2, src);
+	check_all_keys(&merged);
+	check_all_keys(&cache);
+
+	/* Merges in opposite directions at the same time don't deadlock. */
+	struct merge_job merge_jobs[2] = {
+		{ .dst = radv_pipeline_cache_to_handle(&merged),
+		  .src = radv_pipeline_cache_to_handle(&loaded) },
+		{ .dst = radv_pipeline_cache_to_handle(&loaded),
+		  .src = radv_pipeline_cache_to_handle(&merged) },
+	};
+
+	pthread_barrier_init(&barrier, NULL, ARRAY_SIZE(merge_jobs));
+	for (unsigned i = 0; i < ARRAY_SIZE(merge_jobs); i++)
+		pthread_create(&merge_jobs[i].thread, NULL, merge_caches,
+			       &merge_jobs[i]);
+	for (unsigned i = 0; i < ARRAY_SIZE(merge_jobs); i++)
+		pthread_join(merge_jobs[i].thread, NULL);
+	pthread_barrier_destroy(&barrier);
+
+	check_all_keys(&merged);
+	check_all_keys(&loaded);
+
+	radv_pipeline_cache_finish(&merged);
+	radv_pipeline_cache_finish(&loaded);
+	radv_pipeline_cache_finish(&cache);
+}
+
+int main(int argc, char **argv)
+{
+	test_device_init();
+	for (unsigned i = 0; i < 8; i++)
+		run_test();
+
+	return 0;
+}
@@ -25,6 +25,8 @@
 #include <string.h>
 #include <ctype.h>
 #include "glcpp.h"
+#include "c11/threads.h"
+#include "util/list.h"
 
 void
 glcpp_error (YYLTYPE *locp, glcpp_parser_t *parser, const char *fmt, ...)
@@ -211,12 +213,328 @@ remove_line_continuations(glcpp_parser_t *ctx, const char *shader)
 	return clean;
 }
 
+enum source_kind {
+	SOURCE_NEEDS_PREPROCESSING,
+	SOURCE_PLAIN,
+	SOURCE_PLAIN_WITH_COMMENTS,
+};
+
+static bool
+is_identifier_start(char c)
+{
+	return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool
+is_identifier_char(char c)
+{
+	return is_identifier_start(c) || (c >= '0' && c <= '9');
+}
+
+/* Scan the shader once to find out whether the preprocessor could change
+ * anything in it other than removing comments.
+ *
+ * That is the case as soon as there is a directive, a line continuation
+ * or any identifier that might name a built-in macro: __LINE__, __FILE__,
+ * __VERSION__ and all of the GL_* macros, including the ones for
+ * extensions.  User macros can only exist if there is a #define.
+ */
+static enum source_kind
+scan_source(const char *shader)
+{
+	const char *p = shader;
+	bool has_comments = false;
+
+	while (*p) {
+		if (*p == '#' || *p == '\\')
+			return SOURCE_NEEDS_PREPROCESSING;
+
+		if (p[0] == '/' && p[1] == '*') {
+			has_comments = true;
+			for (p += 2; !(p[0] == '*' && p[1] == '/'); p++) {
+				/* Unterminated comments are an error. */
+				if (*p == '\\' || *p == '\0')
+					return SOURCE_NEEDS_PREPROCESSING;
+			}
+			p += 2;
+		} else if (p[0] == '/' && p[1] == '/') {
+			has_comments = true;
+			for (p += 2; *p && *p != '\r' && *p != '\n'; p++) {
+				if (*p == '\\')
+					return SOURCE_NEEDS_PREPROCESSING;
+			}
+		} else if (is_identifier_start(*p)) {
+			const char *start = p;
+			while (is_identifier_char(*p))
+				p++;
+			if ((p - start >= 2 && strncmp(start, "__", 2) == 0) ||
+			    (p - start >= 3 && strncmp(start, "GL_", 3) == 0))
+				return SOURCE_NEEDS_PREPROCESSING;
+		} else if (*p >= '0' && *p <= '9') {
+			/* Skip whole numbers so that suffixes and hex digits
+			 * are not mistaken for identifiers.
+			 */
+			while (is_identifier_char(*p) || *p == '.')
+				p++;
+		} else {
+			p++;
+		}
+	}
+
+	return has_comments ? SOURCE_PLAIN_WITH_COMMENTS : SOURCE_PLAIN;
+}
+
+/* Replace each comment of a shader that scan_source() accepted by a space,
+ * keeping the newlines inside of block comments so that line numbers do
+ * not change.
+ */
+static char *
+strip_comments(void *ralloc_ctx, const char *shader)
+{
+	char *clean = ralloc_size(ralloc_ctx, strlen(shader) + 1);
+	const char *p = shader;
+	char *out = clean;
+
+	while (*p) {
+		if (p[0] == '/' && p[1] == '*') {
+			*out++ = ' ';
+			for (p += 2; !(p[0] == '*' && p[1] == '/'); p++) {
+				if (*p == '\r' || *p == '\n')
+					*out++ = *p;
+			}
+			p += 2;
+		} else if (p[0] == '/' && p[1] == '/') {
+			*out++ = ' ';
+			while (*p && *p != '\r' && *p != '\n')
+				p++;
+		} else {
+			*out++ = *p++;
+		}
+	}
+	*out = '\0';
+
+	return clean;
+}
+
+/* Output of previous preprocessor runs, keyed by source string.
+ *
+ * Besides the source, the output depends on the built-in macros, which come
+ * from the extensions of the context compiling the shader and the version
+ * the shader declares.  So each entry also records the macros that were
+ * defined, and a lookup only hits if the current context defines the same
+ * ones for that version.
+ */
+struct cache_entry {
+	struct list_head link;
+	char *source;
+	gl_api api;
+	bool line_continuations;
+	glcpp_extension_iterator extensions;
+	unsigned version;
+	bool is_gles;
+	char *builtin_defines;
+	char *output;
+	char *info_log;
+	int errors;
+	size_t size;
+};
+
+#define CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+static mtx_t cache_mutex = _MTX_INITIALIZER_NP;
+static struct hash_table *cache_table;
+static struct list_head cache_lru;
+static size_t cache_size;
+
+struct define_collector {
+	char *defines;
+	size_t length;
+};
+
+static void
+collect_builtin_define(glcpp_parser_t *data, const char *name, int value)
+{
+	/* See get_builtin_defines(). */
+	struct define_collector *collector = (struct define_collector *) data;
+
+	ralloc_asprintf_rewrite_tail(&collector->defines, &collector->length,
+				     "%s=%d\n", name, value);
+}
+
+static char *
+get_builtin_defines(void *mem_ctx, glcpp_extension_iterator extensions,
+		    void *state, unsigned version, bool is_gles)
+{
+	struct define_collector collector;
+
+	collector.defines = ralloc_strdup(mem_ctx, "");
+	collector.length = 0;
+
+	/* The iterator only hands its data pointer back to the callback, so
+	 * it can point at the collector rather than at a parser.
+	 */
+	if (extensions)
+		extensions(state, collect_builtin_define,
+			   (glcpp_parser_t *) &collector, version, is_gles);
+
+	return collector.defines;
+}
+
+static bool
+cache_lookup(void *ralloc_ctx, const char **shader, char **info_log,
+	     glcpp_extension_iterator extensions, void *state,
+	     struct gl_context *gl_ctx, int *errors)
+{
+	struct cache_entry *entry = NULL;
+	bool hit = false;
+
+	mtx_lock(&cache_mutex);
+
+	if (cache_table) {
+		struct hash_entry *he =
+			_mesa_hash_table_search(cache_table, *shader);
+		if (he)
+			entry = he->data;
+	}
+
+	if (entry &&
+	    entry->api == gl_ctx->API &&
+	    entry->line_continuations ==
+	    !gl_ctx->Const.DisableGLSLLineContinuations &&
+	    entry->extensions == extensions) {
+		char *defines = get_builtin_defines(NULL, extensions, state,
+						    entry->version,
+						    entry->is_gles);
+		hit = strcmp(defines, entry->builtin_defines) == 0;
+		ralloc_free(defines);
+	}
+
+	if (hit) {
+		list_del(&entry->link);
+		list_addtail(&entry->link, &cache_lru);
+
+		ralloc_strcat(info_log, entry->info_log);
+		*shader = ralloc_strdup(ralloc_ctx, entry->output);
+		*errors = entry->errors;
+	}
+
+	mtx_unlock(&cache_mutex);
+
+	return hit;
+}
+
+static void
+cache_remove(struct cache_entry *entry)
+{
+	struct hash_entry *he = _mesa_hash_table_search(cache_table,
+							 entry->source);
+	_mesa_hash_table_remove(cache_table, he);
+	list_del(&entry->link);
+	cache_size -= entry->size;
+	ralloc_free(entry);
+}
+
+static void
+cache_insert(const char *source, glcpp_parser_t *parser,
+	     struct gl_context *gl_ctx)
+{
+	struct cache_entry *entry = ralloc(NULL, struct cache_entry);
+
+	entry->source = ralloc_strdup(entry, source);
+	entry->api = gl_ctx->API;
+	entry->line_continuations =
+		!gl_ctx->Const.DisableGLSLLineContinuations;
+	entry->extensions = parser->extensions;
+	entry->version = parser->version;
+	entry->is_gles = parser->is_gles;
+	entry->builtin_defines = get_builtin_defines(entry, parser->extensions,
+						     parser->state,
+						     parser->version,
+						     parser->is_gles);
+	entry->output = ralloc_strdup(entry, parser->output);
+	entry->info_log = ralloc_strdup(entry, parser->info_log);
+	entry->errors = parser->error;
+	entry->size = strlen(entry->source) + strlen(entry->output) +
+		      strlen(entry->builtin_defines) +
+		      strlen(entry->info_log) + sizeof(*entry);
+
+	if (entry->size > CACHE_MAX_SIZE / 4) {
+		ralloc_free(entry);
+		return;
+	}
+
+	mtx_lock(&cache_mutex);
+
+	if (cache_table == NULL) {
+		cache_table = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+						      _mesa_key_string_equal);
+		list_inithead(&cache_lru);
+	}
+
+	struct hash_entry *he = _mesa_hash_table_search(cache_table, source);
+	if (he)
+		cache_remove(he->data);
+
+	while (cache_size + entry->size > CACHE_MAX_SIZE) {
+		cache_remove(LIST_ENTRY(struct cache_entry, cache_lru.next,
+					link));
+	}
+
+	_mesa_hash_table_insert(cache_table, entry->source, entry);
+	list_addtail(&entry->link, &cache_lru);
+	cache_size += entry->size;
+
+	mtx_unlock(&cache_mutex);
+}
+
+void
+glcpp_release_cache(void)
+{
+	mtx_lock(&cache_mutex);
+
+	if (cache_table) {
+		list_for_each_entry_safe(struct cache_entry, entry,
+					 &cache_lru, link) {
+			ralloc_free(entry);
+		}
+		_mesa_hash_table_destroy(cache_table, NULL);
+		cache_table = NULL;
+		cache_size = 0;
+	}
+
+	mtx_unlock(&cache_mutex);
+}
+
+/* When state is non-NULL, the output is only going to be fed to the GLSL
+ * compiler, so shaders without any preprocessor constructs are passed
+ * through with just their comments removed, and the output for shaders that
+ * were already preprocessed is reused.  The standalone glcpp always runs
+ * the full preprocessor.
+ */
 int
 glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
                  glcpp_extension_iterator extensions, void *state,
                  struct gl_context *gl_ctx)
 {
+	const char *source = *shader;
 	int errors;
+
+	if (state) {
+		switch (scan_source(source)) {
+		case SOURCE_PLAIN:
+			return 0;
+		case SOURCE_PLAIN_WITH_COMMENTS:
+			*shader = strip_comments(ralloc_ctx, source);
+			return 0;
+		case SOURCE_NEEDS_PREPROCESSING:
+			break;
+		}
+
+		if (cache_lookup(ralloc_ctx, shader, info_log, extensions,
+				 state, gl_ctx, &errors))
+			return errors;
+	}
+
 	glcpp_parser_t *parser =
 		glcpp_parser_create(extensions, state, gl_ctx->API);
 
@@ -232,6 +550,9 @@ glcpp_preprocess(void *ralloc_ctx, const char **shader, char **info_log,
 
 	glcpp_parser_resolve_implicit_version(parser);
 
+	if (state)
+		cache_insert(source, parser, gl_ctx);
+
 	ralloc_strcat(info_log, parser->info_log);
 
 	ralloc_steal(ralloc_ctx, parser->output);
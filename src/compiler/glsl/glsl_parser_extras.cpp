@@ -32,6 +32,7 @@
 #include "main/shaderobj.h"
 #include "util/u_atomic.h" /* for p_atomic_cmpxchg */
 #include "util/ralloc.h"
+#include "compiler/pass_stats.h"
 #include "ast.h"
 #include "glsl_parser_extras.h"
 #include "glsl_parser.h"
@@ -1930,6 +1931,13 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 
    ralloc_free(shader->ir);
    shader->ir = new(shader) exec_list;
+   if (pass_stats_enabled()) {
+      char name[32];
+      snprintf(name, sizeof(name), "%u", shader->Name);
+      pass_stats_get(shader->ir, "GLSL IR",
+                     _mesa_shader_stage_to_abbrev(shader->Stage),
+                     shader->Label ? shader->Label : name);
+   }
    if (!state->error && !state->translation_unit.is_empty())
       _mesa_ast_to_hir(shader->ir, state);
 
@@ -1952,9 +1960,8 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       /* Do some optimization at compile time to reduce shader IR size
        * and reduce later work if the same shader is linked multiple times
        */
-      while (do_common_optimization(shader->ir, false, false, options,
-                                    ctx->Const.NativeIntegers))
-         ;
+      do_common_optimization_loop(shader->ir, false, false, options,
+                                  ctx->Const.NativeIntegers);
 
       validate_ir_tree(shader->ir);
 
@@ -2028,45 +2035,101 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 }
 
 } /* extern "C" */
+
+static void
+count_ir_node(ir_instruction *, void *data)
+{
+   (*(unsigned *) data)++;
+}
+
 /**
- * Do the set of common optimizations passes
+ * Returns the number of IR nodes in the list, which is what MESA_PASS_STATS
+ * reports as the size of GLSL IR.
+ */
+static unsigned
+count_ir_size(exec_list *ir)
+{
+   unsigned size = 0;
+
+   foreach_in_list(ir_instruction, node, ir)
+      visit_tree(node, count_ir_node, &size);
+
+   return size;
+}
+
+/**
+ * Which passes of the common optimization loop are known to have nothing
+ * left to do.
  *
- * \param ir                          List of instructions to be optimized
- * \param linked                      Is the shader linked?  This enables
- *                                    optimizations passes that remove code at
- *                                    global scope and could cause linking to
- *                                    fail.
- * \param uniform_locations_assigned  Have locations already been assigned for
- *                                    uniforms?  This prevents the declarations
- *                                    of unused uniforms from being removed.
- *                                    The setting of this flag only matters if
- *                                    \c linked is \c true.
- * \param options                     The driver's preferred shader options.
- * \param native_integers             Selects optimizations that depend on the
- *                                    implementations supporting integers
- *                                    natively (as opposed to supporting
- *                                    integers in floating point registers).
+ * Every pass reports progress whenever it changes the IR, and the passes
+ * only depend on the IR, so a pass that made no progress cannot make any
+ * until another pass has.  Each pass is identified by its position in
+ * common_optimization_iteration(), which only depends on the arguments and
+ * so is the same in every iteration.
  */
-bool
-do_common_optimization(exec_list *ir, bool linked,
-		       bool uniform_locations_assigned,
-                       const struct gl_shader_compiler_options *options,
-                       bool native_integers)
+struct common_optimization_history {
+   /** Incremented each time a pass makes progress. */
+   unsigned generation;
+
+   /** generation + 1 as of the last run of each pass that made no progress,
+    * so that zero means the pass has not been run.
+    */
+   unsigned idle[32];
+   unsigned invariance_propagated;
+};
+
+static inline bool
+pass_is_idle(const common_optimization_history *history, unsigned index)
+{
+   assert(index < ARRAY_SIZE(history->idle));
+   return history->idle[index] == history->generation + 1;
+}
+
+static bool
+common_optimization_iteration(exec_list *ir, bool linked,
+                              bool uniform_locations_assigned,
+                              const struct gl_shader_compiler_options *options,
+                              bool native_integers,
+                              common_optimization_history *history)
 {
    const bool debug = false;
    GLboolean progress = GL_FALSE;
+   unsigned num_passes = 0;
+   struct pass_stats *stats = NULL;
+   struct pass_stats_sample total_sample;
+
+   if (pass_stats_enabled()) {
+      stats = pass_stats_get(ir, "GLSL IR", NULL, NULL);
+      pass_stats_begin(&total_sample, count_ir_size(ir));
+   }
 
 #define OPT(PASS, ...) do {                                             \
-      if (debug) {                                                      \
+      const unsigned index = num_passes++;                              \
+      if (history && pass_is_idle(history, index))                      \
+         break;                                                         \
+      struct pass_stats_sample sample;                                  \
+      if (stats)                                                        \
+         pass_stats_begin(&sample, count_ir_size(ir));                  \
+      if (debug)                                                        \
          fprintf(stderr, "START GLSL optimization %s\n", #PASS);        \
-         const bool opt_progress = PASS(__VA_ARGS__);                   \
-         progress = opt_progress || progress;                           \
+      const bool opt_progress = PASS(__VA_ARGS__);                      \
+      progress = opt_progress || progress;                              \
+      if (stats) {                                                      \
+         pass_stats_stop(&sample);                                      \
+         pass_stats_end(stats, &sample, #PASS, opt_progress,            \
+                        count_ir_size(ir));                             \
+      }                                                                 \
+      if (debug) {                                                      \
          if (opt_progress)                                              \
             _mesa_print_ir(stderr, ir, NULL);                           \
          fprintf(stderr, "GLSL optimization %s: %s progress\n",         \
                  #PASS, opt_progress ? "made" : "no");                  \
-      } else {                                                          \
-         progress = PASS(__VA_ARGS__) || progress;                      \
+      }                                                                 \
+      if (history) {                                                    \
+         if (opt_progress)                                              \
+            history->generation++;                                      \
+         else                                                           \
+            history->idle[index] = history->generation + 1;             \
       }                                                                 \
    } while (false)
 
@@ -2077,7 +2140,12 @@ do_common_optimization(exec_list *ir, bool linked,
       OPT(do_dead_functions, ir);
       OPT(do_structure_splitting, ir);
    }
-   propagate_invariance(ir);
+   if (!history ||
+       history->invariance_propagated != history->generation + 1) {
+      propagate_invariance(ir);
+      if (history)
+         history->invariance_propagated = history->generation + 1;
+   }
    OPT(do_if_simplification, ir);
    OPT(opt_flatten_nested_if_blocks, ir);
    OPT(opt_conditional_discard, ir);
@@ -2115,7 +2183,12 @@ do_common_optimization(exec_list *ir, bool linked,
    OPT(optimize_split_arrays, ir, linked);
    OPT(optimize_redundant_jumps, ir);
 
-   if (options->MaxUnrollIterations) {
+   /* Don't bother analyzing the loops if neither loop pass has anything
+    * left to do.
+    */
+   if (options->MaxUnrollIterations &&
+       !(history && pass_is_idle(history, num_passes) &&
+         pass_is_idle(history, num_passes + 1))) {
       loop_state *ls = analyze_loop_variables(ir);
       if (ls->loop_found) {
          OPT(set_loop_controls, ir, ls);
@@ -2126,6 +2199,74 @@ do_common_optimization(exec_list *ir, bool linked,
 
 #undef OPT
 
+   /* Recorded as a pass of its own so that the number of iterations of the
+    * optimization loops shows up as its call count.
+    */
+   if (stats) {
+      pass_stats_stop(&total_sample);
+      pass_stats_end(stats, &total_sample, "do_common_optimization",
+                     progress, count_ir_size(ir));
+   }
+
+   return progress;
+}
+
+/**
+ * Do the set of common optimizations passes
+ *
+ * \param ir                          List of instructions to be optimized
+ * \param linked                      Is the shader linked?  This enables
+ *                                    optimizations passes that remove code at
+ *                                    global scope and could cause linking to
+ *                                    fail.
+ * \param uniform_locations_assigned  Have locations already been assigned for
+ *                                    uniforms?  This prevents the declarations
+ *                                    of unused uniforms from being removed.
+ *                                    The setting of this flag only matters if
+ *                                    \c linked is \c true.
+ * \param options                     The driver's preferred shader options.
+ * \param native_integers             Selects optimizations that depend on the
+ *                                    implementations supporting integers
+ *                                    natively (as opposed to supporting
+ *                                    integers in floating point registers).
+ */
+bool
+do_common_optimization(exec_list *ir, bool linked,
+		       bool uniform_locations_assigned,
+                       const struct gl_shader_compiler_options *options,
+                       bool native_integers)
+{
+   return common_optimization_iteration(ir, linked,
+                                        uniform_locations_assigned,
+                                        options, native_integers, NULL);
+}
+
+/**
+ * Runs do_common_optimization() until it stops making progress.
+ *
+ * This gives the same result as calling it in a loop, but each iteration
+ * only runs the passes that could have something to do since the IR last
+ * changed, so the last iteration, which finds nothing to do, and every
+ * iteration where only a few passes make progress get much cheaper.
+ *
+ * Returns true if any progress was made.
+ */
+bool
+do_common_optimization_loop(exec_list *ir, bool linked,
+                            bool uniform_locations_assigned,
+                            const struct gl_shader_compiler_options *options,
+                            bool native_integers)
+{
+   common_optimization_history history;
+   bool progress = false;
+
+   memset(&history, 0, sizeof(history));
+
+   while (common_optimization_iteration(ir, linked,
+                                        uniform_locations_assigned,
+                                        options, native_integers, &history))
+      progress = true;
+
    return progress;
 }
 
@@ -2155,6 +2296,7 @@ void
 _mesa_destroy_shader_compiler_caches(void)
 {
    _mesa_glsl_release_builtin_functions();
+   glcpp_release_cache();
 }
 
 }
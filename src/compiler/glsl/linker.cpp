@@ -75,6 +75,7 @@
 #include "program/program.h"
 #include "util/set.h"
 #include "util/string_to_uint_map.h"
+#include "compiler/pass_stats.h"
 #include "linker.h"
 #include "link_varyings.h"
 #include "ir_optimization.h"
@@ -2216,6 +2217,14 @@ link_intrastage_shaders(void *mem_ctx,
    linked->ir = new(linked) exec_list;
    clone_ir_list(mem_ctx, linked->ir, main->ir);
 
+   if (pass_stats_enabled()) {
+      char name[32];
+      snprintf(name, sizeof(name), "program %u", prog->Name);
+      pass_stats_get(linked->ir, "GLSL IR",
+                     _mesa_shader_stage_to_abbrev(linked->Stage),
+                     prog->Label ? prog->Label : name);
+   }
+
    link_fs_inout_layout_qualifiers(prog, linked, shader_list, num_shaders);
    link_tcs_out_layout_qualifiers(prog, linked, shader_list, num_shaders);
    link_tes_in_layout_qualifiers(prog, linked, shader_list, num_shaders);
@@ -5048,10 +5057,9 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
          lower_tess_level(prog->_LinkedShaders[i]);
       }
 
-      while (do_common_optimization(prog->_LinkedShaders[i]->ir, true, false,
-                                    &ctx->Const.ShaderCompilerOptions[i],
-                                    ctx->Const.NativeIntegers))
-         ;
+      do_common_optimization_loop(prog->_LinkedShaders[i]->ir, true, false,
+                                  &ctx->Const.ShaderCompilerOptions[i],
+                                  ctx->Const.NativeIntegers);
 
       lower_const_arrays_to_uniforms(prog->_LinkedShaders[i]->ir, i);
       propagate_invariance(prog->_LinkedShaders[i]->ir);
@@ -35,10 +35,190 @@
 
 static bool debug = false;
 
+namespace {
+
+/**
+ * A variable whose references are all assignments, waiting to be removed.
+ */
+struct dead_variable {
+   exec_node link;
+   ir_variable_refcount_entry *entry;
+};
+
+/**
+ * Drops the references that an assignment about to be removed makes to
+ * other variables.  Each variable that is left with only assignments is
+ * added to the worklist, so that whole chains of dead assignments go away
+ * in one pass instead of one link per pass.
+ */
+class dead_reference_visitor : public ir_hierarchical_visitor {
+public:
+   dead_reference_visitor(ir_variable_refcount_visitor *refs,
+                          exec_list *worklist, void *mem_ctx)
+      : refs(refs), worklist(worklist), mem_ctx(mem_ctx), lhs_var(NULL)
+   {
+   }
+
+   virtual ir_visitor_status visit(ir_dereference_variable *ir)
+   {
+      if (ir->var == this->lhs_var)
+         return visit_continue;
+
+      struct hash_entry *e = _mesa_hash_table_search(this->refs->ht, ir->var);
+      ir_variable_refcount_entry *entry =
+         (ir_variable_refcount_entry *) e->data;
+
+      assert(entry->referenced_count > entry->assigned_count);
+      entry->referenced_count--;
+
+      if (entry->referenced_count == entry->assigned_count &&
+          entry->declaration)
+         add_dead_variable(entry);
+
+      return visit_continue;
+   }
+
+   /**
+    * Each variable is only added once: either it is dead from the start, in
+    * which case it has no references left to drop, or it becomes dead when
+    * its last one is dropped.
+    */
+   void add_dead_variable(ir_variable_refcount_entry *entry)
+   {
+      dead_variable *dead = ralloc(this->mem_ctx, dead_variable);
+      dead->entry = entry;
+      this->worklist->push_tail(&dead->link);
+   }
+
+   ir_variable_refcount_visitor *refs;
+   exec_list *worklist;
+   void *mem_ctx;
+
+   /** The variable written by the assignment being removed. */
+   ir_variable *lhs_var;
+};
+
+} /* unnamed namespace */
+
+static bool
+remove_dead_variable(ir_variable_refcount_entry *entry,
+                     bool uniform_locations_assigned,
+                     dead_reference_visitor *dead_refs)
+{
+   bool progress = false;
+
+   assert(entry->referenced_count == entry->assigned_count &&
+          entry->declaration);
+
+   /* Section 7.4.1 (Shader Interface Matching) of the OpenGL 4.5
+    * (Core Profile) spec says:
+    *
+    *    "With separable program objects, interfaces between shader
+    *    stages may involve the outputs from one program object and the
+    *    inputs from a second program object.  For such interfaces, it is
+    *    not possible to detect mismatches at link time, because the
+    *    programs are linked separately. When each such program is
+    *    linked, all inputs or outputs interfacing with another program
+    *    stage are treated as active."
+    */
+   if (entry->var->data.always_active_io)
+      return false;
+
+   /* The refcount visitor stops listing the assignments to a variable once
+    * it has seen it read.  That cannot happen to a variable that was dead
+    * from the start, but one that only died when the assignments reading it
+    * were removed may still have assignments we don't know about.  Leave
+    * those for the next pass.
+    */
+   if (entry->assign_list.length() != entry->assigned_count)
+      return false;
+
+   if (!entry->assign_list.is_empty()) {
+      /* Remove all the dead assignments to the variable we found.
+       * Don't do so if it's a shader or function output, though.
+       */
+      if (entry->var->data.mode != ir_var_function_out &&
+          entry->var->data.mode != ir_var_function_inout &&
+          entry->var->data.mode != ir_var_shader_out &&
+          entry->var->data.mode != ir_var_shader_storage) {
+
+         while (!entry->assign_list.is_empty()) {
+            struct assignment_entry *assignment_entry =
+               exec_node_data(struct assignment_entry,
+                              entry->assign_list.get_head_raw(), link);
+
+            dead_refs->lhs_var = entry->var;
+            assignment_entry->assign->accept(dead_refs);
+            assignment_entry->assign->remove();
+
+            if (debug) {
+               printf("Removed assignment to %s@%p\n",
+                      entry->var->name, (void *) entry->var);
+            }
+
+            assignment_entry->link.remove();
+            free(assignment_entry);
+         }
+         progress = true;
+      }
+   }
+
+   if (entry->assign_list.is_empty()) {
+      /* If there are no assignments or references to the variable left,
+       * then we can remove its declaration.
+       */
+
+      /* uniform initializers are precious, and could get used by another
+       * stage.  Also, once uniform locations have been assigned, the
+       * declaration cannot be deleted.
+       */
+      if (entry->var->data.mode == ir_var_uniform ||
+          entry->var->data.mode == ir_var_shader_storage) {
+         if (uniform_locations_assigned || entry->var->constant_initializer)
+            return progress;
+
+         /* Section 2.11.6 (Uniform Variables) of the OpenGL ES 3.0.3 spec
+          * says:
+          *
+          *     "All members of a named uniform block declared with a
+          *     shared or std140 layout qualifier are considered active,
+          *     even if they are not referenced in any shader in the
+          *     program. The uniform block itself is also considered
+          *     active, even if no member of the block is referenced."
+          *
+          * If the variable is in a uniform block with one of those
+          * layouts, do not eliminate it.
+          */
+         if (entry->var->is_in_buffer_block()) {
+            if (entry->var->get_interface_type_packing() !=
+                GLSL_INTERFACE_PACKING_PACKED)
+               return progress;
+         }
+
+         if (entry->var->type->is_subroutine())
+            return progress;
+      }
+
+      entry->var->remove();
+      progress = true;
+
+      if (debug) {
+         printf("Removed declaration of %s@%p\n",
+                entry->var->name, (void *) entry->var);
+      }
+   }
+
+   return progress;
+}
+
 /**
  * Do a dead code pass over instructions and everything that instructions
  * references.
  *
+ * Removing the assignments to a dead variable drops the references they
+ * made to other variables, so those are put on a worklist and removed in
+ * the same pass if that leaves them dead too.
+ *
  * Note that this will remove assignments to globals, so it is not suitable
  * for usage on an unlinked instruction stream.
  */
@@ -46,6 +226,8 @@ bool
 do_dead_code(exec_list *instructions, bool uniform_locations_assigned)
 {
    ir_variable_refcount_visitor v;
+   exec_list worklist;
+   dead_reference_visitor dead_refs(&v, &worklist, v.mem_ctx);
    bool progress = false;
 
    v.run(instructions);
@@ -75,92 +257,16 @@ do_dead_code(exec_list *instructions, bool uniform_locations_assigned)
 	  || !entry->declaration)
 	 continue;
 
-      /* Section 7.4.1 (Shader Interface Matching) of the OpenGL 4.5
-       * (Core Profile) spec says:
-       *
-       *    "With separable program objects, interfaces between shader
-       *    stages may involve the outputs from one program object and the
-       *    inputs from a second program object.  For such interfaces, it is
-       *    not possible to detect mismatches at link time, because the
-       *    programs are linked separately. When each such program is
-       *    linked, all inputs or outputs interfacing with another program
-       *    stage are treated as active."
-       */
-      if (entry->var->data.always_active_io)
-         continue;
-
-      if (!entry->assign_list.is_empty()) {
-	 /* Remove all the dead assignments to the variable we found.
-	  * Don't do so if it's a shader or function output, though.
-	  */
-	 if (entry->var->data.mode != ir_var_function_out &&
-	     entry->var->data.mode != ir_var_function_inout &&
-             entry->var->data.mode != ir_var_shader_out &&
-             entry->var->data.mode != ir_var_shader_storage) {
-
-            while (!entry->assign_list.is_empty()) {
-               struct assignment_entry *assignment_entry =
-                  exec_node_data(struct assignment_entry,
-                                 entry->assign_list.get_head_raw(), link);
-
-	       assignment_entry->assign->remove();
-
-	       if (debug) {
-	          printf("Removed assignment to %s@%p\n",
-		         entry->var->name, (void *) entry->var);
-               }
-
-               assignment_entry->link.remove();
-               free(assignment_entry);
-            }
-            progress = true;
-	 }
-      }
-
-      if (entry->assign_list.is_empty()) {
-	 /* If there are no assignments or references to the variable left,
-	  * then we can remove its declaration.
-	  */
-
-	 /* uniform initializers are precious, and could get used by another
-	  * stage.  Also, once uniform locations have been assigned, the
-	  * declaration cannot be deleted.
-	  */
-         if (entry->var->data.mode == ir_var_uniform ||
-             entry->var->data.mode == ir_var_shader_storage) {
-            if (uniform_locations_assigned || entry->var->constant_initializer)
-               continue;
-
-            /* Section 2.11.6 (Uniform Variables) of the OpenGL ES 3.0.3 spec
-             * says:
-             *
-             *     "All members of a named uniform block declared with a
-             *     shared or std140 layout qualifier are considered active,
-             *     even if they are not referenced in any shader in the
-             *     program. The uniform block itself is also considered
-             *     active, even if no member of the block is referenced."
-             *
-             * If the variable is in a uniform block with one of those
-             * layouts, do not eliminate it.
-             */
-            if (entry->var->is_in_buffer_block()) {
-               if (entry->var->get_interface_type_packing() !=
-                   GLSL_INTERFACE_PACKING_PACKED)
-                  continue;
-            }
-
-            if (entry->var->type->is_subroutine())
-               continue;
-         }
+      dead_refs.add_dead_variable(entry);
+   }
 
-	 entry->var->remove();
-	 progress = true;
+   exec_node *n;
+   while ((n = worklist.pop_head()) != NULL) {
+      dead_variable *dead = exec_node_data(dead_variable, n, link);
 
-	 if (debug) {
-	    printf("Removed declaration of %s@%p\n",
-		   entry->var->name, (void *) entry->var);
-	 }
-      }
+      if (remove_dead_variable(dead->entry, uniform_locations_assigned,
+                               &dead_refs))
+         progress = true;
    }
 
    return progress;
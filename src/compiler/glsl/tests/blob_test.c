@@ -30,7 +30,7 @@
 #include <string.h>
 
 #include "util/ralloc.h"
-#include "blob.h"
+#include "util/blob.h"
 
 #define bytes_test_str     "bytes_test"
 #define reserve_test_str   "reserve_test"
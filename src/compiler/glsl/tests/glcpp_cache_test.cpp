@@ -0,0 +1,194 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "util/ralloc.h"
+#include "glsl_parser_extras.h"
+
+static unsigned extension_calls;
+static int extension_value;
+
+static void
+count_extensions(struct _mesa_glsl_parse_state *,
+                 void (*add_builtin_define)(struct glcpp_parser *,
+                                            const char *, int),
+                 struct glcpp_parser *data, unsigned, bool)
+{
+   extension_calls++;
+   add_builtin_define(data, "GL_TEST_extension", extension_value);
+}
+
+class glcpp_cache : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   int preprocess(const char **shader, bool compiler);
+
+   void *mem_ctx;
+   char *info_log;
+   struct gl_context ctx;
+   int state;
+};
+
+void
+glcpp_cache::SetUp()
+{
+   glcpp_release_cache();
+
+   mem_ctx = ralloc_context(NULL);
+   info_log = ralloc_strdup(mem_ctx, "");
+   memset(&ctx, 0, sizeof(ctx));
+   ctx.API = API_OPENGL_COMPAT;
+   extension_calls = 0;
+   extension_value = 1;
+}
+
+void
+glcpp_cache::TearDown()
+{
+   ralloc_free(mem_ctx);
+   mem_ctx = NULL;
+
+   glcpp_release_cache();
+}
+
+/**
+ * Run the preprocessor the way the compiler does (with a parse state) or the
+ * way the standalone glcpp does (without one, always the full preprocessor).
+ */
+int
+glcpp_cache::preprocess(const char **shader, bool compiler)
+{
+   struct _mesa_glsl_parse_state *s =
+      compiler ? (struct _mesa_glsl_parse_state *) &state : NULL;
+
+   extension_calls = 0;
+   return glcpp_preprocess(mem_ctx, shader, &info_log, count_extensions, s,
+                           &ctx);
+}
+
+TEST_F(glcpp_cache, plain_source_is_skipped)
+{
+   static const char source[] =
+      "uniform vec4 color;\n"
+      "void main() { gl_FragColor = color / 2.0; }\n";
+   const char *shader = source;
+
+   EXPECT_EQ(0, preprocess(&shader, true));
+   EXPECT_EQ(source, shader);
+   EXPECT_EQ(0u, extension_calls);
+   EXPECT_STREQ("", info_log);
+}
+
+TEST_F(glcpp_cache, comments_are_stripped)
+{
+   static const char source[] =
+      "uniform vec4 color; // the color\n"
+      "/* multi\n"
+      " * line */ void main() { gl_FragColor = color; }\n";
+   const char *shader = source;
+
+   EXPECT_EQ(0, preprocess(&shader, true));
+   EXPECT_NE(source, shader);
+   EXPECT_EQ(NULL, strstr(shader, "the color"));
+   EXPECT_EQ(NULL, strstr(shader, "multi"));
+   EXPECT_NE((const char *) NULL, strstr(shader, "void main()"));
+   EXPECT_EQ(0u, extension_calls);
+
+   /* Line numbers in later error messages must not change. */
+   unsigned newlines = 0;
+   for (const char *c = shader; *c; c++)
+      newlines += *c == '\n';
+   EXPECT_EQ(3u, newlines);
+}
+
+TEST_F(glcpp_cache, cache_hit_matches_full_preprocessor)
+{
+   static const char source[] =
+      "#define SCALE 2.0\n"
+      "uniform vec4 color;\n"
+      "void main() { gl_FragColor = color * SCALE * float(GL_TEST_extension); }\n";
+
+   const char *full = source;
+   EXPECT_EQ(0, preprocess(&full, false));
+   const char *full_log = ralloc_strdup(mem_ctx, info_log);
+
+   /* First compile misses and fills the cache. */
+   const char *first = source;
+   info_log = ralloc_strdup(mem_ctx, "");
+   EXPECT_EQ(0, preprocess(&first, true));
+   EXPECT_STREQ(full, first);
+   EXPECT_STREQ(full_log, info_log);
+   EXPECT_GE(extension_calls, 2u);
+
+   /* Second compile only has to recheck the builtin defines. */
+   const char *second = source;
+   info_log = ralloc_strdup(mem_ctx, "");
+   EXPECT_EQ(0, preprocess(&second, true));
+   EXPECT_STREQ(first, second);
+   EXPECT_STREQ(full_log, info_log);
+   EXPECT_EQ(1u, extension_calls);
+}
+
+TEST_F(glcpp_cache, changed_defines_miss)
+{
+   static const char source[] =
+      "#if GL_TEST_extension == 1\n"
+      "float f;\n"
+      "#else\n"
+      "int i;\n"
+      "#endif\n";
+
+   const char *first = source;
+   EXPECT_EQ(0, preprocess(&first, true));
+   EXPECT_NE((const char *) NULL, strstr(first, "float f;"));
+
+   extension_value = 2;
+
+   const char *second = source;
+   EXPECT_EQ(0, preprocess(&second, true));
+   EXPECT_GE(extension_calls, 2u);
+   EXPECT_EQ(NULL, strstr(second, "float f;"));
+   EXPECT_NE((const char *) NULL, strstr(second, "int i;"));
+}
+
+TEST_F(glcpp_cache, errors_are_replayed)
+{
+   static const char source[] =
+      "#error broken\n"
+      "void main() {}\n";
+
+   const char *first = source;
+   EXPECT_NE(0, preprocess(&first, true));
+   const char *first_log = ralloc_strdup(mem_ctx, info_log);
+   EXPECT_NE((const char *) NULL, strstr(first_log, "broken"));
+
+   const char *second = source;
+   info_log = ralloc_strdup(mem_ctx, "");
+   EXPECT_NE(0, preprocess(&second, true));
+   EXPECT_EQ(1u, extension_calls);
+   EXPECT_STREQ(first_log, info_log);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include "ir.h"
+#include "ir_builder.h"
+#include "ir_optimization.h"
+
+using namespace ir_builder;
+
+class dead_code : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   ir_variable *make_var(const char *name, ir_variable_mode mode);
+
+   exec_list instructions;
+   ir_factory *body;
+   void *mem_ctx;
+   ir_variable *var_in;
+   ir_variable *var_out;
+};
+
+void
+dead_code::SetUp()
+{
+   mem_ctx = ralloc_context(NULL);
+
+   instructions.make_empty();
+   body = new ir_factory(&instructions, mem_ctx);
+
+   var_in = make_var("in", ir_var_shader_in);
+   var_out = make_var("out", ir_var_shader_out);
+}
+
+void
+dead_code::TearDown()
+{
+   delete body;
+   body = NULL;
+
+   ralloc_free(mem_ctx);
+   mem_ctx = NULL;
+}
+
+ir_variable *
+dead_code::make_var(const char *name, ir_variable_mode mode)
+{
+   ir_variable *var = new(mem_ctx) ir_variable(glsl_type::float_type,
+                                               name, mode);
+   body->emit(var);
+   return var;
+}
+
+static bool
+is_declared(exec_list *instructions, ir_variable *var)
+{
+   foreach_in_list(ir_instruction, ir, instructions) {
+      if (ir == var)
+         return true;
+   }
+
+   return false;
+}
+
+TEST_F(dead_code, chain)
+{
+   ir_variable *temps[8];
+
+   /* t0 = in; t1 = t0 + in; ... t7 = t6 + in; out = in; */
+   for (unsigned i = 0; i < ARRAY_SIZE(temps); i++) {
+      temps[i] = make_var("t", ir_var_temporary);
+      if (i == 0)
+         body->emit(assign(temps[i], var_in));
+      else
+         body->emit(assign(temps[i], add(temps[i - 1], var_in)));
+   }
+   body->emit(assign(var_out, var_in));
+
+   /* Removing t7 leaves t6 dead, and so on down the chain, so the whole
+    * chain goes away in one pass.
+    */
+   EXPECT_TRUE(do_dead_code(&instructions, false));
+
+   for (unsigned i = 0; i < ARRAY_SIZE(temps); i++)
+      EXPECT_FALSE(is_declared(&instructions, temps[i]));
+
+   /* The declarations of in and out and the assignment to out. */
+   EXPECT_EQ(3u, instructions.length());
+
+   EXPECT_FALSE(do_dead_code(&instructions, false));
+}
+
+TEST_F(dead_code, read_before_assigned)
+{
+   ir_variable *var_a = make_var("a", ir_var_temporary);
+   ir_variable *var_b = make_var("b", ir_var_temporary);
+
+   /* b is read before it is assigned, so the refcount visitor doesn't list
+    * its assignment.  Removing a leaves b dead, but it can't be removed
+    * without knowing where it is assigned.
+    */
+   body->emit(assign(var_a, var_b));
+   body->emit(assign(var_b, var_in));
+   body->emit(assign(var_out, var_in));
+
+   EXPECT_TRUE(do_dead_code(&instructions, false));
+   EXPECT_FALSE(is_declared(&instructions, var_a));
+   EXPECT_TRUE(is_declared(&instructions, var_b));
+   EXPECT_EQ(5u, instructions.length());
+
+   EXPECT_TRUE(do_dead_code(&instructions, false));
+   EXPECT_FALSE(is_declared(&instructions, var_b));
+   EXPECT_EQ(3u, instructions.length());
+
+   EXPECT_FALSE(do_dead_code(&instructions, false));
+}
@@ -25,6 +25,7 @@
 #include "main/macros.h"
 #include "compiler/glsl/glsl_parser_extras.h"
 #include "glsl_types.h"
+#include "util/blob.h"
 #include "util/hash_table.h"
 
 
@@ -1994,6 +1995,230 @@ glsl_type::coordinate_components() const
    return size;
 }
 
+/* The type encoding is one uint32 for the base type in the top byte and, for
+ * the types that are fully described by a few small fields, those fields in
+ * the low bits.  Composite types follow it with their names, lengths and
+ * element types.  Zero is never a valid encoding, so it is used for NULL.
+ */
+void
+encode_type_to_blob(struct blob *blob, const glsl_type *type)
+{
+   uint32_t encoding;
+
+   if (!type) {
+      blob_write_uint32(blob, 0);
+      return;
+   }
+
+   switch (type->base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL:
+   case GLSL_TYPE_DOUBLE:
+      encoding = (type->base_type << 24) |
+                 (type->vector_elements << 4) |
+                 (type->matrix_columns);
+      break;
+   case GLSL_TYPE_SAMPLER:
+      encoding = (type->base_type << 24) |
+                 (type->sampler_dimensionality << 4) |
+                 (type->sampler_shadow << 3) |
+                 (type->sampler_array << 2) |
+                 (type->sampled_type);
+      break;
+   case GLSL_TYPE_IMAGE:
+      encoding = (type->base_type << 24) |
+                 (type->sampler_dimensionality << 4) |
+                 (type->sampler_array << 2) |
+                 (type->sampled_type);
+      break;
+   case GLSL_TYPE_ATOMIC_UINT:
+   case GLSL_TYPE_VOID:
+      encoding = type->base_type << 24;
+      break;
+   case GLSL_TYPE_SUBROUTINE:
+      blob_write_uint32(blob, type->base_type << 24);
+      blob_write_string(blob, type->name);
+      return;
+   case GLSL_TYPE_ARRAY:
+      blob_write_uint32(blob, type->base_type << 24);
+      blob_write_uint32(blob, type->length);
+      encode_type_to_blob(blob, type->fields.array);
+      return;
+   case GLSL_TYPE_STRUCT:
+   case GLSL_TYPE_INTERFACE:
+      blob_write_uint32(blob, type->base_type << 24);
+      blob_write_string(blob, type->name);
+      blob_write_uint32(blob, type->length);
+      blob_write_bytes(blob, type->fields.structure,
+                       sizeof(glsl_struct_field) * type->length);
+      for (unsigned i = 0; i < type->length; i++) {
+         encode_type_to_blob(blob, type->fields.structure[i].type);
+         blob_write_string(blob, type->fields.structure[i].name);
+      }
+
+      if (type->base_type == GLSL_TYPE_INTERFACE) {
+         blob_write_uint32(blob, type->interface_packing);
+         blob_write_uint32(blob, type->interface_row_major);
+      }
+      return;
+   case GLSL_TYPE_FUNCTION:
+      blob_write_uint32(blob, type->base_type << 24);
+      blob_write_uint32(blob, type->length);
+      /* The return type is stored as parameter 0. */
+      for (unsigned i = 0; i <= type->length; i++) {
+         encode_type_to_blob(blob, type->fields.parameters[i].type);
+         blob_write_uint32(blob, type->fields.parameters[i].in);
+         blob_write_uint32(blob, type->fields.parameters[i].out);
+      }
+      return;
+   case GLSL_TYPE_ERROR:
+   default:
+      assert(!"Cannot encode type!");
+      encoding = 0;
+      break;
+   }
+
+   blob_write_uint32(blob, encoding);
+}
+
+/**
+ * Flags the blob as unreadable, so that callers checking blob->overrun also
+ * catch types that were cut short or corrupted.
+ */
+static const glsl_type *
+decode_error(struct blob_reader *blob)
+{
+   blob->overrun = true;
+   return NULL;
+}
+
+const glsl_type *
+decode_type_from_blob(struct blob_reader *blob)
+{
+   uint32_t u = blob_read_uint32(blob);
+
+   if (u == 0)
+      return NULL;
+
+   glsl_base_type base_type = (glsl_base_type) (u >> 24);
+
+   switch (base_type) {
+   case GLSL_TYPE_UINT:
+   case GLSL_TYPE_INT:
+   case GLSL_TYPE_FLOAT:
+   case GLSL_TYPE_BOOL:
+   case GLSL_TYPE_DOUBLE:
+      return glsl_type::get_instance(base_type, (u >> 4) & 0x0f, u & 0x0f);
+   case GLSL_TYPE_SAMPLER:
+      return glsl_type::get_sampler_instance((enum glsl_sampler_dim) ((u >> 4) & 0x0f),
+                                             (u >> 3) & 0x01,
+                                             (u >> 2) & 0x01,
+                                             (glsl_base_type) ((u >> 0) & 0x03));
+   case GLSL_TYPE_IMAGE:
+      return glsl_type::get_image_instance((enum glsl_sampler_dim) ((u >> 4) & 0x0f),
+                                           (u >> 2) & 0x01,
+                                           (glsl_base_type) ((u >> 0) & 0x03));
+   case GLSL_TYPE_ATOMIC_UINT:
+      return glsl_type::atomic_uint_type;
+   case GLSL_TYPE_VOID:
+      return glsl_type::void_type;
+   case GLSL_TYPE_SUBROUTINE: {
+      const char *name = blob_read_string(blob);
+      if (blob->overrun || name == NULL)
+         return decode_error(blob);
+      return glsl_type::get_subroutine_instance(name);
+   }
+   case GLSL_TYPE_ARRAY: {
+      unsigned length = blob_read_uint32(blob);
+      const glsl_type *element_type = decode_type_from_blob(blob);
+      if (blob->overrun || element_type == NULL)
+         return decode_error(blob);
+      return glsl_type::get_array_instance(element_type, length);
+   }
+   case GLSL_TYPE_STRUCT:
+   case GLSL_TYPE_INTERFACE: {
+      char *name = blob_read_string(blob);
+      unsigned num_fields = blob_read_uint32(blob);
+      glsl_struct_field *fields = (glsl_struct_field *)
+         blob_read_bytes(blob, sizeof(glsl_struct_field) * num_fields);
+      const glsl_type *t = NULL;
+
+      if (blob->overrun || name == NULL)
+         return decode_error(blob);
+
+      /* The field array in the blob may not be aligned, and its type and
+       * name pointers are stale, so decode into a private copy.
+       */
+      glsl_struct_field *copy = (glsl_struct_field *)
+         malloc(sizeof(glsl_struct_field) * MAX2(num_fields, 1));
+      if (copy == NULL)
+         return decode_error(blob);
+      memcpy(copy, fields, sizeof(glsl_struct_field) * num_fields);
+
+      bool valid = true;
+      for (unsigned i = 0; i < num_fields && valid; i++) {
+         copy[i].type = decode_type_from_blob(blob);
+         copy[i].name = blob_read_string(blob);
+         valid = !blob->overrun && copy[i].type && copy[i].name;
+      }
+
+      if (valid && base_type == GLSL_TYPE_INTERFACE) {
+         enum glsl_interface_packing packing =
+            (glsl_interface_packing) blob_read_uint32(blob);
+         bool row_major = blob_read_uint32(blob);
+         if (!blob->overrun)
+            t = glsl_type::get_interface_instance(copy, num_fields, packing,
+                                                  row_major, name);
+      } else if (valid) {
+         t = glsl_type::get_record_instance(copy, num_fields, name);
+      }
+
+      free(copy);
+      return t ? t : decode_error(blob);
+   }
+   case GLSL_TYPE_FUNCTION: {
+      unsigned num_params = blob_read_uint32(blob);
+      const glsl_type *return_type = decode_type_from_blob(blob);
+      blob_read_uint32(blob);
+      blob_read_uint32(blob);
+
+      if (blob->overrun || return_type == NULL)
+         return decode_error(blob);
+
+      /* Don't trust num_params for the allocation before the blob has
+       * shown it holds that many parameters.
+       */
+      if (num_params > (blob->end - blob->current) / (3 * sizeof(uint32_t)))
+         return decode_error(blob);
+
+      glsl_function_param *params = (glsl_function_param *)
+         malloc(sizeof(glsl_function_param) * MAX2(num_params, 1));
+      if (params == NULL)
+         return decode_error(blob);
+
+      bool valid = true;
+      for (unsigned i = 0; i < num_params && valid; i++) {
+         params[i].type = decode_type_from_blob(blob);
+         params[i].in = blob_read_uint32(blob);
+         params[i].out = blob_read_uint32(blob);
+         valid = !blob->overrun && params[i].type;
+      }
+
+      const glsl_type *t = valid ?
+         glsl_type::get_function_instance(return_type, params, num_params) :
+         NULL;
+      free(params);
+      return t ? t : decode_error(blob);
+   }
+   case GLSL_TYPE_ERROR:
+   default:
+      /* Only a corrupt blob gets here */
+      return decode_error(blob);
+   }
+}
+
 /**
  * Declarations of type flyweights (glsl_type::_foo_type) and
  * convenience pointers (glsl_type::foo_type).
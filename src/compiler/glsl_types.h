@@ -35,6 +35,9 @@ extern "C" {
 
 struct _mesa_glsl_parse_state;
 struct glsl_symbol_table;
+struct blob;
+struct blob_reader;
+struct glsl_type;
 
 extern void
 _mesa_glsl_initialize_types(struct _mesa_glsl_parse_state *state);
@@ -42,6 +45,16 @@ _mesa_glsl_initialize_types(struct _mesa_glsl_parse_state *state);
 extern void
 _mesa_glsl_release_types(void);
 
+/**
+ * Writes a (possibly NULL) type to a blob, in a form that
+ * decode_type_from_blob() can turn back into the same type instance.
+ */
+void
+encode_type_to_blob(struct blob *blob, const struct glsl_type *type);
+
+const struct glsl_type *
+decode_type_from_blob(struct blob_reader *blob);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1956,3 +1956,47 @@ nir_system_value_from_intrinsic(nir_intrinsic_op intrin)
       unreachable("intrinsic doesn't produce a system value");
    }
 }
+
+static unsigned
+nir_shader_instr_count(nir_shader *shader)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(function, shader) {
+      if (!function->impl)
+         continue;
+
+      nir_foreach_block(block, function->impl) {
+         nir_foreach_instr(instr, block)
+            count++;
+      }
+   }
+
+   return count;
+}
+
+void
+nir_pass_stats_begin(nir_shader *shader, struct pass_stats_sample *sample)
+{
+   if (!pass_stats_enabled())
+      return;
+
+   pass_stats_begin(sample, nir_shader_instr_count(shader));
+}
+
+void
+nir_pass_stats_end(nir_shader *shader, struct pass_stats_sample *sample,
+                   const char *pass, bool progress)
+{
+   if (!pass_stats_enabled())
+      return;
+
+   pass_stats_stop(sample);
+
+   struct pass_stats *stats =
+      pass_stats_get(shader, "NIR", _mesa_shader_stage_to_abbrev(shader->stage),
+                     shader->info->label ? shader->info->label :
+                                           shader->info->name);
+   pass_stats_end(stats, sample, pass, progress,
+                  nir_shader_instr_count(shader));
+}
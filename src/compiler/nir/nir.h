@@ -36,6 +36,7 @@
 #include "util/bitset.h"
 #include "util/macros.h"
 #include "compiler/nir_types.h"
+#include "compiler/pass_stats.h"
 #include "compiler/shader_enums.h"
 #include "compiler/shader_info.h"
 #include <stdio.h>
@@ -2242,6 +2243,8 @@ nir_variable *nir_variable_clone(const nir_variable *c, nir_shader *shader);
 nir_deref *nir_deref_clone(const nir_deref *deref, void *mem_ctx);
 nir_deref_var *nir_deref_var_clone(const nir_deref_var *deref, void *mem_ctx);
 
+nir_shader *nir_shader_serialize_deserialize(void *mem_ctx, nir_shader *s);
+
 #ifdef DEBUG
 void nir_validate_shader(nir_shader *shader);
 void nir_metadata_set_validation_flag(nir_shader *shader);
@@ -2257,33 +2260,66 @@ should_clone_nir(void)
 
    return should_clone;
 }
+
+static inline bool
+should_serialize_deserialize_nir(void)
+{
+   static int test_serialize = -1;
+   if (test_serialize < 0)
+      test_serialize = env_var_as_boolean("NIR_TEST_SERIALIZE", false);
+
+   return test_serialize;
+}
 #else
 static inline void nir_validate_shader(nir_shader *shader) { (void) shader; }
 static inline void nir_metadata_set_validation_flag(nir_shader *shader) { (void) shader; }
 static inline void nir_metadata_check_validation_flag(nir_shader *shader) { (void) shader; }
 static inline bool should_clone_nir(void) { return false; }
+static inline bool should_serialize_deserialize_nir(void) { return false; }
 #endif /* DEBUG */
 
+/* Records a pass run for MESA_PASS_STATS; see compiler/pass_stats.h.
+ * Passes run through NIR_PASS_V never report progress.
+ */
+void nir_pass_stats_begin(nir_shader *shader,
+                          struct pass_stats_sample *sample);
+void nir_pass_stats_end(nir_shader *shader,
+                        struct pass_stats_sample *sample,
+                        const char *pass, bool progress);
+
 #define _PASS(nir, do_pass) do {                                     \
    do_pass                                                           \
    nir_validate_shader(nir);                                         \
    if (should_clone_nir()) {                                         \
       nir_shader *clone = nir_shader_clone(ralloc_parent(nir), nir); \
+      if (pass_stats_enabled())                                      \
+         pass_stats_transfer(nir, clone);                            \
       ralloc_free(nir);                                              \
       nir = clone;                                                   \
    }                                                                 \
+   if (should_serialize_deserialize_nir()) {                         \
+      void *mem_ctx = ralloc_parent(nir);                            \
+      nir = nir_shader_serialize_deserialize(mem_ctx, nir);          \
+   }                                                                 \
 } while (0)
 
 #define NIR_PASS(progress, nir, pass, ...) _PASS(nir,                \
+   struct pass_stats_sample _sample;                                 \
    nir_metadata_set_validation_flag(nir);                            \
-   if (pass(nir, ##__VA_ARGS__)) {                                   \
+   nir_pass_stats_begin(nir, &_sample);                              \
+   bool _progress = pass(nir, ##__VA_ARGS__);                        \
+   nir_pass_stats_end(nir, &_sample, #pass, _progress);              \
+   if (_progress) {                                                  \
       progress = true;                                               \
       nir_metadata_check_validation_flag(nir);                       \
    }                                                                 \
 )
 
 #define NIR_PASS_V(nir, pass, ...) _PASS(nir,                        \
+   struct pass_stats_sample _sample;                                 \
+   nir_pass_stats_begin(nir, &_sample);                              \
    pass(nir, ##__VA_ARGS__);                                         \
+   nir_pass_stats_end(nir, &_sample, #pass, false);                  \
 )
 
 void nir_calc_dominance_impl(nir_function_impl *impl);
@@ -0,0 +1,274 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <time.h>
+#include "nir.h"
+#include "nir_builder.h"
+#include "nir_serialize.h"
+#include "util/blob.h"
+
+class nir_serialize_test : public ::testing::Test {
+protected:
+   nir_serialize_test();
+   ~nir_serialize_test();
+
+   nir_shader *serialize_deserialize(struct blob *blob);
+   char *print_shader(nir_shader *shader);
+
+   void *mem_ctx;
+   nir_builder b;
+};
+
+static const nir_shader_compiler_options options = { };
+
+nir_serialize_test::nir_serialize_test()
+{
+   mem_ctx = ralloc_context(NULL);
+   nir_builder_init_simple_shader(&b, mem_ctx, MESA_SHADER_FRAGMENT,
+                                  &options);
+}
+
+nir_serialize_test::~nir_serialize_test()
+{
+   ralloc_free(mem_ctx);
+}
+
+nir_shader *
+nir_serialize_test::serialize_deserialize(struct blob *blob)
+{
+   nir_serialize(blob, b.shader);
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, blob->data, blob->size);
+   nir_shader *ns = nir_deserialize(mem_ctx, &options, &reader);
+
+   EXPECT_TRUE(ns != NULL);
+   EXPECT_EQ(reader.current, reader.end);
+
+   return ns;
+}
+
+char *
+nir_serialize_test::print_shader(nir_shader *shader)
+{
+   char *str;
+   size_t size;
+
+   /* SSA values are renumbered in the order they get re-created, so number
+    * them the same way before comparing.
+    */
+   nir_foreach_function(func, shader) {
+      if (func->impl)
+         nir_index_ssa_defs(func->impl);
+   }
+
+   FILE *f = open_memstream(&str, &size);
+   nir_print_shader(shader, f);
+   fclose(f);
+   return str;
+}
+
+TEST_F(nir_serialize_test, control_flow)
+{
+   /* Create IR:
+    *
+    * in vec4 in_color; uniform int count; out vec4 color;
+    *
+    * vec4 sum = vec4(0); int i = 0;
+    * while (true) {
+    *    if (i >= count) break;
+    *    sum += in_color; i++;
+    * }
+    * color = sum;
+    */
+   nir_variable *in = nir_variable_create(b.shader, nir_var_shader_in,
+                                          glsl_vec4_type(), "in_color");
+   nir_variable *count = nir_variable_create(b.shader, nir_var_uniform,
+                                             glsl_int_type(), "count");
+   nir_variable *out = nir_variable_create(b.shader, nir_var_shader_out,
+                                           glsl_vec4_type(), "color");
+   nir_variable *sum = nir_local_variable_create(b.impl, glsl_vec4_type(),
+                                                 "sum");
+   nir_variable *i = nir_local_variable_create(b.impl, glsl_int_type(), "i");
+
+   nir_store_var(&b, sum, nir_imm_vec4(&b, 0, 0, 0, 0), 0xf);
+   nir_store_var(&b, i, nir_imm_int(&b, 0), 0x1);
+
+   nir_loop *loop = nir_loop_create(b.shader);
+   nir_builder_cf_insert(&b, &loop->cf_node);
+   b.cursor = nir_after_cf_list(&loop->body);
+
+   nir_if *nif = nir_if_create(b.shader);
+   nif->condition = nir_src_for_ssa(nir_ige(&b, nir_load_var(&b, i),
+                                            nir_load_var(&b, count)));
+   nir_builder_cf_insert(&b, &nif->cf_node);
+   b.cursor = nir_after_cf_list(&nif->then_list);
+   nir_jump(&b, nir_jump_break);
+
+   b.cursor = nir_after_cf_node(&nif->cf_node);
+   nir_store_var(&b, sum, nir_fadd(&b, nir_load_var(&b, sum),
+                                   nir_load_var(&b, in)), 0xf);
+   nir_store_var(&b, i, nir_iadd(&b, nir_load_var(&b, i),
+                                 nir_imm_int(&b, 1)), 0x1);
+
+   b.cursor = nir_after_cf_node(&loop->cf_node);
+   nir_store_var(&b, out, nir_load_var(&b, sum), 0xf);
+
+   /* Turn the locals into SSA so that the shader has phis in the loop
+    * header, which reference values defined later in the loop.
+    */
+   nir_lower_vars_to_ssa(b.shader);
+   nir_validate_shader(b.shader);
+
+   struct blob *blob = blob_create(mem_ctx);
+   nir_shader *ns = serialize_deserialize(blob);
+   ASSERT_TRUE(ns != NULL);
+   nir_validate_shader(ns);
+
+   char *orig = print_shader(b.shader);
+   char *copy = print_shader(ns);
+   EXPECT_STREQ(orig, copy);
+   free(orig);
+   free(copy);
+}
+
+TEST_F(nir_serialize_test, truncated)
+{
+   nir_variable *out = nir_variable_create(b.shader, nir_var_shader_out,
+                                           glsl_vec4_type(), "color");
+   nir_store_var(&b, out, nir_imm_vec4(&b, 1, 2, 3, 4), 0xf);
+
+   struct blob *blob = blob_create(mem_ctx);
+   nir_serialize(blob, b.shader);
+
+   for (size_t size = 0; size < blob->size; size += 4) {
+      struct blob_reader reader;
+      blob_reader_init(&reader, blob->data, size);
+      EXPECT_TRUE(nir_deserialize(mem_ctx, &options, &reader) == NULL);
+   }
+}
+
+TEST_F(nir_serialize_test, truncated_array)
+{
+   nir_variable_create(b.shader, nir_var_shader_out,
+                       glsl_array_type(glsl_vec4_type(), 4), "colors");
+
+   struct blob *blob = blob_create(mem_ctx);
+   nir_serialize(blob, b.shader);
+
+   for (size_t size = 0; size < blob->size; size++) {
+      struct blob_reader reader;
+      blob_reader_init(&reader, blob->data, size);
+      EXPECT_TRUE(nir_deserialize(mem_ctx, &options, &reader) == NULL);
+   }
+}
+
+static void
+check_truncated_type(const glsl_type *type)
+{
+   struct blob *blob = blob_create(NULL);
+   encode_type_to_blob(blob, type);
+
+   struct blob_reader reader;
+   blob_reader_init(&reader, blob->data, blob->size);
+   EXPECT_EQ(type, decode_type_from_blob(&reader));
+   EXPECT_FALSE(reader.overrun);
+
+   for (size_t size = 0; size < blob->size; size++) {
+      blob_reader_init(&reader, blob->data, size);
+      EXPECT_TRUE(decode_type_from_blob(&reader) == NULL);
+      EXPECT_TRUE(reader.overrun);
+   }
+
+   ralloc_free(blob);
+}
+
+TEST_F(nir_serialize_test, truncated_types)
+{
+   check_truncated_type(glsl_type::get_array_instance(glsl_type::vec4_type,
+                                                      4));
+
+   glsl_struct_field fields[2];
+   fields[0] = glsl_struct_field(glsl_type::vec4_type, "a");
+   fields[1] = glsl_struct_field(
+      glsl_type::get_array_instance(glsl_type::float_type, 3), "b");
+   const glsl_type *record =
+      glsl_type::get_record_instance(fields, 2, "serialize_test_s");
+   check_truncated_type(record);
+   check_truncated_type(glsl_type::get_array_instance(record, 2));
+
+   check_truncated_type(
+      glsl_type::get_subroutine_instance("serialize_test_sub"));
+
+   glsl_function_param params[2];
+   params[0].type = glsl_type::vec4_type;
+   params[0].in = true;
+   params[0].out = false;
+   params[1].type = record;
+   params[1].in = true;
+   params[1].out = true;
+   check_truncated_type(
+      glsl_type::get_function_instance(glsl_type::float_type, params, 2));
+}
+
+static double
+get_time(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+TEST_F(nir_serialize_test, throughput)
+{
+   /* A long chain of ALU instructions, roughly the shape of a big
+    * unrolled shader after optimization.
+    */
+   nir_variable *in = nir_variable_create(b.shader, nir_var_shader_in,
+                                          glsl_vec4_type(), "in_color");
+   nir_variable *out = nir_variable_create(b.shader, nir_var_shader_out,
+                                           glsl_vec4_type(), "color");
+   nir_ssa_def *val = nir_load_var(&b, in);
+   for (unsigned i = 0; i < 20000; i++) {
+      val = nir_ffma(&b, val, nir_imm_float(&b, i), nir_fabs(&b, val));
+   }
+   nir_store_var(&b, out, val, 0xf);
+
+   const unsigned iterations = 10;
+   size_t bytes = 0;
+   double start = get_time();
+   for (unsigned i = 0; i < iterations; i++) {
+      struct blob *blob = blob_create(NULL);
+      nir_shader *ns = serialize_deserialize(blob);
+      ASSERT_TRUE(ns != NULL);
+      bytes += blob->size;
+      ralloc_free(ns);
+      ralloc_free(blob);
+   }
+   double time = get_time() - start;
+
+   printf("round-tripped %u x %zu bytes in %.3f ms (%.1f MB/s)\n",
+          iterations, bytes / iterations, time * 1000.0,
+          bytes / time / (1024 * 1024));
+}
@@ -0,0 +1,322 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "c11/threads.h"
+#include "util/debug.h"
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+#include "pass_stats.h"
+
+struct pass_stats_entry {
+   const char *kind;
+   const char *pass;
+   unsigned calls;
+   unsigned progress;
+   int64_t time;
+   uint64_t size_before;
+   int64_t size_change;
+};
+
+struct pass_stats_list {
+   struct pass_stats_entry *entries;
+   unsigned count;
+   unsigned size;
+};
+
+struct pass_stats {
+   const char *kind;
+   char *stage;
+   char *name;
+   void *ir;
+
+   bool has_size;
+   unsigned initial_size;
+   unsigned final_size;
+
+   struct pass_stats_list list;
+};
+
+/* Everything below is protected by pass_stats_mutex.  The per-shader
+ * statistics themselves are not, since a shader is only ever optimized by
+ * one thread at a time.
+ */
+static mtx_t pass_stats_mutex = _MTX_INITIALIZER_NP;
+static struct hash_table *pass_stats_table;
+static struct pass_stats_list process_list;
+static unsigned process_shaders;
+
+bool
+pass_stats_enabled(void)
+{
+   static int enabled = -1;
+   if (enabled < 0)
+      enabled = env_var_as_boolean("MESA_PASS_STATS", false);
+
+   return enabled;
+}
+
+static int64_t
+get_time(void)
+{
+#ifdef _WIN32
+   LARGE_INTEGER frequency, counter;
+   QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+   return counter.QuadPart * INT64_C(1000000000) / frequency.QuadPart;
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+#endif
+}
+
+static struct pass_stats_entry *
+list_get_entry(struct pass_stats_list *list, const char *kind,
+               const char *pass)
+{
+   /* Each list only ever holds a few dozen passes, and they are nearly
+    * always looked up in the order they were added, so a linear search
+    * starting from the pointer comparison is plenty.
+    */
+   for (unsigned i = 0; i < list->count; i++) {
+      struct pass_stats_entry *entry = &list->entries[i];
+      if ((entry->pass == pass || strcmp(entry->pass, pass) == 0) &&
+          (entry->kind == kind || strcmp(entry->kind, kind) == 0))
+         return entry;
+   }
+
+   if (list->count == list->size) {
+      unsigned size = list->size ? list->size * 2 : 32;
+      struct pass_stats_entry *entries =
+         realloc(list->entries, size * sizeof(*entries));
+      if (entries == NULL)
+         return NULL;
+      list->entries = entries;
+      list->size = size;
+   }
+
+   struct pass_stats_entry *entry = &list->entries[list->count++];
+   memset(entry, 0, sizeof(*entry));
+   entry->kind = kind;
+   entry->pass = pass;
+   return entry;
+}
+
+static int
+compare_entry_time(const void *a, const void *b)
+{
+   const struct pass_stats_entry *ea = a, *eb = b;
+   return (ea->time < eb->time) - (ea->time > eb->time);
+}
+
+static void
+print_entries(FILE *fp, const struct pass_stats_entry *entries,
+              unsigned count, bool print_kind)
+{
+   fprintf(fp, "   %-8s%-40s %8s %8s %10s %10s %10s\n",
+           print_kind ? "IR" : "", "pass", "calls", "progress", "time (ms)",
+           "avg size", "change");
+
+   for (unsigned i = 0; i < count; i++) {
+      const struct pass_stats_entry *entry = &entries[i];
+      fprintf(fp, "   %-8s%-40s %8u %8u %10.3f %10.0f %+10" PRId64 "\n",
+              print_kind ? entry->kind : "", entry->pass, entry->calls,
+              entry->progress, entry->time / 1e6,
+              (double) entry->size_before / entry->calls, entry->size_change);
+   }
+}
+
+static void
+print_process_stats(void)
+{
+   mtx_lock(&pass_stats_mutex);
+
+   qsort(process_list.entries, process_list.count,
+         sizeof(*process_list.entries), compare_entry_time);
+
+   int64_t time = 0;
+   for (unsigned i = 0; i < process_list.count; i++)
+      time += process_list.entries[i].time;
+
+   fprintf(stderr, "Pass statistics for %u shaders, %.3f ms total:\n",
+           process_shaders, time / 1e6);
+   print_entries(stderr, process_list.entries, process_list.count, true);
+
+   free(process_list.entries);
+   memset(&process_list, 0, sizeof(process_list));
+
+   mtx_unlock(&pass_stats_mutex);
+}
+
+static void
+pass_stats_destroy(void *ptr)
+{
+   struct pass_stats *stats = ptr;
+
+   /* Only passes that were actually run show up in the list, so the total
+    * is the time spent in passes rather than the whole compile.
+    */
+   int64_t time = 0;
+   for (unsigned i = 0; i < stats->list.count; i++)
+      time += stats->list.entries[i].time;
+
+   fprintf(stderr, "%s pass statistics for %s shader %s (%p): "
+           "size %u -> %u, %.3f ms\n",
+           stats->kind, stats->stage ? stats->stage : "unknown",
+           stats->name ? stats->name : "(unnamed)", stats->ir,
+           stats->initial_size, stats->final_size, time / 1e6);
+   print_entries(stderr, stats->list.entries, stats->list.count, false);
+
+   mtx_lock(&pass_stats_mutex);
+
+   struct hash_entry *entry =
+      _mesa_hash_table_search(pass_stats_table, stats->ir);
+   if (entry && entry->data == stats)
+      _mesa_hash_table_remove(pass_stats_table, entry);
+
+   for (unsigned i = 0; i < stats->list.count; i++) {
+      const struct pass_stats_entry *src = &stats->list.entries[i];
+      struct pass_stats_entry *dst =
+         list_get_entry(&process_list, src->kind, src->pass);
+      if (dst == NULL)
+         break;
+
+      dst->calls += src->calls;
+      dst->progress += src->progress;
+      dst->time += src->time;
+      dst->size_before += src->size_before;
+      dst->size_change += src->size_change;
+   }
+   process_shaders++;
+
+   mtx_unlock(&pass_stats_mutex);
+
+   free(stats->list.entries);
+   free(stats->stage);
+   free(stats->name);
+}
+
+struct pass_stats *
+pass_stats_get(void *ir, const char *kind, const char *stage,
+               const char *name)
+{
+   struct pass_stats *stats = NULL;
+
+   mtx_lock(&pass_stats_mutex);
+
+   if (pass_stats_table == NULL) {
+      pass_stats_table = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
+                                                 _mesa_key_pointer_equal);
+      atexit(print_process_stats);
+   }
+
+   struct hash_entry *entry = _mesa_hash_table_search(pass_stats_table, ir);
+   if (entry) {
+      stats = entry->data;
+   } else {
+      /* The destructor runs after all of the ralloc children of the stats
+       * have been freed, so nothing it uses can live in them.
+       */
+      stats = rzalloc(ir, struct pass_stats);
+      if (stats) {
+         stats->kind = kind;
+         stats->stage = stage ? strdup(stage) : NULL;
+         stats->name = name ? strdup(name) : NULL;
+         stats->ir = ir;
+         ralloc_set_destructor(stats, pass_stats_destroy);
+         _mesa_hash_table_insert(pass_stats_table, ir, stats);
+      }
+   }
+
+   mtx_unlock(&pass_stats_mutex);
+
+   return stats;
+}
+
+void
+pass_stats_transfer(void *old_ir, void *new_ir)
+{
+   mtx_lock(&pass_stats_mutex);
+
+   struct hash_entry *entry = pass_stats_table ?
+      _mesa_hash_table_search(pass_stats_table, old_ir) : NULL;
+   if (entry) {
+      struct pass_stats *stats = entry->data;
+      _mesa_hash_table_remove(pass_stats_table, entry);
+
+      stats->ir = new_ir;
+      ralloc_steal(new_ir, stats);
+      _mesa_hash_table_insert(pass_stats_table, new_ir, stats);
+   }
+
+   mtx_unlock(&pass_stats_mutex);
+}
+
+void
+pass_stats_begin(struct pass_stats_sample *sample, unsigned size)
+{
+   sample->size = size;
+   sample->time = get_time();
+}
+
+void
+pass_stats_stop(struct pass_stats_sample *sample)
+{
+   sample->time = get_time() - sample->time;
+}
+
+void
+pass_stats_end(struct pass_stats *stats,
+               const struct pass_stats_sample *sample,
+               const char *pass, bool progress, unsigned size)
+{
+   if (stats == NULL)
+      return;
+
+   struct pass_stats_entry *entry =
+      list_get_entry(&stats->list, stats->kind, pass);
+   if (entry == NULL)
+      return;
+
+   entry->calls++;
+   entry->progress += progress;
+   entry->time += sample->time;
+   entry->size_before += sample->size;
+   entry->size_change += (int64_t) size - (int64_t) sample->size;
+
+   if (!stats->has_size) {
+      stats->initial_size = sample->size;
+      stats->has_size = true;
+   }
+   stats->final_size = size;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file pass_stats.h
+ *
+ * Compile-time profiling of optimization passes.
+ *
+ * When MESA_PASS_STATS is set, every pass run through the GLSL IR
+ * do_common_optimization() loop or through NIR_PASS records its wall time,
+ * whether it made progress, and the size of the IR before and after it
+ * ran.  The numbers are collected per shader and printed to stderr when the
+ * shader's IR is freed, and are also summed over the whole process and
+ * printed at exit.
+ *
+ * Statistics are attached to the ralloc context holding the IR (the
+ * exec_list for GLSL IR, the nir_shader for NIR), so the IR-specific code
+ * only has to measure its size.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pass_stats;
+
+struct pass_stats_sample {
+   int64_t time;
+   unsigned size;
+};
+
+/** Whether MESA_PASS_STATS is set. */
+bool pass_stats_enabled(void);
+
+/**
+ * Returns the statistics attached to \p ir, creating them if this is the
+ * first pass run on it.  \p ir must be a ralloc context.  \p stage and
+ * \p name are only used to label the per-shader report and may be NULL.
+ */
+struct pass_stats *
+pass_stats_get(void *ir, const char *kind, const char *stage,
+               const char *name);
+
+/**
+ * Moves the statistics of \p old_ir over to \p new_ir, for when a shader is
+ * replaced by a copy of itself.
+ */
+void pass_stats_transfer(void *old_ir, void *new_ir);
+
+/**
+ * A pass is measured by calling pass_stats_begin() with the IR size before
+ * running it, pass_stats_stop() right after it returns, and then
+ * pass_stats_end() with the new IR size, so that the time spent measuring
+ * the IR is not charged to the pass.
+ */
+void pass_stats_begin(struct pass_stats_sample *sample, unsigned size);
+
+void pass_stats_stop(struct pass_stats_sample *sample);
+
+void pass_stats_end(struct pass_stats *stats,
+                    const struct pass_stats_sample *sample,
+                    const char *pass, bool progress, unsigned size);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
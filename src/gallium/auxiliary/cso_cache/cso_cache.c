@@ -172,11 +172,12 @@ static inline void sanitize_cb(struct cso_hash *hash, enum cso_cache_type type,
    int to_remove =  (max_size < max_entries) * max_entries/4;
    if (hash_size > max_size)
       to_remove += hash_size - max_size;
-   while (to_remove) {
+   struct cso_hash_iter iter = cso_hash_first_node(hash);
+   while (to_remove && !cso_hash_iter_is_null(iter)) {
       /*remove elements until we're good */
       /*fixme: currently we pick the nodes to remove at random*/
-      struct cso_hash_iter iter = cso_hash_first_node(hash);
-      void  *cso = cso_hash_take(hash, cso_hash_iter_key(iter));
+      void  *cso = cso_hash_iter_data(iter);
+      iter = cso_hash_erase(hash, iter);
       delete_cso(cso, type);
       --to_remove;
    }
@@ -216,7 +217,7 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 	  */
          return iter_data;
       }
-      iter = cso_hash_iter_next(iter);
+      iter = cso_hash_find_next(iter);
    }
    return NULL;
 }
@@ -231,7 +232,7 @@ struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
       void *iter_data = cso_hash_iter_data(iter);
       if (!memcmp(iter_data, templ, size))
          return iter;
-      iter = cso_hash_iter_next(iter);
+      iter = cso_hash_find_next(iter);
    }
    return iter;
 }
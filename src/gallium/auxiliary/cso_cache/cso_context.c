@@ -103,6 +103,17 @@ struct cso_context {
     * The saved state is used as a 1-deep stack.
     */
    void *blend, *blend_saved;
+
+   /** The cache entries last bound through cso_set_*(), so that setting
+    * the same state again only costs a memcmp rather than a hash lookup.
+    * They are only valid while their handle is the one bound above, and are
+    * cleared when the entry is evicted.
+    */
+   struct cso_blend *blend_cso;
+   struct cso_depth_stencil_alpha *depth_stencil_cso;
+   struct cso_rasterizer *rasterizer_cso;
+   struct cso_velements *velements_cso;
+
    void *depth_stencil, *depth_stencil_saved;
    void *rasterizer, *rasterizer_saved;
    void *fragment_shader, *fragment_shader_saved;
@@ -132,6 +143,9 @@ static boolean delete_blend_state(struct cso_context *ctx, void *state)
    if (ctx->blend == cso->data)
       return FALSE;
 
+   if (ctx->blend_cso == cso)
+      ctx->blend_cso = NULL;
+
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
    FREE(state);
@@ -146,6 +160,9 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
    if (ctx->depth_stencil == cso->data)
       return FALSE;
 
+   if (ctx->depth_stencil_cso == cso)
+      ctx->depth_stencil_cso = NULL;
+
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
    FREE(state);
@@ -168,6 +185,8 @@ static boolean delete_rasterizer_state(struct cso_context *ctx, void *state)
 
    if (ctx->rasterizer == cso->data)
       return FALSE;
+   if (ctx->rasterizer_cso == cso)
+      ctx->rasterizer_cso = NULL;
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
    FREE(state);
@@ -182,6 +201,9 @@ static boolean delete_vertex_elements(struct cso_context *ctx,
    if (ctx->velements == cso->data)
       return FALSE;
 
+   if (ctx->velements_cso == cso)
+      ctx->velements_cso = NULL;
+
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
    FREE(state);
@@ -242,9 +264,21 @@ sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
       for (i = 0; i < PIPE_SHADER_TYPES; i++) {
          for (j = 0; j < ctx->samplers[i].nr_samplers; j++) {
             struct cso_sampler *sampler = ctx->samplers[i].cso_samplers[j];
+            struct cso_hash_iter iter;
+
+            if (!sampler)
+               continue;
 
-            if (sampler && cso_hash_take(hash, sampler->hash_key))
+            /* Other samplers may share the key, so look for this one. */
+            iter = cso_hash_find(hash, sampler->hash_key);
+            while (!cso_hash_iter_is_null(iter) &&
+                   cso_hash_iter_data(iter) != sampler)
+               iter = cso_hash_find_next(iter);
+
+            if (!cso_hash_iter_is_null(iter)) {
+               cso_hash_erase(hash, iter);
                samplers_to_restore[to_restore++] = sampler;
+            }
          }
       }
    }
@@ -449,17 +483,22 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
 {
    unsigned key_size, hash_key;
    struct cso_hash_iter iter;
-   void *handle;
+   struct cso_blend *cso;
 
    key_size = templ->independent_blend_enable ?
       sizeof(struct pipe_blend_state) :
       (char *)&(templ->rt[1]) - (char *)templ;
+
+   if (ctx->blend_cso && ctx->blend_cso->data == ctx->blend &&
+       !memcmp(&ctx->blend_cso->state, templ, key_size))
+      return PIPE_OK;
+
    hash_key = cso_construct_key((void*)templ, key_size);
    iter = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
                                   (void*)templ, key_size);
 
    if (cso_hash_iter_is_null(iter)) {
-      struct cso_blend *cso = MALLOC(sizeof(struct cso_blend));
+      cso = MALLOC(sizeof(struct cso_blend));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -474,16 +513,15 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
    }
    else {
-      handle = ((struct cso_blend *)cso_hash_iter_data(iter))->data;
+      cso = (struct cso_blend *)cso_hash_iter_data(iter);
    }
 
-   if (ctx->blend != handle) {
-      ctx->blend = handle;
-      ctx->pipe->bind_blend_state(ctx->pipe, handle);
+   ctx->blend_cso = cso;
+   if (ctx->blend != cso->data) {
+      ctx->blend = cso->data;
+      ctx->pipe->bind_blend_state(ctx->pipe, cso->data);
    }
    return PIPE_OK;
 }
@@ -512,16 +550,22 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
                             const struct pipe_depth_stencil_alpha_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_depth_stencil_alpha_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_DEPTH_STENCIL_ALPHA,
-                                                       (void*)templ, key_size);
-   void *handle;
+   unsigned hash_key;
+   struct cso_hash_iter iter;
+   struct cso_depth_stencil_alpha *cso;
+
+   if (ctx->depth_stencil_cso &&
+       ctx->depth_stencil_cso->data == ctx->depth_stencil &&
+       !memcmp(&ctx->depth_stencil_cso->state, templ, key_size))
+      return PIPE_OK;
+
+   hash_key = cso_construct_key((void*)templ, key_size);
+   iter = cso_find_state_template(ctx->cache, hash_key,
+                                  CSO_DEPTH_STENCIL_ALPHA,
+                                  (void*)templ, key_size);
 
    if (cso_hash_iter_is_null(iter)) {
-      struct cso_depth_stencil_alpha *cso =
-         MALLOC(sizeof(struct cso_depth_stencil_alpha));
+      cso = MALLOC(sizeof(struct cso_depth_stencil_alpha));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -538,17 +582,15 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
    }
    else {
-      handle = ((struct cso_depth_stencil_alpha *)
-                cso_hash_iter_data(iter))->data;
+      cso = (struct cso_depth_stencil_alpha *)cso_hash_iter_data(iter);
    }
 
-   if (ctx->depth_stencil != handle) {
-      ctx->depth_stencil = handle;
-      ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, handle);
+   ctx->depth_stencil_cso = cso;
+   if (ctx->depth_stencil != cso->data) {
+      ctx->depth_stencil = cso->data;
+      ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, cso->data);
    }
    return PIPE_OK;
 }
@@ -577,15 +619,20 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
                                    const struct pipe_rasterizer_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_rasterizer_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_RASTERIZER,
-                                                       (void*)templ, key_size);
-   void *handle = NULL;
+   unsigned hash_key;
+   struct cso_hash_iter iter;
+   struct cso_rasterizer *cso;
+
+   if (ctx->rasterizer_cso && ctx->rasterizer_cso->data == ctx->rasterizer &&
+       !memcmp(&ctx->rasterizer_cso->state, templ, key_size))
+      return PIPE_OK;
+
+   hash_key = cso_construct_key((void*)templ, key_size);
+   iter = cso_find_state_template(ctx->cache, hash_key, CSO_RASTERIZER,
+                                  (void*)templ, key_size);
 
    if (cso_hash_iter_is_null(iter)) {
-      struct cso_rasterizer *cso = MALLOC(sizeof(struct cso_rasterizer));
+      cso = MALLOC(sizeof(struct cso_rasterizer));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -600,16 +647,15 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
    }
    else {
-      handle = ((struct cso_rasterizer *)cso_hash_iter_data(iter))->data;
+      cso = (struct cso_rasterizer *)cso_hash_iter_data(iter);
    }
 
-   if (ctx->rasterizer != handle) {
-      ctx->rasterizer = handle;
-      ctx->pipe->bind_rasterizer_state(ctx->pipe, handle);
+   ctx->rasterizer_cso = cso;
+   if (ctx->rasterizer != cso->data) {
+      ctx->rasterizer = cso->data;
+      ctx->pipe->bind_rasterizer_state(ctx->pipe, cso->data);
    }
    return PIPE_OK;
 }
@@ -1044,7 +1090,7 @@ cso_set_vertex_elements(struct cso_context *ctx,
    struct u_vbuf *vbuf = ctx->vbuf;
    unsigned key_size, hash_key;
    struct cso_hash_iter iter;
-   void *handle;
+   struct cso_velements *cso;
    struct cso_velems_state velems_state;
 
    if (vbuf) {
@@ -1061,12 +1107,17 @@ cso_set_vertex_elements(struct cso_context *ctx,
    velems_state.count = count;
    memcpy(velems_state.velems, states,
           sizeof(struct pipe_vertex_element) * count);
+
+   if (ctx->velements_cso && ctx->velements_cso->data == ctx->velements &&
+       !memcmp(&ctx->velements_cso->state, &velems_state, key_size))
+      return PIPE_OK;
+
    hash_key = cso_construct_key((void*)&velems_state, key_size);
    iter = cso_find_state_template(ctx->cache, hash_key, CSO_VELEMENTS,
                                   (void*)&velems_state, key_size);
 
    if (cso_hash_iter_is_null(iter)) {
-      struct cso_velements *cso = MALLOC(sizeof(struct cso_velements));
+      cso = MALLOC(sizeof(struct cso_velements));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -1082,16 +1133,15 @@ cso_set_vertex_elements(struct cso_context *ctx,
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
    }
    else {
-      handle = ((struct cso_velements *)cso_hash_iter_data(iter))->data;
+      cso = (struct cso_velements *)cso_hash_iter_data(iter);
    }
 
-   if (ctx->velements != handle) {
-      ctx->velements = handle;
-      ctx->pipe->bind_vertex_elements_state(ctx->pipe, handle);
+   ctx->velements_cso = cso;
+   if (ctx->velements != cso->data) {
+      ctx->velements = cso->data;
+      ctx->pipe->bind_vertex_elements_state(ctx->pipe, cso->data);
    }
    return PIPE_OK;
 }
@@ -1207,12 +1257,21 @@ cso_single_sampler(struct cso_context *ctx, unsigned shader_stage,
 {
    if (templ) {
       unsigned key_size = sizeof(struct pipe_sampler_state);
-      unsigned hash_key = cso_construct_key((void*)templ, key_size);
-      struct cso_sampler *cso;
-      struct cso_hash_iter iter =
-         cso_find_state_template(ctx->cache,
-                                 hash_key, CSO_SAMPLER,
-                                 (void *) templ, key_size);
+      unsigned hash_key;
+      struct cso_sampler *cso = ctx->samplers[shader_stage].cso_samplers[idx];
+      struct cso_hash_iter iter;
+
+      /* Samplers below nr_samplers are bound, and so can't have been
+       * evicted from the cache.
+       */
+      if (cso && idx < ctx->samplers[shader_stage].nr_samplers &&
+          !memcmp(&cso->state, templ, key_size))
+         return PIPE_OK;
+
+      hash_key = cso_construct_key((void*)templ, key_size);
+      iter = cso_find_state_template(ctx->cache,
+                                     hash_key, CSO_SAMPLER,
+                                     (void *) templ, key_size);
 
       if (cso_hash_iter_is_null(iter)) {
          cso = MALLOC(sizeof(struct cso_sampler));
@@ -25,6 +25,7 @@
  *
  **************************************************************************/
 
+
  /*
   * Authors:
   *   Zack Rusin <zackr@vmware.com>
@@ -35,407 +36,307 @@
 
 #include "cso_hash.h"
 
-#ifndef MAX
-#define MAX(a, b) ((a > b) ? (a) : (b))
-#endif
-
-static const int MinNumBits = 4;
+#define CSO_HASH_MIN_BITS 4
 
-static const unsigned char prime_deltas[] = {
-   0,  0,  1,  3,  1,  5,  3,  3,  1,  9,  7,  5,  3,  9, 25,  3,
-   1, 21,  3, 21,  7, 15,  9,  5,  3, 29, 15,  0,  0,  0,  0,  0
+enum cso_node_state {
+   CSO_NODE_EMPTY = 0,
+   CSO_NODE_USED,
+   CSO_NODE_DELETED
 };
 
-static int primeForNumBits(int numBits)
-{
-   return (1 << numBits) + prime_deltas[numBits];
-}
-
-/*
-    Returns the smallest integer n such that
-    primeForNumBits(n) >= hint.
-*/
-static int countBits(int hint)
-{
-   int numBits = 0;
-   int bits = hint;
-
-   while (bits > 1) {
-      bits >>= 1;
-      numBits++;
-   }
-
-   if (numBits >= (int)sizeof(prime_deltas)) {
-      numBits = sizeof(prime_deltas) - 1;
-   } else if (primeForNumBits(numBits) < hint) {
-      ++numBits;
-   }
-   return numBits;
-}
-
 struct cso_node {
-   struct cso_node *next;
    unsigned key;
+   unsigned state;
    void *value;
 };
 
-struct cso_hash_data {
-   struct cso_node *fakeNext;
-   struct cso_node **buckets;
-   int size;
-   int nodeSize;
-   short userNumBits;
-   short numBits;
-   int numBuckets;
-};
-
+/*
+ * Open addressing with linear probing.  The nodes live in a single
+ * power-of-two sized array, so a lookup usually touches one or two cache
+ * lines and compares the full keys stored inline before the caller ever
+ * looks at the data.  Removed nodes are turned into tombstones so that
+ * iterators stay valid across cso_hash_erase(); they are dropped the next
+ * time the table is resized.
+ */
 struct cso_hash {
-   union {
-      struct cso_hash_data *d;
-      struct cso_node      *e;
-   } data;
+   struct cso_node *nodes;
+   unsigned bits;
+   unsigned size;
+   unsigned deleted;
 };
 
-static void *cso_data_allocate_node(struct cso_hash_data *hash)
+
+static inline unsigned cso_hash_capacity(const struct cso_hash *hash)
 {
-   return MALLOC(hash->nodeSize);
+   return hash->nodes ? 1u << hash->bits : 0;
 }
 
-static void cso_free_node(struct cso_node *node)
+static inline unsigned cso_hash_home(const struct cso_hash *hash,
+                                     unsigned key)
 {
-   FREE(node);
+   /* Keys are frequently weak (cso_construct_key() just xors the state
+    * together), so scramble them before picking the start of the probe
+    * sequence from the top bits.
+    */
+   return (key * 2654435769u) >> (32 - hash->bits);
 }
 
-static struct cso_node *
-cso_hash_create_node(struct cso_hash *hash,
-                      unsigned akey, void *avalue,
-                      struct cso_node **anextNode)
+/**
+ * Smallest table that keeps \p size entries under a third full.
+ */
+static unsigned cso_hash_bits_for_size(unsigned size)
 {
-   struct cso_node *node = cso_data_allocate_node(hash->data.d);
-
-   if (!node)
-      return NULL;
+   unsigned bits = CSO_HASH_MIN_BITS;
 
-   node->key = akey;
-   node->value = avalue;
-
-   node->next = (struct cso_node*)(*anextNode);
-   *anextNode = node;
-   ++hash->data.d->size;
-   return node;
+   while ((1u << bits) < size * 3)
+      ++bits;
+   return bits;
 }
 
-static void cso_data_rehash(struct cso_hash_data *hash, int hint)
+static boolean cso_hash_rehash(struct cso_hash *hash, unsigned bits)
 {
-   if (hint < 0) {
-      hint = countBits(-hint);
-      if (hint < MinNumBits)
-         hint = MinNumBits;
-      hash->userNumBits = (short)hint;
-      while (primeForNumBits(hint) < (hash->size >> 1))
-         ++hint;
-   } else if (hint < MinNumBits) {
-      hint = MinNumBits;
+   struct cso_node *old_nodes = hash->nodes;
+   unsigned old_capacity = cso_hash_capacity(hash);
+   unsigned mask = (1u << bits) - 1;
+   unsigned i;
+
+   hash->nodes = CALLOC(1u << bits, sizeof(struct cso_node));
+   if (!hash->nodes) {
+      hash->nodes = old_nodes;
+      return FALSE;
    }
+   hash->bits = bits;
+   hash->deleted = 0;
 
-   if (hash->numBits != hint) {
-      struct cso_node *e = (struct cso_node *)(hash);
-      struct cso_node **oldBuckets = hash->buckets;
-      int oldNumBuckets = hash->numBuckets;
-      int  i = 0;
-
-      hash->numBits = (short)hint;
-      hash->numBuckets = primeForNumBits(hint);
-      hash->buckets = MALLOC(sizeof(struct cso_node*) * hash->numBuckets);
-      for (i = 0; i < hash->numBuckets; ++i)
-         hash->buckets[i] = e;
-
-      for (i = 0; i < oldNumBuckets; ++i) {
-         struct cso_node *firstNode = oldBuckets[i];
-         while (firstNode != e) {
-            unsigned h = firstNode->key;
-            struct cso_node *lastNode = firstNode;
-            struct cso_node *afterLastNode;
-            struct cso_node **beforeFirstNode;
-            
-            while (lastNode->next != e && lastNode->next->key == h)
-               lastNode = lastNode->next;
-
-            afterLastNode = lastNode->next;
-            beforeFirstNode = &hash->buckets[h % hash->numBuckets];
-            while (*beforeFirstNode != e)
-               beforeFirstNode = &(*beforeFirstNode)->next;
-            lastNode->next = *beforeFirstNode;
-            *beforeFirstNode = firstNode;
-            firstNode = afterLastNode;
-         }
-      }
-      FREE(oldBuckets);
+   for (i = 0; i < old_capacity; ++i) {
+      unsigned idx;
+
+      if (old_nodes[i].state != CSO_NODE_USED)
+         continue;
+
+      idx = cso_hash_home(hash, old_nodes[i].key);
+      while (hash->nodes[idx].state != CSO_NODE_EMPTY)
+         idx = (idx + 1) & mask;
+      hash->nodes[idx] = old_nodes[i];
    }
+
+   FREE(old_nodes);
+   return TRUE;
 }
 
-static void cso_data_might_grow(struct cso_hash_data *hash)
+static boolean cso_data_might_grow(struct cso_hash *hash)
 {
-   if (hash->size >= hash->numBuckets)
-      cso_data_rehash(hash, hash->numBits + 1);
+   /* Keep at least a third of the nodes empty, counting tombstones as
+    * used since probe sequences have to walk over them too.
+    */
+   if ((hash->size + hash->deleted + 1) * 3 > cso_hash_capacity(hash) * 2)
+      return cso_hash_rehash(hash, cso_hash_bits_for_size(hash->size + 1));
+   return TRUE;
 }
 
-static void cso_data_has_shrunk(struct cso_hash_data *hash)
+static void cso_data_has_shrunk(struct cso_hash *hash)
 {
-   if (hash->size <= (hash->numBuckets >> 3) &&
-       hash->numBits > hash->userNumBits) {
-      int max = MAX(hash->numBits-2, hash->userNumBits);
-      cso_data_rehash(hash,  max);
-   }
+   if (hash->bits > CSO_HASH_MIN_BITS &&
+       hash->size * 8 < cso_hash_capacity(hash))
+      cso_hash_rehash(hash, cso_hash_bits_for_size(hash->size));
 }
 
-static struct cso_node *cso_data_first_node(struct cso_hash_data *hash)
+static struct cso_node *cso_hash_find_node(struct cso_hash *hash,
+                                           unsigned key,
+                                           unsigned idx)
 {
-   struct cso_node *e = (struct cso_node *)(hash);
-   struct cso_node **bucket = hash->buckets;
-   int n = hash->numBuckets;
-   while (n--) {
-      if (*bucket != e)
-         return *bucket;
-      ++bucket;
+   unsigned mask = cso_hash_capacity(hash) - 1;
+
+   /* There is always at least one empty node, so this terminates. */
+   for (;;) {
+      struct cso_node *node = &hash->nodes[idx];
+
+      if (node->state == CSO_NODE_EMPTY)
+         return NULL;
+      if (node->state == CSO_NODE_USED && node->key == key)
+         return node;
+      idx = (idx + 1) & mask;
    }
-   return e;
 }
 
-static struct cso_node **cso_hash_find_node(struct cso_hash *hash, unsigned akey)
+static struct cso_node *cso_hash_next_used(struct cso_hash *hash,
+                                           unsigned idx)
 {
-   struct cso_node **node;
-
-   if (hash->data.d->numBuckets) {
-      node = (struct cso_node **)(&hash->data.d->buckets[akey % hash->data.d->numBuckets]);
-      assert(*node == hash->data.e || (*node)->next);
-      while (*node != hash->data.e && (*node)->key != akey)
-         node = &(*node)->next;
-   } else {
-      node = (struct cso_node **)((const struct cso_node * const *)(&hash->data.e));
+   unsigned capacity = cso_hash_capacity(hash);
+
+   for (; idx < capacity; ++idx) {
+      if (hash->nodes[idx].state == CSO_NODE_USED)
+         return &hash->nodes[idx];
    }
-   return node;
+   return NULL;
+}
+
+static void cso_hash_remove_node(struct cso_hash *hash,
+                                 struct cso_node *node)
+{
+   node->state = CSO_NODE_DELETED;
+   node->value = NULL;
+   --hash->size;
+   ++hash->deleted;
 }
 
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash,
                                        unsigned key, void *data)
 {
-   cso_data_might_grow(hash->data.d);
-
-   {
-      struct cso_node **nextNode = cso_hash_find_node(hash, key);
-      struct cso_node *node = cso_hash_create_node(hash, key, data, nextNode);
-      if (!node) {
-         struct cso_hash_iter null_iter = {hash, 0};
-         return null_iter;
-      }
+   struct cso_hash_iter iter = {hash, NULL};
+   unsigned mask, idx;
 
-      {
-         struct cso_hash_iter iter = {hash, node};
-         return iter;
-      }
-   }
+   if (!cso_data_might_grow(hash))
+      return iter;
+
+   /* Duplicate keys are allowed, so the first free node will do. */
+   mask = cso_hash_capacity(hash) - 1;
+   idx = cso_hash_home(hash, key);
+   while (hash->nodes[idx].state == CSO_NODE_USED)
+      idx = (idx + 1) & mask;
+
+   if (hash->nodes[idx].state == CSO_NODE_DELETED)
+      --hash->deleted;
+
+   iter.node = &hash->nodes[idx];
+   iter.node->key = key;
+   iter.node->state = CSO_NODE_USED;
+   iter.node->value = data;
+   ++hash->size;
+
+   return iter;
 }
 
 struct cso_hash * cso_hash_create(void)
 {
-   struct cso_hash *hash = MALLOC_STRUCT(cso_hash);
-   if (!hash)
-      return NULL;
-
-   hash->data.d = MALLOC_STRUCT(cso_hash_data);
-   if (!hash->data.d) {
-      FREE(hash);
-      return NULL;
-   }
-
-   hash->data.d->fakeNext = 0;
-   hash->data.d->buckets = 0;
-   hash->data.d->size = 0;
-   hash->data.d->nodeSize = sizeof(struct cso_node);
-   hash->data.d->userNumBits = (short)MinNumBits;
-   hash->data.d->numBits = 0;
-   hash->data.d->numBuckets = 0;
-
-   return hash;
+   return CALLOC_STRUCT(cso_hash);
 }
 
 void cso_hash_delete(struct cso_hash *hash)
 {
-   struct cso_node *e_for_x = (struct cso_node *)(hash->data.d);
-   struct cso_node **bucket = (struct cso_node **)(hash->data.d->buckets);
-   int n = hash->data.d->numBuckets;
-   while (n--) {
-      struct cso_node *cur = *bucket++;
-      while (cur != e_for_x) {
-         struct cso_node *next = cur->next;
-         cso_free_node(cur);
-         cur = next;
-      }
-   }
-   FREE(hash->data.d->buckets);
-   FREE(hash->data.d);
+   FREE(hash->nodes);
    FREE(hash);
 }
 
 struct cso_hash_iter cso_hash_find(struct cso_hash *hash,
                                      unsigned key)
 {
-   struct cso_node **nextNode = cso_hash_find_node(hash, key);
-   struct cso_hash_iter iter = {hash, *nextNode};
+   struct cso_hash_iter iter = {hash, NULL};
+
+   if (hash->size)
+      iter.node = cso_hash_find_node(hash, key, cso_hash_home(hash, key));
    return iter;
 }
 
+struct cso_hash_iter cso_hash_find_next(struct cso_hash_iter iter)
+{
+   struct cso_hash *hash = iter.hash;
+   struct cso_hash_iter next = {hash, NULL};
+
+   if (iter.node) {
+      unsigned idx = (iter.node - hash->nodes + 1) &
+                     (cso_hash_capacity(hash) - 1);
+      next.node = cso_hash_find_node(hash, iter.node->key, idx);
+   }
+   return next;
+}
+
 unsigned cso_hash_iter_key(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
+   if (!iter.node)
       return 0;
    return iter.node->key;
 }
 
 void * cso_hash_iter_data(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
+   if (!iter.node)
       return 0;
    return iter.node->value;
 }
 
-static struct cso_node *cso_hash_data_next(struct cso_node *node)
-{
-   union {
-      struct cso_node *next;
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node **bucket;
-   int n;
-
-   a.next = node->next;
-   if (!a.next) {
-      debug_printf("iterating beyond the last element\n");
-      return 0;
-   }
-   if (a.next->next)
-      return a.next;
-
-   start = (node->key % a.d->numBuckets) + 1;
-   bucket = a.d->buckets + start;
-   n = a.d->numBuckets - start;
-   while (n--) {
-      if (*bucket != a.e)
-         return *bucket;
-      ++bucket;
-   }
-   return a.e;
-}
-
-
-static struct cso_node *cso_hash_data_prev(struct cso_node *node)
+struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter)
 {
-   union {
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node *sentinel;
-   struct cso_node **bucket;
-
-   a.e = node;
-   while (a.e->next)
-      a.e = a.e->next;
-
-   if (node == a.e)
-      start = a.d->numBuckets - 1;
-   else
-      start = node->key % a.d->numBuckets;
-
-   sentinel = node;
-   bucket = a.d->buckets + start;
-   while (start >= 0) {
-      if (*bucket != sentinel) {
-         struct cso_node *prev = *bucket;
-         while (prev->next != sentinel)
-            prev = prev->next;
-         return prev;
-      }
+   struct cso_hash_iter next = {iter.hash, NULL};
 
-      sentinel = a.e;
-      --bucket;
-      --start;
+   if (!iter.node) {
+      debug_printf("iterating beyond the last element\n");
+      return next;
    }
-   debug_printf("iterating backward beyond first element\n");
-   return a.e;
-}
 
-struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter)
-{
-   struct cso_hash_iter next = {iter.hash, cso_hash_data_next(iter.node)};
+   next.node = cso_hash_next_used(iter.hash,
+                                  iter.node - iter.hash->nodes + 1);
    return next;
 }
 
 int cso_hash_iter_is_null(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.node == iter.hash->data.e)
-      return 1;
-   return 0;
+   return !iter.node;
 }
 
 void * cso_hash_take(struct cso_hash *hash,
                       unsigned akey)
 {
-   struct cso_node **node = cso_hash_find_node(hash, akey);
-   if (*node != hash->data.e) {
-      void *t = (*node)->value;
-      struct cso_node *next = (*node)->next;
-      cso_free_node(*node);
-      *node = next;
-      --hash->data.d->size;
-      cso_data_has_shrunk(hash->data.d);
-      return t;
-   }
-   return 0;
+   struct cso_hash_iter iter = cso_hash_find(hash, akey);
+   void *t;
+
+   if (!iter.node)
+      return 0;
+
+   t = iter.node->value;
+   cso_hash_remove_node(hash, iter.node);
+   cso_data_has_shrunk(hash);
+   return t;
 }
 
 struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter)
 {
-   struct cso_hash_iter prev = {iter.hash,
-                                 cso_hash_data_prev(iter.node)};
+   struct cso_hash_iter prev = {iter.hash, NULL};
+   struct cso_node *node;
+
+   if (!iter.node) {
+      debug_printf("iterating backward beyond first element\n");
+      return prev;
+   }
+
+   for (node = iter.node; node != iter.hash->nodes; ) {
+      --node;
+      if (node->state == CSO_NODE_USED) {
+         prev.node = node;
+         break;
+      }
+   }
    return prev;
 }
 
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash)
 {
-   struct cso_hash_iter iter = {hash, cso_data_first_node(hash->data.d)};
+   struct cso_hash_iter iter = {hash, NULL};
+
+   if (hash->size)
+      iter.node = cso_hash_next_used(hash, 0);
    return iter;
 }
 
 int cso_hash_size(struct cso_hash *hash)
 {
-   return hash->data.d->size;
+   return hash->size;
 }
 
 struct cso_hash_iter cso_hash_erase(struct cso_hash *hash, struct cso_hash_iter iter)
 {
-   struct cso_hash_iter ret = iter;
-   struct cso_node *node = iter.node;
-   struct cso_node **node_ptr;
+   struct cso_hash_iter ret = {hash, NULL};
 
-   if (node == hash->data.e)
+   if (!iter.node)
       return iter;
 
-   ret = cso_hash_iter_next(ret);
-   node_ptr = (struct cso_node**)(&hash->data.d->buckets[node->key % hash->data.d->numBuckets]);
-   while (*node_ptr != node)
-      node_ptr = &(*node_ptr)->next;
-   *node_ptr = node->next;
-   cso_free_node(node);
-   --hash->data.d->size;
+   /* Don't resize here, callers erase while iterating. */
+   cso_hash_remove_node(hash, iter.node);
+   ret.node = cso_hash_next_used(hash, iter.node - hash->nodes + 1);
    return ret;
 }
 
 boolean cso_hash_contains(struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **node = cso_hash_find_node(hash, key);
-   return (*node != hash->data.e);
+   return !cso_hash_iter_is_null(cso_hash_find(hash, key));
 }
@@ -41,6 +41,7 @@
 #include "util/u_prim.h"
 #include "util/u_format.h"
 #include "util/u_draw.h"
+#include "util/trace_event.h"
 
 
 DEBUG_GET_ONCE_BOOL_OPTION(draw_fse, "DRAW_FSE", FALSE)
@@ -544,6 +545,8 @@ draw_vbo(struct draw_context *draw,
     * the min_index/max_index hints given by the state tracker.
     */
 
+   trace_event_begin("draw_vbo");
+
    for (instance = 0; instance < info->instance_count; instance++) {
       unsigned instance_idx = instance + info->start_instance;
       draw->start_instance = info->start_instance;
@@ -565,6 +568,8 @@ draw_vbo(struct draw_context *draw,
       }
    }
 
+   trace_event_end("draw_vbo");
+
    /* If requested emit the pipeline statistics for this run */
    if (draw->collect_statistics) {
       draw->render->pipeline_statistics(draw->render, &draw->statistics);
@@ -28,6 +28,7 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/trace_event.h"
 #include "draw/draw_context.h"
 #include "draw/draw_vbuf.h"
 #include "draw/draw_vertex.h"
@@ -157,6 +158,7 @@ static void fetch( struct pt_fetch *fetch,
                    const struct draw_fetch_info *fetch_info,
                    char *output)
 {
+   trace_event_begin("draw fetch");
    if (fetch_info->linear) {
       draw_pt_fetch_run_linear( fetch,
                                 fetch_info->start,
@@ -169,6 +171,7 @@ static void fetch( struct pt_fetch *fetch,
                          fetch_info->count,
                          output );
    }
+   trace_event_end("draw fetch");
 }
 
 
@@ -176,6 +179,7 @@ static void pipeline(struct fetch_pipeline_middle_end *fpme,
                      const struct draw_vertex_info *vert_info,
                      const struct draw_prim_info *prim_info)
 {
+   trace_event_begin("draw pipeline");
    if (prim_info->linear)
       draw_pipeline_run_linear( fpme->draw,
                                 vert_info,
@@ -184,6 +188,7 @@ static void pipeline(struct fetch_pipeline_middle_end *fpme,
       draw_pipeline_run( fpme->draw,
                          vert_info,
                          prim_info );
+   trace_event_end("draw pipeline");
 }
 
 
@@ -192,12 +197,14 @@ emit(struct pt_emit *emit,
      const struct draw_vertex_info *vert_info,
      const struct draw_prim_info *prim_info)
 {
+   trace_event_begin("draw emit");
    if (prim_info->linear) {
       draw_pt_emit_linear(emit, vert_info, prim_info);
    }
    else {
       draw_pt_emit(emit, vert_info, prim_info);
    }
+   trace_event_end("draw emit");
 }
 
 
@@ -215,6 +222,7 @@ draw_vertex_shader_run(struct draw_vertex_shader *vshader,
       (struct vertex_header *)MALLOC(output_verts->vertex_size *
                                      align(output_verts->count, 4));
 
+   trace_event_begin("draw vs");
    vshader->run_linear(vshader,
                        (const float (*)[4])input_verts->verts->data,
                        (      float (*)[4])output_verts->verts->data,
@@ -223,6 +231,7 @@ draw_vertex_shader_run(struct draw_vertex_shader *vshader,
                        input_verts->count,
                        input_verts->vertex_size,
                        input_verts->vertex_size);
+   trace_event_end("draw vs");
 }
 
 
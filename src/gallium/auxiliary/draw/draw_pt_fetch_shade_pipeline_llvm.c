@@ -28,6 +28,7 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/trace_event.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -311,6 +312,7 @@ pipeline(struct llvm_middle_end *llvm,
          const struct draw_vertex_info *vert_info,
          const struct draw_prim_info *prim_info)
 {
+   trace_event_begin("draw pipeline");
    if (prim_info->linear)
       draw_pipeline_run_linear( llvm->draw,
                                 vert_info,
@@ -319,6 +321,7 @@ pipeline(struct llvm_middle_end *llvm,
       draw_pipeline_run( llvm->draw,
                          vert_info,
                          prim_info );
+   trace_event_end("draw pipeline");
 }
 
 
@@ -327,12 +330,14 @@ emit(struct pt_emit *emit,
      const struct draw_vertex_info *vert_info,
      const struct draw_prim_info *prim_info)
 {
+   trace_event_begin("draw emit");
    if (prim_info->linear) {
       draw_pt_emit_linear(emit, vert_info, prim_info);
    }
    else {
       draw_pt_emit(emit, vert_info, prim_info);
    }
+   trace_event_end("draw emit");
 }
 
 
@@ -385,6 +390,7 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       vid_base = draw->pt.user.eltBias;
       elts = fetch_info->elts;
    }
+   trace_event_begin("draw fetch+vs");
    clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
                                              llvm_vert_info.verts,
                                              draw->pt.user.vbuffer,
@@ -396,6 +402,7 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                                              vid_base,
                                              draw->start_instance,
                                              elts);
+   trace_event_end("draw fetch+vs");
 
    /* Finished with fetch and vs:
     */
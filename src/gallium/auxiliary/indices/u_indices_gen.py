@@ -202,9 +202,9 @@ def preamble(intype, outtype, inpv, outpv, pr, prim):
     print '    void *_out )'
     print '{'
     if intype != GENERATE:
-        print '  const ' + intype + '*in = (const ' + intype + '*)_in;'
-    print '  ' + outtype + ' *out = (' + outtype + '*)_out;'
-    print '  unsigned i, j;'
+        print '  const ' + intype + ' * restrict in = (const ' + intype + '*)_in;'
+    print '  ' + outtype + ' * restrict out = (' + outtype + '*)_out;'
+    print '  size_t i, j;'
     print '  (void)j;'
 
 def postamble():
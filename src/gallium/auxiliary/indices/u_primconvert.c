@@ -39,17 +39,36 @@
  *       return;
  *    }
  *
+ * Converted index buffers are kept in a u_upload_cache.
  */
 
 #include "pipe/p_state.h"
 #include "util/u_draw.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "util/u_upload_cache.h"
 #include "util/u_upload_mgr.h"
 
 #include "indices/u_indices.h"
 #include "indices/u_primconvert.h"
 
+#define PRIMCONVERT_CACHE_SIZE 64
+
+#define PRIMCONVERT_CACHE_MAX_BYTES (32 * 1024 * 1024)
+
+struct primconvert_cache_key
+{
+   struct pipe_resource *buffer; /* NULL for non-indexed draws */
+   unsigned offset;
+   unsigned index_size;
+   unsigned mode;
+   unsigned start;
+   unsigned count;
+   unsigned api_pv;
+   unsigned primitive_restart;
+   unsigned restart_index;
+};
+
 struct primconvert_context
 {
    struct pipe_context *pipe;
@@ -57,6 +76,7 @@ struct primconvert_context
    uint32_t primtypes_mask;
    unsigned api_pv;
    struct u_upload_mgr *upload;
+   struct u_upload_cache *cache;
 };
 
 
@@ -68,12 +88,19 @@ util_primconvert_create(struct pipe_context *pipe, uint32_t primtypes_mask)
       return NULL;
    pc->pipe = pipe;
    pc->primtypes_mask = primtypes_mask;
+   pc->cache = u_upload_cache_create(PRIMCONVERT_CACHE_SIZE,
+                                     PRIMCONVERT_CACHE_MAX_BYTES);
+   if (!pc->cache) {
+      FREE(pc);
+      return NULL;
+   }
    return pc;
 }
 
 void
 util_primconvert_destroy(struct primconvert_context *pc)
 {
+   u_upload_cache_destroy(pc->cache);
    if (pc->upload)
       u_upload_destroy(pc->upload);
    util_primconvert_save_index_buffer(pc, NULL);
@@ -115,6 +142,9 @@ util_primconvert_draw_vbo(struct primconvert_context *pc,
    struct pipe_index_buffer new_ib;
    struct pipe_draw_info new_info;
    struct pipe_transfer *src_transfer = NULL;
+   struct primconvert_cache_key key;
+   struct u_upload_cache_source source = { NULL, 0 };
+   boolean cacheable;
    u_translate_func trans_func;
    u_generate_func gen_func;
    const void *src = NULL;
@@ -143,6 +173,8 @@ util_primconvert_draw_vbo(struct primconvert_context *pc,
                                PIPE_TRANSFER_READ, &src_transfer);
       }
       src = (const uint8_t *)src + ib->offset;
+      source.data = (const uint8_t *)src + info->start * ib->index_size;
+      source.size = info->count * ib->index_size;
    }
    else {
       u_index_generator(pc->primtypes_mask,
@@ -152,25 +184,58 @@ util_primconvert_draw_vbo(struct primconvert_context *pc,
                         &gen_func);
    }
 
-   if (!pc->upload) {
-      pc->upload = u_upload_create(pc->pipe, 4096, PIPE_BIND_INDEX_BUFFER,
-                                   PIPE_USAGE_STREAM);
+   /* User buffers can't be told apart, so don't bother caching them. */
+   cacheable = !info->indexed || ib->buffer != NULL;
+   if (cacheable) {
+      memset(&key, 0, sizeof(key));
+      if (info->indexed) {
+         key.buffer = ib->buffer;
+         key.offset = ib->offset;
+         key.index_size = ib->index_size;
+      }
+      key.mode = info->mode;
+      key.start = info->start;
+      key.count = info->count;
+      key.api_pv = pc->api_pv;
+      key.primitive_restart = info->primitive_restart;
+      if (info->primitive_restart)
+         key.restart_index = info->restart_index;
    }
 
-   u_upload_alloc(pc->upload, 0, new_ib.index_size * new_info.count, 4,
-                  &new_ib.offset, &new_ib.buffer, &dst);
-
-   if (info->indexed) {
-      trans_func(src, info->start, info->count, new_info.count, info->restart_index, dst);
+   if (cacheable &&
+       u_upload_cache_find(pc->cache, &key, sizeof(key),
+                           &source, info->indexed ? 1 : 0,
+                           &new_ib.buffer, &new_ib.offset)) {
+      if (src_transfer)
+         pipe_buffer_unmap(pc->pipe, src_transfer);
    }
    else {
-      gen_func(info->start, new_info.count, dst);
-   }
+      if (!pc->upload) {
+         pc->upload = u_upload_create(pc->pipe, 4096, PIPE_BIND_INDEX_BUFFER,
+                                      PIPE_USAGE_STREAM);
+      }
+
+      u_upload_alloc(pc->upload, 0, new_ib.index_size * new_info.count, 4,
+                     &new_ib.offset, &new_ib.buffer, &dst);
+
+      if (info->indexed) {
+         trans_func(src, info->start, info->count, new_info.count, info->restart_index, dst);
+      }
+      else {
+         gen_func(info->start, new_info.count, dst);
+      }
 
-   if (src_transfer)
-      pipe_buffer_unmap(pc->pipe, src_transfer);
+      if (cacheable && new_ib.buffer) {
+         u_upload_cache_add(pc->cache, &key, sizeof(key),
+                            &source, info->indexed ? 1 : 0,
+                            new_ib.buffer, new_ib.offset);
+      }
 
-   u_upload_unmap(pc->upload);
+      if (src_transfer)
+         pipe_buffer_unmap(pc->pipe, src_transfer);
+
+      u_upload_unmap(pc->upload);
+   }
 
    /* bind new index buffer: */
    pc->pipe->set_index_buffer(pc->pipe, &new_ib);
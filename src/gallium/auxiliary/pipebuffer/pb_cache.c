@@ -28,9 +28,16 @@
 
 #include "pb_cache.h"
 #include "util/u_memory.h"
+#include "util/u_math.h"
 #include "util/u_time.h"
 
 
+static unsigned
+pb_cache_size_class(pb_size size)
+{
+   return MIN2(util_last_bit64(size), PB_CACHE_NUM_SIZE_CLASSES - 1);
+}
+
 /**
  * Actually destroy the buffer.
  */
@@ -43,6 +50,7 @@ destroy_buffer_locked(struct pb_cache_entry *entry)
    assert(!pipe_is_referenced(&buf->reference));
    if (entry->head.next) {
       LIST_DEL(&entry->head);
+      LIST_DEL(&entry->lru);
       assert(mgr->num_buffers);
       --mgr->num_buffers;
       mgr->cache_size -= buf->size;
@@ -51,21 +59,27 @@ destroy_buffer_locked(struct pb_cache_entry *entry)
 }
 
 /**
- * Free as many cache buffers from the list head as possible.
+ * Free as many cache buffers from the LRU list head as possible.
+ *
+ * The list is ordered by expiry time across all buckets and size classes,
+ * so this only ever looks at one buffer that isn't released.
  */
 static void
-release_expired_buffers_locked(struct list_head *cache)
+release_expired_buffers_locked(struct pb_cache *mgr)
 {
    struct list_head *curr, *next;
    struct pb_cache_entry *entry;
    int64_t now;
 
+   if (LIST_IS_EMPTY(&mgr->lru))
+      return;
+
    now = os_time_get();
 
-   curr = cache->next;
+   curr = mgr->lru.next;
    next = curr->next;
-   while (curr != cache) {
-      entry = LIST_ENTRY(struct pb_cache_entry, curr, head);
+   while (curr != &mgr->lru) {
+      entry = LIST_ENTRY(struct pb_cache_entry, curr, lru);
 
       if (!os_time_timeout(entry->start, entry->end, now))
          break;
@@ -85,15 +99,13 @@ void
 pb_cache_add_buffer(struct pb_cache_entry *entry)
 {
    struct pb_cache *mgr = entry->mgr;
-   struct list_head *cache = &mgr->buckets[entry->bucket_index];
+   struct pb_cache_bucket *bucket = &mgr->buckets[entry->bucket_index];
    struct pb_buffer *buf = entry->buffer;
-   unsigned i;
 
    pipe_mutex_lock(mgr->mutex);
    assert(!pipe_is_referenced(&buf->reference));
 
-   for (i = 0; i < ARRAY_SIZE(mgr->buckets); i++)
-      release_expired_buffers_locked(&mgr->buckets[i]);
+   release_expired_buffers_locked(mgr);
 
    /* Directly release any buffer that exceeds the limit. */
    if (mgr->cache_size + buf->size > mgr->max_cache_size) {
@@ -104,7 +116,9 @@ pb_cache_add_buffer(struct pb_cache_entry *entry)
 
    entry->start = os_time_get();
    entry->end = entry->start + mgr->usecs;
-   LIST_ADDTAIL(&entry->head, cache);
+   entry->size_class = pb_cache_size_class(buf->size);
+   LIST_ADDTAIL(&entry->head, &bucket->size_classes[entry->size_class]);
+   LIST_ADDTAIL(&entry->lru, &mgr->lru);
    ++mgr->num_buffers;
    mgr->cache_size += buf->size;
    pipe_mutex_unlock(mgr->mutex);
@@ -117,7 +131,8 @@ pb_cache_add_buffer(struct pb_cache_entry *entry)
  */
 static int
 pb_cache_is_buffer_compat(struct pb_cache_entry *entry,
-                          pb_size size, unsigned alignment, unsigned usage)
+                          pb_size size, pb_size max_size,
+                          unsigned alignment, unsigned usage)
 {
    struct pb_cache *mgr = entry->mgr;
    struct pb_buffer *buf = entry->buffer;
@@ -126,11 +141,7 @@ pb_cache_is_buffer_compat(struct pb_cache_entry *entry,
       return 0;
 
    /* be lenient with size */
-   if (buf->size < size ||
-       buf->size > (unsigned) (mgr->size_factor * size))
-      return 0;
-
-   if (usage & mgr->bypass_usage)
+   if (buf->size < size || buf->size > max_size)
       return 0;
 
    if (!pb_check_alignment(alignment, buf->alignment))
@@ -142,62 +153,43 @@ pb_cache_is_buffer_compat(struct pb_cache_entry *entry,
 /**
  * Find a compatible buffer in the cache, return it, and remove it
  * from the cache.
+ *
+ * Only the size classes that can hold a buffer of an acceptable size are
+ * searched, smallest first.  Within a size class buffers are in the order
+ * they were added, so once one is still busy, the rest most likely are as
+ * well and the next size class is tried instead.
  */
 struct pb_buffer *
 pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
                         unsigned alignment, unsigned usage,
                         unsigned bucket_index)
 {
-   struct pb_cache_entry *entry;
-   struct pb_cache_entry *cur_entry;
-   struct list_head *cur, *next;
-   int64_t now;
-   int ret = 0;
-   struct list_head *cache = &mgr->buckets[bucket_index];
-
-   pipe_mutex_lock(mgr->mutex);
-
-   entry = NULL;
-   cur = cache->next;
-   next = cur->next;
-
-   /* search in the expired buffers, freeing them in the process */
-   now = os_time_get();
-   while (cur != cache) {
-      cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
-
-      if (!entry && (ret = pb_cache_is_buffer_compat(cur_entry, size,
-                                                     alignment, usage) > 0))
-         entry = cur_entry;
-      else if (os_time_timeout(cur_entry->start, cur_entry->end, now))
-         destroy_buffer_locked(cur_entry);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
-         break;
+   struct pb_cache_bucket *bucket = &mgr->buckets[bucket_index];
+   struct pb_cache_entry *entry = NULL;
+   pb_size max_size = (pb_size)(mgr->size_factor * size);
+   unsigned first_class = pb_cache_size_class(size);
+   unsigned last_class = pb_cache_size_class(max_size);
+   unsigned i;
 
-      /* the buffer is busy (and probably all remaining ones too) */
-      if (ret == -1)
-         break;
+   if (usage & mgr->bypass_usage)
+      return NULL;
 
-      cur = next;
-      next = cur->next;
-   }
+   pipe_mutex_lock(mgr->mutex);
 
-   /* keep searching in the hot buffers */
-   if (!entry && ret != -1) {
-      while (cur != cache) {
-         cur_entry = LIST_ENTRY(struct pb_cache_entry, cur, head);
-         ret = pb_cache_is_buffer_compat(cur_entry, size, alignment, usage);
+   for (i = first_class; i <= last_class && !entry; i++) {
+      struct pb_cache_entry *cur_entry;
 
+      LIST_FOR_EACH_ENTRY(cur_entry, &bucket->size_classes[i], head) {
+         int ret = pb_cache_is_buffer_compat(cur_entry, size, max_size,
+                                             alignment, usage);
          if (ret > 0) {
             entry = cur_entry;
             break;
          }
+
+         /* the buffer is busy (and probably all remaining ones too) */
          if (ret == -1)
             break;
-         /* no need to check the timeout here */
-         cur = next;
-         next = cur->next;
       }
    }
 
@@ -207,6 +199,7 @@ pb_cache_reclaim_buffer(struct pb_cache *mgr, pb_size size,
 
       mgr->cache_size -= buf->size;
       LIST_DEL(&entry->head);
+      LIST_DEL(&entry->lru);
       --mgr->num_buffers;
       pipe_mutex_unlock(mgr->mutex);
       /* Increase refcount */
@@ -226,20 +219,15 @@ pb_cache_release_all_buffers(struct pb_cache *mgr)
 {
    struct list_head *curr, *next;
    struct pb_cache_entry *buf;
-   unsigned i;
 
    pipe_mutex_lock(mgr->mutex);
-   for (i = 0; i < ARRAY_SIZE(mgr->buckets); i++) {
-      struct list_head *cache = &mgr->buckets[i];
-
-      curr = cache->next;
+   curr = mgr->lru.next;
+   next = curr->next;
+   while (curr != &mgr->lru) {
+      buf = LIST_ENTRY(struct pb_cache_entry, curr, lru);
+      destroy_buffer_locked(buf);
+      curr = next;
       next = curr->next;
-      while (curr != cache) {
-         buf = LIST_ENTRY(struct pb_cache_entry, curr, head);
-         destroy_buffer_locked(buf);
-         curr = next;
-         next = curr->next;
-      }
    }
    pipe_mutex_unlock(mgr->mutex);
 }
@@ -275,10 +263,13 @@ pb_cache_init(struct pb_cache *mgr, uint usecs, float size_factor,
               void (*destroy_buffer)(struct pb_buffer *buf),
               bool (*can_reclaim)(struct pb_buffer *buf))
 {
-   unsigned i;
+   unsigned i, j;
 
-   for (i = 0; i < ARRAY_SIZE(mgr->buckets); i++)
-      LIST_INITHEAD(&mgr->buckets[i]);
+   for (i = 0; i < ARRAY_SIZE(mgr->buckets); i++) {
+      for (j = 0; j < PB_CACHE_NUM_SIZE_CLASSES; j++)
+         LIST_INITHEAD(&mgr->buckets[i].size_classes[j]);
+   }
+   LIST_INITHEAD(&mgr->lru);
 
    pipe_mutex_init(mgr->mutex);
    mgr->cache_size = 0;
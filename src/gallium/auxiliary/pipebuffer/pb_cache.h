@@ -33,16 +33,30 @@
 #include "util/list.h"
 #include "os/os_thread.h"
 
+/**
+ * Cached buffers are kept in one list per power-of-two size class, so that
+ * reclaiming a buffer only looks at buffers of roughly the right size.
+ */
+#define PB_CACHE_NUM_SIZE_CLASSES 40
+
 /**
  * Statically inserted into the driver-specific buffer structure.
  */
 struct pb_cache_entry
 {
-   struct list_head head;
+   struct list_head head; /**< In the size class list of its bucket. */
+   struct list_head lru;  /**< In pb_cache::lru. */
    struct pb_buffer *buffer; /**< Pointer to the structure this is part of. */
    struct pb_cache *mgr;
    int64_t start, end; /**< Caching time interval */
    unsigned bucket_index;
+   unsigned size_class;
+};
+
+struct pb_cache_bucket
+{
+   /* Least recently added first. */
+   struct list_head size_classes[PB_CACHE_NUM_SIZE_CLASSES];
 };
 
 struct pb_cache
@@ -50,7 +64,10 @@ struct pb_cache
    /* The cache is divided into buckets for minimizing cache misses.
     * The driver controls which buffer goes into which bucket.
     */
-   struct list_head buckets[4];
+   struct pb_cache_bucket buckets[4];
+
+   /* All cached buffers, least recently added first, for expiring them. */
+   struct list_head lru;
 
    pipe_mutex mutex;
    uint64_t cache_size;
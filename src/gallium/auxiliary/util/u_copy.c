@@ -0,0 +1,285 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Copy engine for large memory copies.
+ */
+
+
+#include "pipe/p_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "os/os_thread.h"
+#include "util/u_copy.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_queue.h"
+#include "util/u_sse.h"
+
+
+/** Beyond a few threads the copies are bound by memory bandwidth */
+#define UTIL_COPY_MAX_THREADS 3
+
+
+struct util_copy_job {
+   uint8_t *dst;
+   const uint8_t *src;
+   unsigned dst_stride;
+   unsigned dst_slice_stride;
+   int src_stride;
+   unsigned src_slice_stride;
+   unsigned row_size;
+   unsigned height;
+
+   /** Range of rows, counted across slices, to copy */
+   unsigned first_row;
+   unsigned num_rows;
+
+   boolean streaming;
+   struct util_queue_fence fence;
+};
+
+
+pipe_static_mutex(copy_queue_mutex);
+static struct util_queue copy_queue;
+static boolean copy_queue_initialized = FALSE;
+
+
+/**
+ * memcpy() with non-temporal stores.  The caller must issue a store fence
+ * before the data is consumed by another thread.
+ */
+static void
+util_memcpy_streaming(uint8_t *dst, const uint8_t *src, size_t size)
+{
+#if defined(PIPE_ARCH_SSE)
+   if (util_cpu_caps.has_sse2 && size >= 64) {
+      size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+
+      memcpy(dst, src, head);
+      dst += head;
+      src += head;
+      size -= head;
+
+      while (size >= 64) {
+         __m128i a = _mm_loadu_si128((const __m128i *)src + 0);
+         __m128i b = _mm_loadu_si128((const __m128i *)src + 1);
+         __m128i c = _mm_loadu_si128((const __m128i *)src + 2);
+         __m128i d = _mm_loadu_si128((const __m128i *)src + 3);
+
+         _mm_stream_si128((__m128i *)dst + 0, a);
+         _mm_stream_si128((__m128i *)dst + 1, b);
+         _mm_stream_si128((__m128i *)dst + 2, c);
+         _mm_stream_si128((__m128i *)dst + 3, d);
+
+         dst += 64;
+         src += 64;
+         size -= 64;
+      }
+   }
+#endif
+
+   memcpy(dst, src, size);
+}
+
+
+static void
+util_copy_job_execute(void *data, int thread_index)
+{
+   struct util_copy_job *job = (struct util_copy_job *)data;
+   unsigned z = job->first_row / job->height;
+   unsigned y = job->first_row % job->height;
+   uint8_t *dst = job->dst + z * job->dst_slice_stride + y * job->dst_stride;
+   const uint8_t *src = job->src + z * job->src_slice_stride +
+                        (ptrdiff_t)y * job->src_stride;
+   unsigned i;
+
+   for (i = 0; i < job->num_rows; ++i) {
+      if (job->streaming)
+         util_memcpy_streaming(dst, src, job->row_size);
+      else
+         memcpy(dst, src, job->row_size);
+
+      if (++y == job->height) {
+         y = 0;
+         ++z;
+         dst = job->dst + z * job->dst_slice_stride;
+         src = job->src + z * job->src_slice_stride;
+      } else {
+         dst += job->dst_stride;
+         src += job->src_stride;
+      }
+   }
+
+#if defined(PIPE_ARCH_SSE)
+   if (job->streaming)
+      _mm_sfence();
+#endif
+}
+
+
+static void
+util_copy_destroy_queue(void)
+{
+   util_queue_destroy(&copy_queue);
+}
+
+
+/**
+ * Return the number of worker threads, creating them on first use.
+ *
+ * The workers are destroyed from an atexit() handler.  Handlers registered
+ * from a shared object also run when it is unloaded with dlclose(), so this
+ * covers drivers that are unloaded before the process exits.
+ */
+static unsigned
+util_copy_get_num_threads(void)
+{
+   if (!copy_queue_initialized) {
+      pipe_mutex_lock(copy_queue_mutex);
+      if (!copy_queue_initialized) {
+         unsigned num_threads;
+
+         util_cpu_detect();
+         num_threads = debug_get_num_option("GALLIUM_COPY_THREADS", 0);
+         num_threads = MIN3(num_threads, util_cpu_caps.nr_cpus - 1,
+                            UTIL_COPY_MAX_THREADS);
+
+         if (num_threads) {
+            util_queue_init(&copy_queue, "copy", 4 * num_threads, num_threads);
+            if (util_queue_is_initialized(&copy_queue))
+               atexit(util_copy_destroy_queue);
+         }
+
+         copy_queue_initialized = TRUE;
+      }
+      pipe_mutex_unlock(copy_queue_mutex);
+   }
+
+   return util_queue_is_initialized(&copy_queue) ? copy_queue.num_threads : 0;
+}
+
+
+void
+util_copy_rows(void *dst, unsigned dst_stride, unsigned dst_slice_stride,
+               const void *src, int src_stride, unsigned src_slice_stride,
+               unsigned row_size, unsigned height, unsigned depth)
+{
+   struct util_copy_job jobs[UTIL_COPY_MAX_THREADS + 1];
+   uint64_t size = (uint64_t)row_size * height * depth;
+   unsigned num_rows = height * depth;
+   unsigned num_threads, num_jobs, rows_per_job, i;
+
+   if (!size)
+      return;
+
+   /* Fold contiguous rows and slices so that they're copied at once */
+   if (dst_stride == row_size && src_stride == (int)row_size) {
+      row_size *= height;
+      dst_stride = src_stride = 0;
+      height = 1;
+      if (depth == 1 ||
+          (dst_slice_stride == row_size && src_slice_stride == row_size)) {
+         row_size *= depth;
+         depth = 1;
+      }
+      num_rows = depth;
+   }
+
+   jobs[0].dst = dst;
+   jobs[0].src = src;
+   jobs[0].dst_stride = dst_stride;
+   jobs[0].dst_slice_stride = height == 1 && depth == 1 ? 0 : dst_slice_stride;
+   jobs[0].src_stride = src_stride;
+   jobs[0].src_slice_stride = height == 1 && depth == 1 ? 0 : src_slice_stride;
+   jobs[0].row_size = row_size;
+   jobs[0].height = height;
+   jobs[0].first_row = 0;
+   jobs[0].num_rows = num_rows;
+   /* memcpy() already streams large contiguous copies by itself */
+   jobs[0].streaming = num_rows > 1 && size >= UTIL_COPY_STREAMING_MIN_SIZE;
+
+   /* Without workers, splitting would only make memcpy() see smaller
+    * copies.
+    */
+   num_threads = size >= UTIL_COPY_THREADED_MIN_SIZE ?
+                 util_copy_get_num_threads() : 0;
+   if (!num_threads) {
+      util_copy_job_execute(&jobs[0], 0);
+      return;
+   }
+
+   /* A single huge row is split into several rows */
+   if (num_rows == 1) {
+      unsigned slice_size = align(DIV_ROUND_UP(row_size,
+                                               UTIL_COPY_MAX_THREADS + 1), 64);
+      jobs[0].height = 1;
+      jobs[0].dst_slice_stride = jobs[0].src_slice_stride = slice_size;
+      num_rows = row_size / slice_size;
+      jobs[0].row_size = slice_size;
+      jobs[0].num_rows = num_rows;
+
+      /* Leftover bytes */
+      if (num_rows * slice_size < row_size) {
+         memcpy((uint8_t *)dst + num_rows * slice_size,
+                (const uint8_t *)src + num_rows * slice_size,
+                row_size - num_rows * slice_size);
+      }
+   }
+
+   num_jobs = MIN3(num_threads + 1, num_rows,
+                   size / UTIL_COPY_THREADED_SLICE_SIZE);
+   if (num_jobs <= 1) {
+      util_copy_job_execute(&jobs[0], 0);
+      return;
+   }
+
+   rows_per_job = DIV_ROUND_UP(num_rows, num_jobs);
+   num_jobs = DIV_ROUND_UP(num_rows, rows_per_job);
+
+   for (i = 1; i < num_jobs; ++i) {
+      jobs[i] = jobs[0];
+      jobs[i].first_row = i * rows_per_job;
+      jobs[i].num_rows = MIN2(rows_per_job, num_rows - jobs[i].first_row);
+      util_queue_fence_init(&jobs[i].fence);
+      util_queue_add_job(&copy_queue, &jobs[i], &jobs[i].fence,
+                         util_copy_job_execute, NULL);
+   }
+
+   /* The calling thread copies the first rows itself */
+   jobs[0].num_rows = rows_per_job;
+   util_copy_job_execute(&jobs[0], 0);
+
+   for (i = 1; i < num_jobs; ++i) {
+      util_queue_job_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
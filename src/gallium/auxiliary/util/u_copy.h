@@ -0,0 +1,87 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Copy engine for large memory copies.
+ *
+ * Contiguous copies are plain memcpy()s, which already switch to
+ * non-temporal stores for large sizes.  Large copies of many short rows use
+ * non-temporal stores per row, so the destination doesn't evict everything
+ * else and isn't read for ownership.
+ *
+ * Multi-megabyte copies can also be split across a small pool of worker
+ * threads by setting GALLIUM_COPY_THREADS to the number of workers.  This
+ * is off by default and never used on single CPU systems.
+ */
+
+#ifndef U_COPY_H
+#define U_COPY_H
+
+
+#include "pipe/p_compiler.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Strided copies at least this large use non-temporal stores.  Below this,
+ * they were slower than a memcpy() per row in tests/unit/u_copy_test.
+ */
+#define UTIL_COPY_STREAMING_MIN_SIZE (16 * 1024 * 1024)
+
+/** Copies at least this large are split across threads */
+#define UTIL_COPY_THREADED_MIN_SIZE (4 * 1024 * 1024)
+
+/** Size of the slices given to each thread */
+#define UTIL_COPY_THREADED_SLICE_SIZE (1024 * 1024)
+
+
+/**
+ * Copy depth slices of height rows of row_size bytes each.
+ * src_stride may be negative to flip rows.  dst and src must not overlap.
+ */
+void
+util_copy_rows(void *dst, unsigned dst_stride, unsigned dst_slice_stride,
+               const void *src, int src_stride, unsigned src_slice_stride,
+               unsigned row_size, unsigned height, unsigned depth);
+
+static inline void
+util_memcpy_large(void *dst, const void *src, size_t size)
+{
+   util_copy_rows(dst, 0, 0, src, 0, 0, size, 1, 1);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_COPY_H */
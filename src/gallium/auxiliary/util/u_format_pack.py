@@ -611,6 +611,321 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print_channels(format, pack_into_union)
 
 
+def is_unorm8x4(format):
+    '''Whether the format is four 8-bit unsigned normalized channels in a
+    32-bit pixel, some of which may be padding.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    if format.block_width != 1 or format.block_height != 1:
+        return False
+    nr_unorm = 0
+    for i in range(4):
+        channel = format.le_channels[i]
+        if channel.size != 8 or channel.shift != 8*i:
+            return False
+        if channel.type == UNSIGNED and channel.norm and not channel.pure:
+            nr_unorm += 1
+        elif channel.type != VOID:
+            return False
+    return nr_unorm > 0
+
+
+def is_half4(format):
+    '''Whether the format is four 16-bit floats, some of which may be
+    padding.'''
+
+    if format.layout != PLAIN or format.block_width != 1 or format.block_height != 1:
+        return False
+    nr_float = 0
+    for channel in format.le_channels:
+        if channel.size != 16:
+            return False
+        if channel.type == FLOAT:
+            nr_float += 1
+        elif channel.type != VOID:
+            return False
+    return nr_float > 0
+
+
+def is_unorm_bitmask16(format):
+    '''Whether the format packs unsigned normalized channels into 16 bits.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    if format.block_width != 1 or format.block_height != 1:
+        return False
+    if format.block_size() != 16 or format.is_array():
+        return False
+    for channel in format.le_channels:
+        if channel.type == VOID:
+            continue
+        if channel.type != UNSIGNED or not channel.norm or channel.pure:
+            return False
+    return True
+
+
+def simd_swizzle_ps(var, swizzles):
+    '''Swizzle the channels of a pixel held in an __m128.'''
+
+    lines = []
+    order = [swizzles[i] if swizzles[i] < 4 else i for i in range(4)]
+    if order != range(4):
+        lines.append('%s = _mm_shuffle_ps(%s, %s, _MM_SHUFFLE(%s));' % (var, var, var,
+                     ', '.join([str(order[i]) for i in range(3, -1, -1)])))
+    if [swizzle for swizzle in swizzles if swizzle >= 4]:
+        lines.append('%s = _mm_or_ps(_mm_and_ps(%s, keep), constants);' % (var, var))
+    return lines
+
+
+def simd_constants_ps(swizzles):
+    '''Declare the masks simd_swizzle_ps() uses for constant channels.'''
+
+    if not [swizzle for swizzle in swizzles if swizzle >= 4]:
+        return []
+    keep = ['-1' if swizzle < 4 else '0' for swizzle in swizzles]
+    constants = ['1.0f' if swizzle == SWIZZLE_1 else '0.0f' for swizzle in swizzles]
+    return [
+        'const __m128 keep = _mm_castsi128_ps(_mm_setr_epi32(%s));' % ', '.join(keep),
+        'const __m128 constants = _mm_setr_ps(%s);' % ', '.join(constants),
+    ]
+
+
+def simd_byte_swizzle(var, indices):
+    '''Return the statements that move the bytes of the 32-bit pixels held
+    in an __m128i, where indices gives the source byte of each destination
+    byte, or None for zero.  Bytes moving by the same amount are moved
+    together, so common swizzles take only a few instructions.'''
+
+    masks = {}
+    for dst, src in enumerate(indices):
+        if src is not None:
+            masks[dst - src] = masks.get(dst - src, 0) | (0xff << 8*dst)
+
+    terms = []
+    for shift in sorted(masks.keys()):
+        term = var
+        if shift > 0:
+            term = '_mm_slli_epi32(%s, %u)' % (term, 8*shift)
+        elif shift < 0:
+            term = '_mm_srli_epi32(%s, %u)' % (term, -8*shift)
+        if masks[shift] != 0xffffffff:
+            term = '_mm_and_si128(%s, _mm_set1_epi32(0x%x))' % (term, masks[shift])
+        terms.append(term)
+
+    if not terms:
+        return ['%s = _mm_setzero_si128();' % var]
+    expr = terms[0]
+    for term in terms[1:]:
+        expr = '_mm_or_si128(%s, %s)' % (expr, term)
+    if expr == var:
+        return []
+    return ['%s = %s;' % (var, expr)]
+
+
+def simd_unpack(format, dst_channel, dst_native_type):
+    '''Return the body of an SSE2 loop that converts the start of a row, or
+    None if the format has none.
+
+    The loop must leave x, src and dst at the first pixel it did not
+    convert, and produce exactly the same results as the scalar code.'''
+
+    swizzles = format.le_swizzles
+
+    if is_unorm8x4(format) and dst_channel.type == FLOAT and dst_channel.size == 32:
+        lines = [
+            'const __m128i zero = _mm_setzero_si128();',
+            'const __m128 scale = _mm_set1_ps(1.0f/255.0f);',
+        ] + simd_constants_ps(swizzles) + [
+            'for(; x + 4 <= width; x += 4) {',
+            '   __m128i pixels = _mm_loadu_si128((const __m128i *)src);',
+            '   __m128i lo = _mm_unpacklo_epi8(pixels, zero);',
+            '   __m128i hi = _mm_unpackhi_epi8(pixels, zero);',
+            '   __m128 p[4];',
+            '   unsigned i;',
+            '   p[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));',
+            '   p[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));',
+            '   p[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));',
+            '   p[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));',
+            '   for(i = 0; i < 4; ++i) {',
+            '      p[i] = _mm_mul_ps(p[i], scale);',
+        ] + ['      ' + line for line in simd_swizzle_ps('p[i]', swizzles)] + [
+            '      _mm_storeu_ps(dst + 4*i, p[i]);',
+            '   }',
+            '   src += 16;',
+            '   dst += 16;',
+            '}',
+        ]
+        return lines
+
+    if is_unorm8x4(format) and dst_channel.type == UNSIGNED and dst_channel.norm and dst_channel.size == 8:
+        indices = [swizzle if swizzle < 4 else None for swizzle in swizzles]
+        ones = 0
+        for i in range(4):
+            if swizzles[i] == SWIZZLE_1:
+                ones |= 0xff << 8*i
+        lines = [
+            'for(; x + 4 <= width; x += 4) {',
+            '   __m128i pixels = _mm_loadu_si128((const __m128i *)src);',
+        ] + ['   ' + line for line in simd_byte_swizzle('pixels', indices)]
+        if ones:
+            lines.append('   pixels = _mm_or_si128(pixels, _mm_set1_epi32(0x%x));' % ones)
+        lines += [
+            '   _mm_storeu_si128((__m128i *)dst, pixels);',
+            '   src += 16;',
+            '   dst += 16;',
+            '}',
+        ]
+        return lines
+
+    if is_half4(format) and dst_channel.type == FLOAT and dst_channel.size == 32:
+        # Same steps as util_half_to_float()
+        lines = [
+            'const __m128i zero = _mm_setzero_si128();',
+            'const __m128i exp_mant = _mm_set1_epi32(0x7fff);',
+            'const __m128i sign = _mm_set1_epi32(0x8000);',
+            'const __m128i infnan_exp = _mm_set1_epi32(0xff << 23);',
+            'const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(0xef << 23));',
+            'const __m128 infnan = _mm_set1_ps(65536.0f);',
+        ] + simd_constants_ps(swizzles) + [
+            'for(; x + 2 <= width; x += 2) {',
+            '   __m128i pixels = _mm_loadu_si128((const __m128i *)src);',
+            '   __m128i h[2];',
+            '   unsigned i;',
+            '   h[0] = _mm_unpacklo_epi16(pixels, zero);',
+            '   h[1] = _mm_unpackhi_epi16(pixels, zero);',
+            '   for(i = 0; i < 2; ++i) {',
+            '      __m128 p = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h[i], exp_mant), 13));',
+            '      p = _mm_mul_ps(p, magic);',
+            '      p = _mm_or_ps(p, _mm_and_ps(_mm_cmpge_ps(p, infnan), _mm_castsi128_ps(infnan_exp)));',
+            '      p = _mm_or_ps(p, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h[i], sign), 16)));',
+        ] + ['      ' + line for line in simd_swizzle_ps('p', swizzles)] + [
+            '      _mm_storeu_ps(dst + 4*i, p);',
+            '   }',
+            '   src += 16;',
+            '   dst += 8;',
+            '}',
+        ]
+        return lines
+
+    if is_unorm_bitmask16(format) and dst_channel.type == FLOAT and dst_channel.size == 32:
+        # One pixel per vector: mask every channel in place and fold its
+        # shift into the scale.  Dividing by a power of two only changes the
+        # exponent, so this rounds the same as shifting first.
+        masks = []
+        scales = []
+        constants = []
+        for swizzle in swizzles:
+            if swizzle < 4:
+                channel = format.le_channels[swizzle]
+                masks.append('0x%x' % (((1 << channel.size) - 1) << channel.shift))
+                scales.append('(1.0f/0x%x)/(1 << %u)' % ((1 << channel.size) - 1, channel.shift))
+                constants.append('0.0f')
+            else:
+                masks.append('0')
+                scales.append('0.0f')
+                constants.append('1.0f' if swizzle == SWIZZLE_1 else '0.0f')
+        lines = [
+            'const __m128i masks = _mm_setr_epi32(%s);' % ', '.join(masks),
+            'const __m128 scales = _mm_setr_ps(%s);' % ', '.join(scales),
+        ]
+        if SWIZZLE_1 in swizzles:
+            lines.append('const __m128 constants = _mm_setr_ps(%s);' % ', '.join(constants))
+        lines += [
+            'for(; x < width; x += 1) {',
+            '   __m128i value = _mm_set1_epi32(*(const uint16_t *)src);',
+            '   __m128 p = _mm_cvtepi32_ps(_mm_and_si128(value, masks));',
+            '   p = _mm_mul_ps(p, scales);',
+        ]
+        if SWIZZLE_1 in swizzles:
+            lines.append('   p = _mm_or_ps(p, constants);')
+        lines += [
+            '   _mm_storeu_ps(dst, p);',
+            '   src += 2;',
+            '   dst += 4;',
+            '}',
+        ]
+        return lines
+
+    return None
+
+
+def simd_pack(format, src_channel, src_native_type):
+    '''Like simd_unpack(), for packing.'''
+
+    inv_swizzle = inv_swizzles(format.le_swizzles)
+
+    if is_unorm8x4(format) and src_channel.type == FLOAT and src_channel.size == 32:
+        # Same steps as float_to_ubyte()
+        order = [inv_swizzle[i] if inv_swizzle[i] is not None else i for i in range(4)]
+        lines = [
+            'const __m128i zero = _mm_setzero_si128();',
+            'const __m128i almost_one = _mm_set1_epi32(0x3f7fffff);',
+            'const __m128i byte_mask = _mm_set1_epi32(0xff);',
+            'const __m128 scale = _mm_set1_ps(255.0f/256.0f);',
+            'const __m128 bias = _mm_set1_ps(32768.0f);',
+        ]
+        if None in inv_swizzle:
+            keep = ['-1' if inv_swizzle[i] is not None else '0' for i in range(4)]*4
+            lines.append('const __m128i keep = _mm_setr_epi8(%s);' % ', '.join(keep))
+        lines += [
+            'for(; x + 4 <= width; x += 4) {',
+            '   __m128i c[4];',
+            '   __m128i pixels;',
+            '   unsigned i;',
+            '   for(i = 0; i < 4; ++i) {',
+            '      __m128 p = _mm_loadu_ps(src + 4*i);',
+            '      __m128i bits, low, high;',
+        ]
+        if order != range(4):
+            lines.append('      p = _mm_shuffle_ps(p, p, _MM_SHUFFLE(%s));' % ', '.join([str(order[i]) for i in range(3, -1, -1)]))
+        lines += [
+            '      bits = _mm_castps_si128(p);',
+            '      low = _mm_cmplt_epi32(bits, zero);',
+            '      high = _mm_cmpgt_epi32(bits, almost_one);',
+            '      c[i] = _mm_castps_si128(_mm_add_ps(_mm_mul_ps(p, scale), bias));',
+            '      c[i] = _mm_andnot_si128(_mm_or_si128(low, high), _mm_and_si128(c[i], byte_mask));',
+            '      c[i] = _mm_or_si128(c[i], _mm_and_si128(high, byte_mask));',
+            '   }',
+            '   pixels = _mm_packus_epi16(_mm_packs_epi32(c[0], c[1]), _mm_packs_epi32(c[2], c[3]));',
+        ]
+        if None in inv_swizzle:
+            lines.append('   pixels = _mm_and_si128(pixels, keep);')
+        lines += [
+            '   _mm_storeu_si128((__m128i *)dst, pixels);',
+            '   src += 16;',
+            '   dst += 16;',
+            '}',
+        ]
+        return lines
+
+    if is_unorm8x4(format) and src_channel.type == UNSIGNED and src_channel.norm and src_channel.size == 8:
+        lines = [
+            'for(; x + 4 <= width; x += 4) {',
+            '   __m128i pixels = _mm_loadu_si128((const __m128i *)src);',
+        ] + ['   ' + line for line in simd_byte_swizzle('pixels', inv_swizzle)] + [
+            '   _mm_storeu_si128((__m128i *)dst, pixels);',
+            '   src += 16;',
+            '   dst += 16;',
+            '}',
+        ]
+        return lines
+
+    return None
+
+
+def generate_simd(simd):
+    '''Emit the loop returned by simd_unpack() or simd_pack().'''
+
+    print '      x = 0;'
+    print '#ifdef PIPE_ARCH_SSE'
+    print '      if (util_cpu_caps.has_sse2) {'
+    for line in simd:
+        print '         ' + line
+    print '      }'
+    print '#endif'
+
+
 def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
@@ -621,11 +936,16 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     print '{'
 
     if is_format_supported(format):
+        simd = simd_unpack(format, dst_channel, dst_native_type)
         print '   unsigned x, y;'
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      %s *dst = dst_row;' % (dst_native_type)
         print '      const uint8_t *src = src_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        if simd:
+            generate_simd(simd)
+            print '      for(; x < width; x += %u) {' % (format.block_width,)
+        else:
+            print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
         
         generate_unpack_kernel(format, dst_channel, dst_native_type)
     
@@ -650,11 +970,16 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
     print '{'
     
     if is_format_supported(format):
+        simd = simd_pack(format, src_channel, src_native_type)
         print '   unsigned x, y;'
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      const %s *src = src_row;' % (src_native_type)
         print '      uint8_t *dst = dst_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        if simd:
+            generate_simd(simd)
+            print '      for(; x < width; x += %u) {' % (format.block_width,)
+        else:
+            print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
     
         generate_pack_kernel(format, src_channel, src_native_type)
             
@@ -699,6 +1024,8 @@ def generate(formats):
     print '#include "util/format_srgb.h"'
     print '#include "u_format_yuv.h"'
     print '#include "u_format_zs.h"'
+    print '#include "u_cpu_detect.h"'
+    print '#include "u_sse.h"'
     print
 
     for format in formats:
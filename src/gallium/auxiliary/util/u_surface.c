@@ -36,6 +36,7 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_state.h"
 
+#include "util/u_copy.h"
 #include "util/u_format.h"
 #include "util/u_inlines.h"
 #include "util/u_rect.h"
@@ -75,7 +76,31 @@ util_copy_rect(ubyte * dst,
                unsigned src_x,
                unsigned src_y)
 {
-   unsigned i;
+   util_copy_box(dst, format,
+                 dst_stride, 0,
+                 dst_x, dst_y, 0,
+                 width, height, 1,
+                 src,
+                 src_stride, 0,
+                 src_x, src_y, 0);
+}
+
+
+/**
+ * Copy 3D box from one place to another.
+ * Position and sizes are in pixels.
+ * src_stride may be negative to do vertical flip of pixels from source.
+ */
+void
+util_copy_box(ubyte * dst,
+              enum pipe_format format,
+              unsigned dst_stride, unsigned dst_slice_stride,
+              unsigned dst_x, unsigned dst_y, unsigned dst_z,
+              unsigned width, unsigned height, unsigned depth,
+              const ubyte * src,
+              int src_stride, unsigned src_slice_stride,
+              unsigned src_x, unsigned src_y, unsigned src_z)
+{
    int src_stride_pos = src_stride < 0 ? -src_stride : src_stride;
    int blocksize = util_format_get_blocksize(format);
    int blockwidth = util_format_get_blockwidth(format);
@@ -96,50 +121,13 @@ util_copy_rect(ubyte * dst,
    src += src_x * blocksize;
    dst += dst_y * dst_stride;
    src += src_y * src_stride_pos;
-   width *= blocksize;
-
-   if (width == dst_stride && width == src_stride)
-      memcpy(dst, src, height * width);
-   else {
-      for (i = 0; i < height; i++) {
-         memcpy(dst, src, width);
-         dst += dst_stride;
-         src += src_stride;
-      }
-   }
-}
-
-
-/**
- * Copy 3D box from one place to another.
- * Position and sizes are in pixels.
- */
-void
-util_copy_box(ubyte * dst,
-              enum pipe_format format,
-              unsigned dst_stride, unsigned dst_slice_stride,
-              unsigned dst_x, unsigned dst_y, unsigned dst_z,
-              unsigned width, unsigned height, unsigned depth,
-              const ubyte * src,
-              int src_stride, unsigned src_slice_stride,
-              unsigned src_x, unsigned src_y, unsigned src_z)
-{
-   unsigned z;
    dst += dst_z * dst_slice_stride;
    src += src_z * src_slice_stride;
-   for (z = 0; z < depth; ++z) {
-      util_copy_rect(dst,
-                     format,
-                     dst_stride,
-                     dst_x, dst_y,
-                     width, height,
-                     src,
-                     src_stride,
-                     src_x, src_y);
-
-      dst += dst_slice_stride;
-      src += src_slice_stride;
-   }
+   width *= blocksize;
+
+   util_copy_rows(dst, dst_stride, dst_slice_stride,
+                  src, src_stride, src_slice_stride,
+                  width, height, depth);
 }
 
 
@@ -369,7 +357,7 @@ util_resource_copy_region(struct pipe_context *pipe,
    if (dst->target == PIPE_BUFFER && src->target == PIPE_BUFFER) {
       assert(src_box.height == 1);
       assert(src_box.depth == 1);
-      memcpy(dst_map, src_map, src_box.width);
+      util_memcpy_large(dst_map, src_map, src_box.width);
    } else {
       util_copy_box(dst_map,
                     src_format,
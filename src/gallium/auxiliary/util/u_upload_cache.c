@@ -0,0 +1,208 @@
+/**************************************************************************
+ * 
+ * Copyright (C) 2026 agent <agent@local>
+ * All Rights Reserved.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ **************************************************************************/
+
+#include "pipe/p_state.h"
+#include "util/crc32.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+
+#include "u_upload_cache.h"
+
+
+struct u_upload_cache_entry {
+   void *key;                     /* Key, followed by the source copy. */
+   unsigned key_size;
+   unsigned data_size;
+   struct pipe_resource *buffer;  /* Converted data. */
+   unsigned offset;
+};
+
+struct u_upload_cache {
+   struct u_upload_cache_entry *entries;
+   unsigned num_entries;
+   unsigned max_bytes;
+   unsigned bytes;
+};
+
+
+struct u_upload_cache *
+u_upload_cache_create(unsigned num_entries, unsigned max_bytes)
+{
+   struct u_upload_cache *cache = CALLOC_STRUCT(u_upload_cache);
+   if (!cache)
+      return NULL;
+
+   cache->entries = CALLOC(num_entries, sizeof(cache->entries[0]));
+   if (!cache->entries) {
+      FREE(cache);
+      return NULL;
+   }
+
+   cache->num_entries = num_entries;
+   cache->max_bytes = max_bytes;
+   return cache;
+}
+
+
+/**
+ * Size of \p buffer if no entry other than \p entry keeps it alive, so that
+ * each upload buffer is only counted once.
+ */
+static unsigned
+u_upload_cache_buffer_bytes(struct u_upload_cache *cache,
+                            struct u_upload_cache_entry *entry,
+                            struct pipe_resource *buffer)
+{
+   unsigned i;
+
+   for (i = 0; i < cache->num_entries; i++) {
+      if (&cache->entries[i] != entry && cache->entries[i].buffer == buffer)
+         return 0;
+   }
+
+   return buffer->width0;
+}
+
+
+static void
+u_upload_cache_release(struct u_upload_cache *cache,
+                       struct u_upload_cache_entry *entry)
+{
+   if (!entry->buffer)
+      return;
+
+   cache->bytes -= entry->key_size + entry->data_size +
+                   u_upload_cache_buffer_bytes(cache, entry, entry->buffer);
+   FREE(entry->key);
+   pipe_resource_reference(&entry->buffer, NULL);
+   memset(entry, 0, sizeof(*entry));
+}
+
+
+void
+u_upload_cache_destroy(struct u_upload_cache *cache)
+{
+   unsigned i;
+
+   for (i = 0; i < cache->num_entries; i++)
+      u_upload_cache_release(cache, &cache->entries[i]);
+
+   FREE(cache->entries);
+   FREE(cache);
+}
+
+
+static struct u_upload_cache_entry *
+u_upload_cache_slot(struct u_upload_cache *cache,
+                    const void *key, unsigned key_size)
+{
+   return &cache->entries[util_hash_crc32(key, key_size) %
+                          cache->num_entries];
+}
+
+
+boolean
+u_upload_cache_find(struct u_upload_cache *cache,
+                    const void *key, unsigned key_size,
+                    const struct u_upload_cache_source *sources,
+                    unsigned num_sources,
+                    struct pipe_resource **buffer, unsigned *offset)
+{
+   struct u_upload_cache_entry *entry =
+      u_upload_cache_slot(cache, key, key_size);
+   const uint8_t *data;
+   unsigned data_size = 0, i;
+
+   if (!entry->buffer || entry->key_size != key_size ||
+       memcmp(entry->key, key, key_size) != 0)
+      return FALSE;
+
+   for (i = 0; i < num_sources; i++)
+      data_size += sources[i].size;
+   if (data_size != entry->data_size)
+      return FALSE;
+
+   data = (const uint8_t *)entry->key + key_size;
+   for (i = 0; i < num_sources; i++) {
+      if (memcmp(data, sources[i].data, sources[i].size) != 0)
+         return FALSE;
+      data += sources[i].size;
+   }
+
+   pipe_resource_reference(buffer, entry->buffer);
+   *offset = entry->offset;
+   return TRUE;
+}
+
+
+void
+u_upload_cache_add(struct u_upload_cache *cache,
+                   const void *key, unsigned key_size,
+                   const struct u_upload_cache_source *sources,
+                   unsigned num_sources,
+                   struct pipe_resource *buffer, unsigned offset)
+{
+   struct u_upload_cache_entry *entry =
+      u_upload_cache_slot(cache, key, key_size);
+   unsigned data_size = 0, bytes, i;
+   uint8_t *data;
+
+   u_upload_cache_release(cache, entry);
+
+   for (i = 0; i < num_sources; i++)
+      data_size += sources[i].size;
+
+   bytes = key_size + data_size +
+           u_upload_cache_buffer_bytes(cache, entry, buffer);
+
+   /* Start over rather than keep stale entries alive forever. */
+   if (cache->bytes + bytes > cache->max_bytes) {
+      for (i = 0; i < cache->num_entries; i++)
+         u_upload_cache_release(cache, &cache->entries[i]);
+
+      bytes = key_size + data_size + buffer->width0;
+      if (bytes > cache->max_bytes)
+         return;
+   }
+
+   entry->key = MALLOC(key_size + data_size);
+   if (!entry->key)
+      return;
+
+   memcpy(entry->key, key, key_size);
+   data = (uint8_t *)entry->key + key_size;
+   for (i = 0; i < num_sources; i++) {
+      memcpy(data, sources[i].data, sources[i].size);
+      data += sources[i].size;
+   }
+
+   entry->key_size = key_size;
+   entry->data_size = data_size;
+   pipe_resource_reference(&entry->buffer, buffer);
+   entry->offset = offset;
+   cache->bytes += bytes;
+}
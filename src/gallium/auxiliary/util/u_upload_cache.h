@@ -0,0 +1,102 @@
+/**************************************************************************
+ * 
+ * Copyright (C) 2026 agent <agent@local>
+ * All Rights Reserved.
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ * 
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * 
+ **************************************************************************/
+
+/* Cache of data that was converted into an upload buffer, such as indices
+ * or vertices in a format the hardware can't use, so that drawing the same
+ * range of a static buffer over and over only converts it once.
+ *
+ * Gallium has no way to tell auxiliary modules about writes to a buffer, so
+ * each entry keeps a copy of the source data it was converted from and is
+ * only reused if the source is still the same.  The copies and the upload
+ * buffers the entries keep alive count against a per-cache byte limit.
+ */
+
+#ifndef U_UPLOAD_CACHE_H
+#define U_UPLOAD_CACHE_H
+
+#include "pipe/p_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pipe_resource;
+struct u_upload_cache;
+
+struct u_upload_cache_source {
+   const void *data;
+   unsigned size;
+};
+
+/**
+ * Create a direct-mapped cache.
+ *
+ * \param num_entries   Number of cache slots.
+ * \param max_bytes     Limit for the source copies, keys and referenced
+ *                      upload buffers of all entries together.
+ */
+struct u_upload_cache *
+u_upload_cache_create(unsigned num_entries, unsigned max_bytes);
+
+void
+u_upload_cache_destroy(struct u_upload_cache *cache);
+
+/**
+ * Look up a conversion.
+ *
+ * \param key           Everything the conversion depends on besides the
+ *                      source data, with any padding cleared.
+ * \param sources       Mapped source data, compared against the copy made
+ *                      by u_upload_cache_add().
+ * \param buffer        Returns a reference to the converted data on a hit.
+ * \param offset        Returns the offset of the converted data on a hit.
+ */
+boolean
+u_upload_cache_find(struct u_upload_cache *cache,
+                    const void *key, unsigned key_size,
+                    const struct u_upload_cache_source *sources,
+                    unsigned num_sources,
+                    struct pipe_resource **buffer, unsigned *offset);
+
+/**
+ * Remember a conversion, replacing whatever was in its slot.
+ *
+ * The upload manager never writes to memory it has handed out, so the
+ * converted data stays valid for as long as the cache references \p buffer.
+ */
+void
+u_upload_cache_add(struct u_upload_cache *cache,
+                   const void *key, unsigned key_size,
+                   const struct u_upload_cache_source *sources,
+                   unsigned num_sources,
+                   struct pipe_resource *buffer, unsigned offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_UPLOAD_CACHE_H */
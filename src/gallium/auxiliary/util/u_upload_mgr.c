@@ -32,12 +32,22 @@
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "pipe/p_context.h"
+#include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 
 #include "u_upload_mgr.h"
 
 
+/* Beyond this many pending fences, newer fences replace the newest one. */
+#define U_UPLOAD_MAX_FENCES 16
+
+struct u_upload_fence_entry {
+   struct pipe_fence_handle *fence;
+   unsigned end;    /* Offset at which the data read by the fenced commands
+                     * ends. */
+};
+
 struct u_upload_mgr {
    struct pipe_context *pipe;
 
@@ -52,6 +62,16 @@ struct u_upload_mgr {
    uint8_t *map;    /* Pointer to the mapped upload buffer. */
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
+
+   /* Ring buffer mode.  Everything from ring_tail up to offset may still be
+    * in use, either until the end of the buffer and then from the start if
+    * wrapped is set, or contiguously if it isn't.
+    */
+   boolean ring;
+   boolean wrapped;
+   unsigned ring_tail;
+   struct u_upload_fence_entry fences[U_UPLOAD_MAX_FENCES]; /* Oldest first. */
+   unsigned num_fences;
 };
 
 
@@ -87,6 +107,37 @@ u_upload_create(struct pipe_context *pipe, unsigned default_size,
 }
 
 
+struct u_upload_mgr *
+u_upload_create_ring(struct pipe_context *pipe, unsigned size,
+                     unsigned bind, enum pipe_resource_usage usage)
+{
+   struct u_upload_mgr *upload = u_upload_create(pipe, size, bind, usage);
+   if (!upload)
+      return NULL;
+
+   /* Reusing memory needs the mapping to stay valid while the GPU reads
+    * from other parts of the buffer.
+    */
+   upload->ring = upload->map_persistent;
+   return upload;
+}
+
+
+static void
+u_upload_ring_release_fences(struct u_upload_mgr *upload)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   unsigned i;
+
+   for (i = 0; i < upload->num_fences; i++)
+      screen->fence_reference(screen, &upload->fences[i].fence, NULL);
+
+   upload->num_fences = 0;
+   upload->wrapped = FALSE;
+   upload->ring_tail = 0;
+}
+
+
 static void upload_unmap_internal(struct u_upload_mgr *upload, boolean destroying)
 {
    if (!destroying && upload->map_persistent)
@@ -118,6 +169,7 @@ static void u_upload_release_buffer(struct u_upload_mgr *upload)
    /* Unmap and unreference the upload buffer. */
    upload_unmap_internal(upload, TRUE);
    pipe_resource_reference( &upload->buffer, NULL );
+   u_upload_ring_release_fences(upload);
 }
 
 
@@ -176,6 +228,108 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload,
    upload->offset = 0;
 }
 
+/**
+ * Release the ring space of all the fences that have signalled.
+ */
+static void
+u_upload_ring_retire(struct u_upload_mgr *upload)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   unsigned i;
+
+   for (i = 0; i < upload->num_fences; i++) {
+      struct u_upload_fence_entry *entry = &upload->fences[i];
+
+      /* Don't pass the context, so that this never flushes it. */
+      if (!screen->fence_finish(screen, NULL, entry->fence, 0))
+         break;
+
+      /* Data before the wrap always ends after offset. */
+      if (upload->wrapped && entry->end <= upload->offset)
+         upload->wrapped = FALSE;
+      upload->ring_tail = entry->end;
+      screen->fence_reference(screen, &entry->fence, NULL);
+   }
+
+   if (i) {
+      upload->num_fences -= i;
+      memmove(upload->fences, upload->fences + i,
+              upload->num_fences * sizeof(upload->fences[0]));
+   }
+
+   /* Start over at the beginning once the ring is idle. */
+   if (!upload->num_fences && !upload->wrapped &&
+       upload->ring_tail == upload->offset)
+      upload->ring_tail = upload->offset = 0;
+}
+
+/**
+ * Find free space in the ring without waiting for anything.
+ *
+ * The space in use is never allowed to catch up with ring_tail, so that
+ * offset == ring_tail always means the ring is empty.
+ */
+static boolean
+u_upload_ring_fit(struct u_upload_mgr *upload,
+                  unsigned min_out_offset,
+                  unsigned size,
+                  unsigned alignment,
+                  unsigned *out_offset)
+{
+   unsigned offset = MAX2(align(upload->offset, alignment), min_out_offset);
+
+   if (upload->wrapped) {
+      *out_offset = offset;
+      return offset + size < upload->ring_tail;
+   }
+
+   if (offset + size <= upload->buffer->width0) {
+      *out_offset = offset;
+      return TRUE;
+   }
+
+   /* Wrap around to the start of the buffer. */
+   if (min_out_offset + size < upload->ring_tail) {
+      upload->wrapped = TRUE;
+      *out_offset = min_out_offset;
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+void
+u_upload_fence(struct u_upload_mgr *upload,
+               struct pipe_fence_handle *fence)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   struct u_upload_fence_entry *entry;
+   unsigned fenced_end;
+
+   if (!upload->ring || !upload->buffer)
+      return;
+
+   fenced_end = upload->num_fences ?
+                upload->fences[upload->num_fences - 1].end : upload->ring_tail;
+   if (fenced_end == upload->offset)
+      return;
+
+   /* Fences signal in order, so the new fence also covers everything the
+    * newest one does.
+    */
+   if (upload->num_fences == U_UPLOAD_MAX_FENCES) {
+      upload->num_fences--;
+      screen->fence_reference(screen,
+                              &upload->fences[upload->num_fences].fence,
+                              NULL);
+   }
+
+   entry = &upload->fences[upload->num_fences++];
+   entry->fence = NULL;
+   screen->fence_reference(screen, &entry->fence, fence);
+   entry->end = upload->offset;
+}
+
 void
 u_upload_alloc(struct u_upload_mgr *upload,
                unsigned min_out_offset,
@@ -187,6 +341,7 @@ u_upload_alloc(struct u_upload_mgr *upload,
 {
    unsigned buffer_size = upload->buffer ? upload->buffer->width0 : 0;
    unsigned offset;
+   boolean fits;
 
    min_out_offset = align(min_out_offset, alignment);
 
@@ -196,7 +351,19 @@ u_upload_alloc(struct u_upload_mgr *upload,
    /* Make sure we have enough space in the upload buffer
     * for the sub-allocation.
     */
-   if (unlikely(!upload->buffer || offset + size > buffer_size)) {
+   if (upload->ring && upload->buffer) {
+      fits = u_upload_ring_fit(upload, min_out_offset, size, alignment,
+                               &offset);
+      if (!fits) {
+         u_upload_ring_retire(upload);
+         fits = u_upload_ring_fit(upload, min_out_offset, size, alignment,
+                                  &offset);
+      }
+   } else {
+      fits = upload->buffer && offset + size <= buffer_size;
+   }
+
+   if (unlikely(!fits)) {
       u_upload_alloc_buffer(upload, min_out_offset + size);
 
       if (unlikely(!upload->buffer)) {
@@ -211,9 +378,14 @@ u_upload_alloc(struct u_upload_mgr *upload,
    }
 
    if (unlikely(!upload->map)) {
+      /* A ring keeps its mapping while it wraps back to lower offsets,
+       * so it has to map the whole buffer.
+       */
+      unsigned map_offset = upload->ring ? 0 : offset;
+
       upload->map = pipe_buffer_map_range(upload->pipe, upload->buffer,
-                                          offset,
-                                          buffer_size - offset,
+                                          map_offset,
+                                          buffer_size - map_offset,
                                           upload->map_flags,
 					  &upload->transfer);
       if (unlikely(!upload->map)) {
@@ -224,7 +396,7 @@ u_upload_alloc(struct u_upload_mgr *upload,
          return;
       }
 
-      upload->map -= offset;
+      upload->map -= map_offset;
    }
 
    assert(offset < buffer_size);
@@ -36,6 +36,7 @@
 #include "pipe/p_defines.h"
 
 struct pipe_context;
+struct pipe_fence_handle;
 struct pipe_resource;
 
 
@@ -51,6 +52,26 @@ struct u_upload_mgr *
 u_upload_create(struct pipe_context *pipe, unsigned default_size,
                 unsigned bind, enum pipe_resource_usage usage);
 
+/**
+ * Create an upload manager that suballocates from a single buffer in a ring.
+ *
+ * Instead of discarding the upload buffer when it is full, allocation wraps
+ * around to the beginning, reusing memory once the fences passed to
+ * u_upload_fence() for the draws that read it have signalled.  If nothing
+ * can be reclaimed yet, a new buffer is allocated as usual.
+ *
+ * Ring mode requires PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT; without it
+ * the upload manager behaves as if created with u_upload_create().
+ *
+ * \param pipe          Pipe driver.
+ * \param size          Size of the ring buffer, in bytes.
+ * \param bind          Bitmask of PIPE_BIND_* flags.
+ * \param usage         PIPE_USAGE_*
+ */
+struct u_upload_mgr *
+u_upload_create_ring(struct pipe_context *pipe, unsigned size,
+                     unsigned bind, enum pipe_resource_usage usage);
+
 /**
  * Destroy the upload manager.
  */
@@ -68,6 +89,20 @@ void u_upload_destroy( struct u_upload_mgr *upload );
  */
 void u_upload_unmap( struct u_upload_mgr *upload );
 
+/**
+ * Tell a ring upload manager that everything allocated so far is used by
+ * the commands that \p fence waits for.
+ *
+ * \param upload           Upload manager
+ * \param fence            Fence of a flush of the context, which must have
+ *                         been submitted already (not PIPE_FLUSH_DEFERRED).
+ *
+ * Fences must signal in the order they are passed in.  This is a no-op for
+ * upload managers not in ring mode.
+ */
+void u_upload_fence(struct u_upload_mgr *upload,
+                    struct pipe_fence_handle *fence);
+
 /**
  * Sub-allocate new memory from the upload buffer.
  *
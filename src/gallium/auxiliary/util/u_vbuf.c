@@ -81,16 +81,23 @@
  * rate down.
  *
  *
+ * Translated vertices are kept in a u_upload_cache.
+ *
+ *
  * If there is nothing to do, it forwards every command to the driver.
  * The module also has its own CSO cache of vertex element states.
  */
 
 #include "util/u_vbuf.h"
 
+#include <inttypes.h>
+
+#include "util/u_debug.h"
 #include "util/u_dump.h"
 #include "util/u_format.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
+#include "util/u_upload_cache.h"
 #include "util/u_upload_mgr.h"
 #include "translate/translate.h"
 #include "translate/translate_cache.h"
@@ -133,6 +140,29 @@ struct u_vbuf_elements {
    void *driver_cso;
 };
 
+#define U_VBUF_CACHE_SIZE 32
+
+#define U_VBUF_CACHE_MAX_BYTES (32 * 1024 * 1024)
+
+struct u_vbuf_cache_key {
+   struct translate_key translate_key;
+   int start;
+   unsigned num;
+   unsigned num_vbs;
+   struct {
+      struct pipe_resource *buffer;
+      unsigned offset;
+      unsigned stride;
+   } vb[PIPE_MAX_ATTRIBS];
+};
+
+static inline unsigned
+u_vbuf_cache_key_size(const struct u_vbuf_cache_key *key)
+{
+   return offsetof(struct u_vbuf_cache_key, vb) +
+          key->num_vbs * sizeof(key->vb[0]);
+}
+
 enum {
    VB_VERTEX = 0,
    VB_INSTANCE = 1,
@@ -184,8 +214,18 @@ struct u_vbuf {
    uint32_t incompatible_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffer has a non-zero stride. */
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
+
+   /* Translated vertex buffers. */
+   struct u_upload_cache *cache;
+
+   /* Statistics, printed at exit with GALLIUM_VBUF_STATS. */
+   uint64_t num_cache_hits;
+   uint64_t num_cache_misses;
+   uint64_t bytes_translated;
 };
 
+DEBUG_GET_ONCE_BOOL_OPTION(vbuf_stats, "GALLIUM_VBUF_STATS", FALSE)
+
 static void *
 u_vbuf_create_vertex_elements(struct u_vbuf *mgr, unsigned count,
                               const struct pipe_vertex_element *attribs);
@@ -317,6 +357,8 @@ u_vbuf_create(struct pipe_context *pipe,
    mgr->uploader = u_upload_create(pipe, 1024 * 1024,
                                    PIPE_BIND_VERTEX_BUFFER,
                                    PIPE_USAGE_STREAM);
+   mgr->cache = u_upload_cache_create(U_VBUF_CACHE_SIZE,
+                                      U_VBUF_CACHE_MAX_BYTES);
 
    return mgr;
 }
@@ -376,6 +418,16 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
    unsigned num_vb = screen->get_shader_param(screen, PIPE_SHADER_VERTEX,
                                               PIPE_SHADER_CAP_MAX_INPUTS);
 
+   if (debug_get_option_vbuf_stats()) {
+      debug_printf("u_vbuf: %"PRIu64" translate cache hits, "
+                   "%"PRIu64" misses, %"PRIu64" bytes translated\n",
+                   mgr->num_cache_hits, mgr->num_cache_misses,
+                   mgr->bytes_translated);
+   }
+
+   if (mgr->cache)
+      u_upload_cache_destroy(mgr->cache);
+
    mgr->pipe->set_index_buffer(mgr->pipe, NULL);
    pipe_resource_reference(&mgr->index_buffer.buffer, NULL);
 
@@ -404,9 +456,17 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
 {
    struct translate *tr;
    struct pipe_transfer *vb_transfer[PIPE_MAX_ATTRIBS] = {0};
+   struct u_upload_cache_source sources[PIPE_MAX_ATTRIBS];
    struct pipe_resource *out_buffer = NULL;
    uint8_t *out_map;
    unsigned out_offset, mask;
+   struct u_vbuf_cache_key cache_key;
+   boolean cacheable = FALSE;
+
+   memset(&cache_key, 0, sizeof(cache_key));
+   memcpy(&cache_key.translate_key, key, translate_keysize(key));
+   cache_key.start = start_vertex;
+   cache_key.num = num_vertices;
 
    /* Get a translate object. */
    tr = translate_cache_find(mgr->translate_cache, key);
@@ -434,6 +494,13 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
 
          map = pipe_buffer_map_range(mgr->pipe, vb->buffer, offset, size,
                                      PIPE_TRANSFER_READ, &vb_transfer[i]);
+
+         sources[cache_key.num_vbs].data = map;
+         sources[cache_key.num_vbs].size = size;
+         cache_key.vb[cache_key.num_vbs].buffer = vb->buffer;
+         cache_key.vb[cache_key.num_vbs].offset = vb->buffer_offset;
+         cache_key.vb[cache_key.num_vbs].stride = vb->stride;
+         cache_key.num_vbs++;
       }
 
       /* Subtract min_index so that indexing with the index buffer works. */
@@ -484,19 +551,43 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
       if (transfer) {
          pipe_buffer_unmap(mgr->pipe, transfer);
       }
-   } else {
-      /* Create and map the output buffer. */
-      u_upload_alloc(mgr->uploader,
-                     key->output_stride * start_vertex,
-                     key->output_stride * num_vertices, 4,
-                     &out_offset, &out_buffer,
-                     (void**)&out_map);
-      if (!out_buffer)
-         return PIPE_ERROR_OUT_OF_MEMORY;
 
-      out_offset -= key->output_stride * start_vertex;
+      mgr->bytes_translated += key->output_stride * num_indices;
+   } else {
+      /* User buffers can't be told apart, and unrolled indices are rarely
+       * the same twice, so only cache translations of real buffers. */
+      if (mgr->cache && !(vb_mask & mgr->user_vb_mask)) {
+         cacheable = TRUE;
+         if (u_upload_cache_find(mgr->cache, &cache_key,
+                                 u_vbuf_cache_key_size(&cache_key),
+                                 sources, cache_key.num_vbs,
+                                 &out_buffer, &out_offset))
+            mgr->num_cache_hits++;
+      }
 
-      tr->run(tr, 0, num_vertices, 0, 0, out_map);
+      if (!out_buffer) {
+         /* Create and map the output buffer. */
+         u_upload_alloc(mgr->uploader,
+                        key->output_stride * start_vertex,
+                        key->output_stride * num_vertices, 4,
+                        &out_offset, &out_buffer,
+                        (void**)&out_map);
+         if (!out_buffer)
+            return PIPE_ERROR_OUT_OF_MEMORY;
+
+         out_offset -= key->output_stride * start_vertex;
+
+         tr->run(tr, 0, num_vertices, 0, 0, out_map);
+         mgr->bytes_translated += key->output_stride * num_vertices;
+
+         if (cacheable) {
+            mgr->num_cache_misses++;
+            u_upload_cache_add(mgr->cache, &cache_key,
+                               u_vbuf_cache_key_size(&cache_key),
+                               sources, cache_key.num_vbs,
+                               out_buffer, out_offset);
+         }
+      }
    }
 
    /* Unmap all buffers. */
@@ -284,6 +284,7 @@ void r600_context_gfx_flush(void *context, unsigned flags,
 	if (fence)
 		ws->fence_reference(fence, ctx->b.last_gfx_fence);
 	ctx->b.num_gfx_cs_flushes++;
+	r600_upload_fence_gfx(&ctx->b);
 
 	r600_begin_new_cs(ctx);
 }
@@ -335,6 +335,30 @@ void r600_postflush_resume_features(struct r600_common_context *ctx)
 		r600_resume_queries(ctx);
 }
 
+/* Called by the drivers after every gfx IB is submitted, whether the flush
+ * came from the state tracker or from the driver itself, so that the
+ * uploader can reuse what the IB reads once it has finished.
+ */
+void r600_upload_fence_gfx(struct r600_common_context *rctx)
+{
+	struct pipe_screen *screen = rctx->b.screen;
+	struct r600_multi_fence *multi_fence;
+
+	if (!rctx->uploader || !rctx->last_gfx_fence)
+		return;
+
+	multi_fence = CALLOC_STRUCT(r600_multi_fence);
+	if (!multi_fence)
+		return;
+
+	multi_fence->reference.count = 1;
+	rctx->ws->fence_reference(&multi_fence->gfx, rctx->last_gfx_fence);
+
+	u_upload_fence(rctx->uploader, (struct pipe_fence_handle*)multi_fence);
+	screen->fence_reference(screen,
+				(struct pipe_fence_handle**)&multi_fence, NULL);
+}
+
 static void r600_flush_from_st(struct pipe_context *ctx,
 			       struct pipe_fence_handle **fence,
 			       unsigned flags)
@@ -590,9 +614,10 @@ bool r600_common_context_init(struct r600_common_context *rctx,
 	if (!rctx->allocator_zeroed_memory)
 		return false;
 
-	rctx->uploader = u_upload_create(&rctx->b, 1024 * 1024,
-					PIPE_BIND_INDEX_BUFFER |
-					PIPE_BIND_CONSTANT_BUFFER, PIPE_USAGE_STREAM);
+	rctx->uploader = u_upload_create_ring(&rctx->b, 1024 * 1024,
+					     PIPE_BIND_INDEX_BUFFER |
+					     PIPE_BIND_CONSTANT_BUFFER,
+					     PIPE_USAGE_STREAM);
 	if (!rctx->uploader)
 		return false;
 
@@ -711,6 +711,7 @@ bool r600_common_screen_init(struct r600_common_screen *rscreen,
 void r600_destroy_common_screen(struct r600_common_screen *rscreen);
 void r600_preflush_suspend_features(struct r600_common_context *ctx);
 void r600_postflush_resume_features(struct r600_common_context *ctx);
+void r600_upload_fence_gfx(struct r600_common_context *rctx);
 bool r600_common_context_init(struct r600_common_context *rctx,
 			      struct r600_common_screen *rscreen,
 			      unsigned context_flags);
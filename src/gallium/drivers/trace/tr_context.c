@@ -859,7 +859,9 @@ trace_context_set_scissor_states(struct pipe_context *_pipe,
    trace_dump_arg(ptr, pipe);
    trace_dump_arg(uint, start_slot);
    trace_dump_arg(uint, num_scissors);
-   trace_dump_arg(scissor_state, states);
+   trace_dump_arg_begin("states");
+   trace_dump_struct_array(scissor_state, states, num_scissors);
+   trace_dump_arg_end();
 
    pipe->set_scissor_states(pipe, start_slot, num_scissors, states);
 
@@ -881,7 +883,9 @@ trace_context_set_viewport_states(struct pipe_context *_pipe,
    trace_dump_arg(ptr, pipe);
    trace_dump_arg(uint, start_slot);
    trace_dump_arg(uint, num_viewports);
-   trace_dump_arg(viewport_state, states);
+   trace_dump_arg_begin("states");
+   trace_dump_struct_array(viewport_state, states, num_viewports);
+   trace_dump_arg_end();
 
    pipe->set_viewport_states(pipe, start_slot, num_viewports, states);
 
@@ -1743,6 +1747,7 @@ static void trace_context_set_shader_buffers(struct pipe_context *_context,
    trace_dump_arg(ptr, context);
    trace_dump_arg(uint, shader);
    trace_dump_arg(uint, start);
+   trace_dump_arg(uint, nr);
    trace_dump_arg_begin("buffers");
    trace_dump_struct_array(shader_buffer, buffers, nr);
    trace_dump_arg_end();
@@ -1781,6 +1786,7 @@ static void trace_context_set_shader_images(struct pipe_context *_context,
    trace_dump_arg(ptr, context);
    trace_dump_arg(uint, shader);
    trace_dump_arg(uint, start);
+   trace_dump_arg(uint, nr);
    trace_dump_arg_begin("images");
    trace_dump_struct_array(image_view, images, nr);
    trace_dump_arg_end();
@@ -30,10 +30,10 @@
  * @file
  * Trace dumping functions.
  *
- * For now we just use standard XML for dumping the trace calls, as this is
- * simple to write, parse, and visually inspect, but the actual representation
- * is abstracted out of this file, so that we can switch to a binary
- * representation if/when it becomes justified.
+ * By default we use standard XML for dumping the trace calls, as this is
+ * simple to write, parse, and visually inspect.  Setting GALLIUM_TRACE_BINARY
+ * switches to the compact binary representation described in
+ * tr_dump_binary.h, which is much cheaper to write and to replay.
  *
  * @author Jose Fonseca <jfonseca@vmware.com>
  */
@@ -51,8 +51,11 @@
 #include "util/u_string.h"
 #include "util/u_math.h"
 #include "util/u_format.h"
+#include "util/hash_table.h"
+#include "util/ralloc.h"
 
 #include "tr_dump.h"
+#include "tr_dump_binary.h"
 #include "tr_screen.h"
 #include "tr_texture.h"
 
@@ -62,6 +65,9 @@ static FILE *stream = NULL;
 pipe_static_mutex(call_mutex);
 static long unsigned call_no = 0;
 static boolean dumping = FALSE;
+static boolean binary = FALSE;
+static struct hash_table *binary_names = NULL;
+static unsigned binary_num_names = 0;
 
 
 static inline void
@@ -215,10 +221,76 @@ trace_dump_tag_end(const char *name)
    trace_dump_writes(">");
 }
 
+
+/*
+ * Binary representation, see tr_dump_binary.h
+ */
+
+static inline void
+trace_dump_binary_token(enum trace_binary_token token)
+{
+   if (stream) {
+      putc(token, stream);
+   }
+}
+
+
+static inline void
+trace_dump_binary_uint(uint64_t value)
+{
+   uint8_t buf[10];
+   unsigned len = 0;
+
+   while (value >= 0x80) {
+      buf[len++] = (value & 0x7f) | 0x80;
+      value >>= 7;
+   }
+   buf[len++] = value;
+
+   trace_dump_write((const char *)buf, len);
+}
+
+
+static inline void
+trace_dump_binary_sint(int64_t value)
+{
+   trace_dump_binary_uint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+
+static inline void
+trace_dump_binary_data(const void *data, size_t size)
+{
+   trace_dump_binary_uint(size);
+   trace_dump_write(data, size);
+}
+
+
+static void
+trace_dump_binary_name(const char *name)
+{
+   struct hash_entry *entry;
+
+   entry = _mesa_hash_table_search(binary_names, name);
+   if (entry) {
+      trace_dump_binary_uint((uintptr_t)entry->data);
+      return;
+   }
+
+   _mesa_hash_table_insert(binary_names, ralloc_strdup(binary_names, name),
+                           (void *)(uintptr_t)++binary_num_names);
+   trace_dump_binary_uint(0);
+   trace_dump_binary_data(name, strlen(name));
+}
+
+
 void
 trace_dump_trace_flush(void)
 {
-   if (stream) {
+   /* Binary traces are meant to be cheap, so they are only flushed when the
+    * stdio buffer fills up and at exit.  Use XML traces to debug crashes.
+    */
+   if (stream && !binary) {
       fflush(stream);
    }
 }
@@ -227,7 +299,8 @@ static void
 trace_dump_trace_close(void)
 {
    if (stream) {
-      trace_dump_writes("</trace>\n");
+      if (!binary)
+         trace_dump_writes("</trace>\n");
       if (close_stream) {
          fclose(stream);
          close_stream = FALSE;
@@ -235,13 +308,21 @@ trace_dump_trace_close(void)
       }
       call_no = 0;
    }
+
+   ralloc_free(binary_names);
+   binary_names = NULL;
+   binary_num_names = 0;
 }
 
 
 static void
 trace_dump_call_time(int64_t time)
 {
-   if (stream) {
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_CALL_END);
+      trace_dump_binary_uint(time);
+   }
+   else if (stream) {
       trace_dump_indent(2);
       trace_dump_tag_begin("time");
       trace_dump_int(time);
@@ -261,6 +342,7 @@ trace_dump_trace_begin(void)
       return FALSE;
 
    if (!stream) {
+      binary = debug_get_bool_option("GALLIUM_TRACE_BINARY", FALSE);
 
       if (strcmp(filename, "stderr") == 0) {
          close_stream = FALSE;
@@ -272,11 +354,31 @@ trace_dump_trace_begin(void)
       }
       else {
          close_stream = TRUE;
-         stream = fopen(filename, "wt");
+         stream = fopen(filename, binary ? "wb" : "wt");
          if (!stream)
             return FALSE;
       }
 
+      if (binary) {
+         static const char version = TRACE_BINARY_VERSION;
+
+         binary_names = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                                _mesa_key_string_equal);
+         if (!binary_names) {
+            if (close_stream)
+               fclose(stream);
+            stream = NULL;
+            return FALSE;
+         }
+
+         if (close_stream)
+            setvbuf(stream, NULL, _IOFBF, 1 << 20);
+         trace_dump_write(TRACE_BINARY_MAGIC, TRACE_BINARY_MAGIC_SIZE);
+         trace_dump_write(&version, 1);
+         atexit(trace_dump_trace_close);
+         return TRUE;
+      }
+
       trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
       trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
       trace_dump_writes("<trace version='0.1'>\n");
@@ -364,6 +466,16 @@ void trace_dump_call_begin_locked(const char *klass, const char *method)
       return;
 
    ++call_no;
+
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_CALL);
+      trace_dump_binary_uint(call_no);
+      trace_dump_binary_name(klass);
+      trace_dump_binary_name(method);
+      call_start_time = os_time_get_nano();
+      return;
+   }
+
    trace_dump_indent(1);
    trace_dump_writes("<call no=\'");
    trace_dump_writef("%lu", call_no);
@@ -384,6 +496,12 @@ void trace_dump_call_end_locked(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      call_end_time = os_time_get_nano();
+      trace_dump_call_time(call_end_time - call_start_time);
+      return;
+   }
+
    call_end_time = os_time_get();
 
    trace_dump_call_time(call_end_time - call_start_time);
@@ -410,6 +528,12 @@ void trace_dump_arg_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_ARG);
+      trace_dump_binary_name(name);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin1("arg", "name", name);
 }
@@ -419,6 +543,9 @@ void trace_dump_arg_end(void)
    if (!dumping)
       return;
 
+   if (binary)
+      return;
+
    trace_dump_tag_end("arg");
    trace_dump_newline();
 }
@@ -428,6 +555,11 @@ void trace_dump_ret_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_RET);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin("ret");
 }
@@ -437,6 +569,9 @@ void trace_dump_ret_end(void)
    if (!dumping)
       return;
 
+   if (binary)
+      return;
+
    trace_dump_tag_end("ret");
    trace_dump_newline();
 }
@@ -446,6 +581,11 @@ void trace_dump_bool(int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(value ? TRACE_TOKEN_TRUE : TRACE_TOKEN_FALSE);
+      return;
+   }
+
    trace_dump_writef("<bool>%c</bool>", value ? '1' : '0');
 }
 
@@ -454,6 +594,12 @@ void trace_dump_int(long long int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_INT);
+      trace_dump_binary_sint(value);
+      return;
+   }
+
    trace_dump_writef("<int>%lli</int>", value);
 }
 
@@ -462,6 +608,12 @@ void trace_dump_uint(long long unsigned value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_UINT);
+      trace_dump_binary_uint(value);
+      return;
+   }
+
    trace_dump_writef("<uint>%llu</uint>", value);
 }
 
@@ -470,6 +622,12 @@ void trace_dump_float(double value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_FLOAT);
+      trace_dump_write((const char *)&value, sizeof value);
+      return;
+   }
+
    trace_dump_writef("<float>%g</float>", value);
 }
 
@@ -483,6 +641,12 @@ void trace_dump_bytes(const void *data,
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_BYTES);
+      trace_dump_binary_data(data, size);
+      return;
+   }
+
    trace_dump_writes("<bytes>");
    for(i = 0; i < size; ++i) {
       uint8_t byte = *p++;
@@ -503,10 +667,10 @@ void trace_dump_box_bytes(const void *data,
    size_t size;
 
    /*
-    * Only dump buffer transfers to avoid huge files.
-    * TODO: Make this run-time configurable
+    * Only dump buffer transfers to avoid huge XML files.  Binary traces are
+    * meant to be replayed, so they need the texture contents too.
     */
-   if (resource->target != PIPE_BUFFER) {
+   if (resource->target != PIPE_BUFFER && !binary) {
       size = 0;
    } else {
       enum pipe_format format = resource->format;
@@ -527,6 +691,12 @@ void trace_dump_string(const char *str)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_STRING);
+      trace_dump_binary_data(str, strlen(str));
+      return;
+   }
+
    trace_dump_writes("<string>");
    trace_dump_escape(str);
    trace_dump_writes("</string>");
@@ -537,6 +707,12 @@ void trace_dump_enum(const char *value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_ENUM);
+      trace_dump_binary_name(value);
+      return;
+   }
+
    trace_dump_writes("<enum>");
    trace_dump_escape(value);
    trace_dump_writes("</enum>");
@@ -547,6 +723,11 @@ void trace_dump_array_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_ARRAY);
+      return;
+   }
+
    trace_dump_writes("<array>");
 }
 
@@ -555,6 +736,11 @@ void trace_dump_array_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_ARRAY_END);
+      return;
+   }
+
    trace_dump_writes("</array>");
 }
 
@@ -563,6 +749,9 @@ void trace_dump_elem_begin(void)
    if (!dumping)
       return;
 
+   if (binary)
+      return;
+
    trace_dump_writes("<elem>");
 }
 
@@ -571,6 +760,9 @@ void trace_dump_elem_end(void)
    if (!dumping)
       return;
 
+   if (binary)
+      return;
+
    trace_dump_writes("</elem>");
 }
 
@@ -579,6 +771,12 @@ void trace_dump_struct_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_STRUCT);
+      trace_dump_binary_name(name);
+      return;
+   }
+
    trace_dump_writef("<struct name='%s'>", name);
 }
 
@@ -587,6 +785,11 @@ void trace_dump_struct_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_STRUCT_END);
+      return;
+   }
+
    trace_dump_writes("</struct>");
 }
 
@@ -595,6 +798,12 @@ void trace_dump_member_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_MEMBER);
+      trace_dump_binary_name(name);
+      return;
+   }
+
    trace_dump_writef("<member name='%s'>", name);
 }
 
@@ -603,6 +812,9 @@ void trace_dump_member_end(void)
    if (!dumping)
       return;
 
+   if (binary)
+      return;
+
    trace_dump_writes("</member>");
 }
 
@@ -611,6 +823,11 @@ void trace_dump_null(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_dump_binary_token(TRACE_TOKEN_NULL);
+      return;
+   }
+
    trace_dump_writes("<null/>");
 }
 
@@ -619,7 +836,11 @@ void trace_dump_ptr(const void *value)
    if (!dumping)
       return;
 
-   if(value)
+   if (binary && value) {
+      trace_dump_binary_token(TRACE_TOKEN_PTR);
+      trace_dump_binary_uint((uintptr_t)value);
+   }
+   else if(value)
       trace_dump_writef("<ptr>0x%08lx</ptr>", (unsigned long)(uintptr_t)value);
    else
       trace_dump_null();
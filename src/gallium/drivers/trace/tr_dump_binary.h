@@ -0,0 +1,95 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Binary trace encoding.
+ *
+ * The binary encoding carries exactly the same information as the XML one,
+ * as a stream of one byte tokens, each followed by its operands:
+ *
+ *   CALL <uint no> <name class> <name method>
+ *   CALL_END <uint time>    call duration in nanoseconds
+ *   ARG <name>              followed by one value
+ *   RET                     followed by one value
+ *   MEMBER <name>           followed by one value, only within a STRUCT
+ *
+ * and the values
+ *
+ *   NULL, FALSE, TRUE
+ *   INT <sint>, UINT <uint>, PTR <uint>
+ *   FLOAT <8 bytes>         IEEE double, little endian
+ *   STRING <uint size> <bytes>
+ *   BYTES <uint size> <bytes>
+ *   ENUM <name>
+ *   ARRAY <values> ARRAY_END
+ *   STRUCT <name> <members> STRUCT_END
+ *
+ * Unsigned integers are encoded in LEB128, and signed integers are zigzag
+ * encoded first.  Names (classes, methods, arguments, members, structs and
+ * enums) are interned: a name is written as a LEB128 index, where 0 means
+ * that a new name follows as <uint size> <bytes>, which then gets the next
+ * free index, starting at 1.
+ *
+ * The stream starts with TRACE_BINARY_MAGIC followed by one byte holding
+ * TRACE_BINARY_VERSION.  A stream can be read up to its last complete call,
+ * so traces of applications that didn't exit cleanly are still usable.
+ */
+
+#ifndef TR_DUMP_BINARY_H
+#define TR_DUMP_BINARY_H
+
+
+#define TRACE_BINARY_MAGIC "GTRB"
+#define TRACE_BINARY_MAGIC_SIZE 4
+#define TRACE_BINARY_VERSION 1
+
+
+enum trace_binary_token {
+   TRACE_TOKEN_CALL = 1,
+   TRACE_TOKEN_CALL_END,
+   TRACE_TOKEN_ARG,
+   TRACE_TOKEN_RET,
+   TRACE_TOKEN_MEMBER,
+   TRACE_TOKEN_NULL,
+   TRACE_TOKEN_FALSE,
+   TRACE_TOKEN_TRUE,
+   TRACE_TOKEN_INT,
+   TRACE_TOKEN_UINT,
+   TRACE_TOKEN_PTR,
+   TRACE_TOKEN_FLOAT,
+   TRACE_TOKEN_STRING,
+   TRACE_TOKEN_BYTES,
+   TRACE_TOKEN_ENUM,
+   TRACE_TOKEN_ARRAY,
+   TRACE_TOKEN_ARRAY_END,
+   TRACE_TOKEN_STRUCT,
+   TRACE_TOKEN_STRUCT_END,
+};
+
+
+#endif /* TR_DUMP_BINARY_H */
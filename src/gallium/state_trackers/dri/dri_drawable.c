@@ -37,6 +37,7 @@
 #include "util/u_format.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
+#include "util/trace_event.h"
 
 static void
 swap_fences_unref(struct dri_drawable *draw);
@@ -525,7 +526,9 @@ dri_flush(__DRIcontext *cPriv,
 
       fence = swap_fences_pop_front(drawable);
       if (fence) {
+         trace_event_begin("throttle wait");
          (void) screen->fence_finish(screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+         trace_event_end("throttle wait");
          screen->fence_reference(screen, &fence, NULL);
       }
 
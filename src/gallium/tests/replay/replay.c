@@ -0,0 +1,2230 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Replays binary gallium traces (see drivers/trace/tr_dump_binary.h) against
+ * a real driver, and reports how long each kind of call took, both when it
+ * was traced and when it was replayed.
+ *
+ * Usage: replay [-d DEVICE] [-v] TRACE
+ *
+ * Objects are tracked by the pointer values recorded in the trace.  Calls
+ * which can't be replayed (user vertex/index arrays, compute inputs, screen
+ * queries) are skipped and counted separately.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "os/os_time.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_dump.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "util/hash_table.h"
+#include "util/ralloc.h"
+#include "pipe-loader/pipe_loader.h"
+
+#include "trace/tr_dump_binary.h"
+
+
+#define REPLAY_MAX_ARGS 16
+#define REPLAY_MAX_TOKENS (64 * 1024)
+
+
+/*
+ * Trace representation
+ */
+
+struct replay;
+struct trace_call;
+
+typedef void (*replay_func)(struct replay *r, const struct trace_call *call);
+
+struct replay_method {
+   const struct trace_name *klass;
+   const struct trace_name *method;
+   replay_func func;
+   boolean needs_context;
+
+   uint64_t count;
+   uint64_t traced_time;
+   uint64_t replay_time;
+   uint64_t replay_min;
+   uint64_t replay_max;
+
+   struct replay_method *next;
+};
+
+struct trace_name {
+   char *str;
+   int value;                       /**< enum value, or -1 if unresolved */
+   struct replay_method *methods;   /**< when used as a method name */
+};
+
+struct trace_value {
+   enum trace_binary_token type;
+   union {
+      uint64_t u;
+      int64_t i;
+      double f;
+      struct {
+         const char *data;
+         size_t size;
+      } blob;
+      const struct trace_name *name;
+      struct {
+         const struct trace_name *name;
+         unsigned count;
+         const struct trace_name **member_names;
+         const struct trace_value **elems;
+      } list;
+   } u;
+};
+
+struct trace_call {
+   uint64_t no;
+   const struct trace_name *klass;
+   const struct trace_name *method;
+   unsigned num_args;
+   const struct trace_name *arg_names[REPLAY_MAX_ARGS];
+   const struct trace_value *args[REPLAY_MAX_ARGS];
+   const struct trace_value *ret;
+   uint64_t time;
+};
+
+
+/*
+ * Replay state
+ */
+
+struct replay {
+   FILE *stream;
+   boolean eof;
+   boolean verbose;
+
+   struct trace_name **names;
+   unsigned num_names;
+   unsigned max_names;
+
+   uint64_t num_calls;
+   uint64_t num_skipped;
+
+   struct pipe_screen *screen;
+
+   /* Maps from traced pointers to replayed objects */
+   struct hash_table *contexts;
+   struct hash_table *resources;
+   struct hash_table *surfaces;
+   struct hash_table *sampler_views;
+   struct hash_table *so_targets;
+   struct hash_table *queries;
+   struct hash_table *states;
+   struct hash_table *fences;
+};
+
+
+/*
+ * Reading
+ */
+
+static inline uint8_t
+read_byte(struct replay *r)
+{
+   int c = getc(r->stream);
+   if (c == EOF) {
+      r->eof = TRUE;
+      return 0;
+   }
+   return c;
+}
+
+static uint64_t
+read_uint(struct replay *r)
+{
+   uint64_t value = 0;
+   unsigned shift = 0;
+   uint8_t byte;
+
+   do {
+      byte = read_byte(r);
+      if (shift < 64)
+         value |= (uint64_t)(byte & 0x7f) << shift;
+      shift += 7;
+   } while ((byte & 0x80) && !r->eof);
+
+   return value;
+}
+
+static int64_t
+read_sint(struct replay *r)
+{
+   uint64_t value = read_uint(r);
+   return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static char *
+read_data(struct replay *r, void *mem_ctx, size_t *size)
+{
+   char *data;
+
+   *size = read_uint(r);
+   if (r->eof)
+      return NULL;
+
+   data = ralloc_size(mem_ctx, *size + 1);
+   if (!data || fread(data, 1, *size, r->stream) != *size) {
+      r->eof = TRUE;
+      return NULL;
+   }
+   data[*size] = 0;
+
+   return data;
+}
+
+static const struct trace_name *
+read_name(struct replay *r)
+{
+   struct trace_name *name;
+   uint64_t index;
+   size_t size;
+
+   index = read_uint(r);
+   if (r->eof)
+      return NULL;
+
+   if (index) {
+      if (index > r->num_names) {
+         fprintf(stderr, "error: invalid name index %" PRIu64 "\n", index);
+         r->eof = TRUE;
+         return NULL;
+      }
+      return r->names[index - 1];
+   }
+
+   if (r->num_names == r->max_names) {
+      r->max_names = MAX2(2 * r->max_names, 256);
+      r->names = reralloc(r, r->names, struct trace_name *, r->max_names);
+   }
+
+   name = rzalloc(r, struct trace_name);
+   name->str = read_data(r, name, &size);
+   name->value = -1;
+   r->names[r->num_names++] = name;
+
+   return name;
+}
+
+static const struct trace_value *
+read_value(struct replay *r, void *mem_ctx, uint8_t token);
+
+static const struct trace_value *
+read_list(struct replay *r, void *mem_ctx, struct trace_value *value,
+          uint8_t end_token)
+{
+   unsigned max_elems = 0;
+
+   for (;;) {
+      const struct trace_name *member_name = NULL;
+      uint8_t token = read_byte(r);
+
+      if (r->eof)
+         return NULL;
+      if (token == end_token)
+         return value;
+
+      if (token == TRACE_TOKEN_MEMBER) {
+         member_name = read_name(r);
+         token = read_byte(r);
+      }
+
+      if (value->u.list.count == max_elems) {
+         max_elems = MAX2(2 * max_elems, 8);
+         value->u.list.elems = reralloc(mem_ctx, value->u.list.elems,
+                                        const struct trace_value *, max_elems);
+         value->u.list.member_names =
+            reralloc(mem_ctx, value->u.list.member_names,
+                     const struct trace_name *, max_elems);
+      }
+
+      value->u.list.member_names[value->u.list.count] = member_name;
+      value->u.list.elems[value->u.list.count] = read_value(r, mem_ctx, token);
+      ++value->u.list.count;
+   }
+}
+
+static const struct trace_value *
+read_value(struct replay *r, void *mem_ctx, uint8_t token)
+{
+   struct trace_value *value;
+
+   if (r->eof)
+      return NULL;
+
+   value = rzalloc(mem_ctx, struct trace_value);
+   value->type = token;
+
+   switch (token) {
+   case TRACE_TOKEN_NULL:
+   case TRACE_TOKEN_FALSE:
+   case TRACE_TOKEN_TRUE:
+      break;
+   case TRACE_TOKEN_INT:
+      value->u.i = read_sint(r);
+      break;
+   case TRACE_TOKEN_UINT:
+   case TRACE_TOKEN_PTR:
+      value->u.u = read_uint(r);
+      break;
+   case TRACE_TOKEN_FLOAT:
+      if (fread(&value->u.f, sizeof value->u.f, 1, r->stream) != 1)
+         r->eof = TRUE;
+      break;
+   case TRACE_TOKEN_STRING:
+   case TRACE_TOKEN_BYTES:
+      value->u.blob.data = read_data(r, mem_ctx, &value->u.blob.size);
+      break;
+   case TRACE_TOKEN_ENUM:
+      value->u.name = read_name(r);
+      break;
+   case TRACE_TOKEN_ARRAY:
+      return read_list(r, mem_ctx, value, TRACE_TOKEN_ARRAY_END);
+   case TRACE_TOKEN_STRUCT:
+      value->u.list.name = read_name(r);
+      return read_list(r, mem_ctx, value, TRACE_TOKEN_STRUCT_END);
+   default:
+      fprintf(stderr, "error: unexpected token %u\n", token);
+      r->eof = TRUE;
+      return NULL;
+   }
+
+   return value;
+}
+
+/**
+ * Read the next complete call.  Returns FALSE at the end of the trace,
+ * including when the trace was truncated in the middle of a call.
+ */
+static boolean
+read_call(struct replay *r, void *mem_ctx, struct trace_call *call)
+{
+   uint8_t token;
+
+   token = read_byte(r);
+   if (r->eof)
+      return FALSE;
+   if (token != TRACE_TOKEN_CALL) {
+      fprintf(stderr, "error: expected a call, got token %u\n", token);
+      return FALSE;
+   }
+
+   memset(call, 0, sizeof *call);
+   call->no = read_uint(r);
+   call->klass = read_name(r);
+   call->method = read_name(r);
+
+   while (!r->eof) {
+      token = read_byte(r);
+      switch (token) {
+      case TRACE_TOKEN_ARG:
+         if (call->num_args == REPLAY_MAX_ARGS) {
+            fprintf(stderr, "error: too many arguments in call %" PRIu64 "\n",
+                    call->no);
+            return FALSE;
+         }
+         call->arg_names[call->num_args] = read_name(r);
+         call->args[call->num_args] = read_value(r, mem_ctx, read_byte(r));
+         ++call->num_args;
+         break;
+      case TRACE_TOKEN_RET:
+         call->ret = read_value(r, mem_ctx, read_byte(r));
+         break;
+      case TRACE_TOKEN_CALL_END:
+         call->time = read_uint(r);
+         return !r->eof;
+      default:
+         if (!r->eof)
+            fprintf(stderr, "error: unexpected token %u in call %" PRIu64 "\n",
+                    token, call->no);
+         return FALSE;
+      }
+   }
+
+   return FALSE;
+}
+
+
+/*
+ * Value accessors.  They all accept NULL for missing arguments/members.
+ */
+
+static const struct trace_value *
+arg(const struct trace_call *call, const char *name)
+{
+   unsigned i;
+   for (i = 0; i < call->num_args; ++i)
+      if (strcmp(call->arg_names[i]->str, name) == 0)
+         return call->args[i];
+   return NULL;
+}
+
+static const struct trace_value *
+member(const struct trace_value *value, const char *name)
+{
+   unsigned i;
+
+   if (!value || value->type != TRACE_TOKEN_STRUCT)
+      return NULL;
+
+   for (i = 0; i < value->u.list.count; ++i)
+      if (value->u.list.member_names[i] &&
+          strcmp(value->u.list.member_names[i]->str, name) == 0)
+         return value->u.list.elems[i];
+   return NULL;
+}
+
+static unsigned
+value_count(const struct trace_value *value)
+{
+   if (!value || value->type != TRACE_TOKEN_ARRAY)
+      return 0;
+   return value->u.list.count;
+}
+
+static const struct trace_value *
+elem(const struct trace_value *value, unsigned i)
+{
+   return i < value_count(value) ? value->u.list.elems[i] : NULL;
+}
+
+static boolean
+value_is_null(const struct trace_value *value)
+{
+   return !value || value->type == TRACE_TOKEN_NULL;
+}
+
+static uint64_t
+value_uint(const struct trace_value *value)
+{
+   if (!value)
+      return 0;
+
+   switch (value->type) {
+   case TRACE_TOKEN_TRUE:
+      return 1;
+   case TRACE_TOKEN_UINT:
+   case TRACE_TOKEN_PTR:
+      return value->u.u;
+   case TRACE_TOKEN_INT:
+      return value->u.i;
+   case TRACE_TOKEN_FLOAT:
+      return value->u.f;
+   default:
+      return 0;
+   }
+}
+
+static int64_t
+value_int(const struct trace_value *value)
+{
+   return value_uint(value);
+}
+
+static double
+value_float(const struct trace_value *value)
+{
+   if (value && value->type == TRACE_TOKEN_FLOAT)
+      return value->u.f;
+   if (value && value->type == TRACE_TOKEN_INT)
+      return value->u.i;
+   return value_uint(value);
+}
+
+#define value_bool(_value) (value_uint(_value) != 0)
+#define value_ptr(_value) value_uint(_value)
+
+static const char *
+value_string(const struct trace_value *value)
+{
+   if (value && value->type == TRACE_TOKEN_STRING)
+      return value->u.blob.data;
+   return NULL;
+}
+
+static const void *
+value_bytes(const struct trace_value *value, size_t *size)
+{
+   if (value && value->type == TRACE_TOKEN_BYTES) {
+      *size = value->u.blob.size;
+      return value->u.blob.data;
+   }
+   *size = 0;
+   return NULL;
+}
+
+static enum pipe_format
+value_format(const struct trace_value *value)
+{
+   struct trace_name *name;
+   unsigned i;
+
+   if (!value || value->type != TRACE_TOKEN_ENUM)
+      return PIPE_FORMAT_NONE;
+
+   name = (struct trace_name *)value->u.name;
+   if (name->value < 0) {
+      name->value = PIPE_FORMAT_NONE;
+      for (i = 0; i < PIPE_FORMAT_COUNT; ++i) {
+         if (strcmp(util_format_name(i), name->str) == 0) {
+            name->value = i;
+            break;
+         }
+      }
+   }
+
+   return name->value;
+}
+
+static unsigned
+value_query_type(const struct trace_value *value)
+{
+   struct trace_name *name;
+   unsigned i;
+
+   if (!value || value->type != TRACE_TOKEN_ENUM)
+      return value_uint(value);
+
+   name = (struct trace_name *)value->u.name;
+   if (name->value < 0) {
+      name->value = PIPE_QUERY_TYPES;
+      for (i = 0; i < PIPE_QUERY_TYPES; ++i) {
+         if (strcmp(util_dump_query_type(i, FALSE), name->str) == 0) {
+            name->value = i;
+            break;
+         }
+      }
+   }
+
+   return name->value;
+}
+
+#define get_member(_type, _obj, _value, _member) \
+   (_obj)->_member = value_##_type(member(_value, #_member))
+
+#define get_member_array(_type, _obj, _value, _member) \
+   do { \
+      const struct trace_value *_array = member(_value, #_member); \
+      unsigned _i; \
+      for (_i = 0; _i < ARRAY_SIZE((_obj)->_member); ++_i) \
+         (_obj)->_member[_i] = value_##_type(elem(_array, _i)); \
+   } while (0)
+
+
+/*
+ * Object tables
+ */
+
+static void *
+lookup(struct hash_table *ht, const struct trace_value *value)
+{
+   uint64_t ptr = value_ptr(value);
+   struct hash_entry *entry;
+
+   if (!ptr)
+      return NULL;
+
+   entry = _mesa_hash_table_search(ht, (void *)(uintptr_t)ptr);
+   return entry ? entry->data : NULL;
+}
+
+static void
+insert(struct hash_table *ht, const struct trace_value *value, void *obj)
+{
+   uint64_t ptr = value_ptr(value);
+
+   if (ptr && obj)
+      _mesa_hash_table_insert(ht, (void *)(uintptr_t)ptr, obj);
+}
+
+static void *
+take(struct hash_table *ht, const struct trace_value *value)
+{
+   uint64_t ptr = value_ptr(value);
+   struct hash_entry *entry;
+   void *obj;
+
+   if (!ptr)
+      return NULL;
+
+   entry = _mesa_hash_table_search(ht, (void *)(uintptr_t)ptr);
+   if (!entry)
+      return NULL;
+
+   obj = entry->data;
+   _mesa_hash_table_remove(ht, entry);
+   return obj;
+}
+
+static struct pipe_context *
+call_context(struct replay *r, const struct trace_call *call)
+{
+   return call->num_args ? lookup(r->contexts, call->args[0]) : NULL;
+}
+
+#define get_resource(_r, _value) \
+   ((struct pipe_resource *)lookup((_r)->resources, _value))
+
+
+/*
+ * State conversion, mirroring drivers/trace/tr_dump_state.c
+ */
+
+static void
+get_resource_template(const struct trace_value *value,
+                      struct pipe_resource *templat)
+{
+   memset(templat, 0, sizeof *templat);
+   get_member(uint, templat, value, target);
+   get_member(format, templat, value, format);
+   templat->width0 = value_uint(member(value, "width"));
+   templat->height0 = value_uint(member(value, "height"));
+   templat->depth0 = value_uint(member(value, "depth"));
+   templat->array_size = value_uint(member(value, "array_size"));
+   get_member(uint, templat, value, last_level);
+   get_member(uint, templat, value, nr_samples);
+   get_member(uint, templat, value, usage);
+   get_member(uint, templat, value, bind);
+   get_member(uint, templat, value, flags);
+}
+
+static void
+get_box(const struct trace_value *value, struct pipe_box *box)
+{
+   get_member(int, box, value, x);
+   get_member(int, box, value, y);
+   get_member(int, box, value, z);
+   get_member(int, box, value, width);
+   get_member(int, box, value, height);
+   get_member(int, box, value, depth);
+}
+
+static void
+get_scissor_state(const struct trace_value *value,
+                  struct pipe_scissor_state *state)
+{
+   get_member(uint, state, value, minx);
+   get_member(uint, state, value, miny);
+   get_member(uint, state, value, maxx);
+   get_member(uint, state, value, maxy);
+}
+
+static void
+get_viewport_state(const struct trace_value *value,
+                   struct pipe_viewport_state *state)
+{
+   get_member_array(float, state, value, scale);
+   get_member_array(float, state, value, translate);
+}
+
+static void *
+create_rasterizer_state(struct pipe_context *pipe,
+                        const struct trace_value *value)
+{
+   struct pipe_rasterizer_state state;
+
+   memset(&state, 0, sizeof state);
+   get_member(bool, &state, value, flatshade);
+   get_member(bool, &state, value, light_twoside);
+   get_member(bool, &state, value, clamp_vertex_color);
+   get_member(bool, &state, value, clamp_fragment_color);
+   get_member(uint, &state, value, front_ccw);
+   get_member(uint, &state, value, cull_face);
+   get_member(uint, &state, value, fill_front);
+   get_member(uint, &state, value, fill_back);
+   get_member(bool, &state, value, offset_point);
+   get_member(bool, &state, value, offset_line);
+   get_member(bool, &state, value, offset_tri);
+   get_member(bool, &state, value, scissor);
+   get_member(bool, &state, value, poly_smooth);
+   get_member(bool, &state, value, poly_stipple_enable);
+   get_member(bool, &state, value, point_smooth);
+   get_member(bool, &state, value, sprite_coord_mode);
+   get_member(bool, &state, value, point_quad_rasterization);
+   get_member(bool, &state, value, point_size_per_vertex);
+   get_member(bool, &state, value, multisample);
+   get_member(bool, &state, value, line_smooth);
+   get_member(bool, &state, value, line_stipple_enable);
+   get_member(bool, &state, value, line_last_pixel);
+   get_member(bool, &state, value, flatshade_first);
+   get_member(bool, &state, value, half_pixel_center);
+   get_member(bool, &state, value, bottom_edge_rule);
+   get_member(bool, &state, value, rasterizer_discard);
+   get_member(bool, &state, value, depth_clip);
+   get_member(bool, &state, value, clip_halfz);
+   get_member(uint, &state, value, clip_plane_enable);
+   get_member(uint, &state, value, line_stipple_factor);
+   get_member(uint, &state, value, line_stipple_pattern);
+   get_member(uint, &state, value, sprite_coord_enable);
+   get_member(float, &state, value, line_width);
+   get_member(float, &state, value, point_size);
+   get_member(float, &state, value, offset_units);
+   get_member(float, &state, value, offset_scale);
+   get_member(float, &state, value, offset_clamp);
+
+   return pipe->create_rasterizer_state(pipe, &state);
+}
+
+static void *
+create_depth_stencil_alpha_state(struct pipe_context *pipe,
+                                 const struct trace_value *value)
+{
+   struct pipe_depth_stencil_alpha_state state;
+   const struct trace_value *depth = member(value, "depth");
+   const struct trace_value *stencil = member(value, "stencil");
+   const struct trace_value *alpha = member(value, "alpha");
+   unsigned i;
+
+   memset(&state, 0, sizeof state);
+   get_member(bool, &state.depth, depth, enabled);
+   get_member(bool, &state.depth, depth, writemask);
+   get_member(uint, &state.depth, depth, func);
+   for (i = 0; i < 2; ++i) {
+      const struct trace_value *s = elem(stencil, i);
+      get_member(bool, &state.stencil[i], s, enabled);
+      get_member(uint, &state.stencil[i], s, func);
+      get_member(uint, &state.stencil[i], s, fail_op);
+      get_member(uint, &state.stencil[i], s, zpass_op);
+      get_member(uint, &state.stencil[i], s, zfail_op);
+      get_member(uint, &state.stencil[i], s, valuemask);
+      get_member(uint, &state.stencil[i], s, writemask);
+   }
+   get_member(bool, &state.alpha, alpha, enabled);
+   get_member(uint, &state.alpha, alpha, func);
+   get_member(float, &state.alpha, alpha, ref_value);
+
+   return pipe->create_depth_stencil_alpha_state(pipe, &state);
+}
+
+static void *
+create_blend_state(struct pipe_context *pipe, const struct trace_value *value)
+{
+   struct pipe_blend_state state;
+   const struct trace_value *rt = member(value, "rt");
+   unsigned i;
+
+   memset(&state, 0, sizeof state);
+   get_member(bool, &state, value, dither);
+   get_member(bool, &state, value, logicop_enable);
+   get_member(uint, &state, value, logicop_func);
+   get_member(bool, &state, value, independent_blend_enable);
+   for (i = 0; i < MIN2(value_count(rt), PIPE_MAX_COLOR_BUFS); ++i) {
+      const struct trace_value *b = elem(rt, i);
+      get_member(uint, &state.rt[i], b, blend_enable);
+      get_member(uint, &state.rt[i], b, rgb_func);
+      get_member(uint, &state.rt[i], b, rgb_src_factor);
+      get_member(uint, &state.rt[i], b, rgb_dst_factor);
+      get_member(uint, &state.rt[i], b, alpha_func);
+      get_member(uint, &state.rt[i], b, alpha_src_factor);
+      get_member(uint, &state.rt[i], b, alpha_dst_factor);
+      get_member(uint, &state.rt[i], b, colormask);
+   }
+
+   return pipe->create_blend_state(pipe, &state);
+}
+
+static void *
+create_sampler_state(struct pipe_context *pipe,
+                     const struct trace_value *value)
+{
+   struct pipe_sampler_state state;
+   const struct trace_value *border_color = member(value, "border_color.f");
+   unsigned i;
+
+   memset(&state, 0, sizeof state);
+   get_member(uint, &state, value, wrap_s);
+   get_member(uint, &state, value, wrap_t);
+   get_member(uint, &state, value, wrap_r);
+   get_member(uint, &state, value, min_img_filter);
+   get_member(uint, &state, value, min_mip_filter);
+   get_member(uint, &state, value, mag_img_filter);
+   get_member(uint, &state, value, compare_mode);
+   get_member(uint, &state, value, compare_func);
+   get_member(bool, &state, value, normalized_coords);
+   get_member(uint, &state, value, max_anisotropy);
+   get_member(bool, &state, value, seamless_cube_map);
+   get_member(float, &state, value, lod_bias);
+   get_member(float, &state, value, min_lod);
+   get_member(float, &state, value, max_lod);
+   for (i = 0; i < 4; ++i)
+      state.border_color.f[i] = value_float(elem(border_color, i));
+
+   return pipe->create_sampler_state(pipe, &state);
+}
+
+static struct tgsi_token *
+get_tokens(void *mem_ctx, const struct trace_value *value)
+{
+   const char *text = value_string(value);
+   struct tgsi_token *tokens;
+
+   if (!text)
+      return NULL;
+
+   tokens = ralloc_array(mem_ctx, struct tgsi_token, REPLAY_MAX_TOKENS);
+   if (!tokens || !tgsi_text_translate(text, tokens, REPLAY_MAX_TOKENS)) {
+      fprintf(stderr, "error: failed to translate shader:\n%s\n", text);
+      return NULL;
+   }
+
+   return tokens;
+}
+
+static boolean
+get_shader_state(void *mem_ctx, const struct trace_value *value,
+                 struct pipe_shader_state *state)
+{
+   const struct trace_value *so = member(value, "stream_output");
+   const struct trace_value *outputs = member(so, "output");
+   unsigned i;
+
+   memset(state, 0, sizeof *state);
+   state->type = PIPE_SHADER_IR_TGSI;
+   state->tokens = get_tokens(mem_ctx, member(value, "tokens"));
+   if (!state->tokens)
+      return FALSE;
+
+   get_member(uint, &state->stream_output, so, num_outputs);
+   get_member_array(uint, &state->stream_output, so, stride);
+   for (i = 0; i < MIN2(value_count(outputs), PIPE_MAX_SO_OUTPUTS); ++i) {
+      const struct trace_value *o = elem(outputs, i);
+      get_member(uint, &state->stream_output.output[i], o, register_index);
+      get_member(uint, &state->stream_output.output[i], o, start_component);
+      get_member(uint, &state->stream_output.output[i], o, num_components);
+      get_member(uint, &state->stream_output.output[i], o, output_buffer);
+      get_member(uint, &state->stream_output.output[i], o, dst_offset);
+      get_member(uint, &state->stream_output.output[i], o, stream);
+   }
+
+   return TRUE;
+}
+
+static void
+get_sampler_view_template(const struct trace_value *value,
+                          struct pipe_sampler_view *templ)
+{
+   const struct trace_value *u = member(value, "u");
+   const struct trace_value *buf = member(u, "buf");
+   const struct trace_value *tex = member(u, "tex");
+
+   memset(templ, 0, sizeof *templ);
+   get_member(format, templ, value, format);
+   if (buf) {
+      get_member(uint, &templ->u.buf, buf, offset);
+      get_member(uint, &templ->u.buf, buf, size);
+   } else {
+      get_member(uint, &templ->u.tex, tex, first_layer);
+      get_member(uint, &templ->u.tex, tex, last_layer);
+      get_member(uint, &templ->u.tex, tex, first_level);
+      get_member(uint, &templ->u.tex, tex, last_level);
+   }
+   get_member(uint, templ, value, swizzle_r);
+   get_member(uint, templ, value, swizzle_g);
+   get_member(uint, templ, value, swizzle_b);
+   get_member(uint, templ, value, swizzle_a);
+}
+
+static void
+get_surface_template(const struct trace_value *value,
+                     struct pipe_surface *templ)
+{
+   const struct trace_value *u = member(value, "u");
+   const struct trace_value *buf = member(u, "buf");
+   const struct trace_value *tex = member(u, "tex");
+
+   memset(templ, 0, sizeof *templ);
+   get_member(format, templ, value, format);
+   get_member(uint, templ, value, width);
+   get_member(uint, templ, value, height);
+   if (buf) {
+      get_member(uint, &templ->u.buf, buf, first_element);
+      get_member(uint, &templ->u.buf, buf, last_element);
+   } else {
+      get_member(uint, &templ->u.tex, tex, level);
+      get_member(uint, &templ->u.tex, tex, first_layer);
+      get_member(uint, &templ->u.tex, tex, last_layer);
+   }
+}
+
+
+/*
+ * Screen calls
+ */
+
+static void
+replay_context_create(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe;
+
+   pipe = r->screen->context_create(r->screen, NULL,
+                                    value_uint(arg(call, "flags")));
+   insert(r->contexts, call->ret, pipe);
+}
+
+static void
+replay_resource_create(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_resource templat;
+   struct pipe_resource *resource;
+
+   get_resource_template(arg(call, "templat"), &templat);
+   resource = r->screen->resource_create(r->screen, &templat);
+   if (!resource)
+      fprintf(stderr, "warning: call %" PRIu64 ": resource_create failed\n",
+              call->no);
+   insert(r->resources, call->ret, resource);
+}
+
+static void
+replay_resource_destroy(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_resource *resource = take(r->resources, arg(call, "resource"));
+   pipe_resource_reference(&resource, NULL);
+}
+
+static void
+replay_fence_finish(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_fence_handle *fence = lookup(r->fences, arg(call, "fence"));
+
+   if (fence)
+      r->screen->fence_finish(r->screen, lookup(r->contexts, arg(call, "ctx")),
+                              fence, value_uint(arg(call, "timeout")));
+}
+
+
+/*
+ * Context calls
+ */
+
+static void
+replay_context_destroy(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = take(r->contexts, call->args[0]);
+
+   if (pipe)
+      pipe->destroy(pipe);
+}
+
+static void
+replay_flush(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_fence_handle *fence = NULL;
+   struct pipe_fence_handle *old;
+
+   pipe->flush(pipe, value_is_null(call->ret) ? NULL : &fence,
+               value_uint(arg(call, "flags")));
+
+   if (fence) {
+      old = take(r->fences, call->ret);
+      r->screen->fence_reference(r->screen, &old, NULL);
+      insert(r->fences, call->ret, fence);
+   }
+}
+
+static void
+replay_draw_vbo(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *value = arg(call, "info");
+   struct pipe_draw_info info;
+
+   memset(&info, 0, sizeof info);
+   get_member(bool, &info, value, indexed);
+   get_member(uint, &info, value, mode);
+   get_member(uint, &info, value, start);
+   get_member(uint, &info, value, count);
+   get_member(uint, &info, value, start_instance);
+   get_member(uint, &info, value, instance_count);
+   get_member(uint, &info, value, vertices_per_patch);
+   get_member(int, &info, value, index_bias);
+   get_member(uint, &info, value, min_index);
+   get_member(uint, &info, value, max_index);
+   get_member(bool, &info, value, primitive_restart);
+   get_member(uint, &info, value, restart_index);
+   get_member(uint, &info, value, indirect_offset);
+   info.count_from_stream_output =
+      lookup(r->so_targets, member(value, "count_from_stream_output"));
+   info.indirect = get_resource(r, member(value, "indirect"));
+
+   pipe->draw_vbo(pipe, &info);
+}
+
+static void
+replay_launch_grid(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *value = arg(call, "info");
+   struct pipe_grid_info info;
+
+   memset(&info, 0, sizeof info);
+   get_member(uint, &info, value, pc);
+   get_member_array(uint, &info, value, block);
+   get_member_array(uint, &info, value, grid);
+   get_member(uint, &info, value, indirect_offset);
+   info.indirect = get_resource(r, member(value, "indirect"));
+   info.work_dim = 3;
+
+   pipe->launch_grid(pipe, &info);
+}
+
+static void
+replay_create_query(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_query *query;
+
+   query = pipe->create_query(pipe, value_query_type(arg(call, "query_type")),
+                              value_uint(arg(call, "index")));
+   insert(r->queries, call->ret, query);
+}
+
+static void
+replay_destroy_query(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_query *query = take(r->queries, arg(call, "query"));
+
+   if (query)
+      pipe->destroy_query(pipe, query);
+}
+
+static void
+replay_begin_query(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_query *query = lookup(r->queries, arg(call, "query"));
+
+   if (query)
+      pipe->begin_query(pipe, query);
+}
+
+static void
+replay_end_query(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_query *query = lookup(r->queries, arg(call, "query"));
+
+   if (query)
+      pipe->end_query(pipe, query);
+}
+
+static void
+replay_get_query_result(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_query *query = lookup(r->queries, arg(call, "query"));
+   union pipe_query_result result;
+
+   /* Only wait if the application got a result at the time. */
+   if (query)
+      pipe->get_query_result(pipe, query, value_bool(call->ret), &result);
+}
+
+static void
+replay_set_active_query_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+
+   pipe->set_active_query_state(pipe, value_bool(arg(call, "enable")));
+}
+
+static void
+replay_render_condition(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+
+   pipe->render_condition(pipe, lookup(r->queries, arg(call, "query")),
+                          value_bool(arg(call, "condition")),
+                          value_uint(arg(call, "mode")));
+}
+
+#define REPLAY_STATE(_name) \
+   static void \
+   replay_create_##_name##_state(struct replay *r, \
+                                 const struct trace_call *call) \
+   { \
+      struct pipe_context *pipe = call_context(r, call); \
+      insert(r->states, call->ret, \
+             create_##_name##_state(pipe, arg(call, "state"))); \
+   } \
+   \
+   static void \
+   replay_bind_##_name##_state(struct replay *r, \
+                               const struct trace_call *call) \
+   { \
+      struct pipe_context *pipe = call_context(r, call); \
+      pipe->bind_##_name##_state(pipe, lookup(r->states, arg(call, "state"))); \
+   } \
+   \
+   static void \
+   replay_delete_##_name##_state(struct replay *r, \
+                                 const struct trace_call *call) \
+   { \
+      struct pipe_context *pipe = call_context(r, call); \
+      void *state = take(r->states, arg(call, "state")); \
+      if (state) \
+         pipe->delete_##_name##_state(pipe, state); \
+   }
+
+REPLAY_STATE(blend)
+REPLAY_STATE(rasterizer)
+REPLAY_STATE(depth_stencil_alpha)
+
+#undef REPLAY_STATE
+
+static void
+replay_create_sampler_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+
+   insert(r->states, call->ret,
+          create_sampler_state(pipe, arg(call, "state")));
+}
+
+static void
+replay_bind_sampler_states(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *states = arg(call, "states");
+   void *samplers[PIPE_MAX_SAMPLERS];
+   unsigned num = MIN2(value_uint(arg(call, "num_states")), PIPE_MAX_SAMPLERS);
+   unsigned i;
+
+   for (i = 0; i < num; ++i)
+      samplers[i] = lookup(r->states, elem(states, i));
+
+   pipe->bind_sampler_states(pipe, value_uint(arg(call, "shader")),
+                             value_uint(arg(call, "start")), num,
+                             value_is_null(states) ? NULL : samplers);
+}
+
+static void
+replay_delete_sampler_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   void *state = take(r->states, arg(call, "state"));
+
+   if (state)
+      pipe->delete_sampler_state(pipe, state);
+}
+
+#define REPLAY_SHADER_STATE(_stage) \
+   static void \
+   replay_create_##_stage##_state(struct replay *r, \
+                                  const struct trace_call *call) \
+   { \
+      struct pipe_context *pipe = call_context(r, call); \
+      struct pipe_shader_state state; \
+      void *mem_ctx = ralloc_context(NULL); \
+      if (get_shader_state(mem_ctx, arg(call, "state"), &state)) \
+         insert(r->states, call->ret, pipe->create_##_stage##_state(pipe, &state)); \
+      ralloc_free(mem_ctx); \
+   } \
+   \
+   static void \
+   replay_bind_##_stage##_state(struct replay *r, \
+                                const struct trace_call *call) \
+   { \
+      struct pipe_context *pipe = call_context(r, call); \
+      pipe->bind_##_stage##_state(pipe, lookup(r->states, arg(call, "state"))); \
+   } \
+   \
+   static void \
+   replay_delete_##_stage##_state(struct replay *r, \
+                                  const struct trace_call *call) \
+   { \
+      struct pipe_context *pipe = call_context(r, call); \
+      void *state = take(r->states, arg(call, "state")); \
+      if (state) \
+         pipe->delete_##_stage##_state(pipe, state); \
+   }
+
+REPLAY_SHADER_STATE(fs)
+REPLAY_SHADER_STATE(vs)
+REPLAY_SHADER_STATE(gs)
+REPLAY_SHADER_STATE(tcs)
+REPLAY_SHADER_STATE(tes)
+
+#undef REPLAY_SHADER_STATE
+
+static void
+replay_create_compute_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *value = arg(call, "state");
+   struct pipe_compute_state state;
+   void *mem_ctx = ralloc_context(NULL);
+
+   memset(&state, 0, sizeof state);
+   get_member(uint, &state, value, ir_type);
+   get_member(uint, &state, value, req_local_mem);
+   get_member(uint, &state, value, req_private_mem);
+   get_member(uint, &state, value, req_input_mem);
+   state.prog = get_tokens(mem_ctx, member(value, "prog"));
+
+   if (state.ir_type == PIPE_SHADER_IR_TGSI && state.prog)
+      insert(r->states, call->ret, pipe->create_compute_state(pipe, &state));
+
+   ralloc_free(mem_ctx);
+}
+
+static void
+replay_bind_compute_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+
+   pipe->bind_compute_state(pipe, lookup(r->states, arg(call, "state")));
+}
+
+static void
+replay_delete_compute_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   void *state = take(r->states, arg(call, "state"));
+
+   if (state)
+      pipe->delete_compute_state(pipe, state);
+}
+
+static void
+replay_create_vertex_elements_state(struct replay *r,
+                                    const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *elements = arg(call, "elements");
+   struct pipe_vertex_element velems[PIPE_MAX_ATTRIBS];
+   unsigned num = MIN2(value_count(elements), PIPE_MAX_ATTRIBS);
+   unsigned i;
+
+   memset(velems, 0, sizeof velems);
+   for (i = 0; i < num; ++i) {
+      const struct trace_value *e = elem(elements, i);
+      get_member(uint, &velems[i], e, src_offset);
+      get_member(uint, &velems[i], e, instance_divisor);
+      get_member(uint, &velems[i], e, vertex_buffer_index);
+      get_member(format, &velems[i], e, src_format);
+   }
+
+   insert(r->states, call->ret,
+          pipe->create_vertex_elements_state(pipe, num, velems));
+}
+
+static void
+replay_bind_vertex_elements_state(struct replay *r,
+                                  const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+
+   pipe->bind_vertex_elements_state(pipe,
+                                    lookup(r->states, arg(call, "state")));
+}
+
+static void
+replay_delete_vertex_elements_state(struct replay *r,
+                                    const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   void *state = take(r->states, arg(call, "state"));
+
+   if (state)
+      pipe->delete_vertex_elements_state(pipe, state);
+}
+
+static void
+replay_set_blend_color(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_blend_color state;
+
+   get_member_array(float, &state, arg(call, "state"), color);
+   pipe->set_blend_color(pipe, &state);
+}
+
+static void
+replay_set_stencil_ref(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_stencil_ref state;
+
+   get_member_array(uint, &state, arg(call, "state"), ref_value);
+   pipe->set_stencil_ref(pipe, &state);
+}
+
+static void
+replay_set_clip_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *ucp = member(arg(call, "state"), "ucp");
+   struct pipe_clip_state state;
+   unsigned i, j;
+
+   for (i = 0; i < PIPE_MAX_CLIP_PLANES; ++i)
+      for (j = 0; j < 4; ++j)
+         state.ucp[i][j] = value_float(elem(elem(ucp, i), j));
+
+   pipe->set_clip_state(pipe, &state);
+}
+
+static void
+replay_set_sample_mask(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+
+   pipe->set_sample_mask(pipe, value_uint(arg(call, "sample_mask")));
+}
+
+static void
+replay_set_polygon_stipple(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_poly_stipple state;
+
+   get_member_array(uint, &state, arg(call, "state"), stipple);
+   pipe->set_polygon_stipple(pipe, &state);
+}
+
+static void
+replay_set_scissor_states(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *states = arg(call, "states");
+   struct pipe_scissor_state scissors[PIPE_MAX_VIEWPORTS];
+   unsigned num = MIN2(value_uint(arg(call, "num_scissors")),
+                       PIPE_MAX_VIEWPORTS);
+   unsigned i;
+
+   /* Older traces only recorded the first scissor */
+   if (states && states->type == TRACE_TOKEN_STRUCT) {
+      get_scissor_state(states, &scissors[0]);
+      num = 1;
+   } else {
+      num = MIN2(num, value_count(states));
+      for (i = 0; i < num; ++i)
+         get_scissor_state(elem(states, i), &scissors[i]);
+   }
+
+   pipe->set_scissor_states(pipe, value_uint(arg(call, "start_slot")), num,
+                            scissors);
+}
+
+static void
+replay_set_viewport_states(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *states = arg(call, "states");
+   struct pipe_viewport_state viewports[PIPE_MAX_VIEWPORTS];
+   unsigned num = MIN2(value_uint(arg(call, "num_viewports")),
+                       PIPE_MAX_VIEWPORTS);
+   unsigned i;
+
+   if (states && states->type == TRACE_TOKEN_STRUCT) {
+      get_viewport_state(states, &viewports[0]);
+      num = 1;
+   } else {
+      num = MIN2(num, value_count(states));
+      for (i = 0; i < num; ++i)
+         get_viewport_state(elem(states, i), &viewports[i]);
+   }
+
+   pipe->set_viewport_states(pipe, value_uint(arg(call, "start_slot")), num,
+                             viewports);
+}
+
+static void
+replay_set_constant_buffer(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *value = arg(call, "constant_buffer");
+   struct pipe_constant_buffer cb;
+   size_t size;
+
+   if (value_is_null(value)) {
+      pipe->set_constant_buffer(pipe, value_uint(arg(call, "shader")),
+                                value_uint(arg(call, "index")), NULL);
+      return;
+   }
+
+   memset(&cb, 0, sizeof cb);
+   cb.buffer = get_resource(r, member(value, "buffer"));
+   get_member(uint, &cb, value, buffer_offset);
+   get_member(uint, &cb, value, buffer_size);
+   cb.user_buffer = value_bytes(member(value, "user_buffer"), &size);
+
+   pipe->set_constant_buffer(pipe, value_uint(arg(call, "shader")),
+                             value_uint(arg(call, "index")), &cb);
+}
+
+static void
+replay_set_framebuffer_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *value = arg(call, "state");
+   const struct trace_value *cbufs = member(value, "cbufs");
+   struct pipe_framebuffer_state state;
+   unsigned i;
+
+   memset(&state, 0, sizeof state);
+   get_member(uint, &state, value, width);
+   get_member(uint, &state, value, height);
+   get_member(uint, &state, value, samples);
+   get_member(uint, &state, value, layers);
+   get_member(uint, &state, value, nr_cbufs);
+   for (i = 0; i < state.nr_cbufs && i < PIPE_MAX_COLOR_BUFS; ++i)
+      state.cbufs[i] = lookup(r->surfaces, elem(cbufs, i));
+   state.zsbuf = lookup(r->surfaces, member(value, "zsbuf"));
+
+   pipe->set_framebuffer_state(pipe, &state);
+}
+
+static void
+replay_create_sampler_view(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_resource *resource = get_resource(r, arg(call, "resource"));
+   struct pipe_sampler_view templ;
+
+   if (!resource)
+      return;
+
+   get_sampler_view_template(arg(call, "templ"), &templ);
+   templ.target = resource->target;
+   insert(r->sampler_views, call->ret,
+          pipe->create_sampler_view(pipe, resource, &templ));
+}
+
+static void
+replay_sampler_view_destroy(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_sampler_view *view = take(r->sampler_views, arg(call, "view"));
+
+   pipe_sampler_view_reference(&view, NULL);
+}
+
+static void
+replay_set_sampler_views(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *views = arg(call, "views");
+   struct pipe_sampler_view *unwrapped[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   unsigned num = MIN2(value_uint(arg(call, "num")),
+                       PIPE_MAX_SHADER_SAMPLER_VIEWS);
+   unsigned i;
+
+   for (i = 0; i < num; ++i)
+      unwrapped[i] = lookup(r->sampler_views, elem(views, i));
+
+   pipe->set_sampler_views(pipe, value_uint(arg(call, "shader")),
+                           value_uint(arg(call, "start")), num,
+                           value_is_null(views) ? NULL : unwrapped);
+}
+
+static void
+replay_create_surface(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_resource *resource = get_resource(r, arg(call, "resource"));
+   struct pipe_surface templ;
+
+   if (!resource)
+      return;
+
+   get_surface_template(arg(call, "surf_tmpl"), &templ);
+   insert(r->surfaces, call->ret,
+          pipe->create_surface(pipe, resource, &templ));
+}
+
+static void
+replay_surface_destroy(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_surface *surface = take(r->surfaces, arg(call, "surface"));
+
+   pipe_surface_reference(&surface, NULL);
+}
+
+static void
+replay_set_vertex_buffers(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *buffers = arg(call, "buffers");
+   struct pipe_vertex_buffer vbs[PIPE_MAX_ATTRIBS];
+   unsigned num = MIN2(value_uint(arg(call, "num_buffers")), PIPE_MAX_ATTRIBS);
+   unsigned i;
+
+   memset(vbs, 0, sizeof vbs);
+   for (i = 0; i < num; ++i) {
+      const struct trace_value *vb = elem(buffers, i);
+      get_member(uint, &vbs[i], vb, stride);
+      get_member(uint, &vbs[i], vb, buffer_offset);
+      vbs[i].buffer = get_resource(r, member(vb, "buffer"));
+      /* User arrays aren't recorded, so they are replayed as unbound. */
+   }
+
+   pipe->set_vertex_buffers(pipe, value_uint(arg(call, "start_slot")), num,
+                            value_is_null(buffers) ? NULL : vbs);
+}
+
+static void
+replay_set_index_buffer(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *value = arg(call, "ib");
+   struct pipe_index_buffer ib;
+
+   if (value_is_null(value)) {
+      pipe->set_index_buffer(pipe, NULL);
+      return;
+   }
+
+   memset(&ib, 0, sizeof ib);
+   get_member(uint, &ib, value, index_size);
+   get_member(uint, &ib, value, offset);
+   ib.buffer = get_resource(r, member(value, "buffer"));
+
+   pipe->set_index_buffer(pipe, &ib);
+}
+
+static void
+replay_create_stream_output_target(struct replay *r,
+                                   const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_resource *resource = get_resource(r, arg(call, "res"));
+
+   if (!resource)
+      return;
+
+   insert(r->so_targets, call->ret,
+          pipe->create_stream_output_target(pipe, resource,
+                                            value_uint(arg(call, "buffer_offset")),
+                                            value_uint(arg(call, "buffer_size"))));
+}
+
+static void
+replay_stream_output_target_destroy(struct replay *r,
+                                    const struct trace_call *call)
+{
+   struct pipe_stream_output_target *target =
+      take(r->so_targets, arg(call, "target"));
+
+   pipe_so_target_reference(&target, NULL);
+}
+
+static void
+replay_set_stream_output_targets(struct replay *r,
+                                 const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *tgs = arg(call, "tgs");
+   const struct trace_value *offsets = arg(call, "offsets");
+   struct pipe_stream_output_target *targets[PIPE_MAX_SO_BUFFERS];
+   unsigned unwrapped_offsets[PIPE_MAX_SO_BUFFERS];
+   unsigned num = MIN2(value_uint(arg(call, "num_targets")),
+                       PIPE_MAX_SO_BUFFERS);
+   unsigned i;
+
+   for (i = 0; i < num; ++i) {
+      targets[i] = lookup(r->so_targets, elem(tgs, i));
+      unwrapped_offsets[i] = value_uint(elem(offsets, i));
+   }
+
+   pipe->set_stream_output_targets(pipe, num, targets, unwrapped_offsets);
+}
+
+static void
+replay_set_tess_state(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *outer = arg(call, "default_outer_level");
+   const struct trace_value *inner = arg(call, "default_inner_level");
+   float outer_level[4], inner_level[2];
+   unsigned i;
+
+   for (i = 0; i < 4; ++i)
+      outer_level[i] = value_float(elem(outer, i));
+   for (i = 0; i < 2; ++i)
+      inner_level[i] = value_float(elem(inner, i));
+
+   pipe->set_tess_state(pipe, outer_level, inner_level);
+}
+
+static void
+replay_set_shader_buffers(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *buffers = arg(call, "buffers");
+   struct pipe_shader_buffer sbs[PIPE_MAX_SHADER_BUFFERS];
+   unsigned num = MIN2(value_uint(arg(call, "nr")), PIPE_MAX_SHADER_BUFFERS);
+   unsigned i;
+
+   memset(sbs, 0, sizeof sbs);
+   for (i = 0; i < num; ++i) {
+      const struct trace_value *sb = elem(buffers, i);
+      sbs[i].buffer = get_resource(r, member(sb, "buffer"));
+      get_member(uint, &sbs[i], sb, buffer_offset);
+      get_member(uint, &sbs[i], sb, buffer_size);
+   }
+
+   pipe->set_shader_buffers(pipe, value_uint(arg(call, "shader")),
+                            value_uint(arg(call, "start")), num,
+                            value_is_null(buffers) ? NULL : sbs);
+}
+
+static void
+replay_set_shader_images(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *images = arg(call, "images");
+   struct pipe_image_view views[PIPE_MAX_SHADER_IMAGES];
+   unsigned num = MIN2(value_uint(arg(call, "nr")), PIPE_MAX_SHADER_IMAGES);
+   unsigned i;
+
+   memset(views, 0, sizeof views);
+   for (i = 0; i < num; ++i) {
+      const struct trace_value *view = elem(images, i);
+      const struct trace_value *u = member(view, "u");
+      const struct trace_value *buf = member(u, "buf");
+      const struct trace_value *tex = member(u, "tex");
+
+      views[i].resource = get_resource(r, member(view, "resource"));
+      get_member(uint, &views[i], view, format);
+      get_member(uint, &views[i], view, access);
+      if (buf) {
+         get_member(uint, &views[i].u.buf, buf, offset);
+         get_member(uint, &views[i].u.buf, buf, size);
+      } else {
+         get_member(uint, &views[i].u.tex, tex, first_layer);
+         get_member(uint, &views[i].u.tex, tex, last_layer);
+         get_member(uint, &views[i].u.tex, tex, level);
+      }
+   }
+
+   pipe->set_shader_images(pipe, value_uint(arg(call, "shader")),
+                           value_uint(arg(call, "start")), num,
+                           value_is_null(images) ? NULL : views);
+}
+
+static void
+replay_resource_copy_region(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_resource *dst = get_resource(r, arg(call, "dst"));
+   struct pipe_resource *src = get_resource(r, arg(call, "src"));
+   struct pipe_box box;
+
+   if (!dst || !src)
+      return;
+
+   get_box(arg(call, "src_box"), &box);
+   pipe->resource_copy_region(pipe, dst, value_uint(arg(call, "dst_level")),
+                              value_uint(arg(call, "dstx")),
+                              value_uint(arg(call, "dsty")),
+                              value_uint(arg(call, "dstz")),
+                              src, value_uint(arg(call, "src_level")), &box);
+}
+
+static void
+replay_blit(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *value = arg(call, "_info");
+   const struct trace_value *dst = member(value, "dst");
+   const struct trace_value *src = member(value, "src");
+   const char *mask = value_string(member(value, "mask"));
+   struct pipe_blit_info info;
+
+   memset(&info, 0, sizeof info);
+   info.dst.resource = get_resource(r, member(dst, "resource"));
+   get_member(uint, &info.dst, dst, level);
+   get_member(format, &info.dst, dst, format);
+   get_box(member(dst, "box"), &info.dst.box);
+   info.src.resource = get_resource(r, member(src, "resource"));
+   get_member(uint, &info.src, src, level);
+   get_member(format, &info.src, src, format);
+   get_box(member(src, "box"), &info.src.box);
+   if (mask && strlen(mask) == 6) {
+      info.mask = (mask[0] == 'R' ? PIPE_MASK_R : 0) |
+                  (mask[1] == 'G' ? PIPE_MASK_G : 0) |
+                  (mask[2] == 'B' ? PIPE_MASK_B : 0) |
+                  (mask[3] == 'A' ? PIPE_MASK_A : 0) |
+                  (mask[4] == 'Z' ? PIPE_MASK_Z : 0) |
+                  (mask[5] == 'S' ? PIPE_MASK_S : 0);
+   }
+   get_member(uint, &info, value, filter);
+   get_member(bool, &info, value, scissor_enable);
+   get_scissor_state(member(value, "scissor"), &info.scissor);
+
+   if (info.dst.resource && info.src.resource)
+      pipe->blit(pipe, &info);
+}
+
+static void
+replay_flush_resource(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_resource *resource = get_resource(r, arg(call, "resource"));
+
+   if (resource)
+      pipe->flush_resource(pipe, resource);
+}
+
+static void
+replay_clear(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   const struct trace_value *color = arg(call, "color");
+   union pipe_color_union unwrapped_color;
+   unsigned i;
+
+   for (i = 0; i < 4; ++i)
+      unwrapped_color.f[i] = value_float(elem(color, i));
+
+   pipe->clear(pipe, value_uint(arg(call, "buffers")),
+               value_is_null(color) ? NULL : &unwrapped_color,
+               value_float(arg(call, "depth")),
+               value_uint(arg(call, "stencil")));
+}
+
+static void
+replay_clear_render_target(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_surface *dst = lookup(r->surfaces, arg(call, "dst"));
+   const struct trace_value *color = arg(call, "color->f");
+   union pipe_color_union unwrapped_color;
+   unsigned i;
+
+   if (!dst)
+      return;
+
+   for (i = 0; i < 4; ++i)
+      unwrapped_color.f[i] = value_float(elem(color, i));
+
+   pipe->clear_render_target(pipe, dst, &unwrapped_color,
+                             value_uint(arg(call, "dstx")),
+                             value_uint(arg(call, "dsty")),
+                             value_uint(arg(call, "width")),
+                             value_uint(arg(call, "height")),
+                             value_bool(arg(call, "render_condition_enabled")));
+}
+
+static void
+replay_clear_depth_stencil(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_surface *dst = lookup(r->surfaces, arg(call, "dst"));
+
+   if (!dst)
+      return;
+
+   pipe->clear_depth_stencil(pipe, dst,
+                             value_uint(arg(call, "clear_flags")),
+                             value_float(arg(call, "depth")),
+                             value_uint(arg(call, "stencil")),
+                             value_uint(arg(call, "dstx")),
+                             value_uint(arg(call, "dsty")),
+                             value_uint(arg(call, "width")),
+                             value_uint(arg(call, "height")),
+                             value_bool(arg(call, "render_condition_enabled")));
+}
+
+static void
+replay_generate_mipmap(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_resource *resource = get_resource(r, arg(call, "res"));
+
+   if (resource)
+      pipe->generate_mipmap(pipe, resource, value_format(arg(call, "format")),
+                            value_uint(arg(call, "base_level")),
+                            value_uint(arg(call, "last_level")),
+                            value_uint(arg(call, "first_layer")),
+                            value_uint(arg(call, "last_layer")));
+}
+
+static unsigned
+subdata_usage(const struct trace_call *call)
+{
+   /* Mapping flags don't make sense for subdata uploads */
+   return (value_uint(arg(call, "usage")) &
+           (PIPE_TRANSFER_DISCARD_RANGE |
+            PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE |
+            PIPE_TRANSFER_UNSYNCHRONIZED)) | PIPE_TRANSFER_WRITE;
+}
+
+static void
+replay_buffer_subdata(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_resource *resource = get_resource(r, arg(call, "resource"));
+   const struct trace_value *box_value = arg(call, "box");
+   unsigned offset, size;
+   const void *data;
+   size_t data_size;
+
+   data = value_bytes(arg(call, "data"), &data_size);
+   if (!resource || !data)
+      return;
+
+   /* Unmapped transfers are recorded with a box rather than an offset. */
+   if (box_value) {
+      struct pipe_box box;
+      get_box(box_value, &box);
+      offset = box.x;
+      size = box.width;
+   } else {
+      offset = value_uint(arg(call, "offset"));
+      size = value_uint(arg(call, "size"));
+   }
+
+   pipe->buffer_subdata(pipe, resource, subdata_usage(call), offset,
+                        MIN2(size, data_size), data);
+}
+
+static void
+replay_texture_subdata(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_resource *resource = get_resource(r, arg(call, "resource"));
+   struct pipe_box box;
+   const void *data;
+   size_t data_size;
+
+   data = value_bytes(arg(call, "data"), &data_size);
+   if (!resource || !data || !data_size)
+      return;
+
+   get_box(arg(call, "box"), &box);
+   pipe->texture_subdata(pipe, resource, value_uint(arg(call, "level")),
+                         subdata_usage(call), &box, data,
+                         value_uint(arg(call, "stride")),
+                         value_uint(arg(call, "layer_stride")));
+}
+
+static void
+replay_invalidate_resource(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+   struct pipe_resource *resource = get_resource(r, arg(call, "resource"));
+
+   if (resource && pipe->invalidate_resource)
+      pipe->invalidate_resource(pipe, resource);
+}
+
+static void
+replay_texture_barrier(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+
+   pipe->texture_barrier(pipe);
+}
+
+static void
+replay_memory_barrier(struct replay *r, const struct trace_call *call)
+{
+   struct pipe_context *pipe = call_context(r, call);
+
+   pipe->memory_barrier(pipe, value_uint(arg(call, "flags")));
+}
+
+
+static const struct {
+   const char *klass;
+   const char *method;
+   replay_func func;
+} replay_funcs[] = {
+#define SCREEN(_method) { "pipe_screen", #_method, replay_##_method }
+#define CONTEXT(_method) { "pipe_context", #_method, replay_##_method }
+#define CONTEXT_STATE(_name) \
+   CONTEXT(create_##_name##_state), \
+   CONTEXT(bind_##_name##_state), \
+   CONTEXT(delete_##_name##_state)
+   SCREEN(context_create),
+   SCREEN(resource_create),
+   SCREEN(resource_destroy),
+   SCREEN(fence_finish),
+   { "pipe_context", "destroy", replay_context_destroy },
+   CONTEXT(flush),
+   CONTEXT(draw_vbo),
+   CONTEXT(launch_grid),
+   CONTEXT(create_query),
+   CONTEXT(destroy_query),
+   CONTEXT(begin_query),
+   CONTEXT(end_query),
+   CONTEXT(get_query_result),
+   CONTEXT(set_active_query_state),
+   CONTEXT(render_condition),
+   CONTEXT_STATE(blend),
+   CONTEXT_STATE(rasterizer),
+   CONTEXT_STATE(depth_stencil_alpha),
+   CONTEXT_STATE(fs),
+   CONTEXT_STATE(vs),
+   CONTEXT_STATE(gs),
+   CONTEXT_STATE(tcs),
+   CONTEXT_STATE(tes),
+   CONTEXT_STATE(compute),
+   CONTEXT_STATE(vertex_elements),
+   CONTEXT(create_sampler_state),
+   CONTEXT(bind_sampler_states),
+   CONTEXT(delete_sampler_state),
+   CONTEXT(set_blend_color),
+   CONTEXT(set_stencil_ref),
+   CONTEXT(set_clip_state),
+   CONTEXT(set_sample_mask),
+   CONTEXT(set_polygon_stipple),
+   CONTEXT(set_scissor_states),
+   CONTEXT(set_viewport_states),
+   CONTEXT(set_constant_buffer),
+   CONTEXT(set_framebuffer_state),
+   CONTEXT(create_sampler_view),
+   CONTEXT(sampler_view_destroy),
+   CONTEXT(set_sampler_views),
+   CONTEXT(create_surface),
+   CONTEXT(surface_destroy),
+   CONTEXT(set_vertex_buffers),
+   CONTEXT(set_index_buffer),
+   CONTEXT(create_stream_output_target),
+   CONTEXT(stream_output_target_destroy),
+   CONTEXT(set_stream_output_targets),
+   CONTEXT(set_tess_state),
+   CONTEXT(set_shader_buffers),
+   CONTEXT(set_shader_images),
+   CONTEXT(resource_copy_region),
+   CONTEXT(blit),
+   CONTEXT(flush_resource),
+   CONTEXT(clear),
+   CONTEXT(clear_render_target),
+   CONTEXT(clear_depth_stencil),
+   CONTEXT(generate_mipmap),
+   CONTEXT(buffer_subdata),
+   CONTEXT(texture_subdata),
+   CONTEXT(invalidate_resource),
+   CONTEXT(texture_barrier),
+   CONTEXT(memory_barrier),
+#undef CONTEXT_STATE
+#undef CONTEXT
+#undef SCREEN
+};
+
+
+static struct replay_method *
+get_method(struct replay *r, const struct trace_call *call)
+{
+   struct trace_name *method_name = (struct trace_name *)call->method;
+   struct replay_method *method;
+   unsigned i;
+
+   for (method = method_name->methods; method; method = method->next)
+      if (method->klass == call->klass)
+         return method;
+
+   method = rzalloc(r, struct replay_method);
+   method->klass = call->klass;
+   method->method = call->method;
+   method->replay_min = UINT64_MAX;
+   for (i = 0; i < ARRAY_SIZE(replay_funcs); ++i) {
+      if (strcmp(replay_funcs[i].klass, call->klass->str) == 0 &&
+          strcmp(replay_funcs[i].method, call->method->str) == 0) {
+         method->func = replay_funcs[i].func;
+         break;
+      }
+   }
+
+   method->needs_context = strcmp(call->klass->str, "pipe_context") == 0;
+
+   method->next = method_name->methods;
+   method_name->methods = method;
+
+   return method;
+}
+
+static void
+replay_call(struct replay *r, const struct trace_call *call)
+{
+   struct replay_method *method = get_method(r, call);
+   int64_t start, elapsed;
+
+   ++r->num_calls;
+   ++method->count;
+   method->traced_time += call->time;
+
+   /* Calls on contexts which failed to be created are skipped too */
+   if (!method->func ||
+       (method->needs_context && !call_context(r, call))) {
+      ++r->num_skipped;
+      return;
+   }
+
+   if (r->verbose)
+      printf("%" PRIu64 " %s::%s\n", call->no, call->klass->str,
+             call->method->str);
+
+   start = os_time_get_nano();
+   method->func(r, call);
+   elapsed = os_time_get_nano() - start;
+
+   method->replay_time += elapsed;
+   method->replay_min = MIN2(method->replay_min, (uint64_t)elapsed);
+   method->replay_max = MAX2(method->replay_max, (uint64_t)elapsed);
+}
+
+
+/*
+ * Reporting
+ */
+
+static int
+compare_methods(const void *a, const void *b)
+{
+   const struct replay_method *ma = *(const struct replay_method * const *)a;
+   const struct replay_method *mb = *(const struct replay_method * const *)b;
+
+   if (ma->replay_time != mb->replay_time)
+      return ma->replay_time < mb->replay_time ? 1 : -1;
+   return ma->traced_time < mb->traced_time ? 1 : -1;
+}
+
+static void
+print_stats(struct replay *r, int64_t total_time)
+{
+   struct replay_method **methods;
+   struct replay_method *m;
+   unsigned num_methods = 0, i, j;
+
+   for (i = 0; i < r->num_names; ++i)
+      for (m = r->names[i]->methods; m; m = m->next)
+         ++num_methods;
+
+   methods = ralloc_array(r, struct replay_method *, num_methods);
+   for (i = 0, j = 0; i < r->num_names; ++i)
+      for (m = r->names[i]->methods; m; m = m->next)
+         methods[j++] = m;
+   qsort(methods, num_methods, sizeof *methods, compare_methods);
+
+   printf("%-48s %10s %12s %12s %10s %10s %10s\n",
+          "call", "count", "traced(us)", "replay(us)",
+          "avg(ns)", "min(ns)", "max(ns)");
+   for (i = 0; i < num_methods; ++i) {
+      const struct replay_method *m = methods[i];
+      char name[128];
+
+      util_snprintf(name, sizeof name, "%s::%s%s", m->klass->str,
+                    m->method->str, m->func ? "" : " (skipped)");
+      if (m->func) {
+         printf("%-48s %10" PRIu64 " %12" PRIu64 " %12" PRIu64
+                " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+                name, m->count, m->traced_time / 1000, m->replay_time / 1000,
+                m->replay_time / m->count, m->replay_min, m->replay_max);
+      } else {
+         printf("%-48s %10" PRIu64 " %12" PRIu64 "\n",
+                name, m->count, m->traced_time / 1000);
+      }
+   }
+
+   printf("\n%" PRIu64 " calls, %" PRIu64 " skipped, %.3f ms total\n",
+          r->num_calls, r->num_skipped, total_time / 1e6);
+}
+
+
+/*
+ * Main
+ */
+
+static void
+replay_finish(struct replay *r)
+{
+   struct hash_entry *entry;
+
+   /* Wait for the GPU so that the total time is meaningful */
+   hash_table_foreach(r->contexts, entry) {
+      struct pipe_context *pipe = entry->data;
+      struct pipe_fence_handle *fence = NULL;
+
+      pipe->flush(pipe, &fence, 0);
+      if (fence) {
+         r->screen->fence_finish(r->screen, NULL, fence,
+                                 PIPE_TIMEOUT_INFINITE);
+         r->screen->fence_reference(r->screen, &fence, NULL);
+      }
+   }
+}
+
+static void
+replay_cleanup(struct replay *r)
+{
+   struct hash_entry *entry;
+
+   hash_table_foreach(r->fences, entry) {
+      struct pipe_fence_handle *fence = entry->data;
+      r->screen->fence_reference(r->screen, &fence, NULL);
+   }
+   hash_table_foreach(r->sampler_views, entry) {
+      struct pipe_sampler_view *view = entry->data;
+      pipe_sampler_view_reference(&view, NULL);
+   }
+   hash_table_foreach(r->surfaces, entry) {
+      struct pipe_surface *surface = entry->data;
+      pipe_surface_reference(&surface, NULL);
+   }
+   hash_table_foreach(r->so_targets, entry) {
+      struct pipe_stream_output_target *target = entry->data;
+      pipe_so_target_reference(&target, NULL);
+   }
+   hash_table_foreach(r->resources, entry) {
+      struct pipe_resource *resource = entry->data;
+      pipe_resource_reference(&resource, NULL);
+   }
+   /* State objects and queries are owned by their contexts */
+   hash_table_foreach(r->contexts, entry) {
+      struct pipe_context *pipe = entry->data;
+      pipe->destroy(pipe);
+   }
+}
+
+static void
+usage(void)
+{
+   fprintf(stderr, "usage: replay [-d DEVICE] [-v] TRACE\n");
+   exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_loader_device **devs;
+   struct replay *r;
+   const char *filename = NULL;
+   char header[TRACE_BINARY_MAGIC_SIZE + 1];
+   int device = 0, num_devs, i;
+   int64_t start;
+   void *mem_ctx;
+   struct trace_call call;
+
+   r = rzalloc(NULL, struct replay);
+
+   for (i = 1; i < argc; ++i) {
+      if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+         device = atoi(argv[++i]);
+      else if (strcmp(argv[i], "-v") == 0)
+         r->verbose = TRUE;
+      else if (argv[i][0] != '-' && !filename)
+         filename = argv[i];
+      else
+         usage();
+   }
+   if (!filename)
+      usage();
+
+   r->stream = fopen(filename, "rb");
+   if (!r->stream) {
+      fprintf(stderr, "error: failed to open %s\n", filename);
+      return 1;
+   }
+
+   if (fread(header, sizeof header, 1, r->stream) != 1 ||
+       memcmp(header, TRACE_BINARY_MAGIC, TRACE_BINARY_MAGIC_SIZE) != 0 ||
+       header[TRACE_BINARY_MAGIC_SIZE] != TRACE_BINARY_VERSION) {
+      fprintf(stderr, "error: %s is not a version %u binary trace\n",
+              filename, TRACE_BINARY_VERSION);
+      return 1;
+   }
+
+   num_devs = pipe_loader_probe(NULL, 0);
+   if (device >= num_devs) {
+      fprintf(stderr, "error: device %i not found\n", device);
+      return 1;
+   }
+   devs = ralloc_array(r, struct pipe_loader_device *, num_devs);
+   pipe_loader_probe(devs, num_devs);
+
+   r->screen = pipe_loader_create_screen(devs[device]);
+   if (!r->screen) {
+      fprintf(stderr, "error: failed to create screen\n");
+      return 1;
+   }
+   fprintf(stderr, "replaying on %s\n", r->screen->get_name(r->screen));
+
+   r->contexts = _mesa_hash_table_create(r, _mesa_hash_pointer,
+                                         _mesa_key_pointer_equal);
+   r->resources = _mesa_hash_table_create(r, _mesa_hash_pointer,
+                                          _mesa_key_pointer_equal);
+   r->surfaces = _mesa_hash_table_create(r, _mesa_hash_pointer,
+                                         _mesa_key_pointer_equal);
+   r->sampler_views = _mesa_hash_table_create(r, _mesa_hash_pointer,
+                                              _mesa_key_pointer_equal);
+   r->so_targets = _mesa_hash_table_create(r, _mesa_hash_pointer,
+                                           _mesa_key_pointer_equal);
+   r->queries = _mesa_hash_table_create(r, _mesa_hash_pointer,
+                                        _mesa_key_pointer_equal);
+   r->states = _mesa_hash_table_create(r, _mesa_hash_pointer,
+                                       _mesa_key_pointer_equal);
+   r->fences = _mesa_hash_table_create(r, _mesa_hash_pointer,
+                                       _mesa_key_pointer_equal);
+
+   start = os_time_get_nano();
+
+   for (;;) {
+      mem_ctx = ralloc_context(NULL);
+      if (!read_call(r, mem_ctx, &call)) {
+         ralloc_free(mem_ctx);
+         break;
+      }
+      replay_call(r, &call);
+      ralloc_free(mem_ctx);
+   }
+
+   replay_finish(r);
+   print_stats(r, os_time_get_nano() - start);
+
+   replay_cleanup(r);
+   r->screen->destroy(r->screen);
+   pipe_loader_release(devs, num_devs);
+   fclose(r->stream);
+   ralloc_free(r);
+
+   return 0;
+}
@@ -0,0 +1,210 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case for cso_hash, plus a state churn benchmark for the CSO cache.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cso_cache/cso_cache.h"
+#include "cso_cache/cso_hash.h"
+#include "os/os_time.h"
+#include "util/u_memory.h"
+
+
+static unsigned failures;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) { \
+         printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+         ++failures; \
+      } \
+   } while (0)
+
+
+static void
+test_hash(void)
+{
+   struct cso_hash *hash = cso_hash_create();
+   struct cso_hash_iter iter;
+   uintptr_t i;
+   unsigned count;
+
+   /* Lots of entries, a few keys shared by several of them. */
+   for (i = 1; i <= 1000; ++i)
+      cso_hash_insert(hash, i % 700, (void *)i);
+   CHECK(cso_hash_size(hash) == 1000);
+
+   for (i = 0; i < 700; ++i) {
+      count = 0;
+      for (iter = cso_hash_find(hash, i); !cso_hash_iter_is_null(iter);
+           iter = cso_hash_find_next(iter)) {
+         uintptr_t value = (uintptr_t)cso_hash_iter_data(iter);
+         CHECK(cso_hash_iter_key(iter) == i);
+         CHECK(value % 700 == i);
+         ++count;
+      }
+      CHECK(count == (i >= 1 && i <= 300 ? 2 : 1));
+      CHECK(cso_hash_contains(hash, i));
+   }
+   CHECK(!cso_hash_contains(hash, 12345));
+
+   /* Erase every odd value while iterating, and check we saw them all. */
+   count = 0;
+   iter = cso_hash_first_node(hash);
+   while (!cso_hash_iter_is_null(iter)) {
+      uintptr_t value = (uintptr_t)cso_hash_iter_data(iter);
+      ++count;
+      if (value & 1)
+         iter = cso_hash_erase(hash, iter);
+      else
+         iter = cso_hash_iter_next(iter);
+   }
+   CHECK(count == 1000);
+   CHECK(cso_hash_size(hash) == 500);
+
+   for (i = 2; i <= 1000; i += 2) {
+      boolean found = FALSE;
+      for (iter = cso_hash_find(hash, i % 700); !cso_hash_iter_is_null(iter);
+           iter = cso_hash_find_next(iter))
+         found |= (uintptr_t)cso_hash_iter_data(iter) == i;
+      CHECK(found);
+   }
+
+   /* Take everything, which also shrinks the table back down. */
+   count = 0;
+   while (cso_hash_size(hash)) {
+      iter = cso_hash_first_node(hash);
+      CHECK(cso_hash_take(hash, cso_hash_iter_key(iter)) != NULL);
+      ++count;
+   }
+   CHECK(count == 500);
+   CHECK(cso_hash_iter_is_null(cso_hash_first_node(hash)));
+
+   cso_hash_delete(hash);
+}
+
+
+/**
+ * Bind a rotating set of blend, rasterizer and sampler states through the
+ * CSO cache, the way an application switching materials would.  Keys are
+ * built with cso_construct_key(), so similar states collide the same way
+ * they do in cso_context.
+ */
+static void
+benchmark_churn(unsigned num_states, unsigned iterations)
+{
+   struct cso_cache *cache = cso_cache_create();
+   struct pipe_blend_state blend;
+   struct pipe_rasterizer_state rast;
+   struct pipe_sampler_state sampler;
+   int64_t start, time;
+   unsigned i, misses = 0;
+
+   memset(&blend, 0, sizeof blend);
+   memset(&rast, 0, sizeof rast);
+   memset(&sampler, 0, sizeof sampler);
+
+   start = os_time_get();
+   for (i = 0; i < iterations; ++i) {
+      unsigned n = (i * 7919) % num_states;
+      struct cso_hash_iter iter;
+      unsigned key;
+
+      blend.rt[0].blend_enable = n & 1;
+      blend.rt[0].rgb_src_factor = n % 21;
+      blend.rt[0].colormask = n >> 5;
+      key = cso_construct_key(&blend, sizeof blend);
+      iter = cso_find_state_template(cache, key, CSO_BLEND,
+                                     &blend, sizeof blend);
+      if (cso_hash_iter_is_null(iter)) {
+         struct cso_blend *cso = CALLOC_STRUCT(cso_blend);
+         cso->state = blend;
+         cso_insert_state(cache, key, CSO_BLEND, cso);
+         ++misses;
+      }
+
+      rast.cull_face = n & 3;
+      rast.line_width = (float)(n >> 2);
+      rast.offset_units = (float)(n & 7);
+      key = cso_construct_key(&rast, sizeof rast);
+      iter = cso_find_state_template(cache, key, CSO_RASTERIZER,
+                                     &rast, sizeof rast);
+      if (cso_hash_iter_is_null(iter)) {
+         struct cso_rasterizer *cso = CALLOC_STRUCT(cso_rasterizer);
+         cso->state = rast;
+         cso_insert_state(cache, key, CSO_RASTERIZER, cso);
+         ++misses;
+      }
+
+      sampler.wrap_s = n % 5;
+      sampler.wrap_t = (n / 5) % 5;
+      sampler.lod_bias = (float)(n / 25);
+      key = cso_construct_key(&sampler, sizeof sampler);
+      iter = cso_find_state_template(cache, key, CSO_SAMPLER,
+                                     &sampler, sizeof sampler);
+      if (cso_hash_iter_is_null(iter)) {
+         struct cso_sampler *cso = CALLOC_STRUCT(cso_sampler);
+         cso->state = sampler;
+         cso->hash_key = key;
+         cso_insert_state(cache, key, CSO_SAMPLER, cso);
+         ++misses;
+      }
+   }
+   time = os_time_get() - start;
+
+   printf("%5u states: %u lookups in %.3f ms (%.1f ns each), %u misses\n",
+          num_states, iterations * 3, time / 1000.0,
+          time * 1000.0 / (iterations * 3), misses);
+
+   cso_cache_delete(cache);
+}
+
+
+int main(int argc, char **argv)
+{
+   unsigned num_states;
+
+   test_hash();
+
+   for (num_states = 16; num_states <= 8192; num_states *= 4)
+      benchmark_churn(num_states, 1000000);
+
+   if (failures) {
+      printf("%u checks failed\n", failures);
+      return 1;
+   }
+
+   printf("all checks passed\n");
+   return 0;
+}
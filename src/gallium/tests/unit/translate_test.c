@@ -29,6 +29,7 @@
 #include "util/u_format.h"
 #include "util/u_half.h"
 #include "util/u_cpu_detect.h"
+#include "os/os_time.h"
 #include "rtasm/rtasm_cpu.h"
 
 /* don't use this for serious use */
@@ -46,6 +47,94 @@ static double rand_double()
    return v;
 }
 
+/* Time each backend converting a large indexed vertex buffer. */
+static int benchmark(void)
+{
+   static const struct {
+      enum pipe_format input_format;
+      enum pipe_format output_format;
+   } formats[] = {
+      { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32_FLOAT },
+      { PIPE_FORMAT_R32G32B32_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R16G16B16A16_SNORM, PIPE_FORMAT_R32G32B32A32_FLOAT },
+      { PIPE_FORMAT_R16G16_FLOAT, PIPE_FORMAT_R32G32_FLOAT },
+      { PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_B8G8R8A8_UNORM },
+   };
+   static const struct {
+      const char *name;
+      struct translate *(*create)(const struct translate_key *key);
+   } backends[] = {
+      { "generic", translate_generic_create },
+#if defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
+      { "sse", translate_sse2_create },
+#endif
+   };
+   const unsigned count = 65536;
+   const unsigned iterations = 100;
+   struct translate_key key;
+   unsigned char *input, *output;
+   unsigned *elts;
+   unsigned i, j, k;
+
+   input = align_malloc(count * 16, 64);
+   output = align_malloc(count * 16, 64);
+   elts = align_malloc(count * sizeof *elts, 64);
+
+   for (i = 0; i < count * 16; ++i)
+      input[i] = rand();
+   for (i = 0; i < count; ++i)
+      elts[i] = rand() % count;
+
+   memset(&key, 0, sizeof key);
+   key.nr_elements = 1;
+   key.element[0].type = TRANSLATE_ELEMENT_NORMAL;
+
+   for (i = 0; i < ARRAY_SIZE(formats); ++i) {
+      unsigned input_size = util_format_get_blocksize(formats[i].input_format);
+
+      key.element[0].input_format = formats[i].input_format;
+      key.element[0].output_format = formats[i].output_format;
+      key.output_stride = util_format_get_blocksize(formats[i].output_format);
+
+      printf("%s -> %s:\n",
+             util_format_name(formats[i].input_format),
+             util_format_name(formats[i].output_format));
+
+      for (j = 0; j < ARRAY_SIZE(backends); ++j) {
+         struct translate *translate;
+         int64_t start, create_time, run_time;
+
+         start = os_time_get();
+         translate = backends[j].create(&key);
+         create_time = os_time_get() - start;
+         if (!translate) {
+            printf("   %-8s unsupported\n", backends[j].name);
+            continue;
+         }
+
+         translate->set_buffer(translate, 0, input, input_size, count - 1);
+
+         start = os_time_get();
+         for (k = 0; k < iterations; ++k)
+            translate->run_elts(translate, elts, count, 0, 0, output);
+         run_time = os_time_get() - start;
+
+         printf("   %-8s %8.1f Mvertices/s (created in %.3f ms)\n",
+                backends[j].name,
+                (double)count * iterations / MAX2(run_time, 1),
+                create_time / 1000.0);
+
+         translate->release(translate);
+      }
+   }
+
+   align_free(elts);
+   align_free(output);
+   align_free(input);
+   return 0;
+}
+
 int main(int argc, char** argv)
 {
    struct translate *(*create_fn)(const struct translate_key *key) = 0;
@@ -77,6 +166,8 @@ int main(int argc, char** argv)
       create_fn = translate_generic_create;
    else if (!strcmp(argv[1], "x86"))
       create_fn = translate_sse2_create;
+   else if (!strcmp(argv[1], "bench"))
+      return benchmark();
    else if (!strcmp(argv[1], "nosse"))
    {
       util_cpu_caps.has_sse = 0;
@@ -130,7 +221,7 @@ int main(int argc, char** argv)
 
    if (!create_fn)
    {
-      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1]\n");
+      printf("Usage: ./translate_test [default|generic|x86|nosse|sse|sse2|sse3|sse4.1|bench]\n");
       return 2;
    }
 
@@ -0,0 +1,232 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/*
+ * Test case for util_copy_rows(), plus a bandwidth benchmark comparing it
+ * with plain memcpy(), for contiguous copies and for copies of 4KB rows with
+ * padding between them.  Set GALLIUM_COPY_THREADS to also test and time
+ * threaded copies.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "os/os_time.h"
+#include "util/u_copy.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+
+static unsigned failures;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) { \
+         printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+         ++failures; \
+      } \
+   } while (0)
+
+
+static void
+fill(uint8_t *data, size_t size, unsigned seed)
+{
+   size_t i;
+
+   for (i = 0; i < size; ++i)
+      data[i] = (uint8_t)((i * 31 + seed) ^ (i >> 11));
+}
+
+
+/**
+ * Copy a box with util_copy_rows() and compare it against a row by row
+ * memcpy() of the same box, including the bytes around it.
+ */
+static void
+test_copy(unsigned row_size, unsigned height, unsigned depth,
+          unsigned dst_pad, unsigned src_pad, boolean flip, unsigned offset)
+{
+   unsigned dst_stride = row_size + dst_pad;
+   unsigned src_stride = row_size + src_pad;
+   unsigned dst_slice_stride = dst_stride * height + dst_pad;
+   unsigned src_slice_stride = src_stride * height + src_pad;
+   size_t dst_size = (size_t)dst_slice_stride * depth + offset;
+   size_t src_size = (size_t)src_slice_stride * depth + offset;
+   uint8_t *dst = MALLOC(dst_size);
+   uint8_t *ref = MALLOC(dst_size);
+   uint8_t *src = MALLOC(src_size);
+   const uint8_t *src_start;
+   int src_step;
+   unsigned y, z;
+
+   fill(src, src_size, 1);
+   fill(dst, dst_size, 2);
+   memcpy(ref, dst, dst_size);
+
+   /* Flipped copies start at the last row of the first slice */
+   src_start = src + offset + (flip ? (height - 1) * src_stride : 0);
+   src_step = flip ? -(int)src_stride : (int)src_stride;
+
+   for (z = 0; z < depth; ++z) {
+      for (y = 0; y < height; ++y) {
+         memcpy(ref + offset + z * dst_slice_stride + y * dst_stride,
+                src_start + z * src_slice_stride + (ptrdiff_t)y * src_step,
+                row_size);
+      }
+   }
+
+   util_copy_rows(dst + offset, dst_stride, dst_slice_stride,
+                  src_start, src_step, src_slice_stride,
+                  row_size, height, depth);
+
+   if (memcmp(dst, ref, dst_size) != 0) {
+      printf("mismatch: row_size %u height %u depth %u dst_pad %u "
+             "src_pad %u flip %u offset %u\n",
+             row_size, height, depth, dst_pad, src_pad, flip, offset);
+      ++failures;
+   }
+
+   FREE(src);
+   FREE(ref);
+   FREE(dst);
+}
+
+
+static void
+test_memcpy_large(size_t size, unsigned offset)
+{
+   uint8_t *dst = MALLOC(size + offset);
+   uint8_t *src = MALLOC(size + offset);
+
+   fill(src, size + offset, 3);
+   memset(dst, 0, size + offset);
+
+   util_memcpy_large(dst + offset, src + offset, size);
+
+   CHECK(memcmp(dst + offset, src + offset, size) == 0);
+   CHECK(offset == 0 || dst[offset - 1] == 0);
+
+   FREE(src);
+   FREE(dst);
+}
+
+
+static void
+test_copies(void)
+{
+   unsigned offset;
+
+   /* Small copies */
+   test_copy(1, 1, 1, 0, 0, FALSE, 0);
+   test_copy(16, 16, 1, 0, 0, FALSE, 0);
+   test_copy(16, 16, 1, 4, 12, TRUE, 3);
+   test_copy(100, 10, 4, 28, 0, FALSE, 1);
+
+   /* Streaming copies, with every destination alignment */
+   for (offset = 0; offset < 16; offset += 5) {
+      test_copy(4096, 8200, 1, 64, 0, FALSE, offset);
+      test_copy(4093, 8200, 1, 3, 0, FALSE, offset);
+      test_memcpy_large(3 * 1024 * 1024 + 7, offset);
+   }
+
+   /* Threaded copies */
+   test_copy(8192, 1024, 1, 0, 0, FALSE, 0);
+   test_copy(8000, 1024, 1, 192, 64, FALSE, 5);
+   test_copy(4096, 1000, 1, 64, 0, TRUE, 0);
+   test_copy(1024, 512, 12, 0, 0, FALSE, 0);
+   test_copy(1024, 512, 12, 32, 0, FALSE, 0);
+   test_copy(1000, 37, 300, 24, 8, TRUE, 9);
+   test_copy(64 * 1024 * 1024 + 100, 1, 1, 0, 0, FALSE, 3);
+   test_memcpy_large(16 * 1024 * 1024, 0);
+   test_memcpy_large(16 * 1024 * 1024 + 1, 1);
+}
+
+
+/**
+ * Time copies of size bytes in rows of row_size bytes, stride bytes apart.
+ */
+static void
+benchmark_copy(size_t size, unsigned row_size, unsigned stride,
+               unsigned iterations)
+{
+   unsigned height = size / row_size;
+   uint8_t *dst = MALLOC((size_t)stride * height);
+   uint8_t *src = MALLOC((size_t)stride * height);
+   int64_t start, memcpy_time, copy_time;
+   unsigned i, y;
+
+   /* Fault the pages in before timing anything */
+   memset(src, 1, (size_t)stride * height);
+   memset(dst, 2, (size_t)stride * height);
+
+   start = os_time_get();
+   for (i = 0; i < iterations; ++i) {
+      for (y = 0; y < height; ++y)
+         memcpy(dst + (size_t)y * stride, src + (size_t)y * stride, row_size);
+   }
+   memcpy_time = os_time_get() - start;
+
+   start = os_time_get();
+   for (i = 0; i < iterations; ++i)
+      util_copy_rows(dst, stride, 0, src, stride, 0, row_size, height, 1);
+   copy_time = os_time_get() - start;
+
+   printf("%8u KB %s: memcpy %6.2f GB/s, util_copy_rows %6.2f GB/s\n",
+          (unsigned)(size / 1024), row_size == stride ? "contiguous" : "rows",
+          (double)size * iterations / (memcpy_time * 1000.0),
+          (double)size * iterations / (copy_time * 1000.0));
+
+   FREE(src);
+   FREE(dst);
+}
+
+
+int main(int argc, char **argv)
+{
+   size_t size;
+
+   test_copies();
+
+   for (size = 1024 * 1024; size <= 128 * 1024 * 1024; size *= 2) {
+      unsigned iterations = MAX2(1024 * 1024 * 1024 / size, 4);
+
+      benchmark_copy(size, size, size, iterations);
+      benchmark_copy(size, 4096, 4096 + 256, iterations);
+   }
+
+   if (failures) {
+      printf("%u checks failed\n", failures);
+      return 1;
+   }
+
+   printf("all checks passed\n");
+   return 0;
+}
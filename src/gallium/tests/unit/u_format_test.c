@@ -29,8 +29,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <float.h>
+#include <string.h>
 
+#include "os/os_time.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_half.h"
+#include "util/u_memory.h"
 #include "util/u_format.h"
 #include "util/u_format_tests.h"
 #include "util/u_format_s3tc.h"
@@ -679,9 +683,268 @@ test_one_func(const struct util_format_description *format_desc,
 }
 
 
+/*
+ * Row functions may take a vectorized path for the start of each row and
+ * finish it pixel by pixel, so check that they give exactly the same results
+ * as the plain per-pixel code for rows of all lengths, odd strides included.
+ */
+
+#define ROW_TEST_WIDTH  37
+#define ROW_TEST_HEIGHT 3
+
+
+static void
+set_simd_caps(const struct util_cpu_caps *caps, boolean enable)
+{
+   util_cpu_caps.has_sse2 = enable ? caps->has_sse2 : 0;
+}
+
+
+static void
+fill_random(void *ptr, unsigned size)
+{
+   uint8_t *bytes = ptr;
+   unsigned i;
+
+   for (i = 0; i < size; ++i)
+      bytes[i] = rand() >> 7;
+}
+
+
+static void
+fill_random_float(float *values, unsigned count)
+{
+   unsigned i;
+
+   /* Mostly within [0, 1], with a few values each side of it, and NaNs
+    * and infinities thrown in.
+    */
+   for (i = 0; i < count; ++i) {
+      switch (rand() % 16) {
+      case 0:
+         values[i] = -(float)rand() / RAND_MAX;
+         break;
+      case 1:
+         values[i] = 1.0f + (float)rand() / RAND_MAX;
+         break;
+      case 2:
+         values[i] = util_half_to_float(rand() & 0xffff);
+         break;
+      default:
+         values[i] = (float)rand() / RAND_MAX;
+         break;
+      }
+   }
+}
+
+
+static boolean
+test_format_rows(const struct util_format_description *format_desc,
+                 const struct util_cpu_caps *caps)
+{
+   const unsigned bpp = format_desc->block.bits / 8;
+   const unsigned packed_stride = ROW_TEST_WIDTH * bpp + 3;
+   const unsigned float_stride = (ROW_TEST_WIDTH * 4 + 1) * sizeof(float);
+   const unsigned unorm_stride = ROW_TEST_WIDTH * 4 + 5;
+   uint8_t packed[(ROW_TEST_WIDTH * 16 + 3) * ROW_TEST_HEIGHT];
+   uint8_t results[2][(ROW_TEST_WIDTH * 16 + 3) * ROW_TEST_HEIGHT];
+   float unpacked[(ROW_TEST_WIDTH * 4 + 1) * ROW_TEST_HEIGHT];
+   uint8_t unpacked_8unorm[(ROW_TEST_WIDTH * 4 + 5) * ROW_TEST_HEIGHT];
+   unsigned width, simd;
+   boolean success = TRUE;
+
+   if (format_desc->block.width != 1 || format_desc->block.height != 1 ||
+       format_desc->block.bits % 8 != 0 || bpp > 16) {
+      return TRUE;
+   }
+
+   printf("Testing util_format_%s rows ...\n", format_desc->short_name);
+   fflush(stdout);
+
+   for (width = 1; width <= ROW_TEST_WIDTH; ++width) {
+      if (format_desc->unpack_rgba_float) {
+         fill_random(packed, sizeof packed);
+         for (simd = 0; simd < 2; ++simd) {
+            set_simd_caps(caps, simd);
+            memset(results[simd], 0, sizeof results[simd]);
+            format_desc->unpack_rgba_float((float *)results[simd], float_stride,
+                                           packed, packed_stride,
+                                           width, ROW_TEST_HEIGHT);
+         }
+         if (memcmp(results[0], results[1], sizeof results[0]) != 0) {
+            printf("FAILED: unpack_rgba_float rows of %u pixels differ\n", width);
+            success = FALSE;
+         }
+      }
+
+      if (format_desc->pack_rgba_float) {
+         fill_random_float(unpacked, sizeof unpacked / sizeof unpacked[0]);
+         for (simd = 0; simd < 2; ++simd) {
+            set_simd_caps(caps, simd);
+            memset(results[simd], 0, sizeof results[simd]);
+            format_desc->pack_rgba_float(results[simd], packed_stride,
+                                         unpacked, float_stride,
+                                         width, ROW_TEST_HEIGHT);
+         }
+         if (memcmp(results[0], results[1], sizeof results[0]) != 0) {
+            printf("FAILED: pack_rgba_float rows of %u pixels differ\n", width);
+            success = FALSE;
+         }
+      }
+
+      if (format_desc->unpack_rgba_8unorm) {
+         fill_random(packed, sizeof packed);
+         for (simd = 0; simd < 2; ++simd) {
+            set_simd_caps(caps, simd);
+            memset(results[simd], 0, sizeof results[simd]);
+            format_desc->unpack_rgba_8unorm(results[simd], unorm_stride,
+                                            packed, packed_stride,
+                                            width, ROW_TEST_HEIGHT);
+         }
+         if (memcmp(results[0], results[1], sizeof results[0]) != 0) {
+            printf("FAILED: unpack_rgba_8unorm rows of %u pixels differ\n", width);
+            success = FALSE;
+         }
+      }
+
+      if (format_desc->pack_rgba_8unorm) {
+         fill_random(unpacked_8unorm, sizeof unpacked_8unorm);
+         for (simd = 0; simd < 2; ++simd) {
+            set_simd_caps(caps, simd);
+            memset(results[simd], 0, sizeof results[simd]);
+            format_desc->pack_rgba_8unorm(results[simd], packed_stride,
+                                          unpacked_8unorm, unorm_stride,
+                                          width, ROW_TEST_HEIGHT);
+         }
+         if (memcmp(results[0], results[1], sizeof results[0]) != 0) {
+            printf("FAILED: pack_rgba_8unorm rows of %u pixels differ\n", width);
+            success = FALSE;
+         }
+      }
+   }
+
+   set_simd_caps(caps, TRUE);
+
+   return success;
+}
+
+
+#define BENCH_WIDTH  1024
+#define BENCH_HEIGHT 64
+
+
+static double
+bench_one(const struct util_format_description *format_desc,
+          const char *name, void *dst, unsigned dst_stride,
+          const void *src, unsigned src_stride)
+{
+   const unsigned iterations = 20;
+   int64_t start, time, best = INT64_MAX;
+   unsigned i;
+
+   for (i = 0; i < iterations; ++i) {
+      start = os_time_get_nano();
+      if (strcmp(name, "unpack_rgba_float") == 0)
+         format_desc->unpack_rgba_float(dst, dst_stride, src, src_stride,
+                                        BENCH_WIDTH, BENCH_HEIGHT);
+      else if (strcmp(name, "pack_rgba_float") == 0)
+         format_desc->pack_rgba_float(dst, dst_stride, src, src_stride,
+                                      BENCH_WIDTH, BENCH_HEIGHT);
+      else if (strcmp(name, "unpack_rgba_8unorm") == 0)
+         format_desc->unpack_rgba_8unorm(dst, dst_stride, src, src_stride,
+                                         BENCH_WIDTH, BENCH_HEIGHT);
+      else
+         format_desc->pack_rgba_8unorm(dst, dst_stride, src, src_stride,
+                                       BENCH_WIDTH, BENCH_HEIGHT);
+      time = os_time_get_nano() - start;
+      if (time < best)
+         best = time;
+   }
+
+   /* Mpixels per second */
+   return BENCH_WIDTH * BENCH_HEIGHT * 1000.0 / MAX2(best, 1);
+}
+
+
+/*
+ * Print the throughput of the row functions with and without the
+ * vectorized paths, for the formats most often converted.
+ */
+static void
+bench_all(const struct util_cpu_caps *caps)
+{
+   static const enum pipe_format formats[] = {
+      PIPE_FORMAT_B8G8R8A8_UNORM,
+      PIPE_FORMAT_R8G8B8A8_UNORM,
+      PIPE_FORMAT_B8G8R8X8_UNORM,
+      PIPE_FORMAT_R16G16B16A16_FLOAT,
+      PIPE_FORMAT_B5G6R5_UNORM,
+      PIPE_FORMAT_B5G5R5A1_UNORM,
+      PIPE_FORMAT_B4G4R4A4_UNORM,
+   };
+   static const char *names[] = {
+      "unpack_rgba_float",
+      "pack_rgba_float",
+      "unpack_rgba_8unorm",
+      "pack_rgba_8unorm",
+   };
+   const unsigned float_stride = BENCH_WIDTH * 4 * sizeof(float);
+   const unsigned packed_stride = BENCH_WIDTH * 16;
+   float *floats = MALLOC(float_stride * BENCH_HEIGHT);
+   uint8_t *packed = MALLOC(packed_stride * BENCH_HEIGHT);
+   unsigned i, j;
+
+   if (!floats || !packed) {
+      FREE(floats);
+      FREE(packed);
+      return;
+   }
+
+   for (i = 0; i < BENCH_WIDTH * 4 * BENCH_HEIGHT; ++i)
+      floats[i] = (float)rand() / RAND_MAX;
+
+   printf("%-28s %-20s %10s %10s\n", "format", "function",
+          "Mpix/s", "SIMD Mpix/s");
+
+   for (i = 0; i < ARRAY_SIZE(formats); ++i) {
+      const struct util_format_description *format_desc =
+         util_format_description(formats[i]);
+
+      /* Unpack real pixels rather than random bits, which for floats would
+       * be full of denormals and NaNs.
+       */
+      format_desc->pack_rgba_float(packed, packed_stride, floats, float_stride,
+                                   BENCH_WIDTH, BENCH_HEIGHT);
+
+      for (j = 0; j < ARRAY_SIZE(names); ++j) {
+         boolean is_pack = j % 2;
+         void *dst = is_pack ? (void *)packed : (void *)floats;
+         const void *src = is_pack ? (const void *)floats : (const void *)packed;
+         unsigned dst_stride = is_pack ? packed_stride : float_stride;
+         unsigned src_stride = is_pack ? float_stride : packed_stride;
+         double scalar, vector;
+
+         set_simd_caps(caps, FALSE);
+         scalar = bench_one(format_desc, names[j], dst, dst_stride,
+                            src, src_stride);
+         set_simd_caps(caps, TRUE);
+         vector = bench_one(format_desc, names[j], dst, dst_stride,
+                            src, src_stride);
+
+         printf("%-28s %-20s %10.1f %10.1f\n", format_desc->short_name,
+                names[j], scalar, vector);
+      }
+   }
+
+   FREE(floats);
+   FREE(packed);
+}
+
+
 static boolean
 test_all(void)
 {
+   const struct util_cpu_caps caps = util_cpu_caps;
    enum pipe_format format;
    boolean success = TRUE;
 
@@ -723,6 +986,10 @@ test_all(void)
       TEST_ONE_FUNC(pack_s_8uint);
 
 #     undef TEST_ONE_FUNC
+
+      if (!test_format_rows(format_desc, &caps)) {
+         success = FALSE;
+      }
    }
 
    return success;
@@ -733,8 +1000,15 @@ int main(int argc, char **argv)
 {
    boolean success;
 
+   util_cpu_detect();
    util_format_s3tc_init();
 
+   if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+      const struct util_cpu_caps caps = util_cpu_caps;
+      bench_all(&caps);
+      return 0;
+   }
+
    success = test_all();
 
    return success ? 0 : 1;
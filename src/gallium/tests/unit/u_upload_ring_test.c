@@ -0,0 +1,441 @@
+/**************************************************************************
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/*
+ * Test case for the ring buffer mode of u_upload_mgr, using a fake screen
+ * and context whose fences are signalled by hand.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_atomic.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_upload_mgr.h"
+
+
+static unsigned failures;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) { \
+         printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+         ++failures; \
+      } \
+   } while (0)
+
+
+#define RING_SIZE 4096
+
+struct pipe_fence_handle {
+   struct pipe_reference reference;
+   boolean signalled;
+};
+
+struct test_buffer {
+   struct pipe_resource base;
+   uint8_t data[];
+};
+
+/* The range of the buffer mapped last */
+static struct pipe_box mapped;
+
+struct test_screen {
+   struct pipe_screen base;
+   boolean persistent;
+   unsigned buffers_created;
+   unsigned buffers_live;
+};
+
+
+static int
+test_get_param(struct pipe_screen *screen, enum pipe_cap param)
+{
+   struct test_screen *ts = (struct test_screen *)screen;
+
+   return param == PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT && ts->persistent;
+}
+
+static struct pipe_resource *
+test_resource_create(struct pipe_screen *screen,
+                     const struct pipe_resource *templ)
+{
+   struct test_screen *ts = (struct test_screen *)screen;
+   struct test_buffer *buf = CALLOC(1, sizeof(*buf) + templ->width0);
+
+   if (!buf)
+      return NULL;
+
+   buf->base = *templ;
+   pipe_reference_init(&buf->base.reference, 1);
+   buf->base.screen = screen;
+   ts->buffers_created++;
+   ts->buffers_live++;
+   return &buf->base;
+}
+
+static void
+test_resource_destroy(struct pipe_screen *screen, struct pipe_resource *res)
+{
+   struct test_screen *ts = (struct test_screen *)screen;
+
+   ts->buffers_live--;
+   FREE(res);
+}
+
+static void
+test_fence_reference(struct pipe_screen *screen,
+                     struct pipe_fence_handle **ptr,
+                     struct pipe_fence_handle *fence)
+{
+   if (pipe_reference(&(*ptr)->reference, &fence->reference))
+      FREE(*ptr);
+   *ptr = fence;
+}
+
+static boolean
+test_fence_finish(struct pipe_screen *screen, struct pipe_context *ctx,
+                  struct pipe_fence_handle *fence, uint64_t timeout)
+{
+   /* The uploader must never wait or flush. */
+   CHECK(ctx == NULL);
+   CHECK(timeout == 0);
+   return fence->signalled;
+}
+
+static void *
+test_transfer_map(struct pipe_context *pipe, struct pipe_resource *res,
+                  unsigned level, unsigned usage, const struct pipe_box *box,
+                  struct pipe_transfer **out_transfer)
+{
+   struct pipe_transfer *transfer = CALLOC_STRUCT(pipe_transfer);
+
+   transfer->resource = res;
+   transfer->usage = usage;
+   transfer->box = *box;
+   *out_transfer = transfer;
+   mapped = *box;
+   return ((struct test_buffer *)res)->data + box->x;
+}
+
+static void
+test_transfer_flush_region(struct pipe_context *pipe,
+                           struct pipe_transfer *transfer,
+                           const struct pipe_box *box)
+{
+}
+
+static void
+test_transfer_unmap(struct pipe_context *pipe, struct pipe_transfer *transfer)
+{
+   FREE(transfer);
+}
+
+
+static void
+init(struct test_screen *screen, struct pipe_context *pipe,
+     boolean persistent)
+{
+   memset(screen, 0, sizeof *screen);
+   screen->persistent = persistent;
+   screen->base.get_param = test_get_param;
+   screen->base.resource_create = test_resource_create;
+   screen->base.resource_destroy = test_resource_destroy;
+   screen->base.fence_reference = test_fence_reference;
+   screen->base.fence_finish = test_fence_finish;
+
+   memset(pipe, 0, sizeof *pipe);
+   pipe->screen = &screen->base;
+   pipe->transfer_map = test_transfer_map;
+   pipe->transfer_flush_region = test_transfer_flush_region;
+   pipe->transfer_unmap = test_transfer_unmap;
+}
+
+static struct pipe_fence_handle *
+create_fence(void)
+{
+   struct pipe_fence_handle *fence = CALLOC_STRUCT(pipe_fence_handle);
+
+   pipe_reference_init(&fence->reference, 1);
+   return fence;
+}
+
+/* Submit everything uploaded so far, like a driver flush would. */
+static struct pipe_fence_handle *
+flush(struct u_upload_mgr *upload)
+{
+   struct pipe_fence_handle *fence = create_fence();
+
+   u_upload_fence(upload, fence);
+   return fence;
+}
+
+/* Drop the test's reference, after the uploader has dropped its own. */
+static void
+release_fence(struct test_screen *screen, struct pipe_fence_handle *fence)
+{
+   CHECK(p_atomic_read(&fence->reference.count) == 1);
+   screen->base.fence_reference(&screen->base, &fence, NULL);
+}
+
+static unsigned
+alloc_at(struct u_upload_mgr *upload, unsigned min_offset, unsigned size,
+         struct pipe_resource **buffer)
+{
+   unsigned offset;
+   void *ptr;
+
+   u_upload_alloc(upload, min_offset, size, 256, &offset, buffer, &ptr);
+   CHECK(ptr != NULL);
+   CHECK(offset >= mapped.x && offset + size <= mapped.x + mapped.width);
+   if (ptr)
+      memset(ptr, 0xaa, size);
+   return offset;
+}
+
+static unsigned
+alloc(struct u_upload_mgr *upload, unsigned size,
+      struct pipe_resource **buffer)
+{
+   return alloc_at(upload, 0, size, buffer);
+}
+
+
+/* Memory nothing fenced yet can't be reused. */
+static void
+test_unfenced(void)
+{
+   struct test_screen screen;
+   struct pipe_context pipe;
+   struct pipe_resource *first = NULL, *buffer = NULL;
+   struct u_upload_mgr *upload;
+
+   init(&screen, &pipe, TRUE);
+   upload = u_upload_create_ring(&pipe, RING_SIZE, PIPE_BIND_INDEX_BUFFER,
+                                 PIPE_USAGE_STREAM);
+
+   CHECK(alloc(upload, 3072, &first) == 0);
+   CHECK(alloc(upload, 2048, &buffer) == 0);
+   CHECK(buffer != first);
+   CHECK(screen.buffers_created == 2);
+
+   pipe_resource_reference(&first, NULL);
+   pipe_resource_reference(&buffer, NULL);
+   u_upload_destroy(upload);
+   CHECK(screen.buffers_live == 0);
+}
+
+/* Once every fence has signalled, the ring starts over at offset 0. */
+static void
+test_retire_all(void)
+{
+   struct test_screen screen;
+   struct pipe_context pipe;
+   struct pipe_resource *first = NULL, *buffer = NULL;
+   struct pipe_fence_handle *fence_a, *fence_b;
+   struct u_upload_mgr *upload;
+
+   init(&screen, &pipe, TRUE);
+   upload = u_upload_create_ring(&pipe, RING_SIZE, PIPE_BIND_INDEX_BUFFER,
+                                 PIPE_USAGE_STREAM);
+
+   CHECK(alloc(upload, 1024, &first) == 0);
+   CHECK(alloc(upload, 1024, &buffer) == 1024);
+   CHECK(alloc(upload, 1024, &buffer) == 2048);
+   fence_a = flush(upload);
+
+   /* Not signalled yet: a new buffer. */
+   CHECK(alloc(upload, 2048, &buffer) == 0);
+   CHECK(buffer != first);
+   CHECK(screen.buffers_created == 2);
+
+   /* A new ring, signalled this time. */
+   pipe_resource_reference(&first, buffer);
+   CHECK(alloc(upload, 1024, &buffer) == 2048);
+   fence_b = flush(upload);
+   fence_b->signalled = TRUE;
+
+   CHECK(alloc(upload, 2048, &buffer) == 0);
+   CHECK(buffer == first);
+   CHECK(screen.buffers_created == 2);
+
+   pipe_resource_reference(&first, NULL);
+   pipe_resource_reference(&buffer, NULL);
+   u_upload_destroy(upload);
+   CHECK(screen.buffers_live == 0);
+   release_fence(&screen, fence_a);
+   release_fence(&screen, fence_b);
+}
+
+/* Wrapping reuses the start of the ring while the end is still in flight,
+ * but never catches up with data that hasn't been retired.
+ */
+static void
+test_wrap(void)
+{
+   struct test_screen screen;
+   struct pipe_context pipe;
+   struct pipe_resource *first = NULL, *buffer = NULL;
+   struct pipe_fence_handle *fence_a, *fence_b, *fence_c, *fence_d, *fence_e;
+   struct u_upload_mgr *upload;
+
+   init(&screen, &pipe, TRUE);
+   upload = u_upload_create_ring(&pipe, RING_SIZE, PIPE_BIND_INDEX_BUFFER,
+                                 PIPE_USAGE_STREAM);
+
+   CHECK(alloc(upload, 1024, &first) == 0);
+   fence_a = flush(upload);
+   CHECK(alloc(upload, 3072, &buffer) == 1024);
+   fence_b = flush(upload);
+
+   /* Only [0, 1024) is free, so a 512 byte allocation wraps... */
+   fence_a->signalled = TRUE;
+   CHECK(alloc(upload, 512, &buffer) == 0);
+   CHECK(buffer == first);
+
+   /* ...and the next one would reach fence_b's data. */
+   CHECK(alloc(upload, 512, &buffer) == 0);
+   CHECK(buffer != first);
+   CHECK(screen.buffers_created == 2);
+
+   /* The same again, with fence_d signalled in time. */
+   pipe_resource_reference(&first, buffer);
+   CHECK(alloc(upload, 512, &buffer) == 512);
+   fence_c = flush(upload);
+   CHECK(alloc(upload, 3072, &buffer) == 1024);
+   fence_d = flush(upload);
+
+   fence_c->signalled = TRUE;
+   CHECK(alloc(upload, 512, &buffer) == 0);
+   fence_d->signalled = TRUE;
+   CHECK(alloc(upload, 512, &buffer) == 512);
+   CHECK(buffer == first);
+
+   /* Retiring data written after the wrap leaves the ring idle. */
+   fence_e = flush(upload);
+   fence_e->signalled = TRUE;
+   CHECK(alloc(upload, 3072, &buffer) == 0);
+   CHECK(buffer == first);
+   CHECK(screen.buffers_created == 2);
+
+   pipe_resource_reference(&first, NULL);
+   pipe_resource_reference(&buffer, NULL);
+   u_upload_destroy(upload);
+   CHECK(screen.buffers_live == 0);
+   release_fence(&screen, fence_a);
+   release_fence(&screen, fence_b);
+   release_fence(&screen, fence_c);
+   release_fence(&screen, fence_d);
+   release_fence(&screen, fence_e);
+}
+
+/* Wrapping below the offset the ring was first used at stays inside the
+ * mapping.
+ */
+static void
+test_wrap_below_start(void)
+{
+   struct test_screen screen;
+   struct pipe_context pipe;
+   struct pipe_resource *first = NULL, *buffer = NULL;
+   struct pipe_fence_handle *fence;
+   struct u_upload_mgr *upload;
+
+   init(&screen, &pipe, TRUE);
+   upload = u_upload_create_ring(&pipe, RING_SIZE, PIPE_BIND_INDEX_BUFFER,
+                                 PIPE_USAGE_STREAM);
+
+   CHECK(alloc_at(upload, 2048, 1024, &first) == 2048);
+   CHECK(mapped.x == 0 && mapped.width == RING_SIZE);
+   fence = flush(upload);
+   CHECK(alloc(upload, 512, &buffer) == 3072);
+
+   fence->signalled = TRUE;
+   CHECK(alloc(upload, 1024, &buffer) == 0);
+   CHECK(buffer == first);
+   CHECK(screen.buffers_created == 1);
+
+   pipe_resource_reference(&first, NULL);
+   pipe_resource_reference(&buffer, NULL);
+   u_upload_destroy(upload);
+   CHECK(screen.buffers_live == 0);
+   release_fence(&screen, fence);
+}
+
+/* Without persistent mappings, ring mode is off and fences are ignored. */
+static void
+test_not_persistent(void)
+{
+   struct test_screen screen;
+   struct pipe_context pipe;
+   struct pipe_resource *first = NULL, *buffer = NULL;
+   struct pipe_fence_handle *fence;
+   struct u_upload_mgr *upload;
+
+   init(&screen, &pipe, FALSE);
+   upload = u_upload_create_ring(&pipe, RING_SIZE, PIPE_BIND_INDEX_BUFFER,
+                                 PIPE_USAGE_STREAM);
+
+   CHECK(alloc(upload, 3072, &first) == 0);
+   fence = flush(upload);
+   fence->signalled = TRUE;
+
+   CHECK(alloc(upload, 2048, &buffer) == 0);
+   CHECK(buffer != first);
+   CHECK(screen.buffers_created == 2);
+
+   pipe_resource_reference(&first, NULL);
+   pipe_resource_reference(&buffer, NULL);
+   u_upload_destroy(upload);
+   CHECK(screen.buffers_live == 0);
+   release_fence(&screen, fence);
+}
+
+
+int main(int argc, char **argv)
+{
+   test_unfenced();
+   test_retire_all();
+   test_wrap();
+   test_wrap_below_start();
+   test_not_persistent();
+
+   if (failures) {
+      printf("%u checks failed\n", failures);
+      return 1;
+   }
+
+   return 0;
+}
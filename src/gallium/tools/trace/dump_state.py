@@ -394,7 +394,7 @@ class Context(Dispatcher):
 
     def _update(self, array, start_slot, num_slots, states):
         if not isinstance(states, list):
-            # XXX: trace is not serializing multiple scissors/viewports properly yet
+            # Older traces only serialized the first scissor/viewport
             num_slots = 1
             states = [states]
         while len(array) < start_slot + num_slots:
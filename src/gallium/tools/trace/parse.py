@@ -28,6 +28,7 @@
 
 
 import sys
+import struct
 import xml.parsers.expat
 import optparse
 
@@ -187,13 +188,58 @@ class XmlParser:
         return data
 
 
+class PrefixedFile:
+    """Gives back the bytes peeked from the start of a file."""
+
+    def __init__(self, prefix, fp):
+        self.prefix = prefix
+        self.fp = fp
+
+    def read(self, size):
+        if not self.prefix:
+            return self.fp.read(size)
+        data = self.prefix[:size]
+        self.prefix = self.prefix[size:]
+        if len(data) < size:
+            data += self.fp.read(size - len(data))
+        return data
+
+
+# Binary trace encoding, see src/gallium/drivers/trace/tr_dump_binary.h
+BINARY_MAGIC = 'GTRB'
+BINARY_VERSION = 1
+
+(TOKEN_CALL, TOKEN_CALL_END, TOKEN_ARG, TOKEN_RET, TOKEN_MEMBER,
+ TOKEN_NULL, TOKEN_FALSE, TOKEN_TRUE, TOKEN_INT, TOKEN_UINT, TOKEN_PTR,
+ TOKEN_FLOAT, TOKEN_STRING, TOKEN_BYTES, TOKEN_ENUM, TOKEN_ARRAY,
+ TOKEN_ARRAY_END, TOKEN_STRUCT, TOKEN_STRUCT_END) = range(1, 20)
+
+
+class BinaryTruncated(Exception):
+
+    pass
+
+
 class TraceParser(XmlParser):
 
     def __init__(self, fp):
-        XmlParser.__init__(self, fp)
+        magic = fp.read(len(BINARY_MAGIC))
+        self.binary = magic == BINARY_MAGIC
+        if self.binary:
+            self.fp = fp
+            self.names = []
+            version = ord(self.read_bytes(1))
+            if version != BINARY_VERSION:
+                raise Exception('unsupported binary trace version %u' % version)
+        else:
+            XmlParser.__init__(self, PrefixedFile(magic, fp))
         self.last_call_no = 0
     
     def parse(self):
+        if self.binary:
+            self.parse_binary()
+            return
+
         self.element_start('trace')
         while self.token.type not in (ELEMENT_END, EOF):
             call = self.parse_call()
@@ -346,6 +392,115 @@ class TraceParser(XmlParser):
 
         return Pointer(address)
 
+    def read_bytes(self, size):
+        data = self.fp.read(size)
+        if len(data) < size:
+            raise BinaryTruncated()
+        return data
+
+    def read_uint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = ord(self.read_bytes(1))
+            value |= (byte & 0x7f) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    def read_sint(self):
+        value = self.read_uint()
+        return (value >> 1) ^ -(value & 1)
+
+    def read_name(self):
+        index = self.read_uint()
+        if index:
+            return self.names[index - 1]
+        name = self.read_bytes(self.read_uint())
+        self.names.append(name)
+        return name
+
+    def parse_binary(self):
+        # Traces of applications that didn't exit cleanly may end in the
+        # middle of a call, which is silently dropped.
+        try:
+            while True:
+                data = self.fp.read(1)
+                if not data:
+                    break
+                if ord(data) != TOKEN_CALL:
+                    raise Exception('call expected, got token %u' % ord(data))
+                call = self.parse_binary_call()
+                self.handle_call(call)
+        except BinaryTruncated:
+            pass
+
+    def parse_binary_call(self):
+        no = self.read_uint()
+        klass = self.read_name()
+        method = self.read_name()
+        args = []
+        ret = None
+        while True:
+            token = ord(self.read_bytes(1))
+            if token == TOKEN_ARG:
+                name = self.read_name()
+                args.append((name, self.parse_binary_value()))
+            elif token == TOKEN_RET:
+                ret = self.parse_binary_value()
+            elif token == TOKEN_CALL_END:
+                # Binary traces record nanoseconds, XML ones microseconds
+                time = Literal(self.read_uint() // 1000)
+                break
+            else:
+                raise Exception('unexpected token %u in call %u' % (token, no))
+        self.last_call_no = no
+        return Call(no, klass, method, args, ret, time)
+
+    def parse_binary_value(self, token = None):
+        if token is None:
+            token = ord(self.read_bytes(1))
+        if token == TOKEN_NULL:
+            return Literal(None)
+        if token == TOKEN_FALSE:
+            return Literal(0)
+        if token == TOKEN_TRUE:
+            return Literal(1)
+        if token == TOKEN_INT:
+            return Literal(self.read_sint())
+        if token == TOKEN_UINT:
+            return Literal(self.read_uint())
+        if token == TOKEN_PTR:
+            return Pointer('0x%08x' % self.read_uint())
+        if token == TOKEN_FLOAT:
+            return Literal(struct.unpack('<d', self.read_bytes(8))[0])
+        if token == TOKEN_STRING:
+            return Literal(self.read_bytes(self.read_uint()))
+        if token == TOKEN_BYTES:
+            data = self.read_bytes(self.read_uint())
+            return Blob(''.join(['%02X' % ord(c) for c in data]))
+        if token == TOKEN_ENUM:
+            return NamedConstant(self.read_name())
+        if token == TOKEN_ARRAY:
+            elems = []
+            while True:
+                token = ord(self.read_bytes(1))
+                if token == TOKEN_ARRAY_END:
+                    return Array(elems)
+                elems.append(self.parse_binary_value(token))
+        if token == TOKEN_STRUCT:
+            name = self.read_name()
+            members = []
+            while True:
+                token = ord(self.read_bytes(1))
+                if token == TOKEN_STRUCT_END:
+                    return Struct(name, members)
+                if token != TOKEN_MEMBER:
+                    raise Exception('member expected, got token %u' % token)
+                member_name = self.read_name()
+                members.append((member_name, self.parse_binary_value()))
+        raise Exception('unexpected token %u' % token)
+
     def handle_call(self, call):
         pass
     
@@ -383,7 +538,7 @@ class Main:
                 from bz2 import BZ2File
                 stream = BZ2File(arg, 'rU')
             else:
-                stream = open(arg, 'rt')
+                stream = open(arg, 'rb')
             self.process_arg(stream, options)
 
     def get_optparser(self):
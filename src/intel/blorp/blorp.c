@@ -23,7 +23,10 @@
 
 #include <errno.h>
 
+#include "common/gen_disk_cache.h"
 #include "program/prog_instruction.h"
+#include "util/crc32.h"
+#include "util/mesa-sha1.h"
 
 #include "blorp_priv.h"
 #include "brw_compiler.h"
@@ -35,6 +38,8 @@ blorp_init(struct blorp_context *blorp, void *driver_ctx,
 {
    blorp->driver_ctx = driver_ctx;
    blorp->isl_dev = isl_dev;
+   blorp->disk_cache = NULL;
+   memset(blorp->cache_id, 0, sizeof(blorp->cache_id));
 }
 
 void
@@ -221,6 +226,180 @@ blorp_compile_vs(struct blorp_context *blorp, void *mem_ctx,
    return program;
 }
 
+/* Kernels are stored in the disk cache as this header followed by the blorp
+ * key, the prog_data and the kernel.  The key is kept so that a hash
+ * collision can't hand back the wrong kernel.
+ */
+struct blorp_disk_cache_entry {
+   uint32_t crc32;
+   uint32_t key_size;
+   uint32_t prog_data_size;
+   uint32_t kernel_size;
+};
+
+union blorp_prog_data {
+   struct brw_stage_prog_data base;
+   struct brw_wm_prog_data wm;
+   struct brw_vs_prog_data vs;
+};
+
+static void
+blorp_disk_cache_key(const struct blorp_context *blorp,
+                     const void *key, uint32_t key_size,
+                     cache_key disk_key)
+{
+   const struct gen_device_info *devinfo = blorp->isl_dev->info;
+   const uint32_t device[] = {
+      devinfo->gen,
+      devinfo->gt,
+      devinfo->is_g4x,
+      devinfo->is_haswell,
+      devinfo->is_cherryview,
+      devinfo->is_broxton,
+      devinfo->is_kabylake,
+   };
+   struct mesa_sha1 *ctx;
+
+   ctx = _mesa_sha1_init();
+   _mesa_sha1_update(ctx, "blorp", 5);
+   _mesa_sha1_update(ctx, blorp->cache_id, sizeof(blorp->cache_id));
+   _mesa_sha1_update(ctx, device, sizeof(device));
+   _mesa_sha1_update(ctx, &key_size, sizeof(key_size));
+   _mesa_sha1_update(ctx, key, key_size);
+   _mesa_sha1_final(ctx, disk_key);
+}
+
+static bool
+blorp_search_disk(struct blorp_context *blorp,
+                  const void *key, uint32_t key_size,
+                  uint32_t *kernel_out, void *prog_data_out)
+{
+   struct blorp_disk_cache_entry entry;
+   union blorp_prog_data prog_data;
+   cache_key disk_key;
+   size_t size;
+
+   blorp_disk_cache_key(blorp, key, key_size, disk_key);
+
+   uint8_t *data = gen_disk_cache_get(blorp->disk_cache, disk_key, &size);
+   if (!data)
+      return false;
+
+   bool found = false;
+   if (size >= sizeof(entry)) {
+      memcpy(&entry, data, sizeof(entry));
+      const uint8_t *p = data + sizeof(entry);
+      const size_t payload_size = size - sizeof(entry);
+
+      if ((uint64_t)entry.key_size + entry.prog_data_size +
+          entry.kernel_size == payload_size &&
+          entry.crc32 == util_hash_crc32(p, payload_size) &&
+          entry.key_size == key_size && memcmp(p, key, key_size) == 0 &&
+          entry.prog_data_size >= sizeof(prog_data.base) &&
+          entry.prog_data_size <= sizeof(prog_data)) {
+         p += entry.key_size;
+         memcpy(&prog_data, p, entry.prog_data_size);
+         p += entry.prog_data_size;
+
+         /* BLORP kernels have no params, don't trust stale pointers */
+         prog_data.base.param = NULL;
+         prog_data.base.pull_param = NULL;
+         prog_data.base.image_param = NULL;
+
+         blorp->upload_shader(blorp, key, key_size, p, entry.kernel_size,
+                              &prog_data.base, entry.prog_data_size,
+                              kernel_out, prog_data_out);
+         found = true;
+      }
+   }
+
+   free(data);
+
+   return found;
+}
+
+static void
+blorp_store_disk(struct blorp_context *blorp,
+                 const void *key, uint32_t key_size,
+                 const void *kernel, uint32_t kernel_size,
+                 const struct brw_stage_prog_data *prog_data,
+                 uint32_t prog_data_size)
+{
+   struct blorp_disk_cache_entry entry = {
+      .key_size = key_size,
+      .prog_data_size = prog_data_size,
+      .kernel_size = kernel_size,
+   };
+   const size_t payload_size = key_size + prog_data_size + kernel_size;
+   cache_key disk_key;
+
+   assert(prog_data->nr_params == 0 && prog_data->nr_pull_params == 0);
+
+   uint8_t *data = malloc(sizeof(entry) + payload_size);
+   if (!data)
+      return;
+
+   uint8_t *p = data + sizeof(entry);
+   memcpy(p, key, key_size);
+   p += key_size;
+   memcpy(p, prog_data, prog_data_size);
+   p += prog_data_size;
+   memcpy(p, kernel, kernel_size);
+
+   entry.crc32 = util_hash_crc32(data + sizeof(entry), payload_size);
+   memcpy(data, &entry, sizeof(entry));
+
+   blorp_disk_cache_key(blorp, key, key_size, disk_key);
+   gen_disk_cache_put(blorp->disk_cache, disk_key,
+                      data, sizeof(entry) + payload_size);
+
+   free(data);
+}
+
+/**
+ * Looks a kernel up in the driver's cache and then in the disk cache, if
+ * any.  Kernels found on disk are uploaded through the driver's hook.
+ */
+bool
+blorp_find_shader(struct blorp_context *blorp,
+                  const void *key, uint32_t key_size,
+                  uint32_t *kernel_out, void *prog_data_out)
+{
+   if (blorp->lookup_shader(blorp, key, key_size, kernel_out, prog_data_out))
+      return true;
+
+   return blorp->disk_cache &&
+          blorp_search_disk(blorp, key, key_size, kernel_out, prog_data_out);
+}
+
+/**
+ * Uploads a freshly compiled kernel through the driver's hook and writes it
+ * to the disk cache, if any.
+ */
+void
+blorp_upload_shader(struct blorp_context *blorp,
+                    const void *key, uint32_t key_size,
+                    const void *kernel, uint32_t kernel_size,
+                    const struct brw_stage_prog_data *prog_data,
+                    uint32_t prog_data_size,
+                    uint32_t *kernel_out, void *prog_data_out)
+{
+   blorp->upload_shader(blorp, key, key_size, kernel, kernel_size,
+                        prog_data, prog_data_size, kernel_out, prog_data_out);
+
+   if (blorp->disk_cache) {
+      blorp_store_disk(blorp, key, key_size, kernel, kernel_size,
+                       prog_data, prog_data_size);
+   }
+}
+
+void
+blorp_precompile_shaders(struct blorp_context *blorp)
+{
+   blorp_precompile_clear_kernels(blorp);
+   blorp_precompile_copy_kernels(blorp);
+}
+
 void
 blorp_gen6_hiz_op(struct blorp_batch *batch,
                   struct blorp_surf *surf, unsigned level, unsigned layer,
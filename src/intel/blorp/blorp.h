@@ -31,6 +31,7 @@
 
 struct brw_context;
 struct brw_stage_prog_data;
+struct gen_disk_cache;
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,6 +40,8 @@ extern "C" {
 struct blorp_batch;
 struct blorp_params;
 
+#define BLORP_CACHE_ID_SIZE 16
+
 struct blorp_context {
    void *driver_ctx;
 
@@ -62,12 +65,32 @@ struct blorp_context {
                          uint32_t prog_data_size,
                          uint32_t *kernel_out, void *prog_data_out);
    void (*exec)(struct blorp_batch *batch, const struct blorp_params *params);
+
+   /**
+    * Optional persistent kernel store, shared by every context and process
+    * using the same cache_id.  Kernels that miss in lookup_shader are looked
+    * up here before being compiled, and every kernel blorp compiles is
+    * written back.  Drivers whose shader hooks already persist kernels
+    * should leave this NULL.
+    */
+   struct gen_disk_cache *disk_cache;
+
+   /** Identifies the driver build that compiled the kernels in disk_cache */
+   uint8_t cache_id[BLORP_CACHE_ID_SIZE];
 };
 
 void blorp_init(struct blorp_context *blorp, void *driver_ctx,
                 struct isl_device *isl_dev);
 void blorp_finish(struct blorp_context *blorp);
 
+/**
+ * Compiles the clear kernels and the copy kernels for the common texel sizes
+ * so that the first clear or copy doesn't have to.  This only goes through
+ * the lookup_shader and upload_shader hooks, so it may be run on another
+ * thread if those are thread-safe.
+ */
+void blorp_precompile_shaders(struct blorp_context *blorp);
+
 enum blorp_batch_flags {
    /**
     * This flag indicates that blorp should *not* re-emit the depth and
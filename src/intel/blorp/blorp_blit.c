@@ -1288,8 +1288,8 @@ brw_blorp_get_blit_kernel(struct blorp_context *blorp,
                           struct blorp_params *params,
                           const struct brw_blorp_blit_prog_key *prog_key)
 {
-   if (blorp->lookup_shader(blorp, prog_key, sizeof(*prog_key),
-                            &params->wm_prog_kernel, &params->wm_prog_data))
+   if (blorp_find_shader(blorp, prog_key, sizeof(*prog_key),
+                         &params->wm_prog_kernel, &params->wm_prog_data))
       return;
 
    void *mem_ctx = ralloc_context(NULL);
@@ -1309,10 +1309,10 @@ brw_blorp_get_blit_kernel(struct blorp_context *blorp,
    program = blorp_compile_fs(blorp, mem_ctx, nir, &wm_key, false,
                               &prog_data, &program_size);
 
-   blorp->upload_shader(blorp, prog_key, sizeof(*prog_key),
-                        program, program_size,
-                        &prog_data.base, sizeof(prog_data),
-                        &params->wm_prog_kernel, &params->wm_prog_data);
+   blorp_upload_shader(blorp, prog_key, sizeof(*prog_key),
+                       program, program_size,
+                       &prog_data.base, sizeof(prog_data),
+                       &params->wm_prog_kernel, &params->wm_prog_data);
 
    ralloc_free(mem_ctx);
 }
@@ -1606,6 +1606,18 @@ enum blit_shrink_status {
    BLIT_HEIGHT_SHRINK = 2,
 };
 
+static nir_alu_type
+get_texture_data_type(enum isl_format format)
+{
+   if (isl_format_has_sint_channel(format)) {
+      return nir_type_int;
+   } else if (isl_format_has_uint_channel(format)) {
+      return nir_type_uint;
+   } else {
+      return nir_type_float;
+   }
+}
+
 /* Try to blit. If the surface parameters exceed the size allowed by hardware,
  * then enum blit_shrink_status will be returned. If BLIT_NO_SHRINK is
  * returned, then the blit was successful.
@@ -1620,13 +1632,8 @@ try_blorp_blit(struct blorp_batch *batch,
 
    fake_dest_rgb_with_red(batch->blorp->isl_dev, params, wm_prog_key, coords);
 
-   if (isl_format_has_sint_channel(params->src.view.format)) {
-      wm_prog_key->texture_data_type = nir_type_int;
-   } else if (isl_format_has_uint_channel(params->src.view.format)) {
-      wm_prog_key->texture_data_type = nir_type_uint;
-   } else {
-      wm_prog_key->texture_data_type = nir_type_float;
-   }
+   wm_prog_key->texture_data_type =
+      get_texture_data_type(params->src.view.format);
 
    /* src_samples and dst_samples are the true sample counts */
    wm_prog_key->src_samples = params->src.surf.samples;
@@ -2362,3 +2369,39 @@ blorp_copy(struct blorp_batch *batch,
 
    do_blorp_blit(batch, &params, &wm_prog_key, &coords);
 }
+
+void
+blorp_precompile_copy_kernels(struct blorp_context *blorp)
+{
+   static const unsigned bpbs[] = { 8, 16, 32, 64, 128 };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(bpbs); i++) {
+      const enum isl_format format =
+         get_copy_format_for_bpb(blorp->isl_dev, bpbs[i]);
+      const uint8_t bpc = isl_format_get_layout(format)->channels.r.bits;
+
+      /* This is the key blorp_copy() ends up with when copying between
+       * single-sampled, uncompressed surfaces with the same texel size, as
+       * for most image and buffer copies.
+       */
+      struct brw_blorp_blit_prog_key wm_prog_key = {
+         .shader_type = BLORP_SHADER_TYPE_BLIT,
+         .tex_samples = 1,
+         .tex_layout = ISL_MSAA_LAYOUT_NONE,
+         .tex_aux_usage = ISL_AUX_USAGE_NONE,
+         .src_samples = 1,
+         .src_layout = ISL_MSAA_LAYOUT_NONE,
+         .src_bpc = bpc,
+         .rt_samples = 1,
+         .rt_layout = ISL_MSAA_LAYOUT_NONE,
+         .dst_samples = 1,
+         .dst_layout = ISL_MSAA_LAYOUT_NONE,
+         .dst_bpc = bpc,
+         .texture_data_type = get_texture_data_type(format),
+      };
+
+      struct blorp_params params;
+      blorp_params_init(&params);
+      brw_blorp_get_blit_kernel(blorp, &params, &wm_prog_key);
+   }
+}
@@ -50,8 +50,8 @@ blorp_params_get_clear_kernel(struct blorp_context *blorp,
       .use_simd16_replicated_data = use_replicated_data,
    };
 
-   if (blorp->lookup_shader(blorp, &blorp_key, sizeof(blorp_key),
-                            &params->wm_prog_kernel, &params->wm_prog_data))
+   if (blorp_find_shader(blorp, &blorp_key, sizeof(blorp_key),
+                         &params->wm_prog_kernel, &params->wm_prog_data))
       return;
 
    void *mem_ctx = ralloc_context(NULL);
@@ -79,10 +79,10 @@ blorp_params_get_clear_kernel(struct blorp_context *blorp,
       blorp_compile_fs(blorp, mem_ctx, b.shader, &wm_key, use_replicated_data,
                        &prog_data, &program_size);
 
-   blorp->upload_shader(blorp, &blorp_key, sizeof(blorp_key),
-                        program, program_size,
-                        &prog_data.base, sizeof(prog_data),
-                        &params->wm_prog_kernel, &params->wm_prog_data);
+   blorp_upload_shader(blorp, &blorp_key, sizeof(blorp_key),
+                       program, program_size,
+                       &prog_data.base, sizeof(prog_data),
+                       &params->wm_prog_kernel, &params->wm_prog_data);
 
    ralloc_free(mem_ctx);
 }
@@ -110,8 +110,8 @@ blorp_params_get_layer_offset_vs(struct blorp_context *blorp,
    if (params->wm_prog_data)
       blorp_key.num_inputs = params->wm_prog_data->num_varying_inputs;
 
-   if (blorp->lookup_shader(blorp, &blorp_key, sizeof(blorp_key),
-                            &params->vs_prog_kernel, &params->vs_prog_data))
+   if (blorp_find_shader(blorp, &blorp_key, sizeof(blorp_key),
+                         &params->vs_prog_kernel, &params->vs_prog_data))
       return;
 
    void *mem_ctx = ralloc_context(NULL);
@@ -168,14 +168,32 @@ blorp_params_get_layer_offset_vs(struct blorp_context *blorp,
    const unsigned *program =
       blorp_compile_vs(blorp, mem_ctx, b.shader, &vs_prog_data, &program_size);
 
-   blorp->upload_shader(blorp, &blorp_key, sizeof(blorp_key),
-                        program, program_size,
-                        &vs_prog_data.base.base, sizeof(vs_prog_data),
-                        &params->vs_prog_kernel, &params->vs_prog_data);
+   blorp_upload_shader(blorp, &blorp_key, sizeof(blorp_key),
+                       program, program_size,
+                       &vs_prog_data.base.base, sizeof(vs_prog_data),
+                       &params->vs_prog_kernel, &params->vs_prog_data);
 
    ralloc_free(mem_ctx);
 }
 
+void
+blorp_precompile_clear_kernels(struct blorp_context *blorp)
+{
+   struct blorp_params params;
+
+   /* Used by blorp_clear() and blorp_fast_clear() */
+   blorp_params_init(&params);
+   blorp_params_get_clear_kernel(blorp, &params, true);
+
+   /* Used by blorp_clear_attachments(), with and without a color */
+   blorp_params_init(&params);
+   blorp_params_get_clear_kernel(blorp, &params, false);
+   blorp_params_get_layer_offset_vs(blorp, &params);
+
+   blorp_params_init(&params);
+   blorp_params_get_layer_offset_vs(blorp, &params);
+}
+
 /* The x0, y0, x1, and y1 parameters must already be populated with the render
  * area of the framebuffer to be cleared.
  */
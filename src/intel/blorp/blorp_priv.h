@@ -332,6 +332,23 @@ blorp_compile_vs(struct blorp_context *blorp, void *mem_ctx,
                  struct brw_vs_prog_data *vs_prog_data,
                  unsigned *program_size);
 
+bool
+blorp_find_shader(struct blorp_context *blorp,
+                  const void *key, uint32_t key_size,
+                  uint32_t *kernel_out, void *prog_data_out);
+
+void
+blorp_upload_shader(struct blorp_context *blorp,
+                    const void *key, uint32_t key_size,
+                    const void *kernel, uint32_t kernel_size,
+                    const struct brw_stage_prog_data *prog_data,
+                    uint32_t prog_data_size,
+                    uint32_t *kernel_out, void *prog_data_out);
+
+void blorp_precompile_clear_kernels(struct blorp_context *blorp);
+
+void blorp_precompile_copy_kernels(struct blorp_context *blorp);
+
 /** \} */
 
 #ifdef __cplusplus
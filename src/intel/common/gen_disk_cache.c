@@ -0,0 +1,158 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gen_disk_cache.h"
+
+struct gen_disk_cache_write {
+   struct list_head link;
+   cache_key key;
+   size_t size;
+   char data[0];
+};
+
+static void *
+gen_disk_cache_thread(void *data)
+{
+   struct gen_disk_cache *cache = data;
+
+   pthread_mutex_lock(&cache->mutex);
+
+   while (true) {
+      while (list_empty(&cache->writes) && !cache->exit)
+         pthread_cond_wait(&cache->cond, &cache->mutex);
+
+      /* Pending writes are flushed before exiting */
+      if (list_empty(&cache->writes))
+         break;
+
+      struct gen_disk_cache_write *write =
+         list_first_entry(&cache->writes, struct gen_disk_cache_write, link);
+      list_del(&write->link);
+
+      pthread_mutex_unlock(&cache->mutex);
+      pthread_mutex_lock(&cache->io_mutex);
+      disk_cache_put(cache->cache, write->key, write->data, write->size);
+      pthread_mutex_unlock(&cache->io_mutex);
+      pthread_mutex_lock(&cache->mutex);
+
+      cache->pending_size -= write->size;
+      cache->stores++;
+      free(write);
+   }
+
+   pthread_mutex_unlock(&cache->mutex);
+
+   return NULL;
+}
+
+bool
+gen_disk_cache_init(struct gen_disk_cache *cache, size_t max_pending_size)
+{
+   memset(cache, 0, sizeof(*cache));
+
+   cache->cache = disk_cache_create();
+   if (!cache->cache)
+      return false;
+
+   pthread_mutex_init(&cache->io_mutex, NULL);
+   pthread_mutex_init(&cache->mutex, NULL);
+   pthread_cond_init(&cache->cond, NULL);
+   list_inithead(&cache->writes);
+   cache->max_pending_size = max_pending_size;
+
+   return true;
+}
+
+void
+gen_disk_cache_finish(struct gen_disk_cache *cache)
+{
+   if (!cache->cache)
+      return;
+
+   pthread_mutex_lock(&cache->mutex);
+   cache->exit = true;
+   pthread_cond_signal(&cache->cond);
+   pthread_mutex_unlock(&cache->mutex);
+
+   if (cache->thread_started)
+      pthread_join(cache->thread, NULL);
+
+   pthread_cond_destroy(&cache->cond);
+   pthread_mutex_destroy(&cache->mutex);
+   pthread_mutex_destroy(&cache->io_mutex);
+   disk_cache_destroy(cache->cache);
+   cache->cache = NULL;
+}
+
+void *
+gen_disk_cache_get(struct gen_disk_cache *cache, cache_key key, size_t *size)
+{
+   pthread_mutex_lock(&cache->io_mutex);
+   void *data = disk_cache_get(cache->cache, key, size);
+   pthread_mutex_unlock(&cache->io_mutex);
+
+   return data;
+}
+
+void
+gen_disk_cache_put(struct gen_disk_cache *cache, const cache_key key,
+                   const void *data, size_t size)
+{
+   struct gen_disk_cache_write *write = malloc(sizeof(*write) + size);
+   if (!write)
+      return;
+
+   memcpy(write->key, key, sizeof(cache_key));
+   memcpy(write->data, data, size);
+   write->size = size;
+
+   pthread_mutex_lock(&cache->mutex);
+
+   /* Drop the write rather than letting the queue grow without bound */
+   if (cache->pending_size + size > cache->max_pending_size) {
+      cache->dropped++;
+      pthread_mutex_unlock(&cache->mutex);
+      free(write);
+      return;
+   }
+
+   if (!cache->thread_started) {
+      if (pthread_create(&cache->thread, NULL,
+                         gen_disk_cache_thread, cache) != 0) {
+         cache->dropped++;
+         pthread_mutex_unlock(&cache->mutex);
+         free(write);
+         return;
+      }
+      cache->thread_started = true;
+   }
+
+   list_addtail(&write->link, &cache->writes);
+   cache->pending_size += size;
+   pthread_cond_signal(&cache->cond);
+
+   pthread_mutex_unlock(&cache->mutex);
+}
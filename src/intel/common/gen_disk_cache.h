@@ -0,0 +1,92 @@
+/*
+ * Copyright © 2017 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef GEN_DISK_CACHE_H
+#define GEN_DISK_CACHE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "util/disk_cache.h"
+#include "util/list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A util/disk_cache that may be used from several threads, and whose writes
+ * are done by a background thread so that the caller never waits on the
+ * disk.
+ */
+struct gen_disk_cache {
+   /** NULL if the shader cache is disabled */
+   struct disk_cache *cache;
+
+   /**
+    * Serializes disk_cache_get() and disk_cache_put(), which share the
+    * cache's ralloc context and aren't thread-safe.
+    */
+   pthread_mutex_t io_mutex;
+
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   pthread_t thread;
+   bool thread_started;
+   bool exit;
+
+   /** Queued writes, and their total size */
+   struct list_head writes;
+   size_t pending_size;
+
+   /** Writes beyond this many queued bytes are dropped */
+   size_t max_pending_size;
+
+   uint32_t stores;
+   uint32_t dropped;
+};
+
+/**
+ * Returns false, leaving cache->cache NULL, if the shader cache is disabled
+ * or can't be created.
+ */
+bool gen_disk_cache_init(struct gen_disk_cache *cache,
+                         size_t max_pending_size);
+
+/** Finishes the queued writes and destroys the cache. */
+void gen_disk_cache_finish(struct gen_disk_cache *cache);
+
+/** Returns a malloc'ed copy of the entry, or NULL. */
+void *gen_disk_cache_get(struct gen_disk_cache *cache, cache_key key,
+                         size_t *size);
+
+/** Queues a copy of data to be written under key. */
+void gen_disk_cache_put(struct gen_disk_cache *cache, const cache_key key,
+                        const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEN_DISK_CACHE_H */
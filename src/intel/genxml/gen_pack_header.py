@@ -347,10 +347,19 @@ class Group(object):
                 dwords[index + 1] = dwords[index]
                 index = index + 1
 
-    def emit_pack_function(self, start):
+    def emit_pack_function(self, start, merge=False):
         dwords = {}
         self.collect_dwords(dwords, 0, "")
 
+        # In merge mode, only the dwords selected by dw_mask are packed and
+        # they're or'ed into the destination instead of overwriting it.
+        if merge:
+            indent = "      "
+            op = "|="
+        else:
+            indent = "   "
+            op = "="
+
         # Determine number of dwords in this group. If we have a size, use
         # that, since that'll account for MBZ dwords at the end of a group
         # (like dword 8 on BDW+ 3DSTATE_HS). Otherwise, use the largest dword
@@ -363,8 +372,9 @@ class Group(object):
         for index in range(length):
             # Handle MBZ dwords
             if not index in dwords:
-                print("")
-                print("   dw[%d] = 0;" % index)
+                if not merge:
+                    print("")
+                    print("   dw[%d] = 0;" % index)
                 continue
 
             # For 64 bit dwords, we aliased the two dword entries in the dword
@@ -374,107 +384,129 @@ class Group(object):
             if index > 0 and index - 1 in dwords and dw == dwords[index - 1]:
                 continue
 
-            # Special case: only one field and it's a struct at the beginning
-            # of the dword. In this case we pack directly into the
-            # destination. This is the only way we handle embedded structs
-            # larger than 32 bits.
-            if len(dw.fields) == 1:
-                field = dw.fields[0]
-                name = field.name + field.dim
-                if field.type in self.parser.structs and field.start % 32 == 0:
+            if merge:
+                print("")
+                print("   if (dw_mask & (1u << %d)) {" % index)
+
+            self.emit_pack_dword(index, dw, indent, op)
+
+            if merge:
+                print("   }")
+
+    def emit_pack_dword(self, index, dw, indent, op):
+        # Special case: only one field and it's a struct at the beginning
+        # of the dword. In this case we pack directly into the
+        # destination. This is the only way we handle embedded structs
+        # larger than 32 bits.
+        if len(dw.fields) == 1:
+            field = dw.fields[0]
+            name = field.name + field.dim
+            if field.type in self.parser.structs and field.start % 32 == 0:
+                struct = self.parser.gen_prefix(safe_name(field.type))
+                if op == "=":
                     print("")
                     print("   %s_pack(data, &dw[%d], &values->%s);" %
-                          (self.parser.gen_prefix(safe_name(field.type)), index, name))
-                    continue
-
-            # Pack any fields of struct type first so we have integer values
-            # to the dword for those fields.
-            field_index = 0
-            for field in dw.fields:
-                if type(field) is Field and field.type in self.parser.structs:
-                    name = field.name + field.dim
-                    print("")
-                    print("   uint32_t v%d_%d;" % (index, field_index))
-                    print("   %s_pack(data, &v%d_%d, &values->%s);" %
-                          (self.parser.gen_prefix(safe_name(field.type)), index, field_index, name))
-                    field_index = field_index + 1
+                          (struct, index, name))
+                    return
+
+                length = self.parser.structs[field.type]
+                print("%suint32_t v%d[%d];" % (indent, index, length))
+                print("%s%s_pack(data, v%d, &values->%s);" %
+                      (indent, struct, index, name))
+                print("%sfor (unsigned i = 0; i < %d; i++)" % (indent, length))
+                print("%s   dw[%d + i] |= v%d[i];" % (indent, index, index))
+                return
+
+        # Pack any fields of struct type first so we have integer values
+        # to the dword for those fields.
+        field_index = 0
+        for field in dw.fields:
+            if type(field) is Field and field.type in self.parser.structs:
+                name = field.name + field.dim
+                print("")
+                print("%suint32_t v%d_%d;" % (indent, index, field_index))
+                print("%s%s_pack(data, &v%d_%d, &values->%s);" %
+                      (indent, self.parser.gen_prefix(safe_name(field.type)), index, field_index, name))
+                field_index = field_index + 1
 
+        if op == "=":
             print("")
-            dword_start = index * 32
-            if dw.address == None:
-                address_count = 0
-            else:
-                address_count = 1
-
-            if dw.size == 32 and dw.address == None:
-                v = None
-                print("   dw[%d] =" % index)
-            elif len(dw.fields) > address_count:
-                v = "v%d" % index
-                print("   const uint%d_t %s =" % (dw.size, v))
+        dword_start = index * 32
+        if dw.address == None:
+            address_count = 0
+        else:
+            address_count = 1
+
+        if dw.size == 32 and dw.address == None:
+            v = None
+            print("%sdw[%d] %s" % (indent, index, op))
+        elif len(dw.fields) > address_count:
+            v = "v%d" % index
+            print("%sconst uint%d_t %s =" % (indent, dw.size, v))
+        else:
+            v = "0"
+
+        field_index = 0
+        for field in dw.fields:
+            if field.type != "mbo":
+                name = field.name + field.dim
+
+            if field.type == "mbo":
+                s = "__gen_mbo(%d, %d)" % \
+                    (field.start - dword_start, field.end - dword_start)
+            elif field.type == "address":
+                s = None
+            elif field.type == "uint":
+                s = "__gen_uint(values->%s, %d, %d)" % \
+                    (name, field.start - dword_start, field.end - dword_start)
+            elif field.type in self.parser.enums:
+                s = "__gen_uint(values->%s, %d, %d)" % \
+                    (name, field.start - dword_start, field.end - dword_start)
+            elif field.type == "int":
+                s = "__gen_sint(values->%s, %d, %d)" % \
+                    (name, field.start - dword_start, field.end - dword_start)
+            elif field.type == "bool":
+                s = "__gen_uint(values->%s, %d, %d)" % \
+                    (name, field.start - dword_start, field.end - dword_start)
+            elif field.type == "float":
+                s = "__gen_float(values->%s)" % name
+            elif field.type == "offset":
+                s = "__gen_offset(values->%s, %d, %d)" % \
+                    (name, field.start - dword_start, field.end - dword_start)
+            elif field.type == 'ufixed':
+                s = "__gen_ufixed(values->%s, %d, %d, %d)" % \
+                    (name, field.start - dword_start, field.end - dword_start, field.fractional_size)
+            elif field.type == 'sfixed':
+                s = "__gen_sfixed(values->%s, %d, %d, %d)" % \
+                    (name, field.start - dword_start, field.end - dword_start, field.fractional_size)
+            elif field.type in self.parser.structs:
+                s = "__gen_uint(v%d_%d, %d, %d)" % \
+                    (index, field_index, field.start - dword_start, field.end - dword_start)
+                field_index = field_index + 1
             else:
-                v = "0"
-
-            field_index = 0
-            for field in dw.fields:
-                if field.type != "mbo":
-                    name = field.name + field.dim
-
-                if field.type == "mbo":
-                    s = "__gen_mbo(%d, %d)" % \
-                        (field.start - dword_start, field.end - dword_start)
-                elif field.type == "address":
-                    s = None
-                elif field.type == "uint":
-                    s = "__gen_uint(values->%s, %d, %d)" % \
-                        (name, field.start - dword_start, field.end - dword_start)
-                elif field.type in self.parser.enums:
-                    s = "__gen_uint(values->%s, %d, %d)" % \
-                        (name, field.start - dword_start, field.end - dword_start)
-                elif field.type == "int":
-                    s = "__gen_sint(values->%s, %d, %d)" % \
-                        (name, field.start - dword_start, field.end - dword_start)
-                elif field.type == "bool":
-                    s = "__gen_uint(values->%s, %d, %d)" % \
-                        (name, field.start - dword_start, field.end - dword_start)
-                elif field.type == "float":
-                    s = "__gen_float(values->%s)" % name
-                elif field.type == "offset":
-                    s = "__gen_offset(values->%s, %d, %d)" % \
-                        (name, field.start - dword_start, field.end - dword_start)
-                elif field.type == 'ufixed':
-                    s = "__gen_ufixed(values->%s, %d, %d, %d)" % \
-                        (name, field.start - dword_start, field.end - dword_start, field.fractional_size)
-                elif field.type == 'sfixed':
-                    s = "__gen_sfixed(values->%s, %d, %d, %d)" % \
-                        (name, field.start - dword_start, field.end - dword_start, field.fractional_size)
-                elif field.type in self.parser.structs:
-                    s = "__gen_uint(v%d_%d, %d, %d)" % \
-                        (index, field_index, field.start - dword_start, field.end - dword_start)
-                    field_index = field_index + 1
+                print("/* unhandled field %s, type %s */\n" % (name, field.type))
+                s = None
+
+            if not s == None:
+                if field == dw.fields[-1]:
+                    print("%s   %s;" % (indent, s))
                 else:
-                    print("/* unhandled field %s, type %s */\n" % (name, field.type))
-                    s = None
-
-                if not s == None:
-                    if field == dw.fields[-1]:
-                        print("      %s;" % s)
-                    else:
-                        print("      %s |" % s)
-
-            if dw.size == 32:
-                if dw.address:
-                    print("   dw[%d] = __gen_combine_address(data, &dw[%d], values->%s, %s);" % (index, index, dw.address.name, v))
-                continue
+                    print("%s   %s |" % (indent, s))
 
+        if dw.size == 32:
             if dw.address:
-                v_address = "v%d_address" % index
-                print("   const uint64_t %s =\n      __gen_combine_address(data, &dw[%d], values->%s, %s);" %
-                      (v_address, index, dw.address.name, v))
-                v = v_address
+                print("%sdw[%d] %s __gen_combine_address(data, &dw[%d], values->%s, %s);" % (indent, index, op, index, dw.address.name, v))
+            return
+
+        if dw.address:
+            v_address = "v%d_address" % index
+            print("%sconst uint64_t %s =\n%s   __gen_combine_address(data, &dw[%d], values->%s, %s);" %
+                  (indent, v_address, indent, index, dw.address.name, v))
+            v = v_address
+
+        print("%sdw[%d] %s %s;" % (indent, index, op, v))
+        print("%sdw[%d] %s %s >> 32;" % (indent, index + 1, op, v))
 
-            print("   dw[%d] = %s;" % (index, v))
-            print("   dw[%d] = %s >> 32;" % (index + 1, v))
 
 class Value(object):
     def __init__(self, attrs):
@@ -512,7 +544,7 @@ class Parser(object):
                 self.length_bias = int(attrs["bias"])
             elif name == "struct":
                 self.struct = safe_name(attrs["name"])
-                self.structs[attrs["name"]] = 1
+                self.structs[attrs["name"]] = int(attrs["length"])
             elif name == "register":
                 self.register = safe_name(attrs["name"])
                 self.reg_num = num_from_str(attrs["num"])
@@ -585,6 +617,26 @@ class Parser(object):
 
         print("}\n")
 
+    def emit_merge_function(self, name, group):
+        name = self.gen_prefix(name)
+        print("static inline void\n%s_merge(__gen_user_data *data, void * restrict dst,\n%sconst struct %s * restrict values,\n%suint32_t dw_mask)\n{" %
+              (name, ' ' * (len(name) + 7), name, ' ' * (len(name) + 7)))
+
+        # Cast dst to make header C++ friendly
+        print("   uint32_t * restrict dw = (uint32_t * restrict) dst;")
+
+        group.emit_pack_function(0, merge=True)
+
+        print("}\n")
+
+    def emit_field_starts(self, name, group):
+        for field in group.fields:
+            if not type(field) is Field or field.type == "mbo":
+                continue
+            print('#define %-40s %6d' %
+                  (self.gen_prefix(name + "_" + field.name + "_start"), field.start))
+        print('')
+
     def emit_instruction(self):
         name = self.instruction
         if not self.length == None:
@@ -606,10 +658,20 @@ class Parser(object):
             print(",  \\\n".join(default_fields))
             print('')
 
+        # Instructions that fit a 32-bit dword mask also get a merge function,
+        # which packs only the selected dwords on top of a template that was
+        # packed ahead of time.
+        mergeable = self.length != None and self.length <= 32
+        if mergeable:
+            self.emit_field_starts(name, self.group)
+
         self.emit_template_struct(self.instruction, self.group)
 
         self.emit_pack_function(self.instruction, self.group)
 
+        if mergeable:
+            self.emit_merge_function(self.instruction, self.group)
+
     def emit_register(self):
         name = self.register
         if not self.reg_num == None:
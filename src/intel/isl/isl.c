@@ -1506,59 +1506,93 @@ isl_surf_get_ccs_surf(const struct isl_device *dev,
    return true;
 }
 
-void
-isl_surf_fill_state_s(const struct isl_device *dev, void *state,
-                      const struct isl_surf_fill_state_info *restrict info)
-{
-#ifndef NDEBUG
-   isl_surf_usage_flags_t _base_usage =
-      info->view->usage & (ISL_SURF_USAGE_RENDER_TARGET_BIT |
-                           ISL_SURF_USAGE_TEXTURE_BIT |
-                           ISL_SURF_USAGE_STORAGE_BIT);
-   /* They may only specify one of the above bits at a time */
-   assert(__builtin_popcount(_base_usage) == 1);
-   /* The only other allowed bit is ISL_SURF_USAGE_CUBE_BIT */
-   assert((info->view->usage & ~ISL_SURF_USAGE_CUBE_BIT) == _base_usage);
-#endif
-
-   if (info->surf->dim == ISL_SURF_DIM_3D) {
-      assert(info->view->base_array_layer + info->view->array_len <=
-             info->surf->logical_level0_px.depth);
-   } else {
-      assert(info->view->base_array_layer + info->view->array_len <=
-             info->surf->logical_level0_px.array_len);
-   }
+typedef void (*isl_surf_fill_state_func)(const struct isl_device *dev,
+                                         void *state,
+                                         const struct isl_surf_fill_state_info *restrict info);
 
+static isl_surf_fill_state_func
+isl_get_surf_fill_state_func(const struct isl_device *dev)
+{
    switch (ISL_DEV_GEN(dev)) {
    case 4:
       if (ISL_DEV_IS_G4X(dev)) {
          /* G45 surface state is the same as gen5 */
-         isl_gen5_surf_fill_state_s(dev, state, info);
+         return isl_gen5_surf_fill_state_s;
       } else {
-         isl_gen4_surf_fill_state_s(dev, state, info);
+         return isl_gen4_surf_fill_state_s;
       }
-      break;
    case 5:
-      isl_gen5_surf_fill_state_s(dev, state, info);
-      break;
+      return isl_gen5_surf_fill_state_s;
    case 6:
-      isl_gen6_surf_fill_state_s(dev, state, info);
-      break;
+      return isl_gen6_surf_fill_state_s;
    case 7:
       if (ISL_DEV_IS_HASWELL(dev)) {
-         isl_gen75_surf_fill_state_s(dev, state, info);
+         return isl_gen75_surf_fill_state_s;
       } else {
-         isl_gen7_surf_fill_state_s(dev, state, info);
+         return isl_gen7_surf_fill_state_s;
       }
-      break;
    case 8:
-      isl_gen8_surf_fill_state_s(dev, state, info);
-      break;
+      return isl_gen8_surf_fill_state_s;
    case 9:
-      isl_gen9_surf_fill_state_s(dev, state, info);
-      break;
+      return isl_gen9_surf_fill_state_s;
    default:
       assert(!"Cannot fill surface state for this gen");
+      return NULL;
+   }
+}
+
+static void
+isl_surf_fill_state_validate(const struct isl_surf_fill_state_info *info,
+                             const struct isl_view *view)
+{
+#ifndef NDEBUG
+   isl_surf_usage_flags_t _base_usage =
+      view->usage & (ISL_SURF_USAGE_RENDER_TARGET_BIT |
+                     ISL_SURF_USAGE_TEXTURE_BIT |
+                     ISL_SURF_USAGE_STORAGE_BIT);
+   /* They may only specify one of the above bits at a time */
+   assert(__builtin_popcount(_base_usage) == 1);
+   /* The only other allowed bit is ISL_SURF_USAGE_CUBE_BIT */
+   assert((view->usage & ~ISL_SURF_USAGE_CUBE_BIT) == _base_usage);
+#endif
+
+   if (info->surf->dim == ISL_SURF_DIM_3D) {
+      assert(view->base_array_layer + view->array_len <=
+             info->surf->logical_level0_px.depth);
+   } else {
+      assert(view->base_array_layer + view->array_len <=
+             info->surf->logical_level0_px.array_len);
+   }
+}
+
+void
+isl_surf_fill_state_s(const struct isl_device *dev, void *state,
+                      const struct isl_surf_fill_state_info *restrict info)
+{
+   isl_surf_fill_state_func fill_state = isl_get_surf_fill_state_func(dev);
+
+   isl_surf_fill_state_validate(info, info->view);
+
+   if (fill_state)
+      fill_state(dev, state, info);
+}
+
+void
+isl_surf_fill_state_views(const struct isl_device *dev,
+                          void *const *states,
+                          const struct isl_surf_fill_state_info *info,
+                          const struct isl_view *views, uint32_t count)
+{
+   isl_surf_fill_state_func fill_state = isl_get_surf_fill_state_func(dev);
+   struct isl_surf_fill_state_info view_info = *info;
+
+   if (fill_state == NULL)
+      return;
+
+   for (uint32_t i = 0; i < count; i++) {
+      isl_surf_fill_state_validate(info, &views[i]);
+      view_info.view = &views[i];
+      fill_state(dev, states[i], &view_info);
    }
 }
 
@@ -43,6 +43,7 @@
 #include <stdint.h>
 
 #include "c99_compat.h"
+#include "c11/threads.h"
 #include "util/macros.h"
 
 #ifdef __cplusplus
@@ -1008,6 +1009,33 @@ struct isl_buffer_fill_state_info {
    uint32_t stride;
 };
 
+#define ISL_CACHE_SETS 32
+#define ISL_CACHE_WAYS 4
+
+/**
+ * Memoizes isl_surf_init() for one isl_device.
+ *
+ * The table is 4-way set-associative on a hash of the full input, so a
+ * lookup is a hash and at most four compares.  A new input evicts the least
+ * recently used entry of its set.  The cache may be shared between threads.
+ */
+struct isl_cache {
+   mtx_t mutex;
+
+   /** Incremented on every lookup, for LRU replacement */
+   uint32_t clock;
+
+   struct isl_cache_surf_entry {
+      uint32_t hash;
+      uint32_t last_use;
+      uint32_t key[16];
+      struct isl_surf surf;
+   } surfs[ISL_CACHE_SETS][ISL_CACHE_WAYS];
+
+   uint32_t hits;
+   uint32_t misses;
+};
+
 extern const struct isl_format_layout isl_format_layouts[];
 
 void
@@ -1260,6 +1288,22 @@ isl_surf_init_s(const struct isl_device *dev,
                 struct isl_surf *surf,
                 const struct isl_surf_init_info *restrict info);
 
+void
+isl_cache_init(struct isl_cache *cache);
+
+void
+isl_cache_finish(struct isl_cache *cache);
+
+#define isl_surf_init_cached(dev, cache, surf, ...) \
+   isl_surf_init_cached_s((dev), (cache), (surf), \
+                          &(struct isl_surf_init_info) {  __VA_ARGS__ });
+
+bool
+isl_surf_init_cached_s(const struct isl_device *dev,
+                       struct isl_cache *cache,
+                       struct isl_surf *surf,
+                       const struct isl_surf_init_info *restrict info);
+
 void
 isl_surf_get_tile_info(const struct isl_device *dev,
                        const struct isl_surf *surf,
@@ -1288,6 +1332,17 @@ void
 isl_surf_fill_state_s(const struct isl_device *dev, void *state,
                       const struct isl_surf_fill_state_info *restrict info);
 
+/**
+ * Fill out one surface state for each of the given views of the same
+ * surface.  The view in info is ignored and states[i] is filled with
+ * views[i].
+ */
+void
+isl_surf_fill_state_views(const struct isl_device *dev,
+                          void *const *states,
+                          const struct isl_surf_fill_state_info *info,
+                          const struct isl_view *views, uint32_t count);
+
 #define isl_buffer_fill_state(dev, state, ...) \
    isl_buffer_fill_state_s((dev), (state), \
                            &(struct isl_buffer_fill_state_info) {  __VA_ARGS__ });
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "isl.h"
+#include "isl_priv.h"
+
+/* The structs handed to ISL are built on the stack by the callers, so their
+ * padding can't be hashed or compared.  Instead, every field that affects
+ * the result is packed into a flat array of dwords.
+ *
+ * Only isl_surf_init() is worth memoizing.  Hashing the inputs of
+ * isl_surf_fill_state(), two isl_surfs and a view, costs more than packing
+ * the surface state itself.
+ */
+
+static uint32_t *
+pack_u64(uint32_t *k, uint64_t v)
+{
+   *k++ = v;
+   *k++ = v >> 32;
+   return k;
+}
+
+static uint32_t
+hash_key(const uint32_t *k, unsigned len)
+{
+   uint64_t h = 0xcbf29ce484222325ull;
+
+   for (unsigned i = 0; i < len; i++)
+      h = (h ^ k[i]) * 0x100000001b3ull;
+
+   /* Zero marks an empty entry */
+   return (h ^ (h >> 32)) | 1u << 31;
+}
+
+/* Called with the cache mutex held */
+static struct isl_cache_surf_entry *
+find_entry(struct isl_cache_surf_entry *set, uint32_t hash,
+           const uint32_t *key)
+{
+   for (unsigned i = 0; i < ISL_CACHE_WAYS; i++) {
+      if (set[i].hash == hash &&
+          memcmp(set[i].key, key, sizeof(set[i].key)) == 0)
+         return &set[i];
+   }
+
+   return NULL;
+}
+
+void
+isl_cache_init(struct isl_cache *cache)
+{
+   memset(cache, 0, sizeof(*cache));
+   mtx_init(&cache->mutex, mtx_plain);
+}
+
+void
+isl_cache_finish(struct isl_cache *cache)
+{
+   mtx_destroy(&cache->mutex);
+}
+
+bool
+isl_surf_init_cached_s(const struct isl_device *dev,
+                       struct isl_cache *cache,
+                       struct isl_surf *surf,
+                       const struct isl_surf_init_info *restrict info)
+{
+   uint32_t key[ARRAY_SIZE(cache->surfs[0][0].key)] = { 0 }, *k = key;
+
+   *k++ = info->dim;
+   *k++ = info->format;
+   *k++ = info->width;
+   *k++ = info->height;
+   *k++ = info->depth;
+   *k++ = info->levels;
+   *k++ = info->array_len;
+   *k++ = info->samples;
+   *k++ = info->min_alignment;
+   *k++ = info->min_pitch;
+   *k++ = info->tiling_flags;
+   k = pack_u64(k, info->usage);
+   assert(k <= key + ARRAY_SIZE(key));
+
+   const uint32_t hash = hash_key(key, k - key);
+   struct isl_cache_surf_entry *set = cache->surfs[hash % ISL_CACHE_SETS];
+
+   mtx_lock(&cache->mutex);
+   struct isl_cache_surf_entry *entry = find_entry(set, hash, key);
+   if (entry) {
+      entry->last_use = ++cache->clock;
+      *surf = entry->surf;
+      cache->hits++;
+      mtx_unlock(&cache->mutex);
+      return true;
+   }
+   cache->misses++;
+   mtx_unlock(&cache->mutex);
+
+   /* Failures are not cached; they only come from invalid input. */
+   if (!isl_surf_init_s(dev, surf, info))
+      return false;
+
+   mtx_lock(&cache->mutex);
+   /* Another thread may have added the same surface in the meantime */
+   if (find_entry(set, hash, key) == NULL) {
+      entry = &set[0];
+      for (unsigned i = 1; i < ISL_CACHE_WAYS; i++) {
+         if (set[i].last_use < entry->last_use)
+            entry = &set[i];
+      }
+
+      entry->hash = hash;
+      entry->last_use = ++cache->clock;
+      memcpy(entry->key, key, sizeof(key));
+      entry->surf = *surf;
+   }
+   mtx_unlock(&cache->mutex);
+
+   return true;
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Checks that isl_surf_init_cached() and isl_surf_fill_state_views()
+ * produce the same results as isl_surf_init() and isl_surf_fill_state(), and
+ * times them on a stream of textures that keeps repeating a few shapes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common/gen_device_info.h"
+#include "isl/isl.h"
+
+#define SKL_GT2_DEVID 0x1912
+
+#define NUM_SHAPES 32
+#define NUM_TEXTURES 20000
+#define NUM_VIEWS 8
+#define STATE_DWORDS 16
+
+// An asssert that works regardless of NDEBUG.
+#define t_assert(cond) \
+   do { \
+      if (!(cond)) { \
+         fprintf(stderr, "%s:%d: assertion failed\n", __FILE__, __LINE__); \
+         abort(); \
+      } \
+   } while (0)
+
+static struct isl_device dev;
+static struct isl_cache cache;
+
+static struct isl_surf_init_info
+shape_info(unsigned shape)
+{
+   static const enum isl_format formats[] = {
+      ISL_FORMAT_R8G8B8A8_UNORM,
+      ISL_FORMAT_BC1_UNORM,
+      ISL_FORMAT_R16G16B16A16_FLOAT,
+      ISL_FORMAT_R32_FLOAT,
+   };
+
+   return (struct isl_surf_init_info) {
+      .dim = ISL_SURF_DIM_2D,
+      .format = formats[shape % ARRAY_SIZE(formats)],
+      .width = 256 << (shape % 3),
+      .height = 128 << (shape / 3 % 3),
+      .depth = 1,
+      .levels = NUM_VIEWS,
+      .array_len = 1 + shape / 9,
+      .samples = 1,
+      .usage = ISL_SURF_USAGE_TEXTURE_BIT,
+      .tiling_flags = ISL_TILING_ANY_MASK,
+   };
+}
+
+static struct isl_view
+level_view(const struct isl_surf *surf, uint32_t level)
+{
+   return (struct isl_view) {
+      .usage = ISL_SURF_USAGE_TEXTURE_BIT,
+      .format = surf->format,
+      .base_level = level,
+      .levels = 1,
+      .base_array_layer = 0,
+      .array_len = surf->logical_level0_px.array_len,
+      .swizzle = ISL_SWIZZLE_IDENTITY,
+   };
+}
+
+static void
+fill_texture(unsigned shape, bool cached, bool batched,
+             uint32_t states[NUM_VIEWS][STATE_DWORDS])
+{
+   const struct isl_surf_init_info info = shape_info(shape);
+   struct isl_surf surf;
+   bool ok;
+
+   if (cached)
+      ok = isl_surf_init_cached_s(&dev, &cache, &surf, &info);
+   else
+      ok = isl_surf_init_s(&dev, &surf, &info);
+   t_assert(ok);
+
+   if (states == NULL)
+      return;
+
+   if (batched) {
+      struct isl_view views[NUM_VIEWS];
+      void *view_states[NUM_VIEWS];
+
+      for (uint32_t l = 0; l < NUM_VIEWS; l++) {
+         views[l] = level_view(&surf, l);
+         view_states[l] = states[l];
+      }
+
+      isl_surf_fill_state_views(&dev, view_states,
+                                &(struct isl_surf_fill_state_info) {
+                                   .surf = &surf,
+                                   .mocs = 2,
+                                }, views, NUM_VIEWS);
+      return;
+   }
+
+   for (uint32_t l = 0; l < NUM_VIEWS; l++) {
+      const struct isl_view view = level_view(&surf, l);
+      isl_surf_fill_state(&dev, states[l],
+                          .surf = &surf,
+                          .view = &view,
+                          .mocs = 2);
+   }
+}
+
+static double
+run(bool cached, bool fill, bool batched)
+{
+   uint32_t states[NUM_VIEWS][STATE_DWORDS];
+   struct timespec start, end;
+   uint32_t seed = 1;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+
+   for (unsigned i = 0; i < NUM_TEXTURES; i++) {
+      seed = seed * 1103515245 + 12345;
+      fill_texture((seed >> 16) % NUM_SHAPES, cached, batched,
+                   fill ? states : NULL);
+   }
+
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+static void
+check_shapes(void)
+{
+   for (unsigned shape = 0; shape < NUM_SHAPES; shape++) {
+      uint32_t expected[NUM_VIEWS][STATE_DWORDS];
+      uint32_t actual[NUM_VIEWS][STATE_DWORDS];
+
+      memset(expected, 0, sizeof(expected));
+      fill_texture(shape, false, false, expected);
+
+      /* Once to fill the cache and once to hit it */
+      for (unsigned i = 0; i < 2; i++) {
+         memset(actual, 0, sizeof(actual));
+         fill_texture(shape, true, false, actual);
+         t_assert(memcmp(expected, actual, sizeof(expected)) == 0);
+      }
+
+      memset(actual, 0, sizeof(actual));
+      fill_texture(shape, false, true, actual);
+      t_assert(memcmp(expected, actual, sizeof(expected)) == 0);
+   }
+
+   /* Different inputs must not share an entry */
+   const struct isl_surf_init_info a = shape_info(0), b = shape_info(1);
+   struct isl_surf surf_a, surf_b;
+   t_assert(isl_surf_init_cached_s(&dev, &cache, &surf_a, &a));
+   t_assert(isl_surf_init_cached_s(&dev, &cache, &surf_b, &b));
+   t_assert(surf_a.format != surf_b.format);
+}
+
+int main(void)
+{
+   struct gen_device_info devinfo;
+
+   t_assert(gen_get_device_info(SKL_GT2_DEVID, &devinfo));
+   isl_device_init(&dev, &devinfo, /*bit6_swizzle*/ false);
+   t_assert(dev.ss.size <= STATE_DWORDS * 4);
+
+   isl_cache_init(&cache);
+
+   check_shapes();
+
+   const double init = run(false, false, false);
+   const double cached_init = run(true, false, false);
+   const double plain = run(false, true, false);
+   const double cached = run(true, true, false);
+   const double batched = run(true, true, true);
+
+   /* All of the shapes fit, so each one only ever misses once */
+   t_assert(cache.misses == NUM_SHAPES);
+
+   printf("%u textures of %u views\n", NUM_TEXTURES, NUM_VIEWS);
+   printf("init: %.0f ns/texture\n", init * 1e9 / NUM_TEXTURES);
+   printf("cached init: %.0f ns/texture\n", cached_init * 1e9 / NUM_TEXTURES);
+   printf("init + fill: %.2f us/texture\n", plain * 1e6 / NUM_TEXTURES);
+   printf("cached init + fill: %.2f us/texture\n", cached * 1e6 / NUM_TEXTURES);
+   printf("cached init + fill views: %.2f us/texture\n",
+          batched * 1e6 / NUM_TEXTURES);
+   printf("%u hits, %u misses\n", cache.hits, cache.misses);
+
+   isl_cache_finish(&cache);
+
+   return 0;
+}
@@ -59,6 +59,7 @@
 static bool option_full_decode = true;
 static bool option_print_offsets = true;
 static enum { COLOR_AUTO, COLOR_ALWAYS, COLOR_NEVER } option_color;
+static int option_jobs = 1;
 
 /* state */
 
@@ -75,6 +76,11 @@ uint64_t dynamic_state_base;
 uint64_t instruction_base;
 uint64_t instruction_bound;
 
+/* False while we only replay memory writes and state base addresses so that
+ * another process can print the same range of the file.
+ */
+static bool decoding = true;
+
 static inline uint32_t
 field(uint32_t value, int start, int end)
 {
@@ -746,73 +752,84 @@ struct custom_handler {
    { _MI_LOAD_REGISTER_IMM, handle_load_register_imm }
 };
 
+static void
+print_instruction(struct gen_spec *spec, struct gen_group *inst, uint32_t *p)
+{
+   const char *color, *reset_color = NORMAL;
+   uint64_t offset;
+   unsigned int i;
+
+   if (option_full_decode) {
+      if ((p[0] & 0xffff0000) == AUB_MI_BATCH_BUFFER_START ||
+          (p[0] & 0xffff0000) == AUB_MI_BATCH_BUFFER_END)
+         color = GREEN_HEADER;
+      else
+         color = BLUE_HEADER;
+   } else
+      color = NORMAL;
+
+   if (option_color == COLOR_NEVER) {
+      color = "";
+      reset_color = "";
+   }
+
+   if (option_print_offsets)
+      offset = (void *) p - gtt;
+   else
+      offset = 0;
+
+   printf("%s0x%08"PRIx64":  0x%08x:  %-80s%s\n",
+          color, offset, p[0],
+          gen_group_get_name(inst), reset_color);
+
+   if (option_full_decode) {
+      struct gen_field_iterator iter;
+      char *token = NULL;
+      int idx = 0, dword_num = 0;
+      gen_field_iterator_init(&iter, inst, p,
+                              option_color == COLOR_ALWAYS);
+      while (gen_field_iterator_next(&iter)) {
+         idx = 0;
+         print_dword_val(&iter, offset, &dword_num);
+         if (dword_num > 0)
+             token = print_iterator_values(&iter, &idx);
+         if (token != NULL) {
+             printf("0x%08"PRIx64":  0x%08x : Dword %d\n",
+                    offset + 4 * idx, p[idx], idx);
+             handle_struct_decode(spec,token, &p[idx]);
+             token = NULL;
+         }
+      }
+
+      for (i = 0; i < ARRAY_LENGTH(custom_handlers); i++) {
+         if (gen_group_get_opcode(inst) ==
+             custom_handlers[i].opcode)
+            custom_handlers[i].handle(spec, p);
+      }
+   }
+}
+
 static void
 parse_commands(struct gen_spec *spec, uint32_t *cmds, int size, int engine)
 {
    uint32_t *p, *end = cmds + size / 4;
-   unsigned int length, i;
+   unsigned int length;
    struct gen_group *inst;
 
    for (p = cmds; p < end; p += length) {
       inst = gen_spec_find_instruction(spec, p);
       if (inst == NULL) {
-         printf("unknown instruction %08x\n", p[0]);
+         if (decoding)
+            printf("unknown instruction %08x\n", p[0]);
          length = (p[0] & 0xff) + 2;
          continue;
       }
       length = gen_group_get_length(inst, p);
 
-      const char *color, *reset_color = NORMAL;
-      uint64_t offset;
-
-      if (option_full_decode) {
-         if ((p[0] & 0xffff0000) == AUB_MI_BATCH_BUFFER_START ||
-             (p[0] & 0xffff0000) == AUB_MI_BATCH_BUFFER_END)
-            color = GREEN_HEADER;
-         else
-            color = BLUE_HEADER;
-      } else
-         color = NORMAL;
-
-      if (option_color == COLOR_NEVER) {
-         color = "";
-         reset_color = "";
-      }
-
-      if (option_print_offsets)
-         offset = (void *) p - gtt;
-      else
-         offset = 0;
-
-      printf("%s0x%08"PRIx64":  0x%08x:  %-80s%s\n",
-             color, offset, p[0],
-             gen_group_get_name(inst), reset_color);
-
-      if (option_full_decode) {
-         struct gen_field_iterator iter;
-         char *token = NULL;
-         int idx = 0, dword_num = 0;
-         gen_field_iterator_init(&iter, inst, p,
-                                 option_color == COLOR_ALWAYS);
-         while (gen_field_iterator_next(&iter)) {
-            idx = 0;
-            print_dword_val(&iter, offset, &dword_num);
-            if (dword_num > 0)
-                token = print_iterator_values(&iter, &idx);
-            if (token != NULL) {
-                printf("0x%08"PRIx64":  0x%08x : Dword %d\n",
-                       offset + 4 * idx, p[idx], idx);
-                handle_struct_decode(spec,token, &p[idx]);
-                token = NULL;
-            }
-         }
-
-         for (i = 0; i < ARRAY_LENGTH(custom_handlers); i++) {
-            if (gen_group_get_opcode(inst) ==
-                custom_handlers[i].opcode)
-               custom_handlers[i].handle(spec, p);
-         }
-      }
+      if (decoding)
+         print_instruction(spec, inst, p);
+      else if (gen_group_get_opcode(inst) == STATE_BASE_ADDRESS)
+         handle_state_base_address(spec, p);
 
       if ((p[0] & 0xffff0000) == AUB_MI_BATCH_BUFFER_START) {
          uint64_t start = get_address(spec, &p[1]);
@@ -881,7 +898,8 @@ handle_trace_block(uint32_t *p)
          engine = GEN_ENGINE_BLITTER;
          break;
       default:
-         printf("command write to unknown ring %d\n", type);
+         if (decoding)
+            printf("command write to unknown ring %d\n", type);
          break;
       }
 
@@ -1079,6 +1097,15 @@ aub_file_decode_batch(struct aub_file *file)
    if (new_cursor > file->end)
       return AUB_ITEM_DECODE_NEED_MORE_DATA;
 
+   /* Trace blocks carry the memory writes later batches depend on, all the
+    * other blocks are only printed.
+    */
+   if (!decoding &&
+       (h & 0xffff0000) != MAKE_HEADER(TYPE_AUB, OPCODE_AUB, SUBOPCODE_BLOCK)) {
+      file->cursor = new_cursor;
+      return AUB_ITEM_DECODE_OK;
+   }
+
    switch (h & 0xffff0000) {
    case MAKE_HEADER(TYPE_AUB, OPCODE_AUB, SUBOPCODE_HEADER):
       handle_trace_header(p);
@@ -1124,7 +1151,7 @@ aub_file_more_stuff(struct aub_file *file)
    return file->cursor < file->end || (file->stream && !feof(file->stream));
 }
 
-#define AUB_READ_BUFFER_SIZE (4096)
+#define AUB_READ_BUFFER_SIZE (1 << 20)
 #define MAX(a, b) ((a) < (b) ? (b) : (a))
 
 static void
@@ -1166,6 +1193,154 @@ aub_file_data_load(struct aub_file *file)
    return r != 0;
 }
 
+/* Returns the end of the run of blocks starting at the cursor that adds up to
+ * at least AUB_CHUNK_SIZE bytes, looking only at the block headers.
+ */
+#define AUB_CHUNK_SIZE (64 << 20)
+
+static uint32_t *
+aub_file_next_chunk(struct aub_file *file)
+{
+   uint32_t *p = file->cursor;
+
+   while (p < file->end && (p - file->cursor) * 4 < AUB_CHUNK_SIZE) {
+      uint32_t h = *p;
+      uint32_t *next;
+
+      switch (OPCODE(h)) {
+      case OPCODE_AUB:
+         next = p + (h & 0xffff) + 2;
+         break;
+      case OPCODE_NEW_AUB:
+         next = p + (h & 0xffff) + 1;
+         break;
+      default:
+         /* Let aub_file_decode_batch() report it. */
+         return file->end;
+      }
+
+      if ((h & 0xffff0000) == MAKE_HEADER(TYPE_AUB, OPCODE_AUB, SUBOPCODE_BLOCK)) {
+         if (file->end - p < 5)
+            return file->end;
+         next += p[4] / 4;
+      }
+
+      if (next >= file->end)
+         return file->end;
+
+      p = next;
+   }
+
+   return p;
+}
+
+static void
+aub_file_decode_range(struct aub_file *file, uint32_t *end)
+{
+   uint32_t *file_end = file->end;
+
+   file->end = end;
+   while (file->cursor < file->end) {
+      switch (aub_file_decode_batch(file)) {
+      case AUB_ITEM_DECODE_OK:
+         break;
+      case AUB_ITEM_DECODE_NEED_MORE_DATA:
+         file->cursor = file->end;
+         break;
+      default:
+         fprintf(stderr, "failed to parse aubdump data\n");
+         exit(EXIT_FAILURE);
+      }
+   }
+   file->end = file_end;
+}
+
+struct aub_job {
+   pid_t pid;
+   FILE *output;
+};
+
+static void
+aub_job_finish(struct aub_job *job)
+{
+   char buf[4096];
+   size_t r;
+   int status;
+
+   if (job->pid == 0)
+      return;
+
+   if (waitpid(job->pid, &status, 0) == -1) {
+      fprintf(stderr, "waitpid failed: %s\n", strerror(errno));
+      exit(EXIT_FAILURE);
+   }
+
+   rewind(job->output);
+   while ((r = fread(buf, 1, sizeof(buf), job->output)) > 0)
+      fwrite(buf, 1, r, stdout);
+   fclose(job->output);
+   job->pid = 0;
+
+   if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+      exit(EXIT_FAILURE);
+}
+
+/* Batches only depend on the memory writes and state base addresses that
+ * precede them, so the file is split into chunks which are printed by
+ * forked processes.  Each child starts from a copy-on-write snapshot of the
+ * GTT while we only replay the memory writes of the chunk to get to the
+ * start of the next one.  The output of the children is buffered in
+ * temporary files and copied out in file order.
+ */
+static void
+aub_file_decode_parallel(struct aub_file *file)
+{
+   struct aub_job *jobs = calloc(option_jobs, sizeof(*jobs));
+   unsigned int next = 0, i;
+
+   if (jobs == NULL) {
+      fprintf(stderr, "failed to allocate memory\n");
+      exit(EXIT_FAILURE);
+   }
+
+   while (file->cursor < file->end) {
+      uint32_t *end = aub_file_next_chunk(file);
+      struct aub_job *job = &jobs[next++ % option_jobs];
+
+      aub_job_finish(job);
+
+      job->output = tmpfile();
+      if (job->output == NULL) {
+         fprintf(stderr, "failed to create temporary file: %s\n",
+                 strerror(errno));
+         exit(EXIT_FAILURE);
+      }
+
+      fflush(stdout);
+      job->pid = fork();
+      if (job->pid == -1) {
+         fprintf(stderr, "fork failed: %s\n", strerror(errno));
+         exit(EXIT_FAILURE);
+      }
+
+      if (job->pid == 0) {
+         dup2(fileno(job->output), 1);
+         aub_file_decode_range(file, end);
+         fflush(stdout);
+         _exit(EXIT_SUCCESS);
+      }
+
+      decoding = false;
+      aub_file_decode_range(file, end);
+      decoding = true;
+   }
+
+   for (i = 0; i < option_jobs; i++)
+      aub_job_finish(&jobs[(next + i) % option_jobs]);
+
+   free(jobs);
+}
+
 static void
 setup_pager(void)
 {
@@ -1207,6 +1382,7 @@ print_help(const char *progname, FILE *file)
            "                        if omitted), 'always', or 'never'\n"
            "      --no-pager      don't launch pager\n"
            "      --no-offsets    don't print instruction offsets\n"
+           "      --jobs=N        decode FILE using N processes\n"
            "      --xml=DIR       load hardware xml description from directory DIR\n",
            progname);
 }
@@ -1237,6 +1413,7 @@ int main(int argc, char *argv[])
       { "headers",    no_argument,       (int *) &option_full_decode,   false },
       { "color",      required_argument, NULL,                          'c' },
       { "xml",        required_argument, NULL,                          'x' },
+      { "jobs",       required_argument, NULL,                          'j' },
       { NULL,         0,                 NULL,                          0 }
    };
 
@@ -1271,6 +1448,13 @@ int main(int argc, char *argv[])
       case 'x':
          xml_path = strdup(optarg);
          break;
+      case 'j':
+         option_jobs = atoi(optarg);
+         if (option_jobs < 1) {
+            fprintf(stderr, "invalid value for --jobs: %s\n", optarg);
+            exit(EXIT_FAILURE);
+         }
+         break;
       default:
          break;
       }
@@ -1306,6 +1490,14 @@ int main(int argc, char *argv[])
    }
 
    while (aub_file_more_stuff(file)) {
+      /* Once the header has given us the spec, hand the rest of a mapped
+       * file over to the worker processes.
+       */
+      if (option_jobs > 1 && spec != NULL && file->stream == NULL) {
+         aub_file_decode_parallel(file);
+         break;
+      }
+
       switch (aub_file_decode_batch(file)) {
       case AUB_ITEM_DECODE_OK:
          break;
@@ -30,6 +30,7 @@
 #include <inttypes.h>
 
 #include <util/macros.h>
+#include <util/hash_table.h>
 
 #include "decoder.h"
 
@@ -54,6 +55,15 @@ struct gen_spec {
    struct gen_group *registers[256];
    int nenums;
    struct gen_enum *enums[256];
+
+   /* Lookup tables built once the spec is loaded.  The opcode of every
+    * instruction lives in the upper 16 bits of its header, so indexing
+    * commands by those bits gives the same answer as walking the list.
+    * Each entry is an index into commands[] plus one, zero for none.
+    */
+   uint16_t commands_by_header[1 << 16];
+   struct gen_group *registers_by_offset[256];
+   struct hash_table *structs_by_name;
 };
 
 struct location {
@@ -94,19 +104,28 @@ gen_group_get_opcode(struct gen_group *group)
 struct gen_group *
 gen_spec_find_struct(struct gen_spec *spec, const char *name)
 {
-   for (int i = 0; i < spec->nstructs; i++)
-      if (strcmp(spec->structs[i]->name, name) == 0)
-         return spec->structs[i];
+   struct hash_entry *entry =
+      _mesa_hash_table_search(spec->structs_by_name, name);
 
-   return NULL;
+   return entry ? entry->data : NULL;
 }
 
 struct gen_group *
 gen_spec_find_register(struct gen_spec *spec, uint32_t offset)
 {
-   for (int i = 0; i < spec->nregisters; i++)
-      if (spec->registers[i]->register_offset == offset)
-         return spec->registers[i];
+   int lo = 0, hi = spec->nregisters;
+
+   while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      struct gen_group *reg = spec->registers_by_offset[mid];
+
+      if (reg->register_offset == offset)
+         return reg;
+      else if (reg->register_offset < offset)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
 
    return NULL;
 }
@@ -436,9 +455,11 @@ end_element(void *data, const char *name)
 
       if (strcmp(name, "instruction") == 0)
          spec->commands[spec->ncommands++] = group;
-      else if (strcmp(name, "struct") == 0)
+      else if (strcmp(name, "struct") == 0) {
          spec->structs[spec->nstructs++] = group;
-      else if (strcmp(name, "register") == 0)
+         if (!_mesa_hash_table_search(spec->structs_by_name, group->name))
+            _mesa_hash_table_insert(spec->structs_by_name, group->name, group);
+      } else if (strcmp(name, "register") == 0)
          spec->registers[spec->nregisters++] = group;
    } else if (strcmp(name, "group") == 0) {
       ctx->group->group_offset = 0;
@@ -508,6 +529,54 @@ devinfo_to_xml_data(const struct gen_device_info *devinfo,
    return NULL;
 }
 
+static struct gen_spec *
+gen_spec_create(void)
+{
+   struct gen_spec *spec = xzalloc(sizeof(*spec));
+
+   spec->structs_by_name =
+      fail_on_null(_mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                           _mesa_key_string_equal));
+
+   return spec;
+}
+
+static int
+compare_register_offset(const void *a, const void *b)
+{
+   const struct gen_group *ra = *(struct gen_group * const *) a;
+   const struct gen_group *rb = *(struct gen_group * const *) b;
+
+   return ra->register_offset < rb->register_offset ? -1 :
+          ra->register_offset > rb->register_offset;
+}
+
+static void
+gen_spec_build_tables(struct gen_spec *spec)
+{
+   /* Walk the commands backwards so that when several of them match the
+    * same header, the first one in the spec wins, as it did with the linear
+    * search.  For each command, enumerate every header whose opcode bits
+    * match by counting through the bits outside the opcode mask.
+    */
+   for (int i = spec->ncommands - 1; i >= 0; i--) {
+      const uint32_t mask = spec->commands[i]->opcode_mask >> 16;
+      const uint32_t opcode = spec->commands[i]->opcode >> 16;
+      const uint32_t free_bits = ~mask & 0xffff;
+      uint32_t bits = 0;
+
+      do {
+         spec->commands_by_header[opcode | bits] = i + 1;
+         bits = (bits - free_bits) & free_bits;
+      } while (bits != 0);
+   }
+
+   memcpy(spec->registers_by_offset, spec->registers,
+          spec->nregisters * sizeof(spec->registers[0]));
+   qsort(spec->registers_by_offset, spec->nregisters,
+         sizeof(spec->registers_by_offset[0]), compare_register_offset);
+}
+
 struct gen_spec *
 gen_spec_load(const struct gen_device_info *devinfo)
 {
@@ -527,7 +596,7 @@ gen_spec_load(const struct gen_device_info *devinfo)
    XML_SetElementHandler(ctx.parser, start_element, end_element);
    XML_SetCharacterDataHandler(ctx.parser, character_data);
 
-   ctx.spec = xzalloc(sizeof(*ctx.spec));
+   ctx.spec = gen_spec_create();
 
    data = devinfo_to_xml_data(devinfo, &data_length);
    buf = XML_GetBuffer(ctx.parser, data_length);
@@ -545,6 +614,7 @@ gen_spec_load(const struct gen_device_info *devinfo)
    }
 
    XML_ParserFree(ctx.parser);
+   gen_spec_build_tables(ctx.spec);
 
    return ctx.spec;
 }
@@ -583,7 +653,7 @@ gen_spec_load_from_path(const struct gen_device_info *devinfo,
    XML_SetElementHandler(ctx.parser, start_element, end_element);
    XML_SetCharacterDataHandler(ctx.parser, character_data);
    ctx.loc.filename = filename;
-   ctx.spec = xzalloc(sizeof(*ctx.spec));
+   ctx.spec = gen_spec_create();
 
    do {
       buf = XML_GetBuffer(ctx.parser, XML_BUFFER_SIZE);
@@ -607,6 +677,7 @@ gen_spec_load_from_path(const struct gen_device_info *devinfo,
    } while (len > 0);
 
    XML_ParserFree(ctx.parser);
+   gen_spec_build_tables(ctx.spec);
 
    fclose(input);
    free(filename);
@@ -617,13 +688,9 @@ gen_spec_load_from_path(const struct gen_device_info *devinfo,
 struct gen_group *
 gen_spec_find_instruction(struct gen_spec *spec, const uint32_t *p)
 {
-   for (int i = 0; i < spec->ncommands; i++) {
-      uint32_t opcode = *p & spec->commands[i]->opcode_mask;
-      if (opcode == spec->commands[i]->opcode)
-         return spec->commands[i];
-   }
+   uint16_t index = spec->commands_by_header[p[0] >> 16];
 
-   return NULL;
+   return index ? spec->commands[index - 1] : NULL;
 }
 
 int
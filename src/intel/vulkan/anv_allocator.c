@@ -589,8 +589,10 @@ static void
 anv_fixed_size_state_pool_init(struct anv_fixed_size_state_pool *pool,
                                size_t state_size)
 {
-   /* At least a cache line and must divide the block size. */
-   assert(state_size >= 64 && util_is_power_of_two(state_size));
+   /* At least a cache line.  Sizes that don't divide the block size leave
+    * some unused space at the end of each block.
+    */
+   assert(state_size >= 64 && state_size % 64 == 0);
 
    pool->state_size = state_size;
    pool->free_list = ANV_FREE_LIST_EMPTY;
@@ -621,7 +623,9 @@ anv_fixed_size_state_pool_alloc(struct anv_fixed_size_state_pool *pool,
    } else if (block.next == block.end) {
       offset = anv_block_pool_alloc(block_pool);
       new.next = offset + pool->state_size;
-      new.end = offset + block_pool->block_size;
+      /* Stop at the last state that fits entirely in the block */
+      new.end = offset + block_pool->block_size -
+                block_pool->block_size % pool->state_size;
       old.u64 = __sync_lock_test_and_set(&pool->block.u64, new.u64);
       if (old.next != block.next)
          futex_wake(&pool->block.end, INT_MAX);
@@ -640,14 +644,47 @@ anv_fixed_size_state_pool_free(struct anv_fixed_size_state_pool *pool,
    anv_free_list_push(&pool->free_list, block_pool->map, offset);
 }
 
+/* Returns the bucket of the smallest size class that holds size bytes */
+static unsigned
+anv_state_pool_get_bucket(uint32_t size)
+{
+   if (size <= (1 << ANV_STATE_SMALL_CLASSES_LOG2))
+      return MAX2(DIV_ROUND_UP(size, 1 << ANV_MIN_STATE_SIZE_LOG2), 1) - 1;
+
+   const unsigned base_log2 = ilog2_round_up(size) - 1;
+   const unsigned step_log2 = base_log2 - ANV_STATE_CLASSES_PER_POW2_LOG2;
+   const unsigned class = DIV_ROUND_UP(size - (1 << base_log2),
+                                       1 << step_log2);
+
+   return ANV_STATE_SMALL_CLASSES - 1 + class +
+          ((base_log2 - ANV_STATE_SMALL_CLASSES_LOG2) <<
+           ANV_STATE_CLASSES_PER_POW2_LOG2);
+}
+
+static uint32_t
+anv_state_pool_bucket_size(unsigned bucket)
+{
+   if (bucket < ANV_STATE_SMALL_CLASSES)
+      return (bucket + 1) << ANV_MIN_STATE_SIZE_LOG2;
+
+   bucket -= ANV_STATE_SMALL_CLASSES;
+   const unsigned base_log2 = ANV_STATE_SMALL_CLASSES_LOG2 +
+                              (bucket >> ANV_STATE_CLASSES_PER_POW2_LOG2);
+   const unsigned step_log2 = base_log2 - ANV_STATE_CLASSES_PER_POW2_LOG2;
+   const unsigned class =
+      (bucket & ((1 << ANV_STATE_CLASSES_PER_POW2_LOG2) - 1)) + 1;
+
+   return (1 << base_log2) + (class << step_log2);
+}
+
 void
 anv_state_pool_init(struct anv_state_pool *pool,
                     struct anv_block_pool *block_pool)
 {
    pool->block_pool = block_pool;
    for (unsigned i = 0; i < ANV_STATE_BUCKETS; i++) {
-      size_t size = 1 << (ANV_MIN_STATE_SIZE_LOG2 + i);
-      anv_fixed_size_state_pool_init(&pool->buckets[i], size);
+      anv_fixed_size_state_pool_init(&pool->buckets[i],
+                                     anv_state_pool_bucket_size(i));
    }
    VG(VALGRIND_CREATE_MEMPOOL(pool, 0, false));
 }
@@ -661,14 +698,21 @@ anv_state_pool_finish(struct anv_state_pool *pool)
 struct anv_state
 anv_state_pool_alloc(struct anv_state_pool *pool, size_t size, size_t align)
 {
-   unsigned size_log2 = ilog2_round_up(size < align ? align : size);
-   assert(size_log2 <= ANV_MAX_STATE_SIZE_LOG2);
-   if (size_log2 < ANV_MIN_STATE_SIZE_LOG2)
-      size_log2 = ANV_MIN_STATE_SIZE_LOG2;
-   unsigned bucket = size_log2 - ANV_MIN_STATE_SIZE_LOG2;
+   assert(util_is_power_of_two(align));
+   assert(MAX2(size, align) <= (1 << ANV_MAX_STATE_SIZE_LOG2));
+   unsigned bucket = anv_state_pool_get_bucket(MAX2(size, align));
+   uint32_t alloc_size = anv_state_pool_bucket_size(bucket);
+
+   /* States are only aligned to the largest power of two dividing their
+    * size.  Fall back to a power-of-two class for larger alignments.
+    */
+   if ((alloc_size & -alloc_size) < align) {
+      bucket = anv_state_pool_get_bucket(round_to_power_of_two(alloc_size));
+      alloc_size = anv_state_pool_bucket_size(bucket);
+   }
 
    struct anv_state state;
-   state.alloc_size = 1 << size_log2;
+   state.alloc_size = alloc_size;
    state.offset = anv_fixed_size_state_pool_alloc(&pool->buckets[bucket],
                                                   pool->block_pool);
    state.map = pool->block_pool->map + state.offset;
@@ -679,11 +723,10 @@ anv_state_pool_alloc(struct anv_state_pool *pool, size_t size, size_t align)
 void
 anv_state_pool_free(struct anv_state_pool *pool, struct anv_state state)
 {
-   assert(util_is_power_of_two(state.alloc_size));
-   unsigned size_log2 = ilog2_round_up(state.alloc_size);
-   assert(size_log2 >= ANV_MIN_STATE_SIZE_LOG2 &&
-          size_log2 <= ANV_MAX_STATE_SIZE_LOG2);
-   unsigned bucket = size_log2 - ANV_MIN_STATE_SIZE_LOG2;
+   assert(state.alloc_size >= (1 << ANV_MIN_STATE_SIZE_LOG2) &&
+          state.alloc_size <= (1 << ANV_MAX_STATE_SIZE_LOG2));
+   unsigned bucket = anv_state_pool_get_bucket(state.alloc_size);
+   assert(anv_state_pool_bucket_size(bucket) == state.alloc_size);
 
    VG(VALGRIND_MEMPOOL_FREE(pool, state.map));
    anv_fixed_size_state_pool_free(&pool->buckets[bucket],
@@ -46,18 +46,12 @@
  * Functions related to anv_reloc_list
  *-----------------------------------------------------------------------*/
 
-static VkResult
-anv_reloc_list_init_clone(struct anv_reloc_list *list,
-                          const VkAllocationCallbacks *alloc,
-                          const struct anv_reloc_list *other_list)
+VkResult
+anv_reloc_list_init(struct anv_reloc_list *list,
+                    const VkAllocationCallbacks *alloc)
 {
-   if (other_list) {
-      list->num_relocs = other_list->num_relocs;
-      list->array_length = other_list->array_length;
-   } else {
-      list->num_relocs = 0;
-      list->array_length = 256;
-   }
+   list->num_relocs = 0;
+   list->array_length = 256;
 
    list->relocs =
       vk_alloc(alloc, list->array_length * sizeof(*list->relocs), 8,
@@ -75,23 +69,9 @@ anv_reloc_list_init_clone(struct anv_reloc_list *list,
       return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
    }
 
-   if (other_list) {
-      memcpy(list->relocs, other_list->relocs,
-             list->array_length * sizeof(*list->relocs));
-      memcpy(list->reloc_bos, other_list->reloc_bos,
-             list->array_length * sizeof(*list->reloc_bos));
-   }
-
    return VK_SUCCESS;
 }
 
-VkResult
-anv_reloc_list_init(struct anv_reloc_list *list,
-                    const VkAllocationCallbacks *alloc)
-{
-   return anv_reloc_list_init_clone(list, alloc, NULL);
-}
-
 void
 anv_reloc_list_finish(struct anv_reloc_list *list,
                       const VkAllocationCallbacks *alloc)
@@ -241,26 +221,92 @@ anv_batch_emit_batch(struct anv_batch *batch, struct anv_batch *other)
  * Functions related to anv_batch_bo
  *-----------------------------------------------------------------------*/
 
+static void
+anv_batch_bo_destroy(struct anv_batch_bo *bbo,
+                     struct anv_device *device,
+                     struct anv_cmd_pool *pool)
+{
+   anv_reloc_list_finish(&bbo->relocs, &pool->alloc);
+   anv_bo_pool_free(&device->batch_bo_pool, &bbo->bo);
+   vk_free(&pool->alloc, bbo);
+}
+
+/* Returns a batch BO to the command pool's cache, or destroys it if the
+ * cache is full.
+ */
+static void
+anv_batch_bo_release(struct anv_batch_bo *bbo,
+                     struct anv_cmd_buffer *cmd_buffer)
+{
+   struct anv_cmd_pool *pool = cmd_buffer->pool;
+
+   if (pool->free_batch_bo_size + bbo->bo.size >
+       ANV_CMD_POOL_MAX_FREE_BATCH_SIZE) {
+      anv_batch_bo_destroy(bbo, cmd_buffer->device, pool);
+      return;
+   }
+
+   list_add(&bbo->link, &pool->free_batch_bos);
+   pool->free_batch_bo_size += bbo->bo.size;
+}
+
+void
+anv_cmd_pool_free_batch_bos(struct anv_device *device,
+                            struct anv_cmd_pool *pool)
+{
+   list_for_each_entry_safe(struct anv_batch_bo, bbo,
+                            &pool->free_batch_bos, link) {
+      list_del(&bbo->link);
+      anv_batch_bo_destroy(bbo, device, pool);
+   }
+   pool->free_batch_bo_size = 0;
+}
+
+/* Takes the smallest cached batch BO of at least size bytes from the
+ * command pool, or allocates a new one.
+ */
 static VkResult
-anv_batch_bo_create(struct anv_cmd_buffer *cmd_buffer,
+anv_batch_bo_create(struct anv_cmd_buffer *cmd_buffer, uint32_t size,
                     struct anv_batch_bo **bbo_out)
 {
+   struct anv_cmd_pool *pool = cmd_buffer->pool;
+   struct anv_batch_bo *best = NULL;
    VkResult result;
 
-   struct anv_batch_bo *bbo = vk_alloc(&cmd_buffer->pool->alloc, sizeof(*bbo),
+   list_for_each_entry(struct anv_batch_bo, bbo, &pool->free_batch_bos, link) {
+      if (bbo->bo.size >= size && (!best || bbo->bo.size < best->bo.size))
+         best = bbo;
+   }
+
+   if (best) {
+      list_del(&best->link);
+      pool->free_batch_bo_size -= best->bo.size;
+      pool->stats.recycled++;
+
+      best->length = 0;
+      best->relocs.num_relocs = 0;
+      *bbo_out = best;
+
+      return VK_SUCCESS;
+   }
+
+   struct anv_batch_bo *bbo = vk_alloc(&pool->alloc, sizeof(*bbo),
                                         8, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
    if (bbo == NULL)
       return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
 
    result = anv_bo_pool_alloc(&cmd_buffer->device->batch_bo_pool, &bbo->bo,
-                              ANV_CMD_BUFFER_BATCH_SIZE);
+                              size);
    if (result != VK_SUCCESS)
       goto fail_alloc;
 
-   result = anv_reloc_list_init(&bbo->relocs, &cmd_buffer->pool->alloc);
+   result = anv_reloc_list_init(&bbo->relocs, &pool->alloc);
    if (result != VK_SUCCESS)
       goto fail_bo_alloc;
 
+   bbo->length = 0;
+   pool->stats.allocated++;
+
    *bbo_out = bbo;
 
    return VK_SUCCESS;
@@ -268,7 +314,7 @@ anv_batch_bo_create(struct anv_cmd_buffer *cmd_buffer,
  fail_bo_alloc:
    anv_bo_pool_free(&cmd_buffer->device->batch_bo_pool, &bbo->bo);
  fail_alloc:
-   vk_free(&cmd_buffer->pool->alloc, bbo);
+   vk_free(&pool->alloc, bbo);
 
    return result;
 }
@@ -278,22 +324,25 @@ anv_batch_bo_clone(struct anv_cmd_buffer *cmd_buffer,
                    const struct anv_batch_bo *other_bbo,
                    struct anv_batch_bo **bbo_out)
 {
+   struct anv_batch_bo *bbo;
    VkResult result;
 
-   struct anv_batch_bo *bbo = vk_alloc(&cmd_buffer->pool->alloc, sizeof(*bbo),
-                                        8, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
-   if (bbo == NULL)
-      return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
-
-   result = anv_bo_pool_alloc(&cmd_buffer->device->batch_bo_pool, &bbo->bo,
-                              other_bbo->bo.size);
+   result = anv_batch_bo_create(cmd_buffer, other_bbo->bo.size, &bbo);
    if (result != VK_SUCCESS)
-      goto fail_alloc;
+      return result;
 
-   result = anv_reloc_list_init_clone(&bbo->relocs, &cmd_buffer->pool->alloc,
-                                      &other_bbo->relocs);
-   if (result != VK_SUCCESS)
-      goto fail_bo_alloc;
+   result = anv_reloc_list_grow(&bbo->relocs, &cmd_buffer->pool->alloc,
+                                other_bbo->relocs.num_relocs);
+   if (result != VK_SUCCESS) {
+      anv_batch_bo_destroy(bbo, cmd_buffer->device, cmd_buffer->pool);
+      return result;
+   }
+
+   bbo->relocs.num_relocs = other_bbo->relocs.num_relocs;
+   memcpy(bbo->relocs.relocs, other_bbo->relocs.relocs,
+          other_bbo->relocs.num_relocs * sizeof(*bbo->relocs.relocs));
+   memcpy(bbo->relocs.reloc_bos, other_bbo->relocs.reloc_bos,
+          other_bbo->relocs.num_relocs * sizeof(*bbo->relocs.reloc_bos));
 
    bbo->length = other_bbo->length;
    memcpy(bbo->bo.map, other_bbo->bo.map, other_bbo->length);
@@ -301,13 +350,6 @@ anv_batch_bo_clone(struct anv_cmd_buffer *cmd_buffer,
    *bbo_out = bbo;
 
    return VK_SUCCESS;
-
- fail_bo_alloc:
-   anv_bo_pool_free(&cmd_buffer->device->batch_bo_pool, &bbo->bo);
- fail_alloc:
-   vk_free(&cmd_buffer->pool->alloc, bbo);
-
-   return result;
 }
 
 static void
@@ -369,15 +411,6 @@ anv_batch_bo_grow(struct anv_cmd_buffer *cmd_buffer, struct anv_batch_bo *bbo,
    return VK_SUCCESS;
 }
 
-static void
-anv_batch_bo_destroy(struct anv_batch_bo *bbo,
-                     struct anv_cmd_buffer *cmd_buffer)
-{
-   anv_reloc_list_finish(&bbo->relocs, &cmd_buffer->pool->alloc);
-   anv_bo_pool_free(&cmd_buffer->device->batch_bo_pool, &bbo->bo);
-   vk_free(&cmd_buffer->pool->alloc, bbo);
-}
-
 static VkResult
 anv_batch_bo_list_clone(const struct list_head *list,
                         struct anv_cmd_buffer *cmd_buffer,
@@ -411,7 +444,7 @@ anv_batch_bo_list_clone(const struct list_head *list,
 
    if (result != VK_SUCCESS) {
       list_for_each_entry_safe(struct anv_batch_bo, bbo, new_list, link)
-         anv_batch_bo_destroy(bbo, cmd_buffer);
+         anv_batch_bo_release(bbo, cmd_buffer);
    }
 
    return result;
@@ -489,18 +522,27 @@ static VkResult
 anv_cmd_buffer_chain_batch(struct anv_batch *batch, void *_data)
 {
    struct anv_cmd_buffer *cmd_buffer = _data;
+   struct anv_batch_bo *current_bbo =
+      anv_cmd_buffer_current_batch_bo(cmd_buffer);
    struct anv_batch_bo *new_bbo;
 
-   VkResult result = anv_batch_bo_create(cmd_buffer, &new_bbo);
+   /* Grow the chain geometrically so that large command buffers don't
+    * chain through many small batches.
+    */
+   const uint32_t size = MIN2(current_bbo->bo.size * 2,
+                              ANV_CMD_BUFFER_MAX_BATCH_SIZE);
+
+   VkResult result = anv_batch_bo_create(cmd_buffer, size, &new_bbo);
    if (result != VK_SUCCESS)
       return result;
 
    struct anv_batch_bo **seen_bbo = u_vector_add(&cmd_buffer->seen_bbos);
    if (seen_bbo == NULL) {
-      anv_batch_bo_destroy(new_bbo, cmd_buffer);
+      anv_batch_bo_release(new_bbo, cmd_buffer);
       return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
    }
    *seen_bbo = new_bbo;
+   cmd_buffer->pool->stats.chained++;
 
    cmd_buffer_chain_to_batch_bo(cmd_buffer, new_bbo);
 
@@ -659,7 +701,8 @@ anv_cmd_buffer_init_batch_bo_chain(struct anv_cmd_buffer *cmd_buffer)
 
    list_inithead(&cmd_buffer->batch_bos);
 
-   result = anv_batch_bo_create(cmd_buffer, &batch_bo);
+   result = anv_batch_bo_create(cmd_buffer, ANV_CMD_BUFFER_BATCH_SIZE,
+                                &batch_bo);
    if (result != VK_SUCCESS)
       return result;
 
@@ -705,7 +748,7 @@ anv_cmd_buffer_init_batch_bo_chain(struct anv_cmd_buffer *cmd_buffer)
  fail_seen_bbos:
    u_vector_finish(&cmd_buffer->seen_bbos);
  fail_batch_bo:
-   anv_batch_bo_destroy(batch_bo, cmd_buffer);
+   anv_batch_bo_release(batch_bo, cmd_buffer);
 
    return result;
 }
@@ -724,22 +767,22 @@ anv_cmd_buffer_fini_batch_bo_chain(struct anv_cmd_buffer *cmd_buffer)
 
    u_vector_finish(&cmd_buffer->seen_bbos);
 
-   /* Destroy all of the batch buffers */
+   /* Return all of the batch buffers to the pool */
    list_for_each_entry_safe(struct anv_batch_bo, bbo,
                             &cmd_buffer->batch_bos, link) {
-      anv_batch_bo_destroy(bbo, cmd_buffer);
+      anv_batch_bo_release(bbo, cmd_buffer);
    }
 }
 
 void
 anv_cmd_buffer_reset_batch_bo_chain(struct anv_cmd_buffer *cmd_buffer)
 {
-   /* Delete all but the first batch bo */
+   /* Return all but the first batch bo to the pool */
    assert(!list_empty(&cmd_buffer->batch_bos));
    while (cmd_buffer->batch_bos.next != cmd_buffer->batch_bos.prev) {
       struct anv_batch_bo *bbo = anv_cmd_buffer_current_batch_bo(cmd_buffer);
       list_del(&bbo->link);
-      anv_batch_bo_destroy(bbo, cmd_buffer);
+      anv_batch_bo_release(bbo, cmd_buffer);
    }
    assert(!list_empty(&cmd_buffer->batch_bos));
 
@@ -791,6 +834,7 @@ anv_cmd_buffer_end_batch_buffer(struct anv_cmd_buffer *cmd_buffer)
    }
 
    anv_batch_bo_finish(batch_bo, &cmd_buffer->batch);
+   cmd_buffer->pool->stats.recorded++;
 
    if (cmd_buffer->level == VK_COMMAND_BUFFER_LEVEL_SECONDARY) {
       /* If this is a secondary command buffer, we need to determine the
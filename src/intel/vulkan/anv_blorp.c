@@ -81,6 +81,16 @@ upload_blorp_shader(struct blorp_context *blorp,
    *(const struct brw_stage_prog_data **)prog_data_out = bin->prog_data;
 }
 
+static void *
+anv_blorp_precompile_thread(void *data)
+{
+   struct anv_device *device = data;
+
+   blorp_precompile_shaders(&device->blorp);
+
+   return NULL;
+}
+
 void
 anv_device_init_blorp(struct anv_device *device)
 {
@@ -109,11 +119,26 @@ anv_device_init_blorp(struct anv_device *device)
    default:
       unreachable("Unknown hardware generation");
    }
+
+   /* Get the common clear and copy kernels into the cache on the side, so
+    * the first one recorded doesn't wait on the compiler.  A command buffer
+    * racing with this just compiles the kernel itself.  This is only worth
+    * it when the kernels end up on disk; otherwise every device would pay
+    * for kernels the application may never use.  The disk accesses of the
+    * blorp shader cache are serialized by gen_disk_cache.
+    */
+   device->blorp_precompile_started =
+      device->instance->physicalDevice.disk_cache.base.cache &&
+      pthread_create(&device->blorp_precompile_thread, NULL,
+                     anv_blorp_precompile_thread, device) == 0;
 }
 
 void
 anv_device_finish_blorp(struct anv_device *device)
 {
+   if (device->blorp_precompile_started)
+      pthread_join(device->blorp_precompile_thread, NULL);
+
    blorp_finish(&device->blorp);
    anv_pipeline_cache_finish(&device->blorp_shader_cache);
 }
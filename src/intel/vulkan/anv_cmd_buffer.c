@@ -747,6 +747,9 @@ VkResult anv_CreateCommandPool(
       pool->alloc = device->alloc;
 
    list_inithead(&pool->cmd_buffers);
+   list_inithead(&pool->free_batch_bos);
+   pool->free_batch_bo_size = 0;
+   memset(&pool->stats, 0, sizeof(pool->stats));
 
    *pCmdPool = anv_cmd_pool_to_handle(pool);
 
@@ -769,14 +772,24 @@ void anv_DestroyCommandPool(
       anv_cmd_buffer_destroy(cmd_buffer);
    }
 
+   anv_cmd_pool_free_batch_bos(device, pool);
+
+   if (unlikely(INTEL_DEBUG & DEBUG_PERF)) {
+      fprintf(stderr, "anv: command pool: %u command buffers recorded, "
+              "%u batches chained, %u batch BOs allocated, %u recycled\n",
+              pool->stats.recorded, pool->stats.chained,
+              pool->stats.allocated, pool->stats.recycled);
+   }
+
    vk_free2(&device->alloc, pAllocator, pool);
 }
 
 VkResult anv_ResetCommandPool(
-    VkDevice                                    device,
+    VkDevice                                    _device,
     VkCommandPool                               commandPool,
     VkCommandPoolResetFlags                     flags)
 {
+   ANV_FROM_HANDLE(anv_device, device, _device);
    ANV_FROM_HANDLE(anv_cmd_pool, pool, commandPool);
 
    list_for_each_entry(struct anv_cmd_buffer, cmd_buffer,
@@ -784,6 +797,10 @@ VkResult anv_ResetCommandPool(
       anv_cmd_buffer_reset(cmd_buffer);
    }
 
+   /* Otherwise the batch BOs are kept around for the next recording */
+   if (flags & VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT)
+      anv_cmd_pool_free_batch_bos(device, pool);
+
    return VK_SUCCESS;
 }
 
@@ -564,6 +564,96 @@ VkResult anv_FreeDescriptorSets(
    return VK_SUCCESS;
 }
 
+static void
+anv_descriptor_set_write_image_view(struct anv_descriptor_set *set,
+                                    VkDescriptorType type,
+                                    VkImageView _image_view,
+                                    VkSampler _sampler,
+                                    uint32_t descriptor_index)
+{
+   ANV_FROM_HANDLE(anv_image_view, image_view, _image_view);
+   ANV_FROM_HANDLE(anv_sampler, sampler, _sampler);
+   struct anv_descriptor *desc = &set->descriptors[descriptor_index];
+
+   switch (type) {
+   case VK_DESCRIPTOR_TYPE_SAMPLER:
+      *desc = (struct anv_descriptor) {
+         .type = VK_DESCRIPTOR_TYPE_SAMPLER,
+         .sampler = sampler,
+      };
+      break;
+
+   case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+      desc->type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      desc->image_view = image_view;
+
+      /* If this descriptor has an immutable sampler, we don't want
+       * to stomp on it.
+       */
+      if (sampler)
+         desc->sampler = sampler;
+      break;
+
+   default:
+      *desc = (struct anv_descriptor) {
+         .type = type,
+         .image_view = image_view,
+      };
+      break;
+   }
+}
+
+static void
+anv_descriptor_set_write_buffer_view(struct anv_descriptor_set *set,
+                                     VkDescriptorType type,
+                                     VkBufferView _buffer_view,
+                                     uint32_t descriptor_index)
+{
+   ANV_FROM_HANDLE(anv_buffer_view, buffer_view, _buffer_view);
+
+   set->descriptors[descriptor_index] = (struct anv_descriptor) {
+      .type = type,
+      .buffer_view = buffer_view,
+   };
+}
+
+static void
+anv_descriptor_set_write_buffer(struct anv_device *device,
+                                struct anv_descriptor_set *set,
+                                VkDescriptorType type,
+                                const VkDescriptorBufferInfo *info,
+                                bool dynamic,
+                                uint32_t descriptor_index,
+                                uint32_t buffer_index)
+{
+   assert(info->buffer);
+   ANV_FROM_HANDLE(anv_buffer, buffer, info->buffer);
+   assert(buffer);
+
+   struct anv_buffer_view *view = &set->buffer_views[buffer_index];
+
+   view->format = anv_isl_format_for_descriptor_type(type);
+   view->bo = buffer->bo;
+   view->offset = buffer->offset + info->offset;
+
+   /* For buffers with dynamic offsets, we use the full possible range in
+    * the surface state and do the actual range-checking in the shader.
+    */
+   if (dynamic || info->range == VK_WHOLE_SIZE)
+      view->range = buffer->size - info->offset;
+   else
+      view->range = info->range;
+
+   anv_fill_buffer_surface_state(device, view->surface_state,
+                                 view->format,
+                                 view->offset, view->range, 1);
+
+   set->descriptors[descriptor_index] = (struct anv_descriptor) {
+      .type = type,
+      .buffer_view = view,
+   };
+}
+
 void anv_UpdateDescriptorSets(
     VkDevice                                    _device,
     uint32_t                                    descriptorWriteCount,
@@ -578,67 +668,31 @@ void anv_UpdateDescriptorSets(
       ANV_FROM_HANDLE(anv_descriptor_set, set, write->dstSet);
       const struct anv_descriptor_set_binding_layout *bind_layout =
          &set->layout->binding[write->dstBinding];
-      struct anv_descriptor *desc =
-         &set->descriptors[bind_layout->descriptor_index];
-      desc += write->dstArrayElement;
+      const uint32_t descriptor_index =
+         bind_layout->descriptor_index + write->dstArrayElement;
 
       assert(write->descriptorType == bind_layout->type);
 
       switch (write->descriptorType) {
       case VK_DESCRIPTOR_TYPE_SAMPLER:
-         for (uint32_t j = 0; j < write->descriptorCount; j++) {
-            ANV_FROM_HANDLE(anv_sampler, sampler,
-                            write->pImageInfo[j].sampler);
-
-            desc[j] = (struct anv_descriptor) {
-               .type = VK_DESCRIPTOR_TYPE_SAMPLER,
-               .sampler = sampler,
-            };
-         }
-         break;
-
       case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
-         for (uint32_t j = 0; j < write->descriptorCount; j++) {
-            ANV_FROM_HANDLE(anv_image_view, iview,
-                            write->pImageInfo[j].imageView);
-            ANV_FROM_HANDLE(anv_sampler, sampler,
-                            write->pImageInfo[j].sampler);
-
-            desc[j].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            desc[j].image_view = iview;
-
-            /* If this descriptor has an immutable sampler, we don't want
-             * to stomp on it.
-             */
-            if (sampler)
-               desc[j].sampler = sampler;
-         }
-         break;
-
       case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
       case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
       case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
          for (uint32_t j = 0; j < write->descriptorCount; j++) {
-            ANV_FROM_HANDLE(anv_image_view, iview,
-                            write->pImageInfo[j].imageView);
-
-            desc[j] = (struct anv_descriptor) {
-               .type = write->descriptorType,
-               .image_view = iview,
-            };
+            anv_descriptor_set_write_image_view(set, write->descriptorType,
+                                                write->pImageInfo[j].imageView,
+                                                write->pImageInfo[j].sampler,
+                                                descriptor_index + j);
          }
          break;
 
       case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
       case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
          for (uint32_t j = 0; j < write->descriptorCount; j++) {
-            ANV_FROM_HANDLE(anv_buffer_view, bview,
-                            write->pTexelBufferView[j]);
-
-            desc[j] = (struct anv_descriptor) {
-               .type = write->descriptorType,
-               .buffer_view = bview,
-            };
+            anv_descriptor_set_write_buffer_view(set, write->descriptorType,
+                                                 write->pTexelBufferView[j],
+                                                 descriptor_index + j);
          }
          break;
 
@@ -647,39 +701,14 @@ void anv_UpdateDescriptorSets(
       case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
       case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
          for (uint32_t j = 0; j < write->descriptorCount; j++) {
-            assert(write->pBufferInfo[j].buffer);
-            ANV_FROM_HANDLE(anv_buffer, buffer, write->pBufferInfo[j].buffer);
-            assert(buffer);
-
-            struct anv_buffer_view *view =
-               &set->buffer_views[bind_layout->buffer_index];
-            view += write->dstArrayElement + j;
-
-            view->format =
-               anv_isl_format_for_descriptor_type(write->descriptorType);
-            view->bo = buffer->bo;
-            view->offset = buffer->offset + write->pBufferInfo[j].offset;
-
-            /* For buffers with dynamic offsets, we use the full possible
-             * range in the surface state and do the actual range-checking
-             * in the shader.
-             */
-            if (bind_layout->dynamic_offset_index >= 0 ||
-                write->pBufferInfo[j].range == VK_WHOLE_SIZE)
-               view->range = buffer->size - write->pBufferInfo[j].offset;
-            else
-               view->range = write->pBufferInfo[j].range;
-
-            anv_fill_buffer_surface_state(device, view->surface_state,
-                                          view->format,
-                                          view->offset, view->range, 1);
-
-            desc[j] = (struct anv_descriptor) {
-               .type = write->descriptorType,
-               .buffer_view = view,
-            };
-
+            anv_descriptor_set_write_buffer(device, set, write->descriptorType,
+                                            &write->pBufferInfo[j],
+                                            bind_layout->dynamic_offset_index >= 0,
+                                            descriptor_index + j,
+                                            bind_layout->buffer_index +
+                                            write->dstArrayElement + j);
          }
+         break;
 
       default:
          break;
@@ -707,3 +736,128 @@ void anv_UpdateDescriptorSets(
          dst_desc[j] = src_desc[j];
    }
 }
+
+VkResult anv_CreateDescriptorUpdateTemplateKHR(
+    VkDevice                                    _device,
+    const VkDescriptorUpdateTemplateCreateInfoKHR* pCreateInfo,
+    const VkAllocationCallbacks*                pAllocator,
+    VkDescriptorUpdateTemplateKHR*              pDescriptorUpdateTemplate)
+{
+   ANV_FROM_HANDLE(anv_device, device, _device);
+   ANV_FROM_HANDLE(anv_descriptor_set_layout, set_layout,
+                   pCreateInfo->descriptorSetLayout);
+   struct anv_descriptor_update_template *template;
+
+   assert(pCreateInfo->sType == VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR);
+   assert(pCreateInfo->templateType ==
+          VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR);
+
+   size_t size = sizeof(*template) +
+      pCreateInfo->descriptorUpdateEntryCount * sizeof(template->entries[0]);
+   template = vk_alloc2(&device->alloc, pAllocator, size, 8,
+                        VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+   if (template == NULL)
+      return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
+
+   /* Resolve the bindings now so that updates don't need the layout. */
+   template->entry_count = pCreateInfo->descriptorUpdateEntryCount;
+   for (uint32_t i = 0; i < template->entry_count; i++) {
+      const VkDescriptorUpdateTemplateEntryKHR *pEntry =
+         &pCreateInfo->pDescriptorUpdateEntries[i];
+      const struct anv_descriptor_set_binding_layout *bind_layout =
+         &set_layout->binding[pEntry->dstBinding];
+
+      assert(pEntry->descriptorType == bind_layout->type);
+
+      template->entries[i] = (struct anv_descriptor_update_template_entry) {
+         .type = pEntry->descriptorType,
+         .descriptor_index = bind_layout->descriptor_index +
+                             pEntry->dstArrayElement,
+         .buffer_index = bind_layout->buffer_index < 0 ? -1 :
+                         bind_layout->buffer_index + pEntry->dstArrayElement,
+         .dynamic = bind_layout->dynamic_offset_index >= 0,
+         .descriptor_count = pEntry->descriptorCount,
+         .offset = pEntry->offset,
+         .stride = pEntry->stride,
+      };
+   }
+
+   *pDescriptorUpdateTemplate =
+      anv_descriptor_update_template_to_handle(template);
+
+   return VK_SUCCESS;
+}
+
+void anv_DestroyDescriptorUpdateTemplateKHR(
+    VkDevice                                    _device,
+    VkDescriptorUpdateTemplateKHR               descriptorUpdateTemplate,
+    const VkAllocationCallbacks*                pAllocator)
+{
+   ANV_FROM_HANDLE(anv_device, device, _device);
+   ANV_FROM_HANDLE(anv_descriptor_update_template, template,
+                   descriptorUpdateTemplate);
+
+   vk_free2(&device->alloc, pAllocator, template);
+}
+
+void anv_UpdateDescriptorSetWithTemplateKHR(
+    VkDevice                                    _device,
+    VkDescriptorSet                             descriptorSet,
+    VkDescriptorUpdateTemplateKHR               descriptorUpdateTemplate,
+    const void*                                 pData)
+{
+   ANV_FROM_HANDLE(anv_device, device, _device);
+   ANV_FROM_HANDLE(anv_descriptor_set, set, descriptorSet);
+   ANV_FROM_HANDLE(anv_descriptor_update_template, template,
+                   descriptorUpdateTemplate);
+
+   for (uint32_t i = 0; i < template->entry_count; i++) {
+      const struct anv_descriptor_update_template_entry *entry =
+         &template->entries[i];
+      const char *data = (const char *)pData + entry->offset;
+
+      switch (entry->type) {
+      case VK_DESCRIPTOR_TYPE_SAMPLER:
+      case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+      case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+      case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+      case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+         for (uint32_t j = 0; j < entry->descriptor_count; j++) {
+            const VkDescriptorImageInfo *info =
+               (const VkDescriptorImageInfo *)(data + j * entry->stride);
+            anv_descriptor_set_write_image_view(set, entry->type,
+                                                info->imageView,
+                                                info->sampler,
+                                                entry->descriptor_index + j);
+         }
+         break;
+
+      case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+         for (uint32_t j = 0; j < entry->descriptor_count; j++) {
+            const VkBufferView *view =
+               (const VkBufferView *)(data + j * entry->stride);
+            anv_descriptor_set_write_buffer_view(set, entry->type, *view,
+                                                 entry->descriptor_index + j);
+         }
+         break;
+
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+         for (uint32_t j = 0; j < entry->descriptor_count; j++) {
+            const VkDescriptorBufferInfo *info =
+               (const VkDescriptorBufferInfo *)(data + j * entry->stride);
+            anv_descriptor_set_write_buffer(device, set, entry->type, info,
+                                            entry->dynamic,
+                                            entry->descriptor_index + j,
+                                            entry->buffer_index + j);
+         }
+         break;
+
+      default:
+         break;
+      }
+   }
+}
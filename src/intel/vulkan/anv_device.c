@@ -215,6 +215,8 @@ anv_physical_device_init(struct anv_physical_device *device,
 
    isl_device_init(&device->isl_dev, &device->info, swizzled);
 
+   anv_disk_cache_init(&device->disk_cache);
+
    close(fd);
    return VK_SUCCESS;
 
@@ -226,6 +228,7 @@ fail:
 static void
 anv_physical_device_finish(struct anv_physical_device *device)
 {
+   anv_disk_cache_finish(&device->disk_cache);
    anv_finish_wsi(device);
    ralloc_free(device->compiler);
 }
@@ -263,6 +266,10 @@ static const VkExtensionProperties device_extensions[] = {
    {
       .extensionName = VK_KHR_SAMPLER_MIRROR_CLAMP_TO_EDGE_EXTENSION_NAME,
       .specVersion = 1,
+   },
+   {
+      .extensionName = VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME,
+      .specVersion = 1,
    }
 };
 
@@ -922,6 +929,7 @@ VkResult anv_CreateDevice(
 
    device->info = physical_device->info;
    device->isl_dev = physical_device->isl_dev;
+   isl_cache_init(&device->isl_cache);
 
    /* On Broadwell and later, we can use batch chaining to more efficiently
     * implement growing command buffers.  Prior to Haswell, the kernel
@@ -982,7 +990,10 @@ VkResult anv_CreateDevice(
       unreachable("unhandled gen");
    }
    if (result != VK_SUCCESS)
-      goto fail_fd;
+      goto fail_isl_cache;
+
+   anv_pipeline_cache_init(&device->default_pipeline_cache, device,
+                           anv_pipeline_cache_enabled());
 
    anv_device_init_blorp(device);
 
@@ -992,6 +1003,8 @@ VkResult anv_CreateDevice(
 
    return VK_SUCCESS;
 
+ fail_isl_cache:
+   isl_cache_finish(&device->isl_cache);
  fail_fd:
    close(device->fd);
  fail_device:
@@ -1008,6 +1021,8 @@ void anv_DestroyDevice(
 
    anv_device_finish_blorp(device);
 
+   anv_pipeline_cache_finish(&device->default_pipeline_cache);
+
    anv_queue_finish(&device->queue);
 
 #ifdef HAVE_VALGRIND
@@ -1034,6 +1049,12 @@ void anv_DestroyDevice(
    pthread_cond_destroy(&device->queue_submit);
    pthread_mutex_destroy(&device->mutex);
 
+   if (unlikely(INTEL_DEBUG & DEBUG_PERF)) {
+      fprintf(stderr, "anv: isl surface cache: %u hits, %u misses\n",
+              device->isl_cache.hits, device->isl_cache.misses);
+   }
+   isl_cache_finish(&device->isl_cache);
+
    anv_gem_destroy_context(device, device->context_id);
 
    close(device->fd);
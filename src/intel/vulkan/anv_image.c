@@ -118,7 +118,7 @@ add_surface(struct anv_image *image, struct anv_surface *surf)
  * Exactly one bit must be set in \a aspect.
  */
 static VkResult
-make_surface(const struct anv_device *dev,
+make_surface(struct anv_device *dev,
              struct anv_image *image,
              const struct anv_image_create_info *anv_info,
              VkImageAspectFlags aspect)
@@ -153,7 +153,8 @@ make_surface(const struct anv_device *dev,
                                                aspect, vk_info->tiling);
    assert(format != ISL_FORMAT_UNSUPPORTED);
 
-   ok = isl_surf_init(&dev->isl_dev, &anv_surf->isl,
+   /* Streaming applications create many images of the same few shapes */
+   ok = isl_surf_init_cached(&dev->isl_dev, &dev->isl_cache, &anv_surf->isl,
       .dim = vk_to_isl_surf_dim[vk_info->imageType],
       .format = format,
       .width = image->extent.width,
@@ -521,6 +522,13 @@ anv_CreateImageView(VkDevice _device,
       iview->isl.usage = 0;
    }
 
+   /* The sampler and storage states only differ in their views, so they
+    * are filled together once both views are known.
+    */
+   struct isl_view views[2];
+   void *states[2];
+   uint32_t num_views = 0;
+
    /* Input attachment surfaces for color or depth are allocated and filled
     * out at BeginRenderPass time because they need compression information.
     * Stencil image do not support compression so we just use the texture
@@ -531,39 +539,23 @@ anv_CreateImageView(VkDevice _device,
         (iview->aspect_mask & VK_IMAGE_ASPECT_STENCIL_BIT))) {
       iview->sampler_surface_state = alloc_surface_state(device);
 
-      struct isl_view view = iview->isl;
-      view.usage |= ISL_SURF_USAGE_TEXTURE_BIT;
-      isl_surf_fill_state(&device->isl_dev,
-                          iview->sampler_surface_state.map,
-                          .surf = &surface->isl,
-                          .view = &view,
-                          .aux_surf = &image->aux_surface.isl,
-                          .aux_usage = image->aux_usage,
-                          .mocs = device->default_mocs);
-
-      if (!device->info.has_llc)
-         anv_state_clflush(iview->sampler_surface_state);
+      views[num_views] = iview->isl;
+      views[num_views].usage |= ISL_SURF_USAGE_TEXTURE_BIT;
+      states[num_views++] = iview->sampler_surface_state.map;
    } else {
       iview->sampler_surface_state.alloc_size = 0;
    }
 
-   /* NOTE: This one needs to go last since it may stomp isl_view.format */
    if (image->usage & VK_IMAGE_USAGE_STORAGE_BIT) {
       iview->storage_surface_state = alloc_surface_state(device);
 
       if (isl_has_matching_typed_storage_image_format(&device->info,
                                                       format.isl_format)) {
-         struct isl_view view = iview->isl;
-         view.usage |= ISL_SURF_USAGE_STORAGE_BIT;
-         view.format = isl_lower_storage_image_format(&device->info,
-                                                      format.isl_format);
-         isl_surf_fill_state(&device->isl_dev,
-                             iview->storage_surface_state.map,
-                             .surf = &surface->isl,
-                             .view = &view,
-                             .aux_surf = &image->aux_surface.isl,
-                             .aux_usage = image->aux_usage,
-                             .mocs = device->default_mocs);
+         views[num_views] = iview->isl;
+         views[num_views].usage |= ISL_SURF_USAGE_STORAGE_BIT;
+         views[num_views].format =
+            isl_lower_storage_image_format(&device->info, format.isl_format);
+         states[num_views++] = iview->storage_surface_state.map;
       } else {
          anv_fill_buffer_surface_state(device, iview->storage_surface_state,
                                        ISL_FORMAT_RAW,
@@ -574,13 +566,25 @@ anv_CreateImageView(VkDevice _device,
       isl_surf_fill_image_param(&device->isl_dev,
                                 &iview->storage_image_param,
                                 &surface->isl, &iview->isl);
-
-      if (!device->info.has_llc)
-         anv_state_clflush(iview->storage_surface_state);
    } else {
       iview->storage_surface_state.alloc_size = 0;
    }
 
+   isl_surf_fill_state_views(&device->isl_dev, states,
+                             &(struct isl_surf_fill_state_info) {
+                                .surf = &surface->isl,
+                                .aux_surf = &image->aux_surface.isl,
+                                .aux_usage = image->aux_usage,
+                                .mocs = device->default_mocs,
+                             }, views, num_views);
+
+   if (!device->info.has_llc) {
+      if (iview->sampler_surface_state.alloc_size > 0)
+         anv_state_clflush(iview->sampler_surface_state);
+      if (iview->storage_surface_state.alloc_size > 0)
+         anv_state_clflush(iview->storage_surface_state);
+   }
+
    *pView = anv_image_view_to_handle(iview);
 
    return VK_SUCCESS;
@@ -22,6 +22,7 @@
  */
 
 #include "util/mesa-sha1.h"
+#include "util/crc32.h"
 #include "util/hash_table.h"
 #include "util/debug.h"
 #include "anv_private.h"
@@ -178,6 +179,13 @@ anv_pipeline_cache_init(struct anv_pipeline_cache *cache,
    } else {
       cache->cache = NULL;
    }
+
+   struct anv_disk_cache *disk_cache =
+      &device->instance->physicalDevice.disk_cache;
+   if (cache->cache && disk_cache->base.cache)
+      cache->disk_cache = disk_cache;
+   else
+      cache->disk_cache = NULL;
 }
 
 void
@@ -240,6 +248,13 @@ anv_pipeline_cache_search_locked(struct anv_pipeline_cache *cache,
       return NULL;
 }
 
+static struct anv_shader_bin *
+anv_pipeline_cache_search_disk(struct anv_pipeline_cache *cache,
+                               const void *key_data, uint32_t key_size);
+static void
+anv_pipeline_cache_store_disk(struct anv_pipeline_cache *cache,
+                              const struct anv_shader_bin *bin);
+
 struct anv_shader_bin *
 anv_pipeline_cache_search(struct anv_pipeline_cache *cache,
                           const void *key_data, uint32_t key_size)
@@ -254,6 +269,9 @@ anv_pipeline_cache_search(struct anv_pipeline_cache *cache,
 
    pthread_mutex_unlock(&cache->mutex);
 
+   if (!shader && cache->disk_cache)
+      shader = anv_pipeline_cache_search_disk(cache, key_data, key_size);
+
    /* We increment refcount before handing it to the caller */
    if (shader)
       anv_shader_bin_ref(shader);
@@ -300,13 +318,20 @@ anv_pipeline_cache_upload_kernel(struct anv_pipeline_cache *cache,
       pthread_mutex_lock(&cache->mutex);
 
       struct anv_shader_bin *bin =
-         anv_pipeline_cache_add_shader(cache, key_data, key_size,
-                                       kernel_data, kernel_size,
-                                       prog_data, prog_data_size,
-                                       prog_data->param, bind_map);
+         anv_pipeline_cache_search_locked(cache, key_data, key_size);
+      bool is_new = bin == NULL;
+      if (is_new) {
+         bin = anv_pipeline_cache_add_shader(cache, key_data, key_size,
+                                             kernel_data, kernel_size,
+                                             prog_data, prog_data_size,
+                                             prog_data->param, bind_map);
+      }
 
       pthread_mutex_unlock(&cache->mutex);
 
+      if (is_new && bin && cache->disk_cache)
+         anv_pipeline_cache_store_disk(cache, bin);
+
       /* We increment refcount before handing it to the caller */
       anv_shader_bin_ref(bin);
 
@@ -328,6 +353,59 @@ struct cache_header {
    uint8_t  uuid[VK_UUID_SIZE];
 };
 
+/**
+ * Add a shader serialized by anv_shader_bin_write_data() at *p to the cache
+ * and advance *p past it.  Returns NULL if the data is truncated.
+ */
+static struct anv_shader_bin *
+anv_pipeline_cache_add_serialized(struct anv_pipeline_cache *cache,
+                                  const void **pp, const void *end)
+{
+   const void *p = *pp;
+
+   struct anv_shader_bin bin;
+   if (p + sizeof(bin) > end)
+      return NULL;
+   memcpy(&bin, p, sizeof(bin));
+   p += align_u32(sizeof(struct anv_shader_bin), 8);
+
+   const struct brw_stage_prog_data *prog_data = p;
+   p += align_u32(bin.prog_data_size, 8);
+   if (p > end)
+      return NULL;
+
+   uint32_t param_size = prog_data->nr_params * sizeof(void *);
+   const void *prog_data_param = p;
+   p += align_u32(param_size, 8);
+
+   struct anv_shader_bin_key key;
+   if (p + sizeof(key) > end)
+      return NULL;
+   memcpy(&key, p, sizeof(key));
+   const void *key_data = p + sizeof(key);
+   p += align_u32(sizeof(key) + key.size, 8);
+
+   /* We're going to memcpy this so getting rid of const is fine */
+   struct anv_pipeline_binding *bindings = (void *)p;
+   p += align_u32((bin.bind_map.surface_count + bin.bind_map.sampler_count) *
+                  sizeof(struct anv_pipeline_binding), 8);
+   bin.bind_map.surface_to_descriptor = bindings;
+   bin.bind_map.sampler_to_descriptor = bindings + bin.bind_map.surface_count;
+
+   const void *kernel_data = p;
+   p += align_u32(bin.kernel_size, 8);
+
+   if (p > end)
+      return NULL;
+
+   *pp = p;
+
+   return anv_pipeline_cache_add_shader(cache, key_data, key.size,
+                                        kernel_data, bin.kernel_size,
+                                        prog_data, bin.prog_data_size,
+                                        prog_data_param, &bin.bind_map);
+}
+
 static void
 anv_pipeline_cache_load(struct anv_pipeline_cache *cache,
                         const void *data, size_t size)
@@ -364,50 +442,141 @@ anv_pipeline_cache_load(struct anv_pipeline_cache *cache,
    p += align_u32(sizeof(count), 8);
 
    for (uint32_t i = 0; i < count; i++) {
-      struct anv_shader_bin bin;
-      if (p + sizeof(bin) > end)
+      if (!anv_pipeline_cache_add_serialized(cache, &p, end))
          break;
-      memcpy(&bin, p, sizeof(bin));
-      p += align_u32(sizeof(struct anv_shader_bin), 8);
+   }
+}
 
-      const struct brw_stage_prog_data *prog_data = p;
-      p += align_u32(bin.prog_data_size, 8);
-      if (p > end)
-         break;
+/** Queued shaders beyond this size aren't written to the disk cache */
+#define ANV_DISK_CACHE_MAX_PENDING_SIZE (16 * 1024 * 1024)
 
-      uint32_t param_size = prog_data->nr_params * sizeof(void *);
-      const void *prog_data_param = p;
-      p += align_u32(param_size, 8);
+/**
+ * Disk cache entries are the shader as written by
+ * anv_shader_bin_write_data(), preceded by this header.
+ */
+struct anv_disk_cache_entry {
+   uint32_t size;
+   uint32_t crc32;
+};
 
-      struct anv_shader_bin_key key;
-      if (p + sizeof(key) > end)
-         break;
-      memcpy(&key, p, sizeof(key));
-      const void *key_data = p + sizeof(key);
-      p += align_u32(sizeof(key) + key.size, 8);
+/**
+ * The disk cache is shared with other drivers and other builds, so the
+ * key also covers the device and the driver build.
+ */
+static void
+anv_disk_cache_key(const struct anv_physical_device *pdevice,
+                   const void *key_data, uint32_t key_size,
+                   cache_key disk_key)
+{
+   struct mesa_sha1 *ctx;
 
-      /* We're going to memcpy this so getting rid of const is fine */
-      struct anv_pipeline_binding *bindings = (void *)p;
-      p += align_u32((bin.bind_map.surface_count + bin.bind_map.sampler_count) *
-                     sizeof(struct anv_pipeline_binding), 8);
-      bin.bind_map.surface_to_descriptor = bindings;
-      bin.bind_map.sampler_to_descriptor = bindings + bin.bind_map.surface_count;
+   ctx = _mesa_sha1_init();
+   _mesa_sha1_update(ctx, pdevice->uuid, VK_UUID_SIZE);
+   _mesa_sha1_update(ctx, &pdevice->chipset_id, sizeof(pdevice->chipset_id));
+   _mesa_sha1_update(ctx, &key_size, sizeof(key_size));
+   _mesa_sha1_update(ctx, key_data, key_size);
+   _mesa_sha1_final(ctx, disk_key);
+}
 
-      const void *kernel_data = p;
-      p += align_u32(bin.kernel_size, 8);
+static struct anv_shader_bin *
+anv_pipeline_cache_search_disk(struct anv_pipeline_cache *cache,
+                               const void *key_data, uint32_t key_size)
+{
+   struct anv_disk_cache *disk_cache = cache->disk_cache;
+   struct anv_shader_bin *shader = NULL;
+   struct anv_disk_cache_entry entry;
+   cache_key disk_key;
+   size_t size;
+
+   anv_disk_cache_key(&cache->device->instance->physicalDevice,
+                      key_data, key_size, disk_key);
+
+   void *data = gen_disk_cache_get(&disk_cache->base, disk_key, &size);
+   if (data && size >= sizeof(entry)) {
+      memcpy(&entry, data, sizeof(entry));
+      const void *p = data + sizeof(entry);
+      const void *end = p + entry.size;
+
+      if (entry.size == size - sizeof(entry) &&
+          entry.crc32 == util_hash_crc32(p, entry.size)) {
+         pthread_mutex_lock(&cache->mutex);
+         shader = anv_pipeline_cache_add_serialized(cache, &p, end);
+         pthread_mutex_unlock(&cache->mutex);
+
+         /* Only trust the entry if it is the shader we asked for */
+         if (shader && (shader->key->size != key_size ||
+                        memcmp(shader->key->data, key_data, key_size) != 0))
+            shader = NULL;
+      }
+   }
+   free(data);
 
-      if (p > end)
-         break;
+   if (shader)
+      __sync_fetch_and_add(&disk_cache->hits, 1);
+   else
+      __sync_fetch_and_add(&disk_cache->misses, 1);
+
+   return shader;
+}
+
+static void
+anv_pipeline_cache_store_disk(struct anv_pipeline_cache *cache,
+                              const struct anv_shader_bin *bin)
+{
+   struct anv_disk_cache_entry entry;
+   cache_key disk_key;
+
+   entry.size = anv_shader_bin_data_size(bin);
+   size_t size = sizeof(entry) + entry.size;
+
+   char *data = malloc(size);
+   if (!data)
+      return;
 
-      anv_pipeline_cache_add_shader(cache, key_data, key.size,
-                                    kernel_data, bin.kernel_size,
-                                    prog_data, bin.prog_data_size,
-                                    prog_data_param, &bin.bind_map);
+   anv_disk_cache_key(&cache->device->instance->physicalDevice,
+                      bin->key->data, bin->key->size, disk_key);
+   anv_shader_bin_write_data(bin, data + sizeof(entry));
+   entry.crc32 = util_hash_crc32(data + sizeof(entry), entry.size);
+   memcpy(data, &entry, sizeof(entry));
+
+   gen_disk_cache_put(&cache->disk_cache->base, disk_key, data, size);
+
+   free(data);
+}
+
+/**
+ * The disk cache honors MESA_GLSL_CACHE_DIR, MESA_GLSL_CACHE_MAX_SIZE and
+ * MESA_GLSL_CACHE_DISABLE, and is only used along with the in-memory
+ * pipeline caches.
+ */
+void
+anv_disk_cache_init(struct anv_disk_cache *disk_cache)
+{
+   memset(disk_cache, 0, sizeof(*disk_cache));
+
+   if (!anv_pipeline_cache_enabled())
+      return;
+
+   gen_disk_cache_init(&disk_cache->base, ANV_DISK_CACHE_MAX_PENDING_SIZE);
+}
+
+void
+anv_disk_cache_finish(struct anv_disk_cache *disk_cache)
+{
+   if (!disk_cache->base.cache)
+      return;
+
+   if (unlikely(INTEL_DEBUG & DEBUG_PERF)) {
+      fprintf(stderr, "anv: pipeline disk cache: %u hits, %u misses, "
+              "%u stores, %u dropped\n", disk_cache->hits, disk_cache->misses,
+              disk_cache->base.stores, disk_cache->base.dropped);
    }
+
+   gen_disk_cache_finish(&disk_cache->base);
 }
 
-static bool
-pipeline_cache_enabled()
+bool
+anv_pipeline_cache_enabled(void)
 {
    static int enabled = -1;
    if (enabled < 0)
@@ -433,7 +602,7 @@ VkResult anv_CreatePipelineCache(
    if (cache == NULL)
       return vk_error(VK_ERROR_OUT_OF_HOST_MEMORY);
 
-   anv_pipeline_cache_init(cache, device, pipeline_cache_enabled());
+   anv_pipeline_cache_init(cache, device, anv_pipeline_cache_enabled());
 
    if (pCreateInfo->initialDataSize > 0)
       anv_pipeline_cache_load(cache,
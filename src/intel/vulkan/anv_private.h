@@ -42,8 +42,10 @@
 #endif
 
 #include "common/gen_device_info.h"
+#include "common/gen_disk_cache.h"
 #include "blorp/blorp.h"
 #include "brw_compiler.h"
+#include "util/disk_cache.h"
 #include "util/macros.h"
 #include "util/list.h"
 #include "util/u_vector.h"
@@ -380,7 +382,20 @@ struct anv_fixed_size_state_pool {
 #define ANV_MIN_STATE_SIZE_LOG2 6
 #define ANV_MAX_STATE_SIZE_LOG2 17
 
-#define ANV_STATE_BUCKETS (ANV_MAX_STATE_SIZE_LOG2 - ANV_MIN_STATE_SIZE_LOG2 + 1)
+/* State sizes are rounded up to a size class rather than to a power of two.
+ * Up to 512B, there is a class every 64B.  Above that, every power of two is
+ * split into four classes (640, 768, 896, 1024, 1280, ...), so no more than
+ * 25% of a state is wasted.
+ */
+#define ANV_STATE_SMALL_CLASSES_LOG2 9
+#define ANV_STATE_SMALL_CLASSES (1 << (ANV_STATE_SMALL_CLASSES_LOG2 - \
+                                       ANV_MIN_STATE_SIZE_LOG2))
+#define ANV_STATE_CLASSES_PER_POW2_LOG2 2
+
+#define ANV_STATE_BUCKETS (ANV_STATE_SMALL_CLASSES + \
+                           ((ANV_MAX_STATE_SIZE_LOG2 - \
+                             ANV_STATE_SMALL_CLASSES_LOG2) << \
+                            ANV_STATE_CLASSES_PER_POW2_LOG2))
 
 struct anv_state_pool {
    struct anv_block_pool *block_pool;
@@ -482,6 +497,22 @@ extern struct anv_dispatch_table dtable;
 
 #define VK_ICD_WSI_PLATFORM_MAX 5
 
+/**
+ * Second level of the pipeline caches, shared by all devices and persisted
+ * across runs with util/disk_cache.  Shaders are written by a background
+ * thread, so compiling a pipeline never waits on the disk.
+ */
+struct anv_disk_cache {
+   struct gen_disk_cache                        base;
+
+   /* Statistics, reported with INTEL_DEBUG=perf */
+   uint32_t                                     hits;
+   uint32_t                                     misses;
+};
+
+void anv_disk_cache_init(struct anv_disk_cache *cache);
+void anv_disk_cache_finish(struct anv_disk_cache *cache);
+
 struct anv_physical_device {
     VK_LOADER_DATA                              _loader_data;
 
@@ -500,6 +531,8 @@ struct anv_physical_device {
 
     uint8_t                                     uuid[VK_UUID_SIZE];
 
+    struct anv_disk_cache                       disk_cache;
+
     struct wsi_device                       wsi_device;
 };
 
@@ -529,6 +562,9 @@ struct anv_pipeline_cache {
    pthread_mutex_t                              mutex;
 
    struct hash_table *                          cache;
+
+   /** Physical device's disk cache, or NULL if it isn't used */
+   struct anv_disk_cache *                      disk_cache;
 };
 
 struct anv_pipeline_bind_map;
@@ -537,6 +573,7 @@ void anv_pipeline_cache_init(struct anv_pipeline_cache *cache,
                              struct anv_device *device,
                              bool cache_enabled);
 void anv_pipeline_cache_finish(struct anv_pipeline_cache *cache);
+bool anv_pipeline_cache_enabled(void);
 
 struct anv_shader_bin *
 anv_pipeline_cache_search(struct anv_pipeline_cache *cache,
@@ -558,6 +595,7 @@ struct anv_device {
     uint32_t                                    chipset_id;
     struct gen_device_info                      info;
     struct isl_device                           isl_dev;
+    struct isl_cache                            isl_cache;
     int                                         context_id;
     int                                         fd;
     bool                                        can_chain_batches;
@@ -576,8 +614,12 @@ struct anv_device {
 
     struct anv_bo                               workaround_bo;
 
+    struct anv_pipeline_cache                   default_pipeline_cache;
+
     struct anv_pipeline_cache                   blorp_shader_cache;
     struct blorp_context                        blorp;
+    pthread_t                                   blorp_precompile_thread;
+    bool                                        blorp_precompile_started;
 
     struct anv_state                            border_colors;
 
@@ -706,8 +748,14 @@ _anv_combine_address(struct anv_batch *batch, void *location,
 #define __anv_cmd_length_bias(cmd) cmd ## _length_bias
 #define __anv_cmd_header(cmd) cmd ## _header
 #define __anv_cmd_pack(cmd) cmd ## _pack
+#define __anv_cmd_merge(cmd) cmd ## _merge
+#define __anv_cmd_field_start(cmd, field) cmd ## _ ## field ## _start
 #define __anv_reg_num(reg) reg ## _num
 
+/* The bit selecting the dword holding field in a merge function dw_mask */
+#define anv_cmd_field_dw(cmd, field) \
+   (1u << (__anv_cmd_field_start(cmd, field) / 32))
+
 #define anv_pack_struct(dst, struc, ...) do {                              \
       struct struc __template = {                                          \
          __VA_ARGS__                                                       \
@@ -738,6 +786,20 @@ _anv_combine_address(struct anv_batch *batch, void *location,
       VG(VALGRIND_CHECK_MEM_IS_DEFINED(dw, ARRAY_SIZE(dwords0) * 4));\
    } while (0)
 
+/* Emits dwords, packed ahead of time with the dynamic fields left zero,
+ * and packs only the dwords in dw_mask from name on top of them.
+ */
+#define anv_batch_emit_merge_fields(batch, cmd, dwords, dw_mask, name)  \
+   for (struct cmd name = { 0 },                                        \
+        *_dst = anv_batch_emit_dwords(batch, __anv_cmd_length(cmd));    \
+        __builtin_expect(_dst != NULL, 1);                              \
+        ({ STATIC_ASSERT(ARRAY_SIZE(dwords) == __anv_cmd_length(cmd));  \
+           memcpy(_dst, dwords, sizeof(dwords));                        \
+           __anv_cmd_merge(cmd)(batch, _dst, &name, dw_mask);           \
+           VG(VALGRIND_CHECK_MEM_IS_DEFINED(_dst, __anv_cmd_length(cmd) * 4)); \
+           _dst = NULL;                                                 \
+         }))
+
 #define anv_batch_emit(batch, cmd, name)                            \
    for (struct cmd name = { __anv_cmd_header(cmd) },                    \
         *_dst = anv_batch_emit_dwords(batch, __anv_cmd_length(cmd));    \
@@ -905,6 +967,32 @@ anv_descriptor_set_destroy(struct anv_device *device,
                            struct anv_descriptor_pool *pool,
                            struct anv_descriptor_set *set);
 
+struct anv_descriptor_update_template_entry {
+   VkDescriptorType type;
+
+   /* Index of the first descriptor written in the flattened set */
+   uint16_t descriptor_index;
+
+   /* Index of the first buffer view written, for buffer descriptors */
+   int16_t buffer_index;
+
+   /* Whether the buffers are bound with a dynamic offset */
+   bool dynamic;
+
+   uint32_t descriptor_count;
+
+   /* Where the first descriptor's info is in the update data, and the
+    * distance between consecutive ones.
+    */
+   size_t offset;
+   size_t stride;
+};
+
+struct anv_descriptor_update_template {
+   uint32_t entry_count;
+   struct anv_descriptor_update_template_entry entries[0];
+};
+
 #define ANV_DESCRIPTOR_SET_COLOR_ATTACHMENTS UINT8_MAX
 
 struct anv_pipeline_binding {
@@ -1159,13 +1247,40 @@ struct anv_cmd_state {
    } gen7;
 };
 
+struct anv_cmd_pool_stats {
+   /* Command buffers recorded */
+   uint32_t                                     recorded;
+
+   /* Batch BOs chained to while recording */
+   uint32_t                                     chained;
+
+   /* Batch BOs allocated from the device, or taken from the pool's cache */
+   uint32_t                                     allocated;
+   uint32_t                                     recycled;
+};
+
 struct anv_cmd_pool {
    VkAllocationCallbacks                        alloc;
    struct list_head                             cmd_buffers;
+
+   /* Batch BOs released by reset or freed command buffers.  They keep
+    * their size and relocation arrays, so command buffers that are
+    * recorded again start with warm, large enough batches.
+    */
+   struct list_head                             free_batch_bos;
+   uint32_t                                     free_batch_bo_size;
+
+   struct anv_cmd_pool_stats                    stats;
 };
 
 #define ANV_CMD_BUFFER_BATCH_SIZE 8192
 
+/* Chained batch BOs double in size up to this */
+#define ANV_CMD_BUFFER_MAX_BATCH_SIZE (1024 * 1024)
+
+/* Maximum size of the batch BOs cached by a command pool */
+#define ANV_CMD_POOL_MAX_FREE_BATCH_SIZE (16 * 1024 * 1024)
+
 enum anv_cmd_buffer_exec_mode {
    ANV_CMD_BUFFER_EXEC_MODE_PRIMARY,
    ANV_CMD_BUFFER_EXEC_MODE_EMIT,
@@ -1225,6 +1340,8 @@ struct anv_cmd_buffer {
 VkResult anv_cmd_buffer_init_batch_bo_chain(struct anv_cmd_buffer *cmd_buffer);
 void anv_cmd_buffer_fini_batch_bo_chain(struct anv_cmd_buffer *cmd_buffer);
 void anv_cmd_buffer_reset_batch_bo_chain(struct anv_cmd_buffer *cmd_buffer);
+void anv_cmd_pool_free_batch_bos(struct anv_device *device,
+                                 struct anv_cmd_pool *pool);
 void anv_cmd_buffer_end_batch_buffer(struct anv_cmd_buffer *cmd_buffer);
 void anv_cmd_buffer_add_secondary(struct anv_cmd_buffer *primary,
                                   struct anv_cmd_buffer *secondary);
@@ -1829,6 +1946,7 @@ ANV_DEFINE_NONDISP_HANDLE_CASTS(anv_buffer_view, VkBufferView)
 ANV_DEFINE_NONDISP_HANDLE_CASTS(anv_descriptor_pool, VkDescriptorPool)
 ANV_DEFINE_NONDISP_HANDLE_CASTS(anv_descriptor_set, VkDescriptorSet)
 ANV_DEFINE_NONDISP_HANDLE_CASTS(anv_descriptor_set_layout, VkDescriptorSetLayout)
+ANV_DEFINE_NONDISP_HANDLE_CASTS(anv_descriptor_update_template, VkDescriptorUpdateTemplateKHR)
 ANV_DEFINE_NONDISP_HANDLE_CASTS(anv_device_memory, VkDeviceMemory)
 ANV_DEFINE_NONDISP_HANDLE_CASTS(anv_fence, VkFence)
 ANV_DEFINE_NONDISP_HANDLE_CASTS(anv_event, VkEvent)
@@ -161,18 +161,23 @@ genX(cmd_buffer_flush_dynamic_state)(struct anv_cmd_buffer *cmd_buffer)
                                   ANV_CMD_DIRTY_RENDER_TARGETS |
                                   ANV_CMD_DIRTY_DYNAMIC_LINE_WIDTH |
                                   ANV_CMD_DIRTY_DYNAMIC_DEPTH_BIAS)) {
-      uint32_t sf_dw[GENX(3DSTATE_SF_length)];
-      struct GENX(3DSTATE_SF) sf = {
-         GENX(3DSTATE_SF_header),
-         .DepthBufferSurfaceFormat = get_depth_format(cmd_buffer),
-         .LineWidth = cmd_buffer->state.dynamic.line_width,
-         .GlobalDepthOffsetConstant = cmd_buffer->state.dynamic.depth_bias.bias,
-         .GlobalDepthOffsetScale = cmd_buffer->state.dynamic.depth_bias.slope,
-         .GlobalDepthOffsetClamp = cmd_buffer->state.dynamic.depth_bias.clamp
-      };
-      GENX(3DSTATE_SF_pack)(NULL, sf_dw, &sf);
-
-      anv_batch_emit_merge(&cmd_buffer->batch, sf_dw, pipeline->gen7.sf);
+      const uint32_t dw_mask =
+         anv_cmd_field_dw(GENX(3DSTATE_SF), DepthBufferSurfaceFormat) |
+         anv_cmd_field_dw(GENX(3DSTATE_SF), LineWidth) |
+         anv_cmd_field_dw(GENX(3DSTATE_SF), GlobalDepthOffsetConstant) |
+         anv_cmd_field_dw(GENX(3DSTATE_SF), GlobalDepthOffsetScale) |
+         anv_cmd_field_dw(GENX(3DSTATE_SF), GlobalDepthOffsetClamp);
+
+      anv_batch_emit_merge_fields(&cmd_buffer->batch, GENX(3DSTATE_SF),
+                                  pipeline->gen7.sf, dw_mask, sf) {
+         struct anv_dynamic_state *d = &cmd_buffer->state.dynamic;
+
+         sf.DepthBufferSurfaceFormat = get_depth_format(cmd_buffer);
+         sf.LineWidth = d->line_width;
+         sf.GlobalDepthOffsetConstant = d->depth_bias.bias;
+         sf.GlobalDepthOffsetScale = d->depth_bias.slope;
+         sf.GlobalDepthOffsetClamp = d->depth_bias.clamp;
+      }
    }
 
    if (cmd_buffer->state.dirty & (ANV_CMD_DIRTY_DYNAMIC_BLEND_CONSTANTS |
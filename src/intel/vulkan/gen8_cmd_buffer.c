@@ -109,15 +109,13 @@ gen8_cmd_buffer_emit_depth_viewport(struct anv_cmd_buffer *cmd_buffer,
 static void
 __emit_genx_sf_state(struct anv_cmd_buffer *cmd_buffer)
 {
-      uint32_t sf_dw[GENX(3DSTATE_SF_length)];
-      struct GENX(3DSTATE_SF) sf = {
-         GENX(3DSTATE_SF_header),
-         .LineWidth = cmd_buffer->state.dynamic.line_width,
-      };
-      GENX(3DSTATE_SF_pack)(NULL, sf_dw, &sf);
       /* FIXME: gen9.fs */
-      anv_batch_emit_merge(&cmd_buffer->batch, sf_dw,
-                           cmd_buffer->state.pipeline->gen8.sf);
+      anv_batch_emit_merge_fields(&cmd_buffer->batch, GENX(3DSTATE_SF),
+                                  cmd_buffer->state.pipeline->gen8.sf,
+                                  anv_cmd_field_dw(GENX(3DSTATE_SF), LineWidth),
+                                  sf) {
+         sf.LineWidth = cmd_buffer->state.dynamic.line_width;
+      }
 }
 
 void
@@ -166,16 +164,19 @@ genX(cmd_buffer_flush_dynamic_state)(struct anv_cmd_buffer *cmd_buffer)
 
    if (cmd_buffer->state.dirty & (ANV_CMD_DIRTY_PIPELINE |
                                   ANV_CMD_DIRTY_DYNAMIC_DEPTH_BIAS)){
-      uint32_t raster_dw[GENX(3DSTATE_RASTER_length)];
-      struct GENX(3DSTATE_RASTER) raster = {
-         GENX(3DSTATE_RASTER_header),
-         .GlobalDepthOffsetConstant = cmd_buffer->state.dynamic.depth_bias.bias,
-         .GlobalDepthOffsetScale = cmd_buffer->state.dynamic.depth_bias.slope,
-         .GlobalDepthOffsetClamp = cmd_buffer->state.dynamic.depth_bias.clamp
-      };
-      GENX(3DSTATE_RASTER_pack)(NULL, raster_dw, &raster);
-      anv_batch_emit_merge(&cmd_buffer->batch, raster_dw,
-                           pipeline->gen8.raster);
+      const uint32_t dw_mask =
+         anv_cmd_field_dw(GENX(3DSTATE_RASTER), GlobalDepthOffsetConstant) |
+         anv_cmd_field_dw(GENX(3DSTATE_RASTER), GlobalDepthOffsetScale) |
+         anv_cmd_field_dw(GENX(3DSTATE_RASTER), GlobalDepthOffsetClamp);
+
+      anv_batch_emit_merge_fields(&cmd_buffer->batch, GENX(3DSTATE_RASTER),
+                                  pipeline->gen8.raster, dw_mask, raster) {
+         struct anv_dynamic_state *d = &cmd_buffer->state.dynamic;
+
+         raster.GlobalDepthOffsetConstant = d->depth_bias.bias;
+         raster.GlobalDepthOffsetScale = d->depth_bias.slope;
+         raster.GlobalDepthOffsetClamp = d->depth_bias.clamp;
+      }
    }
 
    /* Stencil reference values moved from COLOR_CALC_STATE in gen8 to
@@ -213,23 +214,25 @@ genX(cmd_buffer_flush_dynamic_state)(struct anv_cmd_buffer *cmd_buffer)
    if (cmd_buffer->state.dirty & (ANV_CMD_DIRTY_PIPELINE |
                                   ANV_CMD_DIRTY_DYNAMIC_STENCIL_COMPARE_MASK |
                                   ANV_CMD_DIRTY_DYNAMIC_STENCIL_WRITE_MASK)) {
-      uint32_t wm_depth_stencil_dw[GENX(3DSTATE_WM_DEPTH_STENCIL_length)];
       struct anv_dynamic_state *d = &cmd_buffer->state.dynamic;
-
-      struct GENX(3DSTATE_WM_DEPTH_STENCIL wm_depth_stencil) = {
-         GENX(3DSTATE_WM_DEPTH_STENCIL_header),
-
-         .StencilTestMask = d->stencil_compare_mask.front & 0xff,
-         .StencilWriteMask = d->stencil_write_mask.front & 0xff,
-
-         .BackfaceStencilTestMask = d->stencil_compare_mask.back & 0xff,
-         .BackfaceStencilWriteMask = d->stencil_write_mask.back & 0xff,
-      };
-      GENX(3DSTATE_WM_DEPTH_STENCIL_pack)(NULL, wm_depth_stencil_dw,
-                                          &wm_depth_stencil);
-
-      anv_batch_emit_merge(&cmd_buffer->batch, wm_depth_stencil_dw,
-                           pipeline->gen8.wm_depth_stencil);
+      const uint32_t dw_mask =
+         anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), StencilTestMask) |
+         anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), StencilWriteMask) |
+         anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), BackfaceStencilTestMask) |
+         anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), BackfaceStencilWriteMask);
+
+      anv_batch_emit_merge_fields(&cmd_buffer->batch,
+                                  GENX(3DSTATE_WM_DEPTH_STENCIL),
+                                  pipeline->gen8.wm_depth_stencil, dw_mask,
+                                  wm_depth_stencil) {
+         wm_depth_stencil.StencilTestMask = d->stencil_compare_mask.front & 0xff;
+         wm_depth_stencil.StencilWriteMask = d->stencil_write_mask.front & 0xff;
+
+         wm_depth_stencil.BackfaceStencilTestMask =
+            d->stencil_compare_mask.back & 0xff;
+         wm_depth_stencil.BackfaceStencilWriteMask =
+            d->stencil_write_mask.back & 0xff;
+      }
    }
 #else
    if (cmd_buffer->state.dirty & ANV_CMD_DIRTY_DYNAMIC_BLEND_CONSTANTS) {
@@ -258,24 +261,32 @@ genX(cmd_buffer_flush_dynamic_state)(struct anv_cmd_buffer *cmd_buffer)
                                   ANV_CMD_DIRTY_DYNAMIC_STENCIL_COMPARE_MASK |
                                   ANV_CMD_DIRTY_DYNAMIC_STENCIL_WRITE_MASK |
                                   ANV_CMD_DIRTY_DYNAMIC_STENCIL_REFERENCE)) {
-      uint32_t dwords[GEN9_3DSTATE_WM_DEPTH_STENCIL_length];
       struct anv_dynamic_state *d = &cmd_buffer->state.dynamic;
-      struct GEN9_3DSTATE_WM_DEPTH_STENCIL wm_depth_stencil = {
-         GEN9_3DSTATE_WM_DEPTH_STENCIL_header,
-
-         .StencilTestMask = d->stencil_compare_mask.front & 0xff,
-         .StencilWriteMask = d->stencil_write_mask.front & 0xff,
-
-         .BackfaceStencilTestMask = d->stencil_compare_mask.back & 0xff,
-         .BackfaceStencilWriteMask = d->stencil_write_mask.back & 0xff,
-
-         .StencilReferenceValue = d->stencil_reference.front & 0xff,
-         .BackfaceStencilReferenceValue = d->stencil_reference.back & 0xff,
-      };
-      GEN9_3DSTATE_WM_DEPTH_STENCIL_pack(NULL, dwords, &wm_depth_stencil);
-
-      anv_batch_emit_merge(&cmd_buffer->batch, dwords,
-                           pipeline->gen9.wm_depth_stencil);
+      const uint32_t dw_mask =
+         anv_cmd_field_dw(GEN9_3DSTATE_WM_DEPTH_STENCIL, StencilTestMask) |
+         anv_cmd_field_dw(GEN9_3DSTATE_WM_DEPTH_STENCIL, StencilWriteMask) |
+         anv_cmd_field_dw(GEN9_3DSTATE_WM_DEPTH_STENCIL, BackfaceStencilTestMask) |
+         anv_cmd_field_dw(GEN9_3DSTATE_WM_DEPTH_STENCIL, BackfaceStencilWriteMask) |
+         anv_cmd_field_dw(GEN9_3DSTATE_WM_DEPTH_STENCIL, StencilReferenceValue) |
+         anv_cmd_field_dw(GEN9_3DSTATE_WM_DEPTH_STENCIL, BackfaceStencilReferenceValue);
+
+      anv_batch_emit_merge_fields(&cmd_buffer->batch,
+                                  GEN9_3DSTATE_WM_DEPTH_STENCIL,
+                                  pipeline->gen9.wm_depth_stencil, dw_mask,
+                                  wm_depth_stencil) {
+         wm_depth_stencil.StencilTestMask = d->stencil_compare_mask.front & 0xff;
+         wm_depth_stencil.StencilWriteMask = d->stencil_write_mask.front & 0xff;
+
+         wm_depth_stencil.BackfaceStencilTestMask =
+            d->stencil_compare_mask.back & 0xff;
+         wm_depth_stencil.BackfaceStencilWriteMask =
+            d->stencil_write_mask.back & 0xff;
+
+         wm_depth_stencil.StencilReferenceValue =
+            d->stencil_reference.front & 0xff;
+         wm_depth_stencil.BackfaceStencilReferenceValue =
+            d->stencil_reference.back & 0xff;
+      }
    }
 #endif
 
@@ -0,0 +1,48 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+static void *
+test_alloc(void *user_data, size_t size, size_t align,
+           VkSystemAllocationScope scope)
+{
+   return malloc(size);
+}
+
+static void *
+test_realloc(void *user_data, void *mem, size_t size, size_t align,
+             VkSystemAllocationScope scope)
+{
+   return realloc(mem, size);
+}
+
+static void
+test_free(void *user_data, void *mem)
+{
+   free(mem);
+}
+
+static const VkAllocationCallbacks test_alloc_callbacks = {
+   .pfnAllocation = test_alloc,
+   .pfnReallocation = test_realloc,
+   .pfnFree = test_free,
+};
@@ -0,0 +1,151 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Records and resets command buffers of varying sizes, once keeping the
+ * pool's batch BOs across resets and once releasing them every time.
+ */
+
+#include <time.h>
+
+#include "anv_private.h"
+#include "alloc_test_helper.h"
+
+#define NUM_CMD_BUFFERS 4
+#define NUM_ITERATIONS 2048
+#define RELOC_INTERVAL 16
+
+static struct anv_device device;
+static struct anv_bo target_bo;
+
+static void
+record(struct anv_cmd_buffer *cmd_buffer, uint32_t num_dwords)
+{
+   struct anv_batch *batch = &cmd_buffer->batch;
+
+   for (uint32_t i = 0; i < num_dwords; i += RELOC_INTERVAL) {
+      uint32_t *dw = anv_batch_emit_dwords(batch, RELOC_INTERVAL);
+      for (uint32_t j = 0; j < RELOC_INTERVAL - 2; j++)
+         dw[j] = i + j;
+
+      uint64_t offset = anv_batch_emit_reloc(batch, &dw[RELOC_INTERVAL - 2],
+                                             &target_bo, i);
+      dw[RELOC_INTERVAL - 2] = offset;
+      dw[RELOC_INTERVAL - 1] = offset >> 32;
+   }
+
+   anv_cmd_buffer_end_batch_buffer(cmd_buffer);
+}
+
+static double
+run(struct anv_cmd_pool *pool, bool release)
+{
+   struct anv_cmd_buffer cmd_buffers[NUM_CMD_BUFFERS];
+   struct timespec start, end;
+   uint32_t seed = 1;
+
+   memset(cmd_buffers, 0, sizeof(cmd_buffers));
+   for (unsigned i = 0; i < NUM_CMD_BUFFERS; i++) {
+      cmd_buffers[i].device = &device;
+      cmd_buffers[i].pool = pool;
+      cmd_buffers[i].level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+      anv_cmd_buffer_init_batch_bo_chain(&cmd_buffers[i]);
+   }
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+
+   for (unsigned i = 0; i < NUM_ITERATIONS; i++) {
+      struct anv_cmd_buffer *cmd_buffer = &cmd_buffers[i % NUM_CMD_BUFFERS];
+
+      /* Anywhere from a few draws to several chained batches */
+      seed = seed * 1103515245 + 12345;
+      const uint32_t num_dwords = 256 + (seed >> 16) % 32768;
+
+      anv_cmd_buffer_reset_batch_bo_chain(cmd_buffer);
+      if (release)
+         anv_cmd_pool_free_batch_bos(&device, pool);
+
+      record(cmd_buffer, num_dwords);
+
+      uint32_t num_relocs = 0;
+      list_for_each_entry(struct anv_batch_bo, bbo, &cmd_buffer->batch_bos,
+                          link)
+         num_relocs += bbo->relocs.num_relocs;
+
+      /* One per RELOC_INTERVAL dwords plus one per chained batch */
+      assert(num_relocs >= num_dwords / RELOC_INTERVAL);
+   }
+
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   for (unsigned i = 0; i < NUM_CMD_BUFFERS; i++)
+      anv_cmd_buffer_fini_batch_bo_chain(&cmd_buffers[i]);
+
+   return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+static void
+init_pool(struct anv_cmd_pool *pool)
+{
+   memset(pool, 0, sizeof(*pool));
+   pool->alloc = device.alloc;
+   list_inithead(&pool->cmd_buffers);
+   list_inithead(&pool->free_batch_bos);
+}
+
+int main(int argc, char **argv)
+{
+   struct anv_cmd_pool pool;
+
+   device.alloc = test_alloc_callbacks;
+   device.can_chain_batches = true;
+   pthread_mutex_init(&device.mutex, NULL);
+   anv_bo_pool_init(&device.batch_bo_pool, &device);
+   anv_block_pool_init(&device.surface_state_block_pool, &device, 4096);
+
+   init_pool(&pool);
+   const double cold = run(&pool, true);
+   assert(pool.stats.recycled == 0);
+   anv_cmd_pool_free_batch_bos(&device, &pool);
+
+   init_pool(&pool);
+   const double warm = run(&pool, false);
+
+   /* Once warm, recording never goes back to the device for batch BOs */
+   assert(pool.stats.recycled > 0);
+   assert(pool.stats.allocated < pool.stats.recycled);
+   assert(pool.free_batch_bo_size <= ANV_CMD_POOL_MAX_FREE_BATCH_SIZE);
+
+   printf("%u command buffers, %u chained batches\n",
+          pool.stats.recorded, pool.stats.chained);
+   printf("released: %.2f us/reset, recycled: %.2f us/reset\n",
+          cold * 1e6 / NUM_ITERATIONS, warm * 1e6 / NUM_ITERATIONS);
+   printf("%u batch BOs allocated, %u recycled\n",
+          pool.stats.allocated, pool.stats.recycled);
+
+   anv_cmd_pool_free_batch_bos(&device, &pool);
+   anv_block_pool_finish(&device.surface_state_block_pool);
+   anv_bo_pool_finish(&device.batch_bo_pool);
+   pthread_mutex_destroy(&device.mutex);
+
+   return 0;
+}
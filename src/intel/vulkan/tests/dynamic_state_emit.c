@@ -0,0 +1,314 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Emits the per-draw SF, RASTER and WM_DEPTH_STENCIL packets three ways:
+ * packing every field, or'ing a packed dynamic packet into the pipeline's,
+ * and packing only the dynamic dwords on top of the pipeline's.  All three
+ * have to produce the same batch.
+ */
+
+#include <time.h>
+
+#define GEN_VERSIONx10 90
+
+#include "anv_private.h"
+
+#include "genxml/gen_macros.h"
+#include "genxml/genX_pack.h"
+
+#define NUM_DRAWS (4096 * DRAWS_PER_BATCH)
+#define DRAWS_PER_BATCH 256
+
+#define DRAW_DWORDS (GENX(3DSTATE_SF_length) + \
+                     GENX(3DSTATE_RASTER_length) + \
+                     GENX(3DSTATE_WM_DEPTH_STENCIL_length))
+
+/* API state the static fields are derived from */
+struct pipeline_info {
+   uint32_t front_winding;
+   uint32_t cull_mode;
+   uint32_t fill_mode;
+   bool depth_bias_enable;
+   uint32_t depth_compare_op;
+   uint32_t stencil_compare_op[2];
+   uint32_t stencil_pass_op[2];
+};
+
+struct pipeline {
+   struct pipeline_info info;
+
+   uint32_t sf[GENX(3DSTATE_SF_length)];
+   uint32_t raster[GENX(3DSTATE_RASTER_length)];
+   uint32_t wm_depth_stencil[GENX(3DSTATE_WM_DEPTH_STENCIL_length)];
+};
+
+struct dynamic {
+   float line_width;
+   float depth_bias, depth_slope, depth_clamp;
+   uint32_t compare_mask, write_mask, reference;
+};
+
+static void
+static_sf(struct GENX(3DSTATE_SF) *sf, const struct pipeline_info *info)
+{
+   sf->ViewportTransformEnable = true;
+   sf->TriangleFanProvokingVertexSelect = 1;
+   sf->PointWidthSource = Vertex;
+   sf->PointWidth = 1.0;
+}
+
+static void
+static_raster(struct GENX(3DSTATE_RASTER) *raster,
+              const struct pipeline_info *info)
+{
+   raster->DXMultisampleRasterizationEnable = true;
+   raster->FrontWinding = info->front_winding;
+   raster->CullMode = info->cull_mode;
+   raster->FrontFaceFillMode = info->fill_mode;
+   raster->BackFaceFillMode = info->fill_mode;
+   raster->ScissorRectangleEnable = true;
+   raster->ViewportZFarClipTestEnable = true;
+   raster->ViewportZNearClipTestEnable = true;
+   raster->GlobalDepthOffsetEnableSolid = info->depth_bias_enable;
+   raster->GlobalDepthOffsetEnableWireframe = info->depth_bias_enable;
+   raster->GlobalDepthOffsetEnablePoint = info->depth_bias_enable;
+}
+
+static void
+static_wm_depth_stencil(struct GENX(3DSTATE_WM_DEPTH_STENCIL) *ds,
+                        const struct pipeline_info *info)
+{
+   ds->DepthTestEnable = true;
+   ds->DepthBufferWriteEnable = true;
+   ds->DepthTestFunction = info->depth_compare_op;
+   ds->StencilTestEnable = true;
+   ds->StencilBufferWriteEnable = true;
+   ds->StencilTestFunction = info->stencil_compare_op[0];
+   ds->StencilPassDepthPassOp = info->stencil_pass_op[0];
+   ds->DoubleSidedStencilEnable = true;
+   ds->BackfaceStencilTestFunction = info->stencil_compare_op[1];
+   ds->BackfaceStencilPassDepthPassOp = info->stencil_pass_op[1];
+}
+
+static void
+pack_pipeline(struct pipeline *pipeline)
+{
+   struct GENX(3DSTATE_SF) sf = { GENX(3DSTATE_SF_header) };
+   struct GENX(3DSTATE_RASTER) raster = { GENX(3DSTATE_RASTER_header) };
+   struct GENX(3DSTATE_WM_DEPTH_STENCIL) ds = {
+      GENX(3DSTATE_WM_DEPTH_STENCIL_header)
+   };
+
+   static_sf(&sf, &pipeline->info);
+   static_raster(&raster, &pipeline->info);
+   static_wm_depth_stencil(&ds, &pipeline->info);
+
+   GENX(3DSTATE_SF_pack)(NULL, pipeline->sf, &sf);
+   GENX(3DSTATE_RASTER_pack)(NULL, pipeline->raster, &raster);
+   GENX(3DSTATE_WM_DEPTH_STENCIL_pack)(NULL, pipeline->wm_depth_stencil, &ds);
+}
+
+static void
+emit_full(struct anv_batch *batch, const struct pipeline *pipeline,
+          const struct dynamic *d)
+{
+   anv_batch_emit(batch, GENX(3DSTATE_SF), sf) {
+      static_sf(&sf, &pipeline->info);
+      sf.LineWidth = d->line_width;
+   }
+
+   anv_batch_emit(batch, GENX(3DSTATE_RASTER), raster) {
+      static_raster(&raster, &pipeline->info);
+      raster.GlobalDepthOffsetConstant = d->depth_bias;
+      raster.GlobalDepthOffsetScale = d->depth_slope;
+      raster.GlobalDepthOffsetClamp = d->depth_clamp;
+   }
+
+   anv_batch_emit(batch, GENX(3DSTATE_WM_DEPTH_STENCIL), ds) {
+      static_wm_depth_stencil(&ds, &pipeline->info);
+      ds.StencilTestMask = d->compare_mask;
+      ds.StencilWriteMask = d->write_mask;
+      ds.BackfaceStencilTestMask = d->compare_mask;
+      ds.BackfaceStencilWriteMask = d->write_mask;
+      ds.StencilReferenceValue = d->reference;
+      ds.BackfaceStencilReferenceValue = d->reference;
+   }
+}
+
+static void
+emit_merge(struct anv_batch *batch, const struct pipeline *pipeline,
+           const struct dynamic *d)
+{
+   uint32_t sf_dw[GENX(3DSTATE_SF_length)];
+   struct GENX(3DSTATE_SF) sf = {
+      GENX(3DSTATE_SF_header),
+      .LineWidth = d->line_width,
+   };
+   GENX(3DSTATE_SF_pack)(NULL, sf_dw, &sf);
+   anv_batch_emit_merge(batch, sf_dw, pipeline->sf);
+
+   uint32_t raster_dw[GENX(3DSTATE_RASTER_length)];
+   struct GENX(3DSTATE_RASTER) raster = {
+      GENX(3DSTATE_RASTER_header),
+      .GlobalDepthOffsetConstant = d->depth_bias,
+      .GlobalDepthOffsetScale = d->depth_slope,
+      .GlobalDepthOffsetClamp = d->depth_clamp,
+   };
+   GENX(3DSTATE_RASTER_pack)(NULL, raster_dw, &raster);
+   anv_batch_emit_merge(batch, raster_dw, pipeline->raster);
+
+   uint32_t ds_dw[GENX(3DSTATE_WM_DEPTH_STENCIL_length)];
+   struct GENX(3DSTATE_WM_DEPTH_STENCIL) ds = {
+      GENX(3DSTATE_WM_DEPTH_STENCIL_header),
+      .StencilTestMask = d->compare_mask,
+      .StencilWriteMask = d->write_mask,
+      .BackfaceStencilTestMask = d->compare_mask,
+      .BackfaceStencilWriteMask = d->write_mask,
+      .StencilReferenceValue = d->reference,
+      .BackfaceStencilReferenceValue = d->reference,
+   };
+   GENX(3DSTATE_WM_DEPTH_STENCIL_pack)(NULL, ds_dw, &ds);
+   anv_batch_emit_merge(batch, ds_dw, pipeline->wm_depth_stencil);
+}
+
+static void
+emit_merge_fields(struct anv_batch *batch, const struct pipeline *pipeline,
+                  const struct dynamic *d)
+{
+   anv_batch_emit_merge_fields(batch, GENX(3DSTATE_SF), pipeline->sf,
+                               anv_cmd_field_dw(GENX(3DSTATE_SF), LineWidth),
+                               sf) {
+      sf.LineWidth = d->line_width;
+   }
+
+   const uint32_t raster_mask =
+      anv_cmd_field_dw(GENX(3DSTATE_RASTER), GlobalDepthOffsetConstant) |
+      anv_cmd_field_dw(GENX(3DSTATE_RASTER), GlobalDepthOffsetScale) |
+      anv_cmd_field_dw(GENX(3DSTATE_RASTER), GlobalDepthOffsetClamp);
+
+   anv_batch_emit_merge_fields(batch, GENX(3DSTATE_RASTER), pipeline->raster,
+                               raster_mask, raster) {
+      raster.GlobalDepthOffsetConstant = d->depth_bias;
+      raster.GlobalDepthOffsetScale = d->depth_slope;
+      raster.GlobalDepthOffsetClamp = d->depth_clamp;
+   }
+
+   const uint32_t ds_mask =
+      anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), StencilTestMask) |
+      anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), StencilWriteMask) |
+      anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), BackfaceStencilTestMask) |
+      anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), BackfaceStencilWriteMask) |
+      anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), StencilReferenceValue) |
+      anv_cmd_field_dw(GENX(3DSTATE_WM_DEPTH_STENCIL), BackfaceStencilReferenceValue);
+
+   anv_batch_emit_merge_fields(batch, GENX(3DSTATE_WM_DEPTH_STENCIL),
+                               pipeline->wm_depth_stencil, ds_mask, ds) {
+      ds.StencilTestMask = d->compare_mask;
+      ds.StencilWriteMask = d->write_mask;
+      ds.BackfaceStencilTestMask = d->compare_mask;
+      ds.BackfaceStencilWriteMask = d->write_mask;
+      ds.StencilReferenceValue = d->reference;
+      ds.BackfaceStencilReferenceValue = d->reference;
+   }
+}
+
+typedef void (*emit_func)(struct anv_batch *batch,
+                          const struct pipeline *pipeline,
+                          const struct dynamic *d);
+
+static uint32_t batch_data[3][DRAWS_PER_BATCH * DRAW_DWORDS];
+
+static void
+get_dynamic(unsigned draw, struct dynamic *d)
+{
+   d->line_width = 1.0f + (draw % 7);
+   d->depth_bias = draw % 13 * 0.5f;
+   d->depth_slope = draw % 5 * 0.25f;
+   d->depth_clamp = draw % 3;
+   d->compare_mask = draw & 0xff;
+   d->write_mask = (draw >> 8) & 0xff;
+   d->reference = (draw >> 16) & 0xff;
+}
+
+static double
+run(emit_func emit, const struct pipeline *pipeline, uint32_t *data)
+{
+   struct anv_batch batch = {
+      .start = data,
+      .end = data + DRAWS_PER_BATCH * DRAW_DWORDS,
+   };
+   struct timespec start, end;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+
+   for (unsigned i = 0; i < NUM_DRAWS; i++) {
+      struct dynamic d;
+
+      if (i % DRAWS_PER_BATCH == 0)
+         batch.next = batch.start;
+
+      get_dynamic(i, &d);
+      emit(&batch, pipeline, &d);
+   }
+
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   assert(batch.next == batch.end);
+
+   return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+   struct pipeline pipeline;
+   static const struct {
+      const char *name;
+      emit_func emit;
+   } funcs[] = {
+      { "full pack", emit_full },
+      { "pack and merge", emit_merge },
+      { "merge fields", emit_merge_fields },
+   };
+
+   pipeline.info = (struct pipeline_info) {
+      .front_winding = CounterClockwise,
+      .cull_mode = CULLMODE_BACK,
+      .fill_mode = FILL_MODE_SOLID,
+      .depth_bias_enable = argc > 1,
+      .depth_compare_op = COMPAREFUNCTION_LESS,
+      .stencil_compare_op = { COMPAREFUNCTION_EQUAL, COMPAREFUNCTION_NOTEQUAL },
+      .stencil_pass_op = { STENCILOP_INCR, STENCILOP_DECR },
+   };
+   pack_pipeline(&pipeline);
+
+   for (unsigned i = 0; i < ARRAY_SIZE(funcs); i++) {
+      const double secs = run(funcs[i].emit, &pipeline, batch_data[i]);
+      printf("%-16s %6.1f ns/draw\n", funcs[i].name, secs * 1e9 / NUM_DRAWS);
+   }
+
+   /* The last batch of each run holds the same draws */
+   for (unsigned i = 1; i < ARRAY_SIZE(funcs); i++)
+      assert(memcmp(batch_data[0], batch_data[i], sizeof(batch_data[0])) == 0);
+
+   return 0;
+}
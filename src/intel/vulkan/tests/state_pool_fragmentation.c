@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+
+#include "anv_private.h"
+
+#define BLOCK_SIZE 16384
+#define NUM_STATES 4096
+#define NUM_RUNS 4
+
+static uint32_t
+test_size(unsigned i)
+{
+   /* A mix of small states and a few larger ones, like kernels */
+   if (i % 16 == 0)
+      return 1 + (i * 2654435761u) % BLOCK_SIZE;
+   else
+      return 1 + (i * 2654435761u) % 1024;
+}
+
+static uint32_t
+test_align(unsigned i)
+{
+   return 1 << ((i / 3) % 8);
+}
+
+static int
+compare_offsets(const void *a, const void *b)
+{
+   const struct anv_state *sa = a, *sb = b;
+   return sa->offset - sb->offset;
+}
+
+static uint32_t
+alloc_states(struct anv_state_pool *pool, struct anv_state *states)
+{
+   uint32_t used = 0;
+
+   for (unsigned i = 0; i < NUM_STATES; i++) {
+      const uint32_t size = test_size(i), align = test_align(i);
+
+      states[i] = anv_state_pool_alloc(pool, size, align);
+      assert(states[i].offset > 0);
+      assert(states[i].offset % align == 0);
+      assert(states[i].alloc_size >= size);
+      memset(states[i].map, i & 0xff, states[i].alloc_size);
+
+      /* No more than a cache line or a fifth of the state is wasted, unless
+       * the alignment forces a power-of-two size.
+       */
+      if (align <= 64) {
+         const uint32_t waste = states[i].alloc_size - size;
+         assert(waste < 64 || waste * 5 < states[i].alloc_size);
+      }
+
+      used += states[i].alloc_size;
+   }
+
+   return used;
+}
+
+static void
+check_states(struct anv_state *states)
+{
+   for (unsigned i = 0; i < NUM_STATES; i++) {
+      const uint8_t *map = states[i].map;
+      for (unsigned j = 0; j < states[i].alloc_size; j++)
+         assert(map[j] == (i & 0xff));
+   }
+
+   /* States never overlap and never straddle a block boundary */
+   struct anv_state sorted[NUM_STATES];
+   memcpy(sorted, states, sizeof(sorted));
+   qsort(sorted, NUM_STATES, sizeof(sorted[0]), compare_offsets);
+   for (unsigned i = 0; i < NUM_STATES; i++) {
+      const uint32_t end = sorted[i].offset + sorted[i].alloc_size;
+      assert(i + 1 == NUM_STATES || end <= sorted[i + 1].offset);
+      assert(sorted[i].offset / BLOCK_SIZE == (end - 1) / BLOCK_SIZE);
+   }
+}
+
+int main(int argc, char **argv)
+{
+   struct anv_device device;
+   struct anv_block_pool block_pool;
+   struct anv_state_pool state_pool;
+   struct anv_state states[NUM_STATES];
+
+   pthread_mutex_init(&device.mutex, NULL);
+   anv_block_pool_init(&block_pool, &device, BLOCK_SIZE);
+   anv_state_pool_init(&state_pool, &block_pool);
+
+   /* Grab one so a zero offset is impossible */
+   anv_state_pool_alloc(&state_pool, 16, 16);
+
+   uint32_t requested = 0, pow2 = 0;
+   for (unsigned i = 0; i < NUM_STATES; i++) {
+      const uint32_t size = MAX2(test_size(i), test_align(i));
+      requested += size;
+      uint32_t pow2_size = 64;
+      while (pow2_size < size)
+         pow2_size <<= 1;
+      pow2 += pow2_size;
+   }
+
+   uint32_t used = alloc_states(&state_pool, states);
+   check_states(states);
+
+   const uint32_t pool_size = block_pool.state.next;
+   printf("requested %u, allocated %u (%u with power-of-two sizes), "
+          "block pool %u\n", requested, used, pow2, pool_size);
+   assert(used < pow2);
+
+   /* Once everything is freed, the same states are served from the free
+    * lists without growing the block pool.
+    */
+   for (unsigned r = 0; r < NUM_RUNS; r++) {
+      for (unsigned i = 0; i < NUM_STATES; i++)
+         anv_state_pool_free(&state_pool, states[i]);
+
+      alloc_states(&state_pool, states);
+      check_states(states);
+      assert(block_pool.state.next == pool_size);
+   }
+
+   anv_state_pool_finish(&state_pool);
+   anv_block_pool_finish(&block_pool);
+   pthread_mutex_destroy(&device.mutex);
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+#include <time.h>
+
+#include "anv_private.h"
+
+#define NUM_THREADS 8
+#define NUM_ITERATIONS 1024
+#define STATES_PER_ITERATION 64
+
+struct job {
+   struct anv_state_pool *pool;
+   unsigned id;
+   pthread_t thread;
+} jobs[NUM_THREADS];
+
+pthread_barrier_t barrier;
+
+static void *alloc_states(void *void_job)
+{
+   struct job *job = void_job;
+   struct anv_state states[STATES_PER_ITERATION];
+   uint32_t seed = job->id;
+
+   pthread_barrier_wait(&barrier);
+
+   for (unsigned c = 0; c < NUM_ITERATIONS; c++) {
+      for (unsigned i = 0; i < STATES_PER_ITERATION; i++) {
+         seed = seed * 1103515245 + 12345;
+         const uint32_t size = 1 + (seed >> 16) % 2048;
+
+         states[i] = anv_state_pool_alloc(job->pool, size, 64);
+         assert(states[i].offset != 0);
+         assert(states[i].alloc_size >= size);
+         memset(states[i].map, job->id, states[i].alloc_size);
+      }
+
+      /* Nobody else wrote to our states */
+      for (unsigned i = 0; i < STATES_PER_ITERATION; i++) {
+         const uint8_t *map = states[i].map;
+         for (unsigned j = 0; j < states[i].alloc_size; j += 64)
+            assert(map[j] == job->id);
+         anv_state_pool_free(job->pool, states[i]);
+      }
+   }
+
+   return NULL;
+}
+
+int main(int argc, char **argv)
+{
+   struct anv_device device;
+   struct anv_block_pool block_pool;
+   struct anv_state_pool state_pool;
+   struct timespec start, end;
+
+   pthread_mutex_init(&device.mutex, NULL);
+   anv_block_pool_init(&block_pool, &device, 16384);
+   anv_state_pool_init(&state_pool, &block_pool);
+
+   /* Grab one so a zero offset is impossible */
+   anv_state_pool_alloc(&state_pool, 16, 16);
+
+   pthread_barrier_init(&barrier, NULL, NUM_THREADS);
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+
+   for (unsigned i = 0; i < NUM_THREADS; i++) {
+      jobs[i].pool = &state_pool;
+      jobs[i].id = i;
+      pthread_create(&jobs[i].thread, NULL, alloc_states, &jobs[i]);
+   }
+
+   for (unsigned i = 0; i < NUM_THREADS; i++)
+      pthread_join(jobs[i].thread, NULL);
+
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   const double secs = (end.tv_sec - start.tv_sec) +
+                       (end.tv_nsec - start.tv_nsec) * 1e-9;
+   printf("%u threads: %.2f million states/s\n", NUM_THREADS,
+          NUM_THREADS * NUM_ITERATIONS * STATES_PER_ITERATION / secs / 1e6);
+
+   pthread_barrier_destroy(&barrier);
+   anv_state_pool_finish(&state_pool);
+   anv_block_pool_finish(&block_pool);
+   pthread_mutex_destroy(&device.mutex);
+}
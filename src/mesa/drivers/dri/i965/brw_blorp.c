@@ -104,6 +104,12 @@ brw_blorp_init(struct brw_context *brw)
 
    brw->blorp.lookup_shader = brw_blorp_lookup_shader;
    brw->blorp.upload_shader = brw_blorp_upload_shader;
+
+   /* The program cache only lives as long as the context */
+   if (brw->screen->disk_cache.cache)
+      brw->blorp.disk_cache = &brw->screen->disk_cache;
+   memcpy(brw->blorp.cache_id, brw->screen->cache_id,
+          sizeof(brw->blorp.cache_id));
 }
 
 static void
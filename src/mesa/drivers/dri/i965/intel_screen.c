@@ -23,9 +23,11 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <dlfcn.h>
 #include <errno.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include "main/context.h"
 #include "main/framebuffer.h"
 #include "main/renderbuffer.h"
@@ -1019,11 +1021,52 @@ intel_get_integer(struct intel_screen *screen, int param)
    return -1;
 }
 
+static bool
+intel_screen_get_cache_id(uint8_t *cache_id)
+{
+   Dl_info info;
+   struct stat st;
+
+   memset(cache_id, 0, BLORP_CACHE_ID_SIZE);
+   if (!dladdr(intel_screen_get_cache_id, &info) || !info.dli_fname)
+      return false;
+
+   if (stat(info.dli_fname, &st))
+      return false;
+
+   snprintf((char *) cache_id, BLORP_CACHE_ID_SIZE, "i965-%d",
+            (int) st.st_mtim.tv_sec);
+   return true;
+}
+
+/** Queued BLORP kernels beyond this size aren't written to the disk cache */
+#define INTEL_DISK_CACHE_MAX_PENDING_SIZE (4 * 1024 * 1024)
+
+/**
+ * Kernels compiled by BLORP only depend on the driver build and the device,
+ * so they are kept across runs.  The cache is keyed on the build timestamp
+ * of the driver, and not used at all if that can't be determined.
+ */
+static void
+intel_screen_init_disk_cache(struct intel_screen *screen)
+{
+   if (screen->devinfo.gen < 6)
+      return;
+
+   if (!intel_screen_get_cache_id(screen->cache_id))
+      return;
+
+   gen_disk_cache_init(&screen->disk_cache,
+                       INTEL_DISK_CACHE_MAX_PENDING_SIZE);
+}
+
 static void
 intelDestroyScreen(__DRIscreen * sPriv)
 {
    struct intel_screen *screen = sPriv->driverPrivate;
 
+   gen_disk_cache_finish(&screen->disk_cache);
+
    dri_bufmgr_destroy(screen->bufmgr);
    driDestroyOptionInfo(&screen->optionCache);
 
@@ -1701,7 +1744,16 @@ __DRIconfig **intelInitScreen2(__DRIscreen *dri_screen)
         intel_get_boolean(screen, I915_PARAM_HAS_RESOURCE_STREAMER);
    }
 
-   return (const __DRIconfig**) intel_screen_make_configs(dri_screen);
+   __DRIconfig **configs = intel_screen_make_configs(dri_screen);
+   if (configs == NULL)
+      return NULL;
+
+   /* The loader doesn't call intelDestroyScreen if this function fails, so
+    * the cache and its writer thread are only set up once nothing else can.
+    */
+   intel_screen_init_disk_cache(screen);
+
+   return (const __DRIconfig**) configs;
 }
 
 struct intel_buffer {
@@ -34,6 +34,8 @@
 #include "dri_util.h"
 #include "intel_bufmgr.h"
 #include "common/gen_device_info.h"
+#include "common/gen_disk_cache.h"
+#include "blorp/blorp.h"
 #include "i915_drm.h"
 #include "xmlconfig.h"
 
@@ -79,6 +81,15 @@ struct intel_screen
 
    struct brw_compiler *compiler;
 
+   /**
+    * Persistent store for BLORP kernels, shared by all contexts.
+    * disk_cache.cache is NULL if the shader cache is disabled.
+    */
+   struct gen_disk_cache disk_cache;
+
+   /** Identifies this build of the driver in disk_cache */
+   uint8_t cache_id[BLORP_CACHE_ID_SIZE];
+
    /**
    * Configuration cache with default values for all contexts
    */
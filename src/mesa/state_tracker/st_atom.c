@@ -31,6 +31,7 @@
 #include "main/context.h"
 
 #include "pipe/p_defines.h"
+#include "util/trace_event.h"
 #include "st_context.h"
 #include "st_atom.h"
 #include "st_program.h"
@@ -157,6 +158,8 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
    uint64_t dirty, pipeline_mask;
    uint32_t dirty_lo, dirty_hi;
 
+   trace_event_begin("st_validate_state");
+
    /* Get Mesa driver state.
     *
     * Inactive states are shader states not used by shaders at the moment.
@@ -197,8 +200,10 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
    }
 
    dirty = st->dirty & pipeline_mask;
-   if (!dirty)
+   if (!dirty) {
+      trace_event_end("st_validate_state");
       return;
+   }
 
    dirty_lo = dirty;
    dirty_hi = dirty >> 32;
@@ -214,4 +219,6 @@ void st_validate_state( struct st_context *st, enum st_pipeline pipeline )
 
    /* Clear the render or compute state bits. */
    st->dirty &= ~pipeline_mask;
+
+   trace_event_end("st_validate_state");
 }
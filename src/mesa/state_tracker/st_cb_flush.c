@@ -44,6 +44,7 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "util/u_gen_mipmap.h"
+#include "util/trace_event.h"
 
 
 /** Check if we have a front color buffer and if it's been drawn to. */
@@ -84,7 +85,9 @@ void st_flush(struct st_context *st,
 
    st_flush_bitmap_cache(st);
 
+   trace_event_begin("flush");
    st->pipe->flush(st->pipe, fence, flags);
+   trace_event_end("flush");
 }
 
 
@@ -98,8 +101,10 @@ void st_finish( struct st_context *st )
    st_flush(st, &fence, 0);
 
    if(fence) {
+      trace_event_begin("fence wait");
       st->pipe->screen->fence_finish(st->pipe->screen, NULL, fence,
                                      PIPE_TIMEOUT_INFINITE);
+      trace_event_end("fence wait");
       st->pipe->screen->fence_reference(st->pipe->screen, &fence, NULL);
    }
 }
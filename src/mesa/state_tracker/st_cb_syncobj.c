@@ -34,6 +34,7 @@
 #include "main/macros.h"
 #include "pipe/p_context.h"
 #include "pipe/p_screen.h"
+#include "util/trace_event.h"
 #include "st_context.h"
 #include "st_cb_syncobj.h"
 
@@ -117,12 +118,14 @@ static void st_client_wait_sync(struct gl_context *ctx,
     * Assume GL_SYNC_FLUSH_COMMANDS_BIT is always set, because applications
     * forget to set it.
     */
+   trace_event_begin("fence wait");
    if (screen->fence_finish(screen, pipe, fence, timeout)) {
       mtx_lock(&so->mutex);
       screen->fence_reference(screen, &so->fence, NULL);
       mtx_unlock(&so->mutex);
       so->b.StatusFlag = GL_TRUE;
    }
+   trace_event_end("fence wait");
    screen->fence_reference(screen, &fence, NULL);
 }
 
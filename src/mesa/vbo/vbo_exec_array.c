@@ -38,6 +38,7 @@
 #include "main/enums.h"
 #include "main/macros.h"
 #include "main/transformfeedback.h"
+#include "util/trace_event.h"
 
 #include "vbo_context.h"
 
@@ -409,6 +410,8 @@ vbo_draw_arrays(struct gl_context *ctx, GLenum mode, GLint start,
    struct vbo_context *vbo = vbo_context(ctx);
    struct _mesa_prim prim[2];
 
+   trace_event_begin("glDrawArrays");
+
    vbo_bind_arrays(ctx);
 
    /* init most fields to zero */
@@ -472,6 +475,8 @@ vbo_draw_arrays(struct gl_context *ctx, GLenum mode, GLint start,
    if (MESA_DEBUG_FLAGS & DEBUG_ALWAYS_FLUSH) {
       _mesa_flush(ctx);
    }
+
+   trace_event_end("glDrawArrays");
 }
 
 
@@ -758,6 +763,8 @@ vbo_validated_drawrangeelements(struct gl_context *ctx, GLenum mode,
    struct _mesa_index_buffer ib;
    struct _mesa_prim prim[1];
 
+   trace_event_begin("glDrawElements");
+
    vbo_bind_arrays(ctx);
 
    ib.count = count;
@@ -816,6 +823,8 @@ vbo_validated_drawrangeelements(struct gl_context *ctx, GLenum mode,
    if (MESA_DEBUG_FLAGS & DEBUG_ALWAYS_FLUSH) {
       _mesa_flush(ctx);
    }
+
+   trace_event_end("glDrawElements");
 }
 
 
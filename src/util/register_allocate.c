@@ -68,6 +68,14 @@
  * up front and stored in a 2-dimensional array, so that the cost of
  * coloring a node is constant with the number of registers.  We do
  * this during ra_set_finalize().
+ *
+ * Simplification is driven by a worklist: a node's q total only ever
+ * decreases while nodes are being removed from the graph, so a node
+ * becomes trivially colorable at most once, at the moment one of its
+ * neighbors is pushed on the stack.  This keeps ra_simplify() linear in
+ * the size of the graph instead of rescanning every node until no more
+ * progress is made, which matters for shaders with many thousands of
+ * virtual registers.
  */
 
 #include <stdbool.h>
@@ -156,6 +164,14 @@ struct ra_node {
     * approximate cost of spilling this node.
     */
    float spill_cost;
+
+   /**
+    * The benefit of spilling this node.  It only depends on the node's
+    * class and on the classes of its neighbors, so it is accumulated as
+    * interferences are added rather than recomputed for each
+    * ra_get_best_spill_node().
+    */
+   float spill_benefit;
 };
 
 struct ra_graph {
@@ -166,9 +182,35 @@ struct ra_graph {
    struct ra_node *nodes;
    unsigned int count; /**< count of nodes. */
 
+   /**
+    * Storage for the adjacency bitsets of all the nodes, allocated as a
+    * single count x BITSET_WORDS(count) matrix so that the rows of
+    * neighboring nodes are also neighbors in memory.
+    */
+   BITSET_WORD *adjacency;
+
    unsigned int *stack;
    unsigned int stack_count;
 
+   /**
+    * FIFO of nodes that passed the pq test and are waiting to be pushed on
+    * the stack by ra_simplify().  Each node enters it at most once.
+    */
+   unsigned int *worklist;
+   unsigned int worklist_head;
+   unsigned int worklist_tail;
+
+   /**
+    * Nodes that may still need to be simplified, in increasing order.  This
+    * is compacted lazily when looking for an optimistic node, so that
+    * choosing one doesn't have to walk the whole graph again.
+    */
+   unsigned int *remaining;
+   unsigned int remaining_count;
+
+   /** Scratch bitset of the registers conflicting with a node's neighbors. */
+   BITSET_WORD *reg_conflicts;
+
    /**
     * Tracks the start of the set of optimistically-colored registers in the
     * stack.
@@ -396,6 +438,15 @@ ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
       int n1_class = g->nodes[n1].class;
       int n2_class = g->nodes[n2].class;
       g->nodes[n1].q_total += g->regs->classes[n1_class]->q[n2_class];
+
+      /* Define the benefit of eliminating an interference between n1, n2
+       * through spilling as q(C, B) / p(C).  This is similar to the
+       * "count number of edges" approach of traditional graph coloring,
+       * but takes classes into account.
+       */
+      g->nodes[n1].spill_benefit +=
+         ((float)g->regs->classes[n1_class]->q[n2_class] /
+          g->regs->classes[n1_class]->p);
    }
 
    if (g->nodes[n1].adjacency_count >=
@@ -414,6 +465,7 @@ struct ra_graph *
 ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
 {
    struct ra_graph *g;
+   unsigned int bitset_count = BITSET_WORDS(count);
    unsigned int i;
 
    g = rzalloc(NULL, struct ra_graph);
@@ -421,11 +473,15 @@ ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
    g->nodes = rzalloc_array(g, struct ra_node, count);
    g->count = count;
 
+   g->adjacency = rzalloc_array(g, BITSET_WORD, (size_t)count * bitset_count);
+
    g->stack = rzalloc_array(g, unsigned int, count);
+   g->worklist = ralloc_array(g, unsigned int, count);
+   g->remaining = ralloc_array(g, unsigned int, count);
+   g->reg_conflicts = ralloc_array(g, BITSET_WORD, BITSET_WORDS(regs->count));
 
    for (i = 0; i < count; i++) {
-      int bitset_count = BITSET_WORDS(count);
-      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
+      g->nodes[i].adjacency = &g->adjacency[(size_t)i * bitset_count];
 
       g->nodes[i].adjacency_list_size = 4;
       g->nodes[i].adjacency_list =
@@ -465,21 +521,80 @@ pq_test(struct ra_graph *g, unsigned int n)
    return g->nodes[n].q_total < g->regs->classes[n_class]->p;
 }
 
+/**
+ * Returns true if the node still has to go through simplification.
+ */
+static bool
+ra_node_is_unsimplified(struct ra_graph *g, unsigned int n)
+{
+   return !g->nodes[n].in_stack && g->nodes[n].reg == NO_REG;
+}
+
+static void
+ra_worklist_push(struct ra_graph *g, unsigned int n)
+{
+   assert(g->worklist_tail < g->count);
+   g->worklist[g->worklist_tail++] = n;
+}
+
+/**
+ * Removes a node from the graph by pushing it on the stack, and updates
+ * the q totals of its neighbors.  Any neighbor that becomes trivially
+ * colorable as a result is added to the worklist.
+ */
 static void
-decrement_q(struct ra_graph *g, unsigned int n)
+ra_push_node(struct ra_graph *g, unsigned int n)
 {
    unsigned int i;
    int n_class = g->nodes[n].class;
 
+   g->stack[g->stack_count] = n;
+   g->stack_count++;
+   g->nodes[n].in_stack = true;
+
    for (i = 0; i < g->nodes[n].adjacency_count; i++) {
       unsigned int n2 = g->nodes[n].adjacency_list[i];
       unsigned int n2_class = g->nodes[n2].class;
 
       if (n != n2 && !g->nodes[n2].in_stack) {
+         bool was_colorable = pq_test(g, n2);
+
          assert(g->nodes[n2].q_total >= g->regs->classes[n2_class]->q[n_class]);
          g->nodes[n2].q_total -= g->regs->classes[n2_class]->q[n_class];
+
+         if (!was_colorable && pq_test(g, n2) && g->nodes[n2].reg == NO_REG)
+            ra_worklist_push(g, n2);
+      }
+   }
+}
+
+/**
+ * Returns the remaining node with the lowest q total, or ~0 if every node
+ * has been simplified.  Ties go to the highest-numbered node.
+ */
+static unsigned int
+ra_find_optimistic_node(struct ra_graph *g)
+{
+   unsigned int best_optimistic_node = ~0;
+   unsigned int lowest_q_total = ~0;
+   unsigned int i, count = 0;
+
+   for (i = 0; i < g->remaining_count; i++) {
+      unsigned int n = g->remaining[i];
+
+      if (!ra_node_is_unsimplified(g, n))
+         continue;
+
+      g->remaining[count++] = n;
+
+      if (g->nodes[n].q_total <= lowest_q_total) {
+         best_optimistic_node = n;
+         lowest_q_total = g->nodes[n].q_total;
       }
    }
+   g->remaining_count = count;
+
+   return best_optimistic_node;
 }
 
 /**
@@ -495,45 +610,38 @@ decrement_q(struct ra_graph *g, unsigned int n)
 static void
 ra_simplify(struct ra_graph *g)
 {
-   bool progress = true;
    unsigned int stack_optimistic_start = UINT_MAX;
-   int i;
-
-   while (progress) {
-      unsigned int best_optimistic_node = ~0;
-      unsigned int lowest_q_total = ~0;
-
-      progress = false;
-
-      for (i = g->count - 1; i >= 0; i--) {
-	 if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
-	    continue;
-
-	 if (pq_test(g, i)) {
-	    decrement_q(g, i);
-	    g->stack[g->stack_count] = i;
-	    g->stack_count++;
-	    g->nodes[i].in_stack = true;
-	    progress = true;
-	 } else {
-	    unsigned int new_q_total = g->nodes[i].q_total;
-	    if (new_q_total < lowest_q_total) {
-	       best_optimistic_node = i;
-	       lowest_q_total = new_q_total;
-	    }
-	 }
-      }
+   unsigned int i;
+   int n;
 
-      if (!progress && best_optimistic_node != ~0U) {
-         if (stack_optimistic_start == UINT_MAX)
-            stack_optimistic_start = g->stack_count;
+   g->worklist_head = 0;
+   g->worklist_tail = 0;
+   g->remaining_count = 0;
 
-	 decrement_q(g, best_optimistic_node);
-	 g->stack[g->stack_count] = best_optimistic_node;
-	 g->stack_count++;
-	 g->nodes[best_optimistic_node].in_stack = true;
-	 progress = true;
-      }
+   for (i = 0; i < g->count; i++) {
+      if (ra_node_is_unsimplified(g, i))
+         g->remaining[g->remaining_count++] = i;
+   }
+
+   for (n = g->count - 1; n >= 0; n--) {
+      if (ra_node_is_unsimplified(g, n) && pq_test(g, n))
+         ra_worklist_push(g, n);
+   }
+
+   while (true) {
+      unsigned int best_optimistic_node;
+
+      while (g->worklist_head != g->worklist_tail)
+         ra_push_node(g, g->worklist[g->worklist_head++]);
+
+      best_optimistic_node = ra_find_optimistic_node(g);
+      if (best_optimistic_node == ~0U)
+         break;
+
+      if (stack_optimistic_start == UINT_MAX)
+         stack_optimistic_start = g->stack_count;
+
+      ra_push_node(g, best_optimistic_node);
    }
 
    g->stack_optimistic_start = stack_optimistic_start;
@@ -551,31 +659,38 @@ ra_select(struct ra_graph *g)
 {
    int start_search_reg = 0;
 
+   unsigned int reg_words = BITSET_WORDS(g->regs->count);
+
    while (g->stack_count != 0) {
-      unsigned int i;
+      unsigned int i, w;
       unsigned int ri;
       unsigned int r = -1;
       int n = g->stack[g->stack_count - 1];
       struct ra_class *c = g->regs->classes[g->nodes[n].class];
 
+      /* Gather the registers that conflict with the choices already made
+       * by our neighbors.  Register conflicts are symmetric, so this is
+       * the set of registers that would conflict with one of them.
+       */
+      memset(g->reg_conflicts, 0, reg_words * sizeof(BITSET_WORD));
+      for (i = 0; i < g->nodes[n].adjacency_count; i++) {
+         unsigned int n2 = g->nodes[n].adjacency_list[i];
+         unsigned int n2_reg = g->nodes[n2].reg;
+
+         if (g->nodes[n2].in_stack || n2_reg == NO_REG)
+            continue;
+
+         for (w = 0; w < reg_words; w++)
+            g->reg_conflicts[w] |= g->regs->regs[n2_reg].conflicts[w];
+      }
+
       /* Find the lowest-numbered reg which is not used by a member
        * of the graph adjacent to us.
        */
       for (ri = 0; ri < g->regs->count; ri++) {
          r = (start_search_reg + ri) % g->regs->count;
-         if (!reg_belongs_to_class(r, c))
-	    continue;
-
-	 /* Check if any of our neighbors conflict with this register choice. */
-	 for (i = 0; i < g->nodes[n].adjacency_count; i++) {
-	    unsigned int n2 = g->nodes[n].adjacency_list[i];
-
-	    if (!g->nodes[n2].in_stack &&
-		BITSET_TEST(g->regs->regs[r].conflicts, g->nodes[n2].reg)) {
-	       break;
-	    }
-	 }
-	 if (i == g->nodes[n].adjacency_count)
+         if (reg_belongs_to_class(r, c) &&
+             !BITSET_TEST(g->reg_conflicts, r))
 	    break;
       }
 
@@ -640,30 +755,6 @@ ra_set_node_reg(struct ra_graph *g, unsigned int n, unsigned int reg)
    g->nodes[n].in_stack = false;
 }
 
-static float
-ra_get_spill_benefit(struct ra_graph *g, unsigned int n)
-{
-   unsigned int j;
-   float benefit = 0;
-   int n_class = g->nodes[n].class;
-
-   /* Define the benefit of eliminating an interference between n, n2
-    * through spilling as q(C, B) / p(C).  This is similar to the
-    * "count number of edges" approach of traditional graph coloring,
-    * but takes classes into account.
-    */
-   for (j = 0; j < g->nodes[n].adjacency_count; j++) {
-      unsigned int n2 = g->nodes[n].adjacency_list[j];
-      if (n != n2) {
-	 unsigned int n2_class = g->nodes[n2].class;
-	 benefit += ((float)g->regs->classes[n_class]->q[n2_class] /
-		     g->regs->classes[n_class]->p);
-      }
-   }
-
-   return benefit;
-}
-
 /**
  * Returns a node number to be spilled according to the cost/benefit using
  * the pq test, or -1 if there are no spillable nodes.
@@ -690,7 +781,7 @@ ra_get_best_spill_node(struct ra_graph *g)
       if (g->nodes[n].in_stack)
          continue;
 
-      benefit = ra_get_spill_benefit(g, n);
+      benefit = g->nodes[n].spill_benefit;
 
       if (benefit / cost > best_benefit) {
 	 best_benefit = benefit / cost;
@@ -0,0 +1,307 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/** @file register_allocate_test.c
+ *
+ * Checks and times the graph-coloring register allocator.
+ *
+ * Run without arguments, this allocates a set of pseudo-random
+ * interference graphs and checks that every coloring it gets back is
+ * valid.  Given file names, it replays the interference graphs dumped in
+ * them instead and reports how long allocation took.  The dump format is
+ * one command per line:
+ *
+ *    n <node count>
+ *    c <node> <class>
+ *    r <node> <forced reg>
+ *    e <node> <node>
+ *
+ * Graphs are allocated against a register set of 128 registers, with
+ * class 0 holding single registers and class 1 holding aligned pairs of
+ * them, which roughly mirrors what the backends set up.
+ */
+
+/* Force assertions, even on release builds. */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ralloc.h"
+#include "register_allocate.h"
+
+#define BASE_REGS 128
+#define PAIR_REGS (BASE_REGS / 2)
+
+static struct ra_regs *
+create_reg_set(void *mem_ctx)
+{
+   struct ra_regs *regs = ra_alloc_reg_set(mem_ctx, BASE_REGS + PAIR_REGS,
+                                           true);
+   unsigned single = ra_alloc_reg_class(regs);
+   unsigned pair = ra_alloc_reg_class(regs);
+   unsigned i;
+
+   for (i = 0; i < BASE_REGS; i++)
+      ra_class_add_reg(regs, single, i);
+
+   for (i = 0; i < PAIR_REGS; i++) {
+      ra_class_add_reg(regs, pair, BASE_REGS + i);
+      ra_add_reg_conflict(regs, BASE_REGS + i, 2 * i);
+      ra_add_reg_conflict(regs, BASE_REGS + i, 2 * i + 1);
+   }
+
+   ra_set_finalize(regs, NULL);
+
+   return regs;
+}
+
+struct test_edge {
+   unsigned a, b;
+};
+
+struct test_graph {
+   unsigned count;
+   unsigned *classes;
+   unsigned *forced;
+   struct test_edge *edges;
+   unsigned edge_count;
+   unsigned edge_size;
+};
+
+static void
+add_edge(struct test_graph *tg, unsigned a, unsigned b)
+{
+   if (tg->edge_count == tg->edge_size) {
+      tg->edge_size = tg->edge_size ? tg->edge_size * 2 : 64;
+      tg->edges = reralloc(tg, tg->edges, struct test_edge, tg->edge_size);
+   }
+   tg->edges[tg->edge_count].a = a;
+   tg->edges[tg->edge_count].b = b;
+   tg->edge_count++;
+}
+
+static void
+set_count(struct test_graph *tg, unsigned count)
+{
+   unsigned i;
+
+   tg->count = count;
+   tg->classes = rzalloc_array(tg, unsigned, count);
+   tg->forced = ralloc_array(tg, unsigned, count);
+   for (i = 0; i < count; i++)
+      tg->forced[i] = ~0u;
+}
+
+/**
+ * Builds an interval-like graph: each node lives for a random range of
+ * "instructions", and nodes interfere when their ranges overlap, which
+ * gives the same kind of structure as real liveness information.
+ */
+static struct test_graph *
+random_graph(unsigned count, unsigned max_live, unsigned seed)
+{
+   struct test_graph *tg = rzalloc(NULL, struct test_graph);
+   unsigned *start = ralloc_array(tg, unsigned, count);
+   unsigned *end = ralloc_array(tg, unsigned, count);
+   unsigned i, j;
+
+   srand(seed);
+   set_count(tg, count);
+
+   for (i = 0; i < count; i++) {
+      start[i] = i;
+      end[i] = i + 1 + rand() % max_live;
+      tg->classes[i] = (rand() % 4) == 0;
+   }
+
+   for (i = 0; i < count; i++) {
+      for (j = i + 1; j < count && start[j] < end[i]; j++)
+         add_edge(tg, i, j);
+   }
+
+   return tg;
+}
+
+static struct test_graph *
+read_graph(const char *filename)
+{
+   struct test_graph *tg;
+   char line[128];
+   FILE *f;
+
+   f = fopen(filename, "r");
+   if (!f) {
+      fprintf(stderr, "Failed to open %s\n", filename);
+      return NULL;
+   }
+
+   tg = rzalloc(NULL, struct test_graph);
+
+   while (fgets(line, sizeof(line), f)) {
+      unsigned a, b;
+
+      if (sscanf(line, "n %u", &a) == 1) {
+         set_count(tg, a);
+      } else if (sscanf(line, "c %u %u", &a, &b) == 2 && a < tg->count) {
+         tg->classes[a] = b;
+      } else if (sscanf(line, "r %u %u", &a, &b) == 2 && a < tg->count) {
+         tg->forced[a] = b;
+      } else if (sscanf(line, "e %u %u", &a, &b) == 2 &&
+                 a < tg->count && b < tg->count) {
+         add_edge(tg, a, b);
+      }
+   }
+
+   fclose(f);
+
+   return tg;
+}
+
+static bool
+regs_conflict(unsigned r1, unsigned r2)
+{
+   unsigned lo1 = r1 < BASE_REGS ? r1 : 2 * (r1 - BASE_REGS);
+   unsigned hi1 = r1 < BASE_REGS ? r1 : lo1 + 1;
+   unsigned lo2 = r2 < BASE_REGS ? r2 : 2 * (r2 - BASE_REGS);
+   unsigned hi2 = r2 < BASE_REGS ? r2 : lo2 + 1;
+
+   return lo1 <= hi2 && lo2 <= hi1;
+}
+
+static double
+get_time(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Allocates the graph, spilling the node picked by
+ * ra_get_best_spill_node() until allocation succeeds, the same way the
+ * backends do.  Returns the number of spills.
+ */
+static unsigned
+allocate_graph(struct ra_regs *regs, struct test_graph *tg, double *time)
+{
+   bool *spilled = rzalloc_array(tg, bool, tg->count);
+   unsigned spills = 0;
+   double start = get_time();
+
+   while (true) {
+      struct ra_graph *g = ra_alloc_interference_graph(regs, tg->count);
+      unsigned i;
+
+      for (i = 0; i < tg->count; i++) {
+         ra_set_node_class(g, i, tg->classes[i]);
+         if (tg->forced[i] != ~0u)
+            ra_set_node_reg(g, i, tg->forced[i]);
+         ra_set_node_spill_cost(g, i, spilled[i] ? 0.0f : 1.0f);
+      }
+
+      for (i = 0; i < tg->edge_count; i++) {
+         unsigned a = tg->edges[i].a, b = tg->edges[i].b;
+
+         /* A spilled node no longer interferes with anything. */
+         if (!spilled[a] && !spilled[b])
+            ra_add_node_interference(g, a, b);
+      }
+
+      if (ra_allocate(g)) {
+         *time = get_time() - start;
+
+         for (i = 0; i < tg->edge_count; i++) {
+            unsigned a = tg->edges[i].a, b = tg->edges[i].b;
+
+            if (spilled[a] || spilled[b])
+               continue;
+
+            assert(!regs_conflict(ra_get_node_reg(g, a),
+                                  ra_get_node_reg(g, b)));
+         }
+
+         ralloc_free(g);
+         return spills;
+      }
+
+      int n = ra_get_best_spill_node(g);
+      assert(n >= 0 && !spilled[n]);
+      spilled[n] = true;
+      spills++;
+
+      ralloc_free(g);
+   }
+}
+
+int
+main(int argc, char **argv)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   struct ra_regs *regs = create_reg_set(mem_ctx);
+   int i;
+
+   if (argc > 1) {
+      for (i = 1; i < argc; i++) {
+         struct test_graph *tg = read_graph(argv[i]);
+         unsigned spills;
+         double time;
+
+         if (!tg)
+            return 1;
+
+         spills = allocate_graph(regs, tg, &time);
+         printf("%s: %u nodes, %u edges, %u spills, %.3f ms\n",
+                argv[i], tg->count, tg->edge_count, spills, time * 1000.0);
+         ralloc_free(tg);
+      }
+   } else {
+      static const struct {
+         unsigned count;
+         unsigned max_live;
+      } tests[] = {
+         { 16, 4 },
+         { 1000, 40 },
+         { 1000, 200 },
+         { 10000, 60 },
+      };
+
+      for (i = 0; i < (int)(sizeof(tests) / sizeof(tests[0])); i++) {
+         struct test_graph *tg = random_graph(tests[i].count,
+                                              tests[i].max_live, i);
+         unsigned spills;
+         double time;
+
+         spills = allocate_graph(regs, tg, &time);
+         printf("random graph %d: %u nodes, %u edges, %u spills, %.3f ms\n",
+                i, tg->count, tg->edge_count, spills, time * 1000.0);
+         ralloc_free(tg);
+      }
+   }
+
+   ralloc_free(mem_ctx);
+
+   return 0;
+}
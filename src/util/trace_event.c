@@ -0,0 +1,189 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "c11/threads.h"
+#include "trace_event.h"
+
+#define TRACE_EVENT_RING_SIZE (1 << 16)
+
+struct trace_event {
+   int64_t time;
+   const char *name;
+   char phase;
+};
+
+struct trace_event_ring {
+   struct trace_event events[TRACE_EVENT_RING_SIZE];
+   uint64_t count;
+   unsigned tid;
+   struct trace_event_ring *next;
+};
+
+int trace_event_state = -1;
+
+static once_flag trace_event_once = ONCE_FLAG_INIT;
+static tss_t trace_event_tss;
+static int64_t trace_event_start;
+static const char *trace_event_path;
+
+/* Protects the list of rings.  Each ring is only written by its own
+ * thread.
+ */
+static mtx_t trace_event_mutex = _MTX_INITIALIZER_NP;
+static struct trace_event_ring *trace_event_rings;
+static unsigned trace_event_num_threads;
+
+static int64_t
+get_time(void)
+{
+#ifdef _WIN32
+   LARGE_INTEGER frequency, counter;
+   QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+   return counter.QuadPart * INT64_C(1000000000) / frequency.QuadPart;
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+#endif
+}
+
+static void
+trace_event_dump(void)
+{
+   struct trace_event_ring *ring;
+   const char *separator = "";
+   unsigned pid;
+   FILE *fp;
+
+   fp = fopen(trace_event_path, "w");
+   if (fp == NULL) {
+      fprintf(stderr, "Mesa: failed to open %s for writing trace events\n",
+              trace_event_path);
+      return;
+   }
+
+#ifdef _WIN32
+   pid = GetCurrentProcessId();
+#else
+   pid = getpid();
+#endif
+
+   mtx_lock(&trace_event_mutex);
+
+   fprintf(fp, "{\"traceEvents\":[");
+   for (ring = trace_event_rings; ring; ring = ring->next) {
+      uint64_t first = ring->count > TRACE_EVENT_RING_SIZE ?
+                       ring->count - TRACE_EVENT_RING_SIZE : 0;
+
+      for (uint64_t i = first; i < ring->count; i++) {
+         const struct trace_event *event =
+            &ring->events[i % TRACE_EVENT_RING_SIZE];
+         int64_t time = event->time - trace_event_start;
+
+         fprintf(fp, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":%u,"
+                 "\"tid\":%u,\"ts\":%" PRId64 ".%03u}",
+                 separator, event->name, event->phase, pid, ring->tid,
+                 time / 1000, (unsigned) (time % 1000));
+         separator = ",";
+      }
+   }
+   fprintf(fp, "\n]}\n");
+
+   mtx_unlock(&trace_event_mutex);
+
+   fclose(fp);
+}
+
+static void
+trace_event_init(void)
+{
+   trace_event_path = getenv("MESA_TRACE_EVENTS");
+   if (trace_event_path == NULL || trace_event_path[0] == '\0' ||
+       tss_create(&trace_event_tss, NULL) != thrd_success) {
+      trace_event_state = 0;
+      return;
+   }
+
+   trace_event_start = get_time();
+   atexit(trace_event_dump);
+   trace_event_state = 1;
+}
+
+static struct trace_event_ring *
+trace_event_get_ring(void)
+{
+   struct trace_event_ring *ring = tss_get(trace_event_tss);
+   if (ring)
+      return ring;
+
+   /* Rings are never freed, so that events from threads that have exited
+    * still get written out.
+    */
+   ring = calloc(1, sizeof(*ring));
+   if (ring == NULL)
+      return NULL;
+
+   mtx_lock(&trace_event_mutex);
+   ring->tid = ++trace_event_num_threads;
+   ring->next = trace_event_rings;
+   trace_event_rings = ring;
+   mtx_unlock(&trace_event_mutex);
+
+   tss_set(trace_event_tss, ring);
+   return ring;
+}
+
+void
+_trace_event_record(const char *name, char phase)
+{
+   struct trace_event_ring *ring;
+   struct trace_event *event;
+
+   if (trace_event_state < 0) {
+      call_once(&trace_event_once, trace_event_init);
+      if (trace_event_state == 0)
+         return;
+   }
+
+   ring = trace_event_get_ring();
+   if (ring == NULL)
+      return;
+
+   event = &ring->events[ring->count % TRACE_EVENT_RING_SIZE];
+   event->time = get_time();
+   event->name = name;
+   event->phase = phase;
+   ring->count++;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright © 2016 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file trace_event.h
+ *
+ * Timeline tracing of where the CPU time of a frame goes.
+ *
+ * When MESA_TRACE_EVENTS is set to a file name, trace_event_begin() and
+ * trace_event_end() record timestamped events into a per-thread ring
+ * buffer, and at exit all of them are written to that file in the Chrome
+ * trace event format, which chrome://tracing and Perfetto can load.  Each
+ * ring only keeps the most recent events.
+ *
+ * When tracing is disabled, each call is a load and a predicted branch.
+ */
+
+#ifndef TRACE_EVENT_H
+#define TRACE_EVENT_H
+
+#include "macros.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** -1 until the environment has been checked, then whether tracing is on. */
+extern int trace_event_state;
+
+/**
+ * Records an event.  \p name must stay valid until exit, which string
+ * literals do, and \p phase is 'B' for begin or 'E' for end.
+ */
+void _trace_event_record(const char *name, char phase);
+
+static inline void
+trace_event_begin(const char *name)
+{
+   if (unlikely(trace_event_state != 0))
+      _trace_event_record(name, 'B');
+}
+
+static inline void
+trace_event_end(const char *name)
+{
+   if (unlikely(trace_event_state != 0))
+      _trace_event_record(name, 'E');
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TRACE_EVENT_H */